@@ -0,0 +1,151 @@
+#!/usr/bin/perl -s
+#*************************************************************************
+#
+#   Program:    benchmark
+#   File:       benchmark.pl
+#
+#   Version:    V1.0
+#   Date:       17.10.26
+#   Function:   Run chibench, chisq and chisq3 over a grid of synthetic
+#               tables
+#
+#   Copyright:  (c) Dr. Andrew C. R. Martin 2026
+#   Author:     Dr. Andrew C. R. Martin
+#   Address:    Biomolecular Structure & Modelling Unit,
+#               Department of Biochemistry & Molecular Biology,
+#               University College,
+#               Gower Street,
+#               London.
+#               WC1E 6BT.
+#   EMail:      INTERNET: martin@biochem.ucl.ac.uk
+#
+#*************************************************************************
+#
+#   This program is not in the public domain, but it may be copied
+#   according to the conditions laid out in the accompanying file
+#   COPYING.DOC
+#
+#   The code may be modified as required, but any modifications must be
+#   documented so that the person responsible can be identified. If
+#   someone else breaks this code, I don't want to be blamed for code
+#   that does not work!
+#
+#   The code may not be sold commercially or included as part of a
+#   commercial product except as described in the file COPYING.DOC.
+#
+#*************************************************************************
+#
+#   Description:
+#   ============
+#   Runs chibench for every combination of category count, sparsity,
+#   label length and number of input lines, for both two-way (chisq) and
+#   three-way (chisq3) tables. The category counts go up to and beyond
+#   the old fixed limits (MAXITEM was 2000 in chisq and 100 in chisq3).
+#
+#   chibench times ingestion and computation separately in one process.
+#   The same input is also written to a file and the real chisq or
+#   chisq3 is timed on it from start to finish (end_to_end_s).
+#
+#   Results are appended, as TSV, to the output file together with the
+#   version of chisq and the date, so runs of different versions can be
+#   compared to spot regressions. The header is only written to a new
+#   file.
+#
+#*************************************************************************
+#
+#   Usage:
+#   ======
+#   benchmark [-quick] [-bin=dir] [-out=file]
+#   -quick Run a small grid only
+#   -bin   Directory holding chibench, chisq and chisq3 (default .)
+#   -out   File to append the results to (default bench.tsv)
+#
+#*************************************************************************
+#
+#   Revision History:
+#   =================
+#   V1.0  17.10.26   Original   By: ACRM
+#
+#*************************************************************************
+use strict;
+use Time::HiRes qw(time);
+use POSIX qw(strftime);
+
+my $bin     = defined($::bin) ? $::bin : ".";
+my $outFile = defined($::out) ? $::out : "bench.tsv";
+my $tmpFile = "/tmp/chibench.$$.dat";
+
+my %categories = (chisq  => [10, 100, 2000, 5000],
+                  chisq3 => [5, 30, 100, 150]);
+my @sparsities = (0, 0.9, 0.99);
+my @labels     = (8, 32);
+my @lines      = (10000, 1000000);
+
+if(defined($::quick))
+{
+    %categories = (chisq  => [10, 100],
+                   chisq3 => [5, 30]);
+    @sparsities = (0, 0.9);
+    @labels     = (8);
+    @lines      = (10000);
+}
+
+my $version = GetVersion("$bin/chisq");
+my $date    = strftime("%Y-%m-%d", localtime);
+my $newFile = (! -e $outFile);
+
+open(my $out, '>>', $outFile) || die "Can't write $outFile";
+if($newFile)
+{
+    my $header = `$bin/chibench -H`;
+    chomp $header;
+    print $out "version\tdate\t$header\tend_to_end_s\n";
+}
+
+foreach my $program ("chisq", "chisq3")
+{
+    my $flag = (($program eq "chisq3") ? "-3" : "");
+
+    foreach my $nCategories (@{$categories{$program}})
+    {
+        foreach my $sparsity (@sparsities)
+        {
+            foreach my $label (@labels)
+            {
+                foreach my $nLines (@lines)
+                {
+                    my $args = "$flag -n $nCategories -s $sparsity " .
+                               "-l $label -r $nLines";
+                    my $result = `$bin/chibench $args`;
+                    die "chibench $args failed" if($?);
+                    chomp $result;
+
+                    system("$bin/chibench $args -w $tmpFile") == 0 ||
+                        die "chibench $args -w failed";
+                    my $start = time();
+                    system("$bin/$program $tmpFile >/dev/null 2>&1");
+                    my $elapsed = time() - $start;
+                    unlink $tmpFile;
+
+                    printf $out "%s\t%s\t%s\t%.6g\n",
+                                $version, $date, $result, $elapsed;
+                    print STDERR "$program $args\n";
+                }
+            }
+        }
+    }
+}
+
+close $out;
+
+#*************************************************************************
+# Gets the version of chisq from the first line of its usage message
+#
+# 17.10.26 Original   By: ACRM
+sub GetVersion
+{
+    my ($program) = @_;
+    my $usage = `$program -h 2>&1`;
+
+    return(($usage =~ /V(\d+\.\d+)/) ? $1 : "unknown");
+}
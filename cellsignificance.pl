@@ -36,12 +36,18 @@
 #
 #   Description:
 #   ============
+#   Tests each cell of a contingency table for significance by comparing
+#   it with the rest of the table as a 2x2 table.
+#
+#   This is now done natively by chisq -c which does the whole table in
+#   one pass. This script is kept as a wrapper so existing pipelines
+#   still work.
 #
 #*************************************************************************
 #
 #   Usage:
 #   ======
-#   cellsignificance [-nobf] [-low] file.chi 
+#   cellsignificance [-nobf] [-low] [file.chi ...]
 #   -nobf Don't do Bonferroni correction
 #   -low  Allow significance to be indicated for cells with low expected
 #         values
@@ -51,119 +57,32 @@
 #   Revision History:
 #   =================
 #   V1.0  01.03.11   By: ACRM
+#   V2.0  17.10.26   Now just runs chisq -c. This also fixes the count
+#                    used for the cell outside both the row and column
+#                    which was the total minus the cell rather than the
+#                    total minus the row and column totals plus the cell
+#   V2.1  17.10.26   Several files are read as one table again rather
+#                    than the second being given to chisq as its output
 #
 #*************************************************************************
 use strict;
-my %data;
-my %rows;
-my %cols;
-my %rowTotal;
-my %colTotal;
-my $lowOK;
-
-my $tfile = "/tmp/cellsig_$$.chi";
-my $threshold = 0.05;
-
-# Read  the data file
-my $totalObs = 0;
-while(<>)
-{
-    chomp;
-    s/^\s+//;
-    if(length)
-    {
-        my @line = split;
-        $data{$line[0]}{$line[1]} = $line[2];
-        $totalObs += $line[2];
 
-        $rows{$line[0]} = 1;
-        $cols{$line[1]} = 1;
-    }
-}
+my @args = ("chisq", "-c");
+push @args, "-n" if(defined($::nobf));
+push @args, "-l" if(defined($::low));
 
-# Count totals for the rows
-foreach my $row (keys %rows)
+# chisq takes a single input file, and a second file name would be
+# its output, so more than one file is concatenated into its stdin
+# as they were read by the old script
+if(@ARGV <= 1)
 {
-    $rowTotal{$row} = 0;
-    foreach my $col (keys %cols)
-    {
-        $rowTotal{$row} += $data{$row}{$col};
-    }
+    exec(@args, @ARGV) || die "Can't run chisq";
 }
 
-# Count totals for the columns
-foreach my $col (keys %cols)
-{
-    $colTotal{$col} = 0;
-    foreach my $row (keys %rows)
-    {
-        $colTotal{$col} += $data{$row}{$col};
-    }
-}
-
-# Bonferonni correction - set to 1 if -nobf used on command line
-my $Bonferroni = (defined($::nobf))?1:((keys %rows) * (keys %cols));
-
-# Run the analysis for each cell
-foreach my $row (sort keys %rows)
+open(my $chisq, '|-', @args) || die "Can't run chisq";
+while(<>)
 {
-    foreach my $col (sort keys %cols)
-    {
-        # Create a file for running the chisq program and run it
-        my $cell = $data{$row}{$col};
-        open(TMP, ">$tfile") || die "Can't write $tfile";
-        print TMP "$row $col $cell\n";
-        printf TMP "$row X$col %d\n", $rowTotal{$row} - $cell;
-        printf TMP "X$row $col %d\n", $colTotal{$col} - $cell; 
-        printf TMP "X$row X$col %d\n", $totalObs - $cell;
-        close TMP;
-        my $result = `chisq -d -y $tfile`;
-
-        # Extract the significance results
-        $result =~ s/\n/ /g;
-        $result =~ /=\s+(.*)\s+with\s+(\d+)\s+degrees/;
-        my $chi=$1;
-        print "$row $col Chi=$chi ";
-        $result =~ /$row\,\s+$col\:\s+Obs\s+(.*?)\s+Exp\s+(.*?)\s+/;
-        my $obs = $1;
-        my $exp = $2;
-        print " [$obs $exp] ";
-
-        printf "%s ", (($obs>$exp)?"over":"under");
-
-        # Extract expected values and check they are OK
-        if(!defined($::low))
-        {
-            $result =~ /.*Exp\s+(\d+\.\d).*Exp\s+(\d+\.\d).*Exp\s+(\d+\.\d).*Exp\s+(\d+\.\d)/;
-            if(($1 >= 5) && ($2 >= 5) && ($3 >= 5) && ($4 >= 5))
-            {
-                $lowOK = 1;
-            }
-            else
-            {
-                $lowOK = 0;
-            }
-        }
-
-
-        # Run the chisig program to get the p-value
-        $result = `chisig $chi 1`;
-        $result =~ /the\s+(.*)\s+level/;
-        my $pvalue = $1;
-
-        # Apply Bonferroni correction
-        $pvalue *= $Bonferroni;
-
-        # Print significance
-        if($pvalue<$threshold)
-        {
-            if(defined($::low) || $lowOK)
-            {
-                printf "SIGNIFICANT (p=%.5g)", $pvalue, (($Bonferroni==1)?"":" - BF corrected");
-            }
-        }
-        print "\n";
-
-        unlink $tfile;
-    }
+    print $chisq $_;
 }
+close($chisq);
+exit($? >> 8);
@@ -0,0 +1,689 @@
+/*************************************************************************
+
+   Program:    chibench
+   File:       chibench.c
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Benchmark libchisq on synthetic tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Generates the input for a synthetic two- or three-way table in memory,
+   in the format read by chisq or chisq3, then times reading it into a
+   table (ingestion) and calculating chi squared (computation)
+   separately. One result line is printed with the throughput and the
+   peak resident set size, so each run should be a new process.
+   benchmark.pl runs this over a grid of table shapes.
+
+   The table has n categories in each dimension. A fixed fraction of the
+   cells (the sparsity) never have a count and each input line sets one
+   of the others, chosen at random, to a count from 1 to 9. Labels are
+   padded to the requested length. The same seed gives the same input.
+
+   With -p it instead checks the p-values from ChiSqProb() against a file
+   of known values (a chi squared value, degrees of freedom and p-value
+   on each line, such as test/test_chiprob.dat), which is run by make
+   check.
+
+**************************************************************************
+
+   Usage:
+   ======
+   chibench [-3] [-n n] [-s sparsity] [-l length] [-r lines] [-S seed]
+            [-o tsv|json] [-w file]
+   chibench -H
+   chibench -p file
+
+**************************************************************************
+
+   Notes:
+   ======
+   Computation is repeated until it has taken at least MINTIME seconds
+   and the mean is reported.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Only 1 from ContabParseLine() is success as it may
+                  now return -1
+   V1.2  17.10.26 Added -p to check p-values against known values
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <sys/resource.h>
+
+#include "contab.h"
+#include "chiprob.h"
+#include "lineread.h"
+#include "results.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MINTIME     0.2           /* Least time spent on computation    */
+#define MAXSPARSITY 0.999         /* Most cells that may be empty       */
+#define MAXLABEL    1000          /* Longest label                      */
+#define LINEEXTRA   16            /* Line space beyond the labels       */
+#define DEFSEED     12345UL       /* Default random number seed         */
+#define PTOLERANCE  1.0e-6        /* Relative error allowed with -p     */
+#define MAXPLINE    256           /* Longest line in the -p file        */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   int    threeWay,               /* -3 Three-way table (chisq3)        */
+          nCategories,            /* -n Categories in each dimension    */
+          labelLength,            /* -l Length of each label            */
+          format;                 /* -o OUTPUT_TSV or OUTPUT_JSON       */
+   long   nLines;                 /* -r Lines of input                  */
+   double sparsity;               /* -s Fraction of cells left empty    */
+   unsigned long seed;            /* -S Random number seed              */
+   char   *writeFile,             /* -w Write the input here instead    */
+          *probFile;              /* -p Check p-values in this file     */
+}  BENCHOPTS;
+
+typedef struct
+{
+   double ingest,                 /* Seconds to read the input          */
+          compute,                /* Seconds for one chi squared        */
+          chisq;                  /* Chi squared (to check runs agree)  */
+   long   nCells,                 /* Cells in the table                 */
+          maxRSS;                 /* Peak resident set size (KB)        */
+   int    nComputes,              /* Times chi squared was calculated   */
+          dof;
+}  TIMINGS;
+
+/************************************************************************/
+/* Prototypes
+*/
+int    main(int argc, char **argv);
+int    ParseCmdLine(int argc, char **argv, BENCHOPTS *opts,
+                    int *header);
+char   *MakeInput(BENCHOPTS *opts, size_t *length);
+int    Bench2(char *input, size_t length, TIMINGS *timings);
+int    Bench3(char *input, size_t length, TIMINGS *timings);
+int    CheckProbs(char *file);
+void   PrintHeader(void);
+void   PrintTimings(BENCHOPTS *opts, size_t length, TIMINGS *timings);
+double Now(void);
+unsigned long NextRandom(unsigned long *state);
+void   Usage(void);
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program for benchmarking libchisq
+
+   17.10.26 Original    By: ACRM
+*/
+int main(int argc, char **argv)
+{
+   BENCHOPTS     opts;
+   TIMINGS       timings;
+   struct rusage usage;
+   FILE          *fp;
+   char          *input;
+   size_t        length;
+   int           header,
+                 ok;
+
+   if(!ParseCmdLine(argc, argv, &opts, &header))
+   {
+      Usage();
+      return(1);
+   }
+   if(header)
+   {
+      PrintHeader();
+      return(0);
+   }
+   if(opts.probFile != NULL)
+      return(CheckProbs(opts.probFile) ? 0 : 1);
+
+   if((input = MakeInput(&opts, &length)) == NULL)
+   {
+      fprintf(stderr,"No memory for input\n");
+      return(1);
+   }
+
+   if(opts.writeFile != NULL)
+   {
+      if(((fp = fopen(opts.writeFile, "w")) == NULL) ||
+         (fwrite(input, 1, length, fp) != length) ||
+         fclose(fp))
+      {
+         fprintf(stderr,"Unable to write %s\n", opts.writeFile);
+         free(input);
+         return(1);
+      }
+      free(input);
+      return(0);
+   }
+
+   ok = (opts.threeWay ? Bench3(input, length, &timings) :
+                         Bench2(input, length, &timings));
+   free(input);
+   if(!ok)
+   {
+      fprintf(stderr,"No memory for table\n");
+      return(1);
+   }
+
+   getrusage(RUSAGE_SELF, &usage);
+   timings.maxRSS = (long)usage.ru_maxrss;
+   PrintTimings(&opts, length, &timings);
+
+   return(0);
+}
+
+/************************************************************************/
+/*>char *MakeInput(BENCHOPTS *opts, size_t *length)
+   ------------------------------------------------
+   Input:   BENCHOPTS *opts   What to generate
+   Output:  size_t    *length Length of the input
+   Returns: char *            Malloc'd input (NULL if no memory)
+
+   Generates the input lines. A cell is left empty if a hash of its
+   index falls below the sparsity, so the empty cells do not depend on
+   the number of lines.
+
+   17.10.26 Original    By: ACRM
+*/
+char *MakeInput(BENCHOPTS *opts, size_t *length)
+{
+   unsigned long state     = opts->seed,
+                 threshold = (unsigned long)(opts->sparsity *
+                                             4294967295.0),
+                 hash;
+   int           nDims     = (opts->threeWay ? 3 : 2),
+                 item[3],
+                 d, n;
+   long          line,
+                 cell;
+   size_t        lineSize  = (size_t)nDims * (opts->labelLength + 1) +
+                             LINEEXTRA;
+   char          *input, *pos;
+
+   if((input = (char *)malloc(lineSize * opts->nLines + 1)) == NULL)
+      return(NULL);
+
+   pos = input;
+   for(line=0; line<opts->nLines; line++)
+   {
+      /* Choose a cell that is not to be left empty                     */
+      do
+      {
+         for(d=0, cell=0; d<nDims; d++)
+         {
+            item[d] = (int)(NextRandom(&state) % opts->nCategories);
+            cell    = cell * opts->nCategories + item[d];
+         }
+         hash = (unsigned long)cell ^ opts->seed;
+         hash = NextRandom(&hash);
+      }  while(hash < threshold);
+
+      for(d=0; d<nDims; d++)
+      {
+         n = sprintf(pos, "%c%d", 'a' + d, item[d]);
+         for(; n<opts->labelLength; n++)
+            pos[n] = 'x';
+         pos[n] = ' ';
+         pos   += n + 1;
+      }
+      pos += sprintf(pos, "%d\n", 1 + (int)(NextRandom(&state) % 9));
+   }
+
+   *length = (size_t)(pos - input);
+   return(input);
+}
+
+/************************************************************************/
+/*>int Bench2(char *input, size_t length, TIMINGS *timings)
+   ---------------------------------------------------------
+   Input:   char      *input   Input lines
+            size_t    length   Length of the input
+   Output:  TIMINGS   *timings Times taken
+   Returns: int                Success?
+
+   Reads the input into a CONTAB as chisq does and times chi squared
+   with expecteds from the margins
+
+   17.10.26 Original    By: ACRM
+*/
+int Bench2(char *input, size_t length, TIMINGS *timings)
+{
+   CONTAB     *ct;
+   LINEREADER *reader;
+   CHIRESULT  result;
+   char       *line;
+   size_t     lineLength;
+   double     start;
+   int        ok = 1;
+
+   if((ct = CreateContab(0)) == NULL)
+      return(0);
+   if((reader = OpenTextReader(input, length)) == NULL)
+   {
+      FreeContab(ct);
+      return(0);
+   }
+
+   start = Now();
+   while(ok && ((line = ReadLine(reader, &lineLength)) != NULL))
+      ok = (ContabParseLine(ct, line, lineLength) == 1);
+   timings->ingest = Now() - start;
+   CloseLineReader(reader);
+
+   if(ok)
+   {
+      timings->nComputes = 0;
+      start = Now();
+      do
+      {
+         ContabChiSq(ct, CHIEXP_MARGINS, 0, 0, &result);
+         timings->nComputes++;
+      }  while((timings->compute = Now() - start) < MINTIME);
+      timings->compute /= timings->nComputes;
+
+      timings->chisq  = result.chisq;
+      timings->dof    = result.dof;
+      timings->nCells = (long)ct->nItem1 * (long)ct->nItem2;
+   }
+
+   FreeContab(ct);
+   return(ok);
+}
+
+/************************************************************************/
+/*>int Bench3(char *input, size_t length, TIMINGS *timings)
+   ---------------------------------------------------------
+   Input:   char      *input   Input lines
+            size_t    length   Length of the input
+   Output:  TIMINGS   *timings Times taken
+   Returns: int                Success?
+
+   Reads the input into a CONTAB3 as chisq3 does and times chi squared
+   for mutual independence
+
+   17.10.26 Original    By: ACRM
+*/
+int Bench3(char *input, size_t length, TIMINGS *timings)
+{
+   CONTAB3    *ct;
+   LINEREADER *reader;
+   CHIRESULT  result;
+   char       *line;
+   size_t     lineLength;
+   double     start;
+   int        ok = 1;
+
+   if((ct = CreateContab3(0)) == NULL)
+      return(0);
+   if((reader = OpenTextReader(input, length)) == NULL)
+   {
+      FreeContab3(ct);
+      return(0);
+   }
+
+   start = Now();
+   while(ok && ((line = ReadLine(reader, &lineLength)) != NULL))
+      ok = (Contab3ParseLine(ct, line, lineLength) == 1);
+   timings->ingest = Now() - start;
+   CloseLineReader(reader);
+
+   if(ok)
+   {
+      timings->nComputes = 0;
+      start = Now();
+      do
+      {
+         Contab3ChiSq(ct, 0, &result);
+         timings->nComputes++;
+      }  while((timings->compute = Now() - start) < MINTIME);
+      timings->compute /= timings->nComputes;
+
+      timings->chisq  = result.chisq;
+      timings->dof    = result.dof;
+      timings->nCells = (long)ct->nItems[0] * (long)ct->nItems[1] *
+                        (long)ct->nItems[2];
+   }
+
+   FreeContab3(ct);
+   return(ok);
+}
+
+/************************************************************************/
+/*>int CheckProbs(char *file)
+   --------------------------
+   Input:   char   *file      File of chi squared, dof and known p-value
+   Returns: int               All p-values agree?
+
+   Prints each value that differs from the known p-value by more than
+   PTOLERANCE relative to it, and the number checked
+
+   17.10.26 Original    By: ACRM
+*/
+int CheckProbs(char *file)
+{
+   FILE   *fp;
+   char   buffer[MAXPLINE];
+   double chisq, known, p;
+   int    dof,
+          nChecked = 0,
+          nBad     = 0;
+
+   if((fp = fopen(file, "r")) == NULL)
+   {
+      fprintf(stderr,"Unable to read %s\n", file);
+      return(0);
+   }
+
+   while(fgets(buffer, MAXPLINE, fp))
+   {
+      if(sscanf(buffer, "%lf %d %lf", &chisq, &dof, &known) != 3)
+         continue;
+      p = ChiSqProb(chisq, dof);
+      nChecked++;
+      if(fabs(p - known) > PTOLERANCE * known)
+      {
+         printf("ChiSq = %.10g with %d degrees of freedom: p = %.10g, \
+expected %.10g\n", chisq, dof, p, known);
+         nBad++;
+      }
+   }
+   fclose(fp);
+
+   printf("%d p-values checked, %d wrong\n", nChecked, nBad);
+   return((nChecked > 0) && (nBad == 0));
+}
+
+/************************************************************************/
+/*>void PrintHeader(void)
+   ----------------------
+   Prints the column headings for TSV output
+
+   17.10.26 Original    By: ACRM
+*/
+void PrintHeader(void)
+{
+   printf("program\tcategories\tsparsity\tlabel_length\tlines\tbytes\t\
+cells\tingest_s\tcompute_s\tlines_per_s\tcells_per_s\tmax_rss_kb\t\
+chisq\tdof\n");
+}
+
+/************************************************************************/
+/*>void PrintTimings(BENCHOPTS *opts, size_t length, TIMINGS *timings)
+   -------------------------------------------------------------------
+   Input:   BENCHOPTS *opts    Options
+            size_t    length   Length of the input
+            TIMINGS   *timings Times taken
+
+   Prints one line of TSV or a JSON object. Ingestion throughput is in
+   lines per second and computation throughput in cells of the table
+   per second.
+
+   17.10.26 Original    By: ACRM
+*/
+void PrintTimings(BENCHOPTS *opts, size_t length, TIMINGS *timings)
+{
+   const char *program = (opts->threeWay ? "chisq3" : "chisq");
+   double     linesPerSec, cellsPerSec;
+
+   linesPerSec = ((timings->ingest > 0.0) ?
+                  (double)opts->nLines / timings->ingest : 0.0);
+   cellsPerSec = ((timings->compute > 0.0) ?
+                  (double)timings->nCells / timings->compute : 0.0);
+
+   if(opts->format == OUTPUT_JSON)
+   {
+      printf("{\"program\": \"%s\", \"categories\": %d, \"sparsity\": %g, \
+\"label_length\": %d, \"lines\": %ld, \"bytes\": %lu, \"cells\": %ld, \
+\"ingest_s\": %.6g, \"compute_s\": %.6g, \"lines_per_s\": %.6g, \
+\"cells_per_s\": %.6g, \"max_rss_kb\": %ld, \"chisq\": %.10g, \
+\"dof\": %d}\n",
+             program, opts->nCategories, opts->sparsity,
+             opts->labelLength, opts->nLines, (unsigned long)length,
+             timings->nCells, timings->ingest, timings->compute,
+             linesPerSec, cellsPerSec, timings->maxRSS, timings->chisq,
+             timings->dof);
+   }
+   else
+   {
+      printf("%s\t%d\t%g\t%d\t%ld\t%lu\t%ld\t%.6g\t%.6g\t%.6g\t%.6g\t\
+%ld\t%.10g\t%d\n",
+             program, opts->nCategories, opts->sparsity,
+             opts->labelLength, opts->nLines, (unsigned long)length,
+             timings->nCells, timings->ingest, timings->compute,
+             linesPerSec, cellsPerSec, timings->maxRSS, timings->chisq,
+             timings->dof);
+   }
+}
+
+/************************************************************************/
+/*>double Now(void)
+   ----------------
+   Returns: double           Time in seconds from an arbitrary start
+
+   17.10.26 Original    By: ACRM
+*/
+double Now(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return((double)now.tv_sec + (double)now.tv_nsec / 1.0e9);
+}
+
+/************************************************************************/
+/*>unsigned long NextRandom(unsigned long *state)
+   ----------------------------------------------
+   I/O:     unsigned long *state  Generator state
+   Returns: unsigned long         32-bit random number
+
+   The lowbias32 hash of an incrementing counter. This is quick, has no
+   poor low bits and gives the same sequence whatever the size of a
+   long.
+
+   17.10.26 Original    By: ACRM
+*/
+unsigned long NextRandom(unsigned long *state)
+{
+   unsigned long x;
+
+   *state = (*state + 0x9e3779b9UL) & 0xffffffffUL;
+   x  = *state;
+   x ^= x >> 16;
+   x  = (x * 0x7feb352dUL) & 0xffffffffUL;
+   x ^= x >> 15;
+   x  = (x * 0x846ca68bUL) & 0xffffffffUL;
+   x ^= x >> 16;
+   return(x);
+}
+
+/************************************************************************/
+/*>int ParseCmdLine(int argc, char **argv, BENCHOPTS *opts, int *header)
+   ---------------------------------------------------------------------
+   Input:   int       argc    Argument count
+            char      **argv  Argument array
+   Output:  BENCHOPTS *opts   Options
+            int       *header Just print the TSV header
+   Returns: int               Success?
+
+   Parse the command line
+
+   17.10.26 Original    By: ACRM
+*/
+int ParseCmdLine(int argc, char **argv, BENCHOPTS *opts, int *header)
+{
+   int digits, n;
+
+   opts->threeWay    = 0;
+   opts->nCategories = 100;
+   opts->labelLength = 8;
+   opts->format      = OUTPUT_TSV;
+   opts->nLines      = 100000L;
+   opts->sparsity    = 0.0;
+   opts->seed        = DEFSEED;
+   opts->writeFile   = NULL;
+   opts->probFile    = NULL;
+   *header           = 0;
+
+   argc--;
+   argv++;
+
+   while(argc)
+   {
+      if((argv[0][0] != '-') || (argv[0][1] == '\0') ||
+         (argv[0][2] != '\0'))
+         return(0);
+
+      switch(argv[0][1])
+      {
+      case '3':
+         opts->threeWay = 1;
+         break;
+      case 'H':
+         *header = 1;
+         break;
+      case 'n':
+         if((argc < 2) || !sscanf(argv[1], "%d", &(opts->nCategories)) ||
+            (opts->nCategories < 1))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 's':
+         if((argc < 2) || !sscanf(argv[1], "%lf", &(opts->sparsity)) ||
+            (opts->sparsity < 0.0) || (opts->sparsity > MAXSPARSITY))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 'l':
+         if((argc < 2) || !sscanf(argv[1], "%d", &(opts->labelLength)) ||
+            (opts->labelLength < 1) || (opts->labelLength > MAXLABEL))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 'r':
+         if((argc < 2) || !sscanf(argv[1], "%ld", &(opts->nLines)) ||
+            (opts->nLines < 1))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 'S':
+         if((argc < 2) || !sscanf(argv[1], "%lu", &(opts->seed)))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 'o':
+         if((argc < 2) ||
+            ((opts->format = ParseOutputFormat(argv[1])) < 0) ||
+            (opts->format == OUTPUT_TEXT))
+            return(0);
+         argc--;
+         argv++;
+         break;
+      case 'w':
+         if(argc < 2)
+            return(0);
+         opts->writeFile = argv[1];
+         argc--;
+         argv++;
+         break;
+      case 'p':
+         if(argc < 2)
+            return(0);
+         opts->probFile = argv[1];
+         argc--;
+         argv++;
+         break;
+      default:
+         return(0);
+      }
+      argc--;
+      argv++;
+   }
+
+   /* Labels must have room for the dimension letter and item number    */
+   for(digits=1, n=opts->nCategories-1; n>=10; n/=10)
+      digits++;
+   return(opts->labelLength > digits);
+}
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Prints a usage message
+
+   17.10.26 Original    By: ACRM
+*/
+void Usage(void)
+{
+   fprintf(stderr,"ChiBench V1.2 (c) 2026 Andrew C.R. Martin, UCL\n");
+   fprintf(stderr,"Usage: chibench [-3] [-n n] [-s sparsity] [-l length] \
+[-r lines] [-S seed]\n");
+   fprintf(stderr,"                [-o tsv|json] [-w file]\n");
+   fprintf(stderr,"       chibench -H\n");
+   fprintf(stderr,"       chibench -p file\n");
+   fprintf(stderr,"       -3 Three-way table as read by chisq3 (default \
+two-way as chisq)\n");
+   fprintf(stderr,"       -n Categories in each dimension (default 100)\n");
+   fprintf(stderr,"       -s Fraction of cells that are empty (default 0, \
+at most %g)\n", MAXSPARSITY);
+   fprintf(stderr,"       -l Length of each label (default 8)\n");
+   fprintf(stderr,"       -r Lines of input (default 100000)\n");
+   fprintf(stderr,"       -S Random number seed (default %lu)\n", DEFSEED);
+   fprintf(stderr,"       -o Output format (default tsv)\n");
+   fprintf(stderr,"       -w Just write the input to a file (to time \
+chisq or chisq3 on it)\n");
+   fprintf(stderr,"       -H Just print the TSV column headings\n");
+   fprintf(stderr,"       -p Just check p-values against the known \
+ones in a file\n");
+   fprintf(stderr,"          (chi squared, dof and p on each line)\n\n");
+   fprintf(stderr,"Generates the input for a synthetic table, then times \
+reading it into\n");
+   fprintf(stderr,"a table and calculating chi squared separately. One \
+line is printed\n");
+   fprintf(stderr,"with ingestion throughput (lines/s), computation \
+throughput (cells/s)\n");
+   fprintf(stderr,"and the peak resident set size, so run each benchmark \
+as a new process.\n");
+   fprintf(stderr,"See benchmark.pl to run a grid of benchmarks.\n\n");
+}
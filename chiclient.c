@@ -0,0 +1,325 @@
+/*************************************************************************
+
+   Program:    chiclient
+   File:       chiclient.c
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Send tables to a chisq server
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Sends each input file (or standard input) as one request to a server
+   started with chisq --serve and prints the answers. All the requests
+   go over a single connection.
+
+**************************************************************************
+
+   Usage:
+   ======
+   chiclient [-r n] socket [file ...]
+
+**************************************************************************
+
+   Notes:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chiframe.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXRESPONSE (64L * 1024L * 1024L)
+
+/************************************************************************/
+/* Prototypes
+*/
+int  main(int argc, char **argv);
+int  Connect(char *socketName);
+char *ReadFile(FILE *fp, size_t *length);
+int  SendRequest(int fd, char *request, size_t length, int nRepeats,
+                 const char *name);
+void Usage(void);
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program for sending requests to a chisq server
+
+   17.10.26 Original    By: ACRM
+*/
+int main(int argc, char **argv)
+{
+   FILE   *fp;
+   char   *request;
+   size_t length;
+   int    fd,
+          nRepeats = 1,
+          ok       = 1;
+
+   argc--;
+   argv++;
+
+   if(argc && !strcmp(argv[0], "-r"))
+   {
+      if((argc < 2) || !sscanf(argv[1], "%d", &nRepeats) ||
+         (nRepeats < 1))
+      {
+         Usage();
+         return(1);
+      }
+      argc -= 2;
+      argv += 2;
+   }
+
+   if(!argc || (argv[0][0] == '-'))
+   {
+      Usage();
+      return(1);
+   }
+
+   if((fd = Connect(argv[0])) < 0)
+      return(1);
+   argc--;
+   argv++;
+
+   if(!argc)
+   {
+      if((request = ReadFile(stdin, &length)) == NULL)
+      {
+         fprintf(stderr,"Unable to read standard input\n");
+         ok = 0;
+      }
+      else
+      {
+         ok = SendRequest(fd, request, length, nRepeats, "stdin");
+         free(request);
+      }
+   }
+
+   for(; ok && argc; argc--, argv++)
+   {
+      if((fp = fopen(argv[0], "rb")) == NULL)
+      {
+         fprintf(stderr,"Unable to open %s\n", argv[0]);
+         ok = 0;
+      }
+      else
+      {
+         if((request = ReadFile(fp, &length)) == NULL)
+         {
+            fprintf(stderr,"Unable to read %s\n", argv[0]);
+            ok = 0;
+         }
+         else
+         {
+            ok = SendRequest(fd, request, length, nRepeats, argv[0]);
+            free(request);
+         }
+         fclose(fp);
+      }
+   }
+
+   close(fd);
+   return(ok ? 0 : 1);
+}
+
+/************************************************************************/
+/*>int Connect(char *socketName)
+   -----------------------------
+   Input:   char  *socketName   Unix domain socket of the server
+   Returns: int                 Connected socket (-1 on error)
+
+   Connects to the server
+
+   17.10.26 Original    By: ACRM
+*/
+int Connect(char *socketName)
+{
+   struct sockaddr_un address;
+   int                fd;
+
+   if(strlen(socketName) >= sizeof(address.sun_path))
+   {
+      fprintf(stderr,"Socket name is too long: %s\n", socketName);
+      return(-1);
+   }
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, socketName);
+
+   if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+   {
+      perror("chiclient: socket");
+      return(-1);
+   }
+   if(connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+   {
+      perror("chiclient: unable to connect to server");
+      close(fd);
+      return(-1);
+   }
+   return(fd);
+}
+
+/************************************************************************/
+/*>char *ReadFile(FILE *fp, size_t *length)
+   ----------------------------------------
+   Input:   FILE   *fp       File to read
+   Output:  size_t *length   Number of bytes read
+   Returns: char *           Malloc'd contents of the file (NULL on error)
+
+   Reads the whole of a file, which may be a binary table file
+
+   17.10.26 Original    By: ACRM
+*/
+char *ReadFile(FILE *fp, size_t *length)
+{
+   char   *buffer = NULL,
+          *bigger;
+   size_t size    = 0,
+          nRead;
+
+   *length = 0;
+   do
+   {
+      if(*length == size)
+      {
+         size = (size ? 2 * size : 65536);
+         if((bigger = (char *)realloc(buffer, size)) == NULL)
+         {
+            free(buffer);
+            return(NULL);
+         }
+         buffer = bigger;
+      }
+      nRead    = fread(buffer + *length, 1, size - *length, fp);
+      *length += nRead;
+   }  while(nRead);
+
+   if(ferror(fp))
+   {
+      free(buffer);
+      return(NULL);
+   }
+   return(buffer);
+}
+
+/************************************************************************/
+/*>int SendRequest(int fd, char *request, size_t length, int nRepeats,
+                   const char *name)
+   -------------------------------------------------------------------
+   Input:   int    fd         Connection to the server
+            char   *request   The request (a table)
+            size_t length     Length of the request
+            int    nRepeats   Number of times to send it
+            const char *name  Name of the request for messages
+   Returns: int               Success?
+
+   Sends a request and writes the answer to standard output. If it is
+   repeated, the answer is only written once and the mean time for each
+   request and answer is reported on standard error.
+
+   17.10.26 Original    By: ACRM
+*/
+int SendRequest(int fd, char *request, size_t length, int nRepeats,
+                const char *name)
+{
+   static char     *response    = NULL;
+   static size_t   responseSize = 0;
+   size_t          responseLength;
+   struct timespec start, end;
+   double          elapsed;
+   int             i, status;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for(i=0; i<nRepeats; i++)
+   {
+      if(WriteFrame(fd, request, length) != FRAME_OK)
+      {
+         fprintf(stderr,"Unable to send %s\n", name);
+         return(0);
+      }
+      if((status = ReadFrame(fd, &response, &responseSize,
+                             &responseLength, MAXRESPONSE)) != FRAME_OK)
+      {
+         fprintf(stderr,"%s\n", (status == FRAME_NOMEM) ?
+                 "No memory for answer" :
+                 "Server closed the connection");
+         return(0);
+      }
+   }
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   fwrite(response, 1, responseLength, stdout);
+   fflush(stdout);
+
+   if(nRepeats > 1)
+   {
+      elapsed = (double)(end.tv_sec - start.tv_sec) +
+                (double)(end.tv_nsec - start.tv_nsec) / 1.0e9;
+      fprintf(stderr,"%s: %d requests, mean %.1f microseconds\n", name,
+              nRepeats, 1.0e6 * elapsed / nRepeats);
+   }
+
+   return(1);
+}
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Prints a usage message
+
+   17.10.26 Original    By: ACRM
+*/
+void Usage(void)
+{
+   fprintf(stderr,"ChiClient V1.0 (c) 2026 Andrew C.R. Martin, UCL\n");
+   fprintf(stderr,"Usage: chiclient [-r n] socket [file ...]\n");
+   fprintf(stderr,"       -r Send each request n times and report the \
+mean time taken\n\n");
+   fprintf(stderr,"Sends each file (or standard input) as a request to a \
+server started\n");
+   fprintf(stderr,"with chisq --serve socket and prints the answers. The \
+options used\n");
+   fprintf(stderr,"for the analysis are those given to the server.\n\n");
+}
@@ -0,0 +1,219 @@
+/*************************************************************************
+
+   Program:    chisq / chiclient
+   File:       chiframe.c
+
+   Version:    V1.1
+   Date:       17.10.26
+   Function:   Framed messages on a socket
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Requests to and responses from chisq --serve are sent as frames: a
+   4-byte length in network byte order followed by that many bytes. A
+   request is a table in any form chisq reads from a file (text or a
+   binary table file) and the response is what chisq would print for it.
+
+   SetFrameTimeout() stops a read or write on a socket waiting for ever,
+   so a client that goes quiet cannot hold on to a server's worker.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added SetFrameTimeout(). ReadFrame() returns
+                  FRAME_TIMEOUT if no frame starts within the timeout
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+#include "chiframe.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+static int ReadFully(int fd, char *data, size_t length);
+
+/************************************************************************/
+/*>int ReadFrame(int fd, char **buffer, size_t *size, size_t *length,
+                 size_t maxLength)
+   -------------------------------------------------------------------
+   Input:   int    fd        Socket to read
+   I/O:     char   **buffer  Buffer for the frame, grown as needed so
+                             it can be reused for the next frame
+            size_t *size     Allocated size of buffer
+   Output:  size_t *length   Length of the frame
+   Input:   size_t maxLength Longest frame allowed
+   Returns: int              FRAME_OK, FRAME_EOF, FRAME_ERROR,
+                             FRAME_TOOBIG, FRAME_NOMEM or FRAME_TIMEOUT
+
+   Reads the next frame. The buffer comes from malloc() so is suitably
+   aligned for a binary table file. If SetFrameTimeout() has been used,
+   FRAME_TIMEOUT is returned when no frame starts within the timeout and
+   FRAME_ERROR when one stops part way.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Returns FRAME_TIMEOUT
+*/
+int ReadFrame(int fd, char **buffer, size_t *size, size_t *length,
+              size_t maxLength)
+{
+   unsigned char header[4];
+   char          *grown;
+   ssize_t       nRead;
+
+   /* A clean close is only allowed before the header                   */
+   do
+   {
+      nRead = read(fd, header, 1);
+   }  while((nRead < 0) && (errno == EINTR));
+   if(nRead == 0)
+      return(FRAME_EOF);
+   if((nRead < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      return(FRAME_TIMEOUT);
+   if((nRead < 0) || !ReadFully(fd, (char *)header + 1, 3))
+      return(FRAME_ERROR);
+
+   *length = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+             ((size_t)header[2] << 8)  |  (size_t)header[3];
+   if(*length > maxLength)
+      return(FRAME_TOOBIG);
+
+   if((*buffer == NULL) || (*length > *size))
+   {
+      if((grown = (char *)realloc(*buffer, *length + 1)) == NULL)
+         return(FRAME_NOMEM);
+      *buffer = grown;
+      *size   = *length + 1;
+   }
+
+   return(ReadFully(fd, *buffer, *length) ? FRAME_OK : FRAME_ERROR);
+}
+
+/************************************************************************/
+/*>int WriteFrame(int fd, char *data, size_t length)
+   -------------------------------------------------
+   Input:   int    fd        Socket to write
+            char   *data     Frame contents
+            size_t length    Length of data
+   Returns: int              FRAME_OK or FRAME_ERROR
+
+   Writes a frame: a 4-byte big-endian length followed by the data
+
+   17.10.26 Original    By: ACRM
+*/
+int WriteFrame(int fd, char *data, size_t length)
+{
+   unsigned char header[4];
+   char          *chunk;
+   size_t        chunkLength, done;
+   ssize_t       nWritten;
+   int           part;
+
+   header[0] = (unsigned char)((length >> 24) & 0xFF);
+   header[1] = (unsigned char)((length >> 16) & 0xFF);
+   header[2] = (unsigned char)((length >> 8)  & 0xFF);
+   header[3] = (unsigned char)(length & 0xFF);
+
+   /* Write the header and then the data                                */
+   for(part=0; part<2; part++)
+   {
+      chunk       = (part ? data   : (char *)header);
+      chunkLength = (part ? length : 4);
+      for(done=0; done<chunkLength; done+=(size_t)nWritten)
+      {
+         if((nWritten = write(fd, chunk + done, chunkLength - done)) < 0)
+         {
+            if(errno != EINTR)
+               return(FRAME_ERROR);
+            nWritten = 0;
+         }
+      }
+   }
+
+   return(FRAME_OK);
+}
+
+/************************************************************************/
+/*>int SetFrameTimeout(int fd, int seconds)
+   ----------------------------------------
+   Input:   int    fd        Socket
+            int    seconds   Longest wait for a read or write
+   Returns: int              Success?
+
+   Sets the receive and send timeouts of a socket, so that ReadFrame()
+   and WriteFrame() give up rather than wait for ever on a client that
+   has stopped reading or writing
+
+   17.10.26 Original    By: ACRM
+*/
+int SetFrameTimeout(int fd, int seconds)
+{
+   struct timeval timeout;
+
+   timeout.tv_sec  = seconds;
+   timeout.tv_usec = 0;
+
+   return((setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                      sizeof(timeout)) == 0) &&
+          (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                      sizeof(timeout)) == 0));
+}
+
+/************************************************************************/
+/*>static int ReadFully(int fd, char *data, size_t length)
+   -------------------------------------------------------
+   Input:   int    fd        Socket to read
+   Output:  char   *data     The data read
+   Input:   size_t length    Number of bytes to read
+   Returns: int              Success? (FALSE if the connection closes
+                             first)
+
+   17.10.26 Original    By: ACRM
+*/
+static int ReadFully(int fd, char *data, size_t length)
+{
+   size_t  done;
+   ssize_t nRead;
+
+   for(done=0; done<length; done+=(size_t)nRead)
+   {
+      if((nRead = read(fd, data + done, length - done)) <= 0)
+      {
+         if((nRead < 0) && (errno == EINTR))
+            nRead = 0;
+         else
+            return(0);
+      }
+   }
+
+   return(1);
+}
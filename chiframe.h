@@ -0,0 +1,59 @@
+/*************************************************************************
+
+   Program:    chisq / chiclient
+   File:       chiframe.h
+
+   Version:    V1.1
+   Date:       17.10.26
+   Function:   Include file for framed messages on a socket
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added FRAME_TIMEOUT and SetFrameTimeout()
+
+*************************************************************************/
+#ifndef _CHIFRAME_H
+#define _CHIFRAME_H
+
+#include <stddef.h>
+
+/************************************************************************/
+/* Defines
+*/
+#define FRAME_OK      0
+#define FRAME_EOF     1        /* Connection closed between frames      */
+#define FRAME_ERROR   2        /* Read error or truncated frame         */
+#define FRAME_TOOBIG  3        /* Frame longer than allowed             */
+#define FRAME_NOMEM   4
+#define FRAME_TIMEOUT 5        /* Nothing arrived within the timeout    */
+
+/************************************************************************/
+/* Prototypes
+*/
+int ReadFrame(int fd, char **buffer, size_t *size, size_t *length,
+              size_t maxLength);
+int WriteFrame(int fd, char *data, size_t length);
+int SetFrameTimeout(int fd, int seconds);
+
+#endif
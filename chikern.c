@@ -0,0 +1,684 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       chikern.c
+
+   Version:    V1.5
+   Date:       17.10.26
+   Function:   Chi squared accumulation kernel
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   Accumulates chi squared over a contiguous run of cells - a row of the
+   two-way table or a (row, column) line of the three-way table. Each
+   cell's expected value is either given or calculated from the margins
+   as rowTot * base[j] / divisor. The margins are 64-bit; base is either
+   a margin or, for expecteds scaled from the first row, a row of int
+   counts. AVX2 has no conversion from 64-bit integers to doubles, so
+   the two 32-bit halves are each made exact doubles by putting them in
+   the mantissa of 2^84 and 2^52 and then added. Cells whose margin is
+   zero are skipped
+   and cells whose expected value is below SMALL are counted rather than
+   included. This is done without branches, using masks, so that the
+   loop can be vectorized.
+
+   If asked for, O ln(O/E) is summed in the same pass for the G
+   (likelihood ratio) statistic, without the Yates correction. Cells
+   with O = 0 add nothing. There is no vector log in the C library, so
+   the log is calculated by Log(), which uses the Cephes rational
+   approximation on the mantissa. LogAVX2() does exactly the same
+   operations on four values at once. The log roughly triples the cost
+   of the AVX2 kernel, so it is not done unless G is wanted.
+
+   ChiSqOccupied() is for sparse tables, where only the occupied cells
+   are visited and the empty ones are allowed for by the caller. Its
+   expecteds have already been gathered from scattered totals, which is
+   the cost, so it is not vectorized.
+
+   An AVX2 version is used if the processor supports it. Otherwise a
+   scalar version is used. Both sum the cells into NLANES partial sums
+   (cell j into sum j % NLANES) and combine them in the same order, so
+   they give identical results.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Can also sum O ln(O/E) for the G statistic
+   V1.2  17.10.26 Counts the cells visited and those with observations
+   V1.3  17.10.26 Added ChiContribution()
+   V1.4  17.10.26 The margins are int64_t. Added ChiSqCellsFromRow()
+   V1.5  17.10.26 Added ChiSqOccupied() for sparse tables
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <math.h>
+
+#include "chikern.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(NOSIMD)
+#  define USE_AVX2
+#  include <immintrin.h>
+#endif
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   double chisq[NLANES],
+          g[NLANES],
+          nCells[NLANES],
+          nSmall[NLANES],
+          nZero[NLANES],
+          nOccupied[NLANES];
+}  LANESUMS;
+
+/************************************************************************/
+/* Prototypes
+*/
+static void AccumulateScalar(int *observed, double *expected,
+                             int64_t *base, int *rowBase,
+                             int64_t *margin, double rowTot,
+                             double divisor, int n, int yates, int withG,
+                             LANESUMS *lanes);
+#ifdef USE_AVX2
+static void AccumulateAVX2(int *observed, double *expected,
+                           int64_t *base, int *rowBase, int64_t *margin,
+                           double rowTot, double divisor, int n,
+                           int yates, int withG, LANESUMS *lanes)
+   __attribute__((target("avx2")));
+#endif
+static void Accumulate(int *observed, double *expected, int64_t *base,
+                       int *rowBase, int64_t *margin, double rowTot,
+                       double divisor, int n, int yates, CHIACC *acc);
+static double Log(double x);
+#ifdef USE_AVX2
+static __m256d LogAVX2(__m256d x) __attribute__((target("avx2")));
+static __m256d Int64ToDoubleAVX2(__m256i x)
+   __attribute__((target("avx2")));
+#endif
+
+/************************************************************************/
+/* Globals
+*/
+/* Cephes log() coefficients: log(1+x) = x - x^2/2 + x^3 P(x)/Q(x)      */
+static const double sLogP[6] =
+{
+   1.01875663804580931796e-4,
+   4.97494994976747001425e-1,
+   4.70579119878881725854e0,
+   1.44989225341610930846e1,
+   1.79368678507819816313e1,
+   7.70838733755885391666e0
+};
+static const double sLogQ[5] =    /* The leading 1 is implied           */
+{
+   1.12873587189167450590e1,
+   4.52279145837532221105e1,
+   8.29875266912776603211e1,
+   7.11544750618563894466e1,
+   2.31251620126765340583e1
+};
+
+/************************************************************************/
+/*>void ClearChiAcc(CHIACC *acc, int withG)
+   ----------------------------------------
+   Output:  CHIACC *acc      Accumulator to clear
+   Input:   int    withG     Also sum O ln(O/E) for G
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added withG
+   17.10.26 Clears nOccupied and nVisited
+*/
+void ClearChiAcc(CHIACC *acc, int withG)
+{
+   acc->chisq     = 0.0;
+   acc->g         = 0.0;
+   acc->nCells    = 0;
+   acc->nSmall    = 0;
+   acc->nZero     = 0;
+   acc->nOccupied = 0;
+   acc->nVisited  = 0;
+   acc->withG     = withG;
+}
+
+/************************************************************************/
+/*>void ChiSqCells(int *observed, double *expected, int *margin, int n,
+                   int yates, CHIACC *acc)
+   --------------------------------------------------------------------
+   Input:   int     *observed  Observed counts
+            double  *expected  Expected values
+            int64_t *margin    Cells are skipped where this is zero (NULL
+                               to include all cells)
+            int     n          Number of cells
+            int     yates      Apply the Yates correction
+   I/O:     CHIACC  *acc       Accumulator
+
+   Adds n cells with known expecteds to the accumulator
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The margin is int64_t
+*/
+void ChiSqCells(int *observed, double *expected, int64_t *margin, int n,
+                int yates, CHIACC *acc)
+{
+   Accumulate(observed, expected, NULL, NULL, margin, 0.0, 1.0, n, yates,
+              acc);
+}
+
+/************************************************************************/
+/*>void ChiSqCellsFromMargins(int *observed, int64_t *base,
+                              int64_t *margin, double rowTot,
+                              double divisor, int n, int yates,
+                              CHIACC *acc)
+   ----------------------------------------------------------------
+   Input:   int     *observed  Observed counts
+            int64_t *base      Totals from which expecteds are scaled
+            int64_t *margin    Cells are skipped where this is zero (NULL
+                               to include all cells)
+            double  rowTot     Scale factor for base (the row total)
+            double  divisor    Divisor for base (usually the grand total)
+            int     n          Number of cells
+            int     yates      Apply the Yates correction
+   I/O:     CHIACC  *acc       Accumulator
+
+   Adds n cells to the accumulator, with the expected value of cell j
+   being rowTot * base[j] / divisor. For a normal table, base and margin
+   are both the column totals.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The base and margin are int64_t
+*/
+void ChiSqCellsFromMargins(int *observed, int64_t *base, int64_t *margin,
+                           double rowTot, double divisor, int n,
+                           int yates, CHIACC *acc)
+{
+   Accumulate(observed, NULL, base, NULL, margin, rowTot, divisor, n,
+              yates, acc);
+}
+
+/************************************************************************/
+/*>void ChiSqCellsFromRow(int *observed, int *base, int64_t *margin,
+                          double rowTot, double divisor, int n,
+                          int yates, CHIACC *acc)
+   ------------------------------------------------------------------
+   Input:   int     *observed  Observed counts
+            int     *base      Counts from which expecteds are scaled
+            int64_t *margin    Cells are skipped where this is zero (NULL
+                               to include all cells)
+            double  rowTot     Scale factor for base (the row total)
+            double  divisor    Divisor for base (the total for the row
+                               in base)
+            int     n          Number of cells
+            int     yates      Apply the Yates correction
+   I/O:     CHIACC  *acc       Accumulator
+
+   As ChiSqCellsFromMargins() but with the expecteds scaled from a row
+   of counts, such as the first row of the table
+
+   17.10.26 Original    By: ACRM
+*/
+void ChiSqCellsFromRow(int *observed, int *base, int64_t *margin,
+                       double rowTot, double divisor, int n, int yates,
+                       CHIACC *acc)
+{
+   Accumulate(observed, NULL, NULL, base, margin, rowTot, divisor, n,
+              yates, acc);
+}
+
+/************************************************************************/
+/*>void ChiSqOccupied(int *observed, double *expected, int n,
+                      CHIACC *acc)
+   ----------------------------------------------------------
+   Input:   int     *observed  Observed counts (cells with none are
+                               skipped)
+            double  *expected  Expected values
+            int     n          Number of cells
+   I/O:     CHIACC  *acc       Accumulator
+
+   Adds the occupied cells of a sparse table for
+      chisq = sum(O^2/E) - N
+   summed as O(O-E)/E for each cell so that nothing large cancels. A
+   cell whose expected is too small to be included adds its O instead,
+   as the N taken off includes it. The caller takes off the expecteds
+   of the cells that are not included and counts the cells, as only it
+   knows about the empty ones. G is summed as by the other kernels.
+
+   17.10.26 Original    By: ACRM
+*/
+void ChiSqOccupied(int *observed, double *expected, int n, CHIACC *acc)
+{
+   double o, e;
+   int    j;
+
+   for(j=0; j<n; j++)
+   {
+      if((o = (double)observed[j]) <= 0.0)
+         continue;
+      e = expected[j];
+      acc->nOccupied++;
+      if(e > SMALL)
+      {
+         acc->chisq += o * (o - e) / e;
+         if(acc->withG)
+            acc->g  += o * Log(o / e);
+      }
+      else
+      {
+         acc->chisq += o;
+      }
+   }
+   acc->nVisited += n;
+}
+
+/************************************************************************/
+/*>double ChiContribution(double observed, double expected, int yates)
+   ------------------------------------------------------------------
+   Input:   double observed    Observed count
+            double expected    Expected value
+            int    yates       Apply the Yates correction
+   Returns: double             The cell's (O-E)^2/E
+
+   The term the kernel adds to chi squared for one cell, or 0 if the
+   expected value is too small to be included
+
+   17.10.26 Original    By: ACRM
+*/
+double ChiContribution(double observed, double expected, int yates)
+{
+   double d;
+
+   if(!(expected > SMALL))
+      return(0.0);
+
+   d = observed - expected;
+   if(yates)
+      d = fabs(d) - 0.5;
+   return(d * d / expected);
+}
+
+/************************************************************************/
+/*>static void Accumulate(int *observed, double *expected,
+                          int64_t *base, int *rowBase, int64_t *margin,
+                          double rowTot, double divisor, int n,
+                          int yates, CHIACC *acc)
+   ------------------------------------------------------------------
+   Chooses the kernel for this processor, runs it and combines the lane
+   sums into the accumulator. Arguments are as for ChiSqCells(),
+   ChiSqCellsFromMargins() and ChiSqCellsFromRow(). Only one of
+   expected, base and rowBase is given.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added rowBase
+*/
+static void Accumulate(int *observed, double *expected, int64_t *base,
+                       int *rowBase, int64_t *margin, double rowTot,
+                       double divisor, int n, int yates, CHIACC *acc)
+{
+   LANESUMS lanes;
+   int      i;
+
+   for(i=0; i<NLANES; i++)
+   {
+      lanes.chisq[i]  = 0.0;
+      lanes.g[i]      = 0.0;
+      lanes.nCells[i] = 0.0;
+      lanes.nSmall[i] = 0.0;
+      lanes.nZero[i]  = 0.0;
+      lanes.nOccupied[i] = 0.0;
+   }
+
+#ifdef USE_AVX2
+   if(__builtin_cpu_supports("avx2"))
+      AccumulateAVX2(observed, expected, base, rowBase, margin, rowTot,
+                     divisor, n, yates, acc->withG, &lanes);
+   else
+#endif
+      AccumulateScalar(observed, expected, base, rowBase, margin, rowTot,
+                       divisor, n, yates, acc->withG, &lanes);
+
+   acc->chisq  += (lanes.chisq[0]  + lanes.chisq[1]) +
+                  (lanes.chisq[2]  + lanes.chisq[3]);
+   acc->g      += (lanes.g[0]      + lanes.g[1]) +
+                  (lanes.g[2]      + lanes.g[3]);
+   acc->nCells += (int)((lanes.nCells[0] + lanes.nCells[1]) +
+                        (lanes.nCells[2] + lanes.nCells[3]));
+   acc->nSmall += (int)((lanes.nSmall[0] + lanes.nSmall[1]) +
+                        (lanes.nSmall[2] + lanes.nSmall[3]));
+   acc->nZero  += (int)((lanes.nZero[0]  + lanes.nZero[1]) +
+                        (lanes.nZero[2]  + lanes.nZero[3]));
+   acc->nOccupied += (int)((lanes.nOccupied[0] + lanes.nOccupied[1]) +
+                           (lanes.nOccupied[2] + lanes.nOccupied[3]));
+   acc->nVisited  += n;
+}
+
+/************************************************************************/
+/*>static void AccumulateScalar(int *observed, double *expected,
+                                int64_t *base, int *rowBase,
+                                int64_t *margin, double rowTot,
+                                double divisor, int n, int yates,
+                                int withG, LANESUMS *lanes)
+   -------------------------------------------------------------------
+   Portable version of the kernel
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added withG
+   17.10.26 Added rowBase
+*/
+static void AccumulateScalar(int *observed, double *expected,
+                             int64_t *base, int *rowBase,
+                             int64_t *margin, double rowTot,
+                             double divisor, int n, int yates, int withG,
+                             LANESUMS *lanes)
+{
+   double e, d, o;
+   int    j, lane, in, valid, present;
+
+   for(j=0; j<n; j++)
+   {
+      lane  = j % NLANES;
+      if(expected != NULL)
+         e = expected[j];
+      else if(base != NULL)
+         e = rowTot * (double)base[j] / divisor;
+      else
+         e = rowTot * (double)rowBase[j] / divisor;
+      in    = (margin == NULL) || (margin[j] != 0);
+      valid = in & (e > SMALL);
+
+      o       = (double)observed[j];
+      present = valid & (o > 0.0);
+      d       = o - e;
+      if(yates)
+         d = fabs(d) - 0.5;
+
+      lanes->chisq[lane]  += valid ? (d * d / e) : 0.0;
+      if(withG && present)
+         lanes->g[lane]   += o * Log(o / e);
+      lanes->nCells[lane] += (double)in;
+      lanes->nSmall[lane] += (double)(valid & (e < 5.0));
+      lanes->nZero[lane]  += (double)(in & !valid);
+      lanes->nOccupied[lane] += (double)(in & (o > 0.0));
+   }
+}
+
+#ifdef USE_AVX2
+/************************************************************************/
+/*>static void AccumulateAVX2(int *observed, double *expected,
+                              int64_t *base, int *rowBase,
+                              int64_t *margin, double rowTot,
+                              double divisor, int n, int yates,
+                              int withG, LANESUMS *lanes)
+   ----------------------------------------------------------------------
+   AVX2 version of the kernel. Four cells are done at a time, with
+   masked loads for the last few. The 64-bit margins are loaded as
+   doubles, which just moves the bits, and then compared or converted
+   as integers.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added withG
+   17.10.26 Added rowBase. The margins are 64-bit
+*/
+static void AccumulateAVX2(int *observed, double *expected,
+                           int64_t *base, int *rowBase, int64_t *margin,
+                           double rowTot, double divisor, int n,
+                           int yates, int withG, LANESUMS *lanes)
+{
+   __m256d vSmall   = _mm256_set1_pd(SMALL),
+           vFive    = _mm256_set1_pd(5.0),
+           vOne     = _mm256_set1_pd(1.0),
+           vHalf    = _mm256_set1_pd(0.5),
+           vSign    = _mm256_set1_pd(-0.0),
+           vRowTot  = _mm256_set1_pd(rowTot),
+           vDivisor = _mm256_set1_pd(divisor),
+           vZero    = _mm256_setzero_pd(),
+           sumChi   = _mm256_setzero_pd(),
+           sumG     = _mm256_setzero_pd(),
+           sumCells = _mm256_setzero_pd(),
+           sumSmall = _mm256_setzero_pd(),
+           sumZero  = _mm256_setzero_pd(),
+           sumOcc   = _mm256_setzero_pd(),
+           e, o, d, in, valid, present, term;
+   __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3),
+           mask32;
+   __m256i mask64,
+           vZeroI    = _mm256_setzero_si256(),
+           wide;
+   int     j;
+
+   for(j=0; j<n; j+=NLANES)
+   {
+      /* Lanes that are within the n cells                              */
+      mask32 = _mm_cmpgt_epi32(_mm_set1_epi32(n - j), laneIndex);
+      mask64 = _mm256_cvtepi32_epi64(mask32);
+      in     = _mm256_castsi256_pd(mask64);
+
+      if(margin != NULL)
+      {
+         wide = _mm256_castpd_si256(
+                   _mm256_maskload_pd((double *)(margin+j), mask64));
+         in   = _mm256_andnot_pd(
+                   _mm256_castsi256_pd(_mm256_cmpeq_epi64(wide, vZeroI)),
+                   in);
+      }
+
+      if(expected != NULL)
+      {
+         e = _mm256_maskload_pd(expected+j, mask64);
+      }
+      else if(base != NULL)
+      {
+         wide = _mm256_castpd_si256(
+                   _mm256_maskload_pd((double *)(base+j), mask64));
+         e    = _mm256_div_pd(_mm256_mul_pd(vRowTot,
+                                            Int64ToDoubleAVX2(wide)),
+                              vDivisor);
+      }
+      else
+      {
+         e = _mm256_div_pd(_mm256_mul_pd(vRowTot,
+                              _mm256_cvtepi32_pd(
+                                 _mm_maskload_epi32(rowBase+j, mask32))),
+                           vDivisor);
+      }
+
+      valid = _mm256_and_pd(in, _mm256_cmp_pd(e, vSmall, _CMP_GT_OQ));
+
+      o = _mm256_cvtepi32_pd(_mm_maskload_epi32(observed+j, mask32));
+      d = _mm256_sub_pd(o, e);
+      if(yates)
+         d = _mm256_sub_pd(_mm256_andnot_pd(vSign, d), vHalf);
+
+      /* Divide by 1 rather than a tiny expected in the unused lanes    */
+      term = _mm256_div_pd(_mm256_mul_pd(d, d),
+                           _mm256_blendv_pd(vOne, e, valid));
+
+      sumChi   = _mm256_add_pd(sumChi,   _mm256_and_pd(valid, term));
+
+      /* Take the log of 1 in the lanes with no observations            */
+      if(withG)
+      {
+         present = _mm256_and_pd(valid,
+                                 _mm256_cmp_pd(o, vZero, _CMP_GT_OQ));
+         term    = _mm256_mul_pd(o,
+                      LogAVX2(_mm256_blendv_pd(vOne, _mm256_div_pd(o, e),
+                                               present)));
+         sumG    = _mm256_add_pd(sumG, _mm256_and_pd(present, term));
+      }
+
+      sumCells = _mm256_add_pd(sumCells, _mm256_and_pd(in, vOne));
+      sumSmall = _mm256_add_pd(sumSmall,
+                    _mm256_and_pd(_mm256_and_pd(valid,
+                                     _mm256_cmp_pd(e, vFive, _CMP_LT_OQ)),
+                                  vOne));
+      sumZero  = _mm256_add_pd(sumZero,
+                    _mm256_and_pd(_mm256_andnot_pd(valid, in), vOne));
+      sumOcc   = _mm256_add_pd(sumOcc,
+                    _mm256_and_pd(_mm256_and_pd(in,
+                                     _mm256_cmp_pd(o, vZero, _CMP_GT_OQ)),
+                                  vOne));
+   }
+
+   _mm256_storeu_pd(lanes->chisq,  sumChi);
+   _mm256_storeu_pd(lanes->g,      sumG);
+   _mm256_storeu_pd(lanes->nCells, sumCells);
+   _mm256_storeu_pd(lanes->nSmall, sumSmall);
+   _mm256_storeu_pd(lanes->nZero,  sumZero);
+   _mm256_storeu_pd(lanes->nOccupied, sumOcc);
+}
+
+/************************************************************************/
+/*>static __m256d Int64ToDoubleAVX2(__m256i x)
+   -------------------------------------------
+   Input:   __m256i x        Four non-negative 64-bit integers
+   Returns: __m256d          The same values as doubles
+
+   The high and low 32 bits are put in the mantissas of 2^84 and 2^52,
+   which gives 2^84 + hi * 2^32 and 2^52 + lo exactly. Taking off
+   2^84 + 2^52 and adding the two rounds only once.
+
+   17.10.26 Original    By: ACRM
+*/
+static __m256d Int64ToDoubleAVX2(__m256i x)
+{
+   __m256d two52   = _mm256_set1_pd(4503599627370496.0),
+           two84   = _mm256_set1_pd(19342813113834066795298816.0),
+           both    = _mm256_set1_pd(19342813118337666422669312.0);
+   __m256i hi, lo;
+
+   hi = _mm256_or_si256(_mm256_srli_epi64(x, 32),
+                        _mm256_castpd_si256(two84));
+   lo = _mm256_blend_epi32(x, _mm256_castpd_si256(two52), 0xaa);
+   return(_mm256_add_pd(_mm256_sub_pd(_mm256_castsi256_pd(hi), both),
+                        _mm256_castsi256_pd(lo)));
+}
+
+/************************************************************************/
+/*>static __m256d LogAVX2(__m256d x)
+   ---------------------------------
+   Input:   __m256d x        Four positive, normal values
+   Returns: __m256d          Their natural logs
+
+   AVX2 version of Log(). The exponent and mantissa are taken from the
+   bits, which is exactly what frexp() does for normal values.
+
+   17.10.26 Original    By: ACRM
+*/
+static __m256d LogAVX2(__m256d x)
+{
+   __m256i bits     = _mm256_castpd_si256(x),
+           vMagic   = _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0)),
+           vMant    = _mm256_srli_epi64(_mm256_set1_epi32(-1), 12);
+   __m256d vOne     = _mm256_set1_pd(1.0),
+           vHalf    = _mm256_set1_pd(0.5),
+           vSqrtH   = _mm256_set1_pd(0.70710678118654752440),
+           m, e, small, z, p, q, y;
+
+   /* Exponent as a double, via the 2^52 trick, and mantissa in [0.5,1) */
+   e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(
+                        _mm256_srli_epi64(bits, 52), vMagic)),
+                     _mm256_set1_pd(4503599627370496.0 + 1022.0));
+   m = _mm256_or_pd(_mm256_castsi256_pd(_mm256_and_si256(bits, vMant)),
+                    vHalf);
+
+   small = _mm256_cmp_pd(m, vSqrtH, _CMP_LT_OQ);
+   e     = _mm256_sub_pd(e, _mm256_and_pd(small, vOne));
+   x     = _mm256_sub_pd(_mm256_add_pd(m, _mm256_and_pd(small, m)), vOne);
+
+   z = _mm256_mul_pd(x, x);
+   p = _mm256_set1_pd(sLogP[0]);
+   p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(sLogP[1]));
+   p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(sLogP[2]));
+   p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(sLogP[3]));
+   p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(sLogP[4]));
+   p = _mm256_add_pd(_mm256_mul_pd(p, x), _mm256_set1_pd(sLogP[5]));
+   q = _mm256_add_pd(x, _mm256_set1_pd(sLogQ[0]));
+   q = _mm256_add_pd(_mm256_mul_pd(q, x), _mm256_set1_pd(sLogQ[1]));
+   q = _mm256_add_pd(_mm256_mul_pd(q, x), _mm256_set1_pd(sLogQ[2]));
+   q = _mm256_add_pd(_mm256_mul_pd(q, x), _mm256_set1_pd(sLogQ[3]));
+   q = _mm256_add_pd(_mm256_mul_pd(q, x), _mm256_set1_pd(sLogQ[4]));
+
+   y = _mm256_mul_pd(x, _mm256_div_pd(_mm256_mul_pd(z, p), q));
+   y = _mm256_sub_pd(y, _mm256_mul_pd(e,
+                           _mm256_set1_pd(2.121944400546905827679e-4)));
+   y = _mm256_sub_pd(y, _mm256_mul_pd(z, vHalf));
+   return(_mm256_add_pd(_mm256_add_pd(x, y),
+                        _mm256_mul_pd(e, _mm256_set1_pd(0.693359375))));
+}
+#endif
+
+/************************************************************************/
+/*>static double Log(double x)
+   ---------------------------
+   Input:   double x         A positive, normal value
+   Returns: double           Its natural log
+
+   log(x) from the Cephes rational approximation. Used rather than the
+   C library so that the scalar and AVX2 kernels give identical results.
+   ln(2) is split into 0.693359375 (exact in a few bits) and a small
+   correction so e * ln(2) adds no rounding error.
+
+   17.10.26 Original    By: ACRM
+*/
+static double Log(double x)
+{
+   double m, e, z, p, q, y;
+   int    exponent;
+
+   m = frexp(x, &exponent);
+   e = (double)exponent;
+   if(m < 0.70710678118654752440)
+   {
+      e -= 1.0;
+      x  = (m + m) - 1.0;
+   }
+   else
+   {
+      x  = m - 1.0;
+   }
+
+   z = x * x;
+   p = sLogP[0];
+   p = p * x + sLogP[1];
+   p = p * x + sLogP[2];
+   p = p * x + sLogP[3];
+   p = p * x + sLogP[4];
+   p = p * x + sLogP[5];
+   q = x + sLogQ[0];
+   q = q * x + sLogQ[1];
+   q = q * x + sLogQ[2];
+   q = q * x + sLogQ[3];
+   q = q * x + sLogQ[4];
+
+   y = x * ((z * p) / q);
+   y = y - e * 2.121944400546905827679e-4;
+   y = y - z * 0.5;
+   return((x + y) + e * 0.693359375);
+}
@@ -0,0 +1,83 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       chikern.h
+
+   Version:    V1.5
+   Date:       17.10.26
+   Function:   Include file for the chi squared accumulation kernel
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Can also sum O ln(O/E) for the G statistic
+   V1.2  17.10.26 Counts the cells visited and those with observations
+   V1.3  17.10.26 Added ChiContribution()
+   V1.4  17.10.26 The margins are int64_t. Added ChiSqCellsFromRow()
+   V1.5  17.10.26 Added ChiSqOccupied()
+
+*************************************************************************/
+#ifndef _CHIKERN_H
+#define _CHIKERN_H
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines
+*/
+#define SMALL   (0.1e-20)      /* Expecteds below this are not included */
+#define NLANES  4              /* Cells summed in parallel              */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   double chisq,               /* Sum of (O-E)^2/E                      */
+          g;                   /* Sum of O ln(O/E)                      */
+   int    nCells,              /* Cells included                        */
+          nSmall,              /* ...with expected < 5                  */
+          nZero,               /* ...with expected too small to use     */
+          nOccupied,           /* ...with observations                  */
+          nVisited,            /* Cells looked at (included or not)     */
+          withG;               /* Also sum O ln(O/E)                    */
+}  CHIACC;
+
+/************************************************************************/
+/* Prototypes
+*/
+void ClearChiAcc(CHIACC *acc, int withG);
+void ChiSqCells(int *observed, double *expected, int64_t *margin, int n,
+                int yates, CHIACC *acc);
+void ChiSqCellsFromMargins(int *observed, int64_t *base, int64_t *margin,
+                           double rowTot, double divisor, int n,
+                           int yates, CHIACC *acc);
+void ChiSqCellsFromRow(int *observed, int *base, int64_t *margin,
+                       double rowTot, double divisor, int n, int yates,
+                       CHIACC *acc);
+void ChiSqOccupied(int *observed, double *expected, int n, CHIACC *acc);
+double ChiContribution(double observed, double expected, int yates);
+
+#endif
@@ -0,0 +1,45 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       chiprob.h
+
+   Version:    V1.1
+   Date:       17.10.26
+   Function:   Include file for chi squared probabilities
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added ChiSqCritical()
+
+*************************************************************************/
+#ifndef _CHIPROB_H
+#define _CHIPROB_H
+
+/************************************************************************/
+/* Prototypes
+*/
+double ChiSqProb(double chisq, int dof);
+double ChiSqCritical(double alpha, int dof);
+
+#endif
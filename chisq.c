@@ -3,11 +3,11 @@
    Program:    chisq
    File:       chisq.c
    
-   Version:    V1.8
-   Date:       03.10.17
+   Version:    V1.32
+   Date:       17.10.26
    Function:   Do general chi squared analysis
    
-   Copyright:  (c) Dr. Andrew C. R. Martin, 1994-2017
+   Copyright:  (c) Dr. Andrew C. R. Martin, 1994-2026
    Author:     Dr. Andrew C. R. Martin
    Address:    Biomolecular Structure and Modelling,
                University College London,
@@ -59,50 +59,222 @@
    V1.7  16.06.09 Added -f flag to take expecteds from first data set
                   observed values
    V1.8  03.10.17 Added warning information
+   V1.9  17.10.26 Labels are interned through a hash table
+   V1.10 17.10.26 The contingency table is allocated to fit the data
+                  rather than being a fixed MAXITEM x MAXITEM array
+   V1.11 17.10.26 Row, column and grand totals are accumulated while
+                  reading the data
+   V1.12 17.10.26 Added batch mode (-b and -t) to analyze many tables in
+                  one run
+   V1.13 17.10.26 Added -j to analyze tables in batch mode on several
+                  threads. Globals moved into a per-table CONTEXT and
+                  output now goes to the output file rather than always
+                  to stdout
+   V1.14 17.10.26 Added -c to test the significance of each cell, with -n
+                  and -l, replacing cellsignificance.pl
+   V1.15 17.10.26 Added -p to print the p-value, -a to print the critical
+                  value and -o for TSV or JSON output
+   V1.16 17.10.26 Regular files are mapped into memory and split into
+                  tokens in place rather than read with fgets() and
+                  sscanf(). Lines and labels may be any length
+   V1.17 17.10.26 Added -w to write the table as a binary file. Binary
+                  table files are recognized and read instead of text
+   V1.18 17.10.26 Now a front end to libchisq. The table, chi squared
+                  and cell significance are handled by contab.c
+   V1.19 17.10.26 Added --serve to answer requests on a Unix domain
+                  socket
+   V1.20 17.10.26 Added -u to read a stream of changes to cells and
+                  print the running chi squared after each
+   V1.21 17.10.26 An exact test is done when the expecteds are too small
+                  for the chi squared approximation
+   V1.22 17.10.26 Added -B for a Monte Carlo p-value and -s to set its
+                  seed
+   V1.23 17.10.26 Added -g to give the G statistic, which is summed in
+                  the same pass as chi squared
+   V1.24 17.10.26 Added -S, --stats and --perf to report the time in each
+                  phase and counts of the work done
+   V1.25 17.10.26 Added -A to sum the counts for repeated cells rather
+                  than replacing them. Counts that would overflow are an
+                  error and the grand total is a long
+   V1.26 17.10.26 Added -r to read raw observations (item1 item2) and
+                  count them
+   V1.27 17.10.26 -d output is collected in a large buffer and the
+                  numbers formatted by outbuf.c rather than printf().
+                  Added --cells to write each cell as TSV
+   V1.28 17.10.26 The automatic exact test has a much smaller budget
+                  and too large tables are rejected from their totals.
+                  Added -x to turn it off. Tables too large for it are
+                  only reported with -S
+   V1.29 17.10.26 --serve reports refused binary requests. Their counts
+                  are checked against their totals when they are loaded
+   V1.30 17.10.26 A count or -u change too large for an int is refused
+                  rather than wrapping. The totals are 64 bit
+   V1.31 17.10.26 A one-line note is always given when the exact test
+                  is needed but skipped
+   V1.32 17.10.26 --serve closes a connection that is idle for
+                  IDLETIMEOUT seconds so idle clients cannot hold all the
+                  workers
 
 *************************************************************************/
 /* Includes
 */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "bioplib/MathType.h"
 #include "bioplib/SysDefs.h"
 #include "bioplib/general.h"
 #include "bioplib/macros.h"
 
+#include "contab.h"
+#include "workpool.h"
+#include "results.h"
+#include "chikern.h"
+#include "lineread.h"
+#include "tabfile.h"
+#include "chiframe.h"
+#include "chistats.h"
+#include "outbuf.h"
+
 /************************************************************************/
 /* Defines
 */
-#define MAXITEM 2000
-#define MAXBUFF 160
-#define SMALL   (0.1e-20)
+#define SIGLEVEL 0.05                  /* Significance level for -c     */
+#define CHUNKSPERTHREAD 64                 /* Tables per thread per batch */
+#define MAXBATCHBYTES   (64L * 1024L * 1024L) /* Input text per batch     */
+#define MAXREQUEST      (64L * 1024L * 1024L) /* Largest --serve request  */
+#define IDLETIMEOUT     10     /* Seconds a --serve connection may be idle */
+#define MAXREPS         2000000000L           /* Most replicates with -B  */
+#define DEFSEED         12345UL               /* Default seed for -B      */
 
 /************************************************************************/
-/* Globals
+/* Types
+*/
+typedef struct
+{
+   BOOL display,          /* -d Display observed and expected values    */
+        yates,            /* -y Apply Yates correction                  */
+        gotExpecteds,     /* -e Expecteds appear in the file            */
+        firstAsExpecteds, /* -f First dataset observeds as expecteds    */
+        batch,            /* -b/-t File contains several tables         */
+        tableColumn,      /* -t Table name is in the first column       */
+        cellSig,          /* -c Significance of each cell               */
+        noBonferroni,     /* -n No Bonferroni correction with -c        */
+        lowOK,            /* -l Allow low expecteds with -c             */
+        update,           /* -u Input is a stream of changes to cells   */
+        accumulate,       /* -A Sum the counts for repeated cells       */
+        raw,              /* -r Each line is one observation            */
+        stats,            /* -S Report phase times and counters         */
+        perf;             /* --perf Also count hardware events with -S  */
+   int  nThreads;         /* -j Threads in batch mode, --serve or -B    */
+   long nReps;            /* -B Random tables for a simulated p-value   */
+   unsigned long seed;    /* -s Random number seed for -B               */
+   RESULTFORMAT result;   /* -p/-g/-a/-o/-x How to print the result     */
+   char *writeFile,       /* -w Write the table to this binary file     */
+        *serve,           /* --serve Socket to listen on                */
+        *statsFile,       /* --stats Write -S statistics here as JSON   */
+        *cellsFile;       /* --cells Write each cell here as TSV        */
+}  OPTIONS;
+
+/* Everything needed to read and analyze one table. Each thread has its
+   own so ReadData() and CalcChiSq() may run concurrently
 */
-BOOL gDisplay      = FALSE,
-     gYates        = FALSE,
-     gGotExpecteds = FALSE,
-     gFirstAsExpecteds = FALSE;
-char gItemList1[MAXITEM][MAXBUFF],
-     gItemList2[MAXITEM][MAXBUFF];
-int  gNItem1 = 0, gNItem2 = 0;
-REAL gExpecteds[MAXITEM][MAXITEM];
+typedef struct
+{
+   OPTIONS    *opts;            /* Shared options (read only)           */
+   CONTAB     *table;           /* The contingency table                */
+   int        nTables,          /* Tables read so far (for numbering)   */
+              nThreads;         /* Threads for -B                       */
+   BOOL       pending;          /* line holds a line not yet used       */
+   char       *line,            /* Input line (not NUL terminated)      */
+              *name,            /* Name from a '#table' line            */
+              *tableID;         /* Name of the current table            */
+   size_t     lineLength,       /* Length of line                       */
+              nameSize,         /* Allocated size of name               */
+              tableIDSize;      /* Allocated size of tableID            */
+   FILE       *out,             /* Where results are written            */
+              *err;             /* Where warnings are written           */
+   CHISTATS   *stats;           /* -S statistics (NULL if not wanted)   */
+   OUTBUF     *display,         /* Buffer for -d (NULL without -d)      */
+              *cells;           /* --cells file (NULL if not wanted)    */
+}  CONTEXT;
+
+/* The input text for one table in threaded batch mode, and the output
+   it produced
+*/
+typedef struct
+{
+   char   *input,       /* Input lines for the table - text or the
+                           mapped input file                            */
+          *text,        /* Copy of the input lines if not mapped        */
+          *outText,     /* Results                                      */
+          *errText;     /* Warnings                                     */
+   size_t length,       /* Length of input                              */
+          size,         /* Allocated size of text                       */
+          outLength,
+          errLength;
+   int    number;       /* Table number (from 1)                        */
+}  CHUNK;
+
+typedef struct
+{
+   OPTIONS *opts;
+   CHUNK   *chunks;
+   CONTEXT **contexts;  /* One per thread                               */
+   int     maxChunks,   /* Size of chunks array                         */
+           nTables;     /* Tables read so far                           */
+   BOOL    pending;     /* line holds a line not yet used               */
+   char    *line,
+           *name,
+           *tableID;
+   size_t  lineLength,
+           nameSize,
+           tableIDSize;
+}  BATCH;
+
+typedef struct
+{
+   OPTIONS *opts;
+   int     listener;    /* Listening socket for --serve                 */
+}  SERVER;
 
 /************************************************************************/
 /* Prototypes
 */
 int main(int argc, char **argv);
-void ZeroMatrix(int matrix[MAXITEM][MAXITEM]);
-BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM]);
-REAL CalcChiSq(int matrix[MAXITEM][MAXITEM], int *NDoF);
-int CalcNDoF(int Tot1[MAXITEM], int Tot2[MAXITEM]);
+CONTEXT *CreateContext(OPTIONS *opts, FILE *out, FILE *err);
+void FreeContext(CONTEXT *ctx);
+BOOL ReadData(LINEREADER *in, CONTEXT *ctx, BOOL *gotTable);
+BOOL IsTableSeparator(char *line, size_t length, char **name,
+                      size_t *nameSize);
+BOOL LoadTable(CONTEXT *ctx, char *data, size_t size);
+BOOL SaveTable(CONTEXT *ctx, char *fileName);
+void AnalyzeTable(CONTEXT *ctx);
+void CalcCellSignificance(CONTEXT *ctx);
+REAL CalcChiSq(CONTEXT *ctx, int *NDoF, REAL *exactP, REAL *simP,
+               REAL *g, REAL *williams);
+int ExpectedsMethod(OPTIONS *opts);
 void Usage(void);
-void PrintMatrix(int matrix[MAXITEM][MAXITEM]);
-BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile);
+void PrintMatrix(CONTEXT *ctx);
+void WriteCells(CONTEXT *ctx);
+BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile,
+                  OPTIONS *opts);
+BOOL RunThreadedBatch(LINEREADER *in, FILE *out, OPTIONS *opts);
+int  ReadChunks(LINEREADER *in, BATCH *batch);
+BOOL AddToChunk(CHUNK *chunk, char *line, size_t length, BOOL mapped);
+void AnalyzeChunk(void *data, int task, int thread);
+BOOL RunServer(OPTIONS *opts);
+void ServeConnections(void *data, int task, int thread);
+void AnswerRequest(CONTEXT *ctx, char *request, size_t length);
+BOOL RunUpdates(LINEREADER *in, FILE *out, OPTIONS *opts);
 
 /************************************************************************/
 /*>int main(int argc, char **argv)
@@ -110,34 +282,185 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile);
    Main program for chi squared calculation
 
    21.06.94 Original    By: ACRM
+   17.10.26 The table is now allocated to the size of the data
+   17.10.26 Added batch mode - loops over the tables in the file
+   17.10.26 Uses a CONTEXT. Batch mode may be run on several threads
+   17.10.26 Prints a header for TSV output
+   17.10.26 Input is read through a LINEREADER
+   17.10.26 Reads binary table files and writes them with -w
+   17.10.26 Added --serve
+   17.10.26 Added -u
+   17.10.26 Added -B. It runs on -j threads (or all processors) unless
+            the tables are already being analyzed on several threads
+   17.10.26 Added -S. Each phase of the run is timed
+   17.10.26 Added -r
+   17.10.26 Added --cells
 */
 int main(int argc, char **argv)
 {
-   FILE *in = stdin,
-        *out = stdout;
-   REAL chisq;
-   int  dof;
-   static int  matrix[MAXITEM][MAXITEM];
-   char InFile[160], OutFile[160];
+   FILE       *in = stdin,
+              *out = stdout;
+   LINEREADER *reader;
+   BOOL       gotTable,
+              binary,
+              cellsOK,
+              ok = TRUE;
+   OPTIONS    opts;
+   CONTEXT    *ctx;
+   CHISTATS   *stats = NULL;
+   FILE       *cellsFp = NULL;
+   OUTBUF     *cells   = NULL;
+   char       InFile[160], OutFile[160],
+              *data;
+   size_t     size;
 
-   if(!ParseCmdLine(argc, argv, InFile, OutFile))
+   if(!ParseCmdLine(argc, argv, InFile, OutFile, &opts) ||
+      (opts.batch && (opts.writeFile != NULL)) ||
+      ((opts.serve != NULL) &&
+       (opts.batch || (opts.writeFile != NULL) || InFile[0])) ||
+      (opts.raw && (opts.gotExpecteds || opts.update)) ||
+      (opts.update &&
+       (opts.batch || opts.display || opts.yates || opts.gotExpecteds ||
+        opts.firstAsExpecteds || opts.cellSig || opts.result.gStat ||
+        (opts.writeFile != NULL) || (opts.serve != NULL))) ||
+      (opts.result.gStat && opts.cellSig) ||
+      (opts.nReps &&
+       (opts.gotExpecteds || opts.firstAsExpecteds || opts.cellSig ||
+        opts.update)) ||
+      ((opts.stats || (opts.cellsFile != NULL)) &&
+       ((opts.batch && (opts.nThreads > 1)) || (opts.serve != NULL) ||
+        opts.update)))
    {
       Usage();
    }
+   else if(opts.serve != NULL)
+   {
+      return(RunServer(&opts) ? 0 : 1);
+   }
    else
    {
+      if(opts.stats)
+      {
+         if((stats = CreateStats(opts.perf)) == NULL)
+         {
+            fprintf(stderr,"No memory for statistics\n");
+            return(1);
+         }
+         StartPhase(stats, STATS_OPEN);
+      }
+
       if(blOpenStdFiles(InFile, OutFile, &in, &out))
       {
-         ZeroMatrix(matrix);
-   
-         if(ReadData(in, matrix))
+         if((reader = OpenLineReader(in)) == NULL)
+         {
+            fprintf(stderr,"No memory for input\n");
+            return(1);
+         }
+
+         /* A binary table file holds a single table                    */
+         binary = (((data = MappedText(reader, &size)) != NULL) &&
+                   IsTableFile(data, size));
+         if(binary && opts.batch)
+         {
+            fprintf(stderr,"Binary table files cannot be used in batch \
+mode\n");
+            return(1);
+         }
+
+         if(opts.update)
+         {
+            if(binary)
+            {
+               fprintf(stderr,"Binary table files cannot be used with \
+-u\n");
+               return(1);
+            }
+            PrintResultHeader(out, &(opts.result), FALSE);
+            ok = RunUpdates(reader, out, &opts);
+            CloseLineReader(reader);
+            return(ok ? 0 : 1);
+         }
+
+         if(!opts.cellSig)
+            PrintResultHeader(out, &(opts.result), opts.batch);
+
+         if(opts.batch && (opts.nThreads > 1))
+         {
+            ok = RunThreadedBatch(reader, out, &opts);
+            CloseLineReader(reader);
+            return(ok ? 0 : 1);
+         }
+
+         if((ctx = CreateContext(&opts, out, stderr)) == NULL)
+         {
+            fprintf(stderr,"No memory for labels\n");
+            return(1);
+         }
+         ctx->nThreads = (opts.nThreads ? opts.nThreads :
+                          NumProcessors());
+         ctx->stats    = stats;
+
+         if(opts.cellsFile != NULL)
          {
-            if(gDisplay)
-               PrintMatrix(matrix);
-            
-            chisq = CalcChiSq(matrix, &dof);
-            printf("ChiSq = %f with %d degrees of freedom\n", chisq, dof);
+            if(((cellsFp = fopen(opts.cellsFile, "w")) == NULL) ||
+               ((cells = CreateOutBuf(cellsFp, 0)) == NULL))
+            {
+               fprintf(stderr,"Error: unable to write %s\n",
+                       opts.cellsFile);
+               FreeContext(ctx);
+               return(1);
+            }
+            if(opts.batch)
+               OutBufString(cells, "table\t");
+            OutBufString(cells, "row\tcolumn\tobserved\texpected\t\
+contribution\n");
+            ctx->cells = cells;
+         }
+
+         StartPhase(stats, STATS_READ);
+         if(binary)
+         {
+            if((ok = LoadTable(ctx, data, size)) &&
+               ((opts.writeFile == NULL) ||
+                (ok = SaveTable(ctx, opts.writeFile))))
+               AnalyzeTable(ctx);
          }
+         else
+         {
+            /* In batch mode, each table is read, analyzed and then
+               cleared in turn
+            */
+            while((ok = ReadData(reader, ctx, &gotTable)) && gotTable)
+            {
+               if((opts.writeFile != NULL) &&
+                  !(ok = SaveTable(ctx, opts.writeFile)))
+                  break;
+               AnalyzeTable(ctx);
+               if(!opts.batch)
+                  break;
+               StartPhase(stats, STATS_CLEAR);
+               ClearContab(ctx->table);
+               StartPhase(stats, STATS_READ);
+            }
+         }
+
+         if((stats != NULL) && !WriteStats(stats, opts.statsFile))
+            ok = FALSE;
+         if(cells != NULL)
+         {
+            cellsOK = FreeOutBuf(cells);
+            if(fclose(cellsFp) || !cellsOK)
+            {
+               fprintf(stderr,"Error: unable to write %s\n",
+                       opts.cellsFile);
+               ok = FALSE;
+            }
+         }
+         FreeStats(stats);
+         FreeContext(ctx);
+         CloseLineReader(reader);
+         if(!ok)
+            return(1);
       }
       else
       {
@@ -149,242 +472,607 @@ int main(int argc, char **argv)
 }
 
 /************************************************************************/
-/*>void ZeroMatrix(int matrix[MAXITEM][MAXITEM])
-   ---------------------------------------------
-   Zeroes the data matrix
+/*>CONTEXT *CreateContext(OPTIONS *opts, FILE *out, FILE *err)
+   -----------------------------------------------------------
+   Input:   OPTIONS *opts    Options (kept by reference)
+            FILE    *out     Where results are to be written
+            FILE    *err     Where warnings are to be written
+   Returns: CONTEXT *        New context with an empty table (NULL if
+                             no memory)
 
-   09.02.94 Original    By: ACRM
+   17.10.26 Original    By: ACRM
+   17.10.26 Table names are allocated so they may be any length
+   17.10.26 The table is a CONTAB
+   17.10.26 Sets accumulate for -A
+   17.10.26 ...and raw for -r
+   17.10.26 Creates the buffer for -d
 */
-void ZeroMatrix(int matrix[MAXITEM][MAXITEM])
+CONTEXT *CreateContext(OPTIONS *opts, FILE *out, FILE *err)
 {
-   int i,j;
+   CONTEXT *ctx;
 
-   /* Zero the matrix                                                   */
-   for(i=0; i<MAXITEM; i++)
+   if((ctx = (CONTEXT *)malloc(sizeof(CONTEXT))) == NULL)
+      return(NULL);
+
+   ctx->opts          = opts;
+   ctx->out           = out;
+   ctx->err           = err;
+   ctx->nTables       = 0;
+   ctx->nThreads      = 1;
+   ctx->stats         = NULL;
+   ctx->cells         = NULL;
+   ctx->display       = NULL;
+   ctx->pending       = FALSE;
+   ctx->line          = ctx->name = ctx->tableID = NULL;
+   ctx->lineLength    = ctx->nameSize = ctx->tableIDSize = 0;
+   ctx->table         = CreateContab(opts->gotExpecteds);
+
+   if((ctx->table == NULL) ||
+      (opts->display &&
+       ((ctx->display = CreateOutBuf(out, 0)) == NULL)) ||
+      !CopyToken(&(ctx->name), &(ctx->nameSize), "", 0) ||
+      !CopyToken(&(ctx->tableID), &(ctx->tableIDSize), "", 0))
    {
-      for(j=0; j<MAXITEM; j++)
-      {
-         matrix[i][j] = 0;
-      }
+      FreeContext(ctx);
+      return(NULL);
    }
+   ctx->table->accumulate = opts->accumulate;
+   ctx->table->raw        = opts->raw;
+
+   return(ctx);
 }
 
 /************************************************************************/
-/*>BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM])
-   -----------------------------------------------------
+/*>void FreeContext(CONTEXT *ctx)
+   ------------------------------
+   I/O:     CONTEXT *ctx     Context to free
+
+   The --cells file belongs to the caller and is not closed
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Frees the buffer for -d
+*/
+void FreeContext(CONTEXT *ctx)
+{
+   if(ctx != NULL)
+   {
+      FreeContab(ctx->table);
+      FreeOutBuf(ctx->display);
+      if(ctx->name    != NULL) free(ctx->name);
+      if(ctx->tableID != NULL) free(ctx->tableID);
+      free(ctx);
+   }
+}
+
+/************************************************************************/
+/*>BOOL ReadData(LINEREADER *in, CONTEXT *ctx, BOOL *gotTable)
+   -----------------------------------------------------------
+   Input:   LINEREADER *in       Input file
+   I/O:     CONTEXT    *ctx      Context holding the table to fill in.
+                                 The tableID is set in batch mode
+   Output:  BOOL       *gotTable Was a table read?
+   Returns: BOOL                 Success?
+
    Read data into the matrix
 
+   In batch mode this reads just the next table. Tables are separated
+   by blank lines or lines starting '#table' (optionally followed by a
+   name for the table) or, with -t, the first column gives the table
+   and a new table starts whenever it changes. Tables not given a name
+   are numbered from 1. gotTable is FALSE when there are no more tables.
+
+   Lines with fewer than two labels are ignored and a missing count is
+   taken as zero. With -A, the counts for a cell that appears more than
+   once are summed, otherwise the last one is used. With -r each line
+   is a single observation with no count.
+
    21.06.94 Original    By: ACRM
    04.03.08 Added reading of expecteds
+   17.10.26 Labels are found with a hash table rather than a linear
+            search. The table grows to fit the data so there is no
+            longer a limit on the number of items
+   17.10.26 Maintains the row, column and grand totals as data are read
+   17.10.26 Added batch mode
+   17.10.26 Takes a CONTEXT so it is reentrant
+   17.10.26 Reads from a LINEREADER and splits the line with NextToken()
+            rather than sscanf(). Lines and labels may be any length
+   17.10.26 The cell is set by ContabParseLine()
+   17.10.26 Counts the lines for -S
+   17.10.26 Counts that would become negative or overflow are an error
 */
-BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM])
+BOOL ReadData(LINEREADER *in, CONTEXT *ctx, BOOL *gotTable)
 {
-   int  count;
-   char buffer[MAXBUFF];
-   char item1[MAXBUFF], item2[MAXBUFF];
-   int  MatPos1,    MatPos2,
-        i, j;
-   REAL expect;
+   OPTIONS *opts  = ctx->opts;
+   char    *token,
+           *data, *end,
+           number[24];
+   size_t  length;
+   int     status;
 
-   for(i=0; i<MAXITEM; i++)
-      for(j=0; j<MAXITEM; j++)
-         matrix[i][j] = 0;
+   *gotTable = !opts->batch;
 
-   while(fgets(buffer,MAXBUFF,in))
+   /* The previous call may have read the first line of this table      */
+   while(ctx->pending ||
+         ((ctx->line = ReadLine(in, &(ctx->lineLength))) != NULL))
    {
-      if(gGotExpecteds)
-      {
-         sscanf(buffer,"%s %s %d %lf",item1,item2,&count,&expect);
-      }
-      else
-      {
-         sscanf(buffer,"%s %s %d",item1,item2,&count);
-      }
+      if((ctx->stats != NULL) && !ctx->pending)
+         ctx->stats->nLines++;
+      ctx->pending = FALSE;
+      data         = ctx->line;
+      end          = ctx->line + ctx->lineLength;
 
-      /* Find the matrix position for the first item                    */
-      MatPos1 = (-1);
-      for(i=0; i<gNItem1; i++)
+      if(opts->batch)
       {
-         if(!strcmp(item1,gItemList1[i]))
+         if(IsTableSeparator(ctx->line, ctx->lineLength, &(ctx->name),
+                             &(ctx->nameSize)))
          {
-            MatPos1 = i;
-            break;
+            /* End of a table. This line is read again by the next call
+               so a name given on a '#table' line is picked up
+            */
+            if(*gotTable && !opts->tableColumn)
+            {
+               ctx->pending = TRUE;
+               return(TRUE);
+            }
+            continue;
          }
-      }
-      if(MatPos1 == (-1))
-      {
-         strcpy(gItemList1[gNItem1],item1);
-         MatPos1 = gNItem1++;
-         if(MatPos1 >= MAXITEM)
+
+         if(opts->tableColumn)
          {
-            fprintf(stderr,"Too many items in first column\n");
-            return(FALSE);
+            /* Split off the table name and see if it has changed       */
+            if((token = NextToken(&data, end, &length)) == NULL)
+            {
+               token  = data;
+               length = 0;
+            }
+            if(*gotTable &&
+               (strncmp(token, ctx->tableID, length) ||
+                ctx->tableID[length]))
+            {
+               ctx->pending = TRUE;
+               return(TRUE);
+            }
+            if(!CopyToken(&(ctx->tableID), &(ctx->tableIDSize), token,
+                          length))
+            {
+               fprintf(ctx->err,"No memory for table name\n");
+               return(FALSE);
+            }
          }
-      }
-      
-      /* Find the matrix position for the second item                   */
-      MatPos2 = (-1);
-      for(i=0; i<gNItem2; i++)
-      {
-         if(!strcmp(item2,gItemList2[i]))
+
+         /* First line of a new table                                   */
+         if(!*gotTable)
          {
-            MatPos2 = i;
-            break;
+            *gotTable = TRUE;
+            ctx->nTables++;
+            if(!opts->tableColumn)
+            {
+               if(ctx->name[0])
+               {
+                  token = ctx->name;
+               }
+               else
+               {
+                  sprintf(number, "%d", ctx->nTables);
+                  token = number;
+               }
+               if(!CopyToken(&(ctx->tableID), &(ctx->tableIDSize), token,
+                             strlen(token)))
+               {
+                  fprintf(ctx->err,"No memory for table name\n");
+                  return(FALSE);
+               }
+               ctx->name[0] = '\0';
+            }
          }
       }
-      if(MatPos2 == (-1))
+
+      /* Set the cell from the labels, count and expected               */
+      if((status = ContabParseLine(ctx->table, data, end - data)) != 1)
       {
-         strcpy(gItemList2[gNItem2],item2);
-         MatPos2 = gNItem2++;
-         if(MatPos2 >= MAXITEM)
+         if(status < 0)
          {
-            fprintf(stderr,"Too many items in second column\n");
-            return(FALSE);
+            if(opts->batch)
+               fprintf(ctx->err,"%s: ", ctx->tableID);
+            fprintf(ctx->err,"Error: a count would become negative or \
+too large\n");
+         }
+         else
+         {
+            fprintf(ctx->err,"No memory for table\n");
          }
+         return(FALSE);
       }
+   }
+
+   if(in->error)
+   {
+      fprintf(ctx->err,"No memory for input line\n");
+      return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL IsTableSeparator(char *line, size_t length, char **name,
+                         size_t *nameSize)
+   -------------------------------------------------------------
+   Input:   char   *line      Line from the input file (need not be
+                              terminated)
+            size_t length     Length of the line
+   I/O:     char   **name     Table name from a '#table' line, otherwise
+                              unchanged. Grown as needed
+            size_t *nameSize  Allocated size of name
+   Returns: BOOL              Is this a table separator?
+
+   Tests whether a line separates tables in batch mode. This is either a
+   blank line or a line starting '#table' which may be followed by a
+   name for the next table.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Takes the line length and the name may be any length
+*/
+BOOL IsTableSeparator(char *line, size_t length, char **name,
+                      size_t *nameSize)
+{
+   char   *chp,
+          *end = line + length,
+          *token;
+   size_t tokenLength;
+
+   for(chp=line; (chp < end) && ((*chp == ' ') || (*chp == '\t')); chp++);
+   if((chp == end) || (*chp == '\0') || (*chp == '\n') || (*chp == '\r'))
+      return(TRUE);
 
-      /* Fill in the value in the matrix                                */
-      matrix[MatPos1][MatPos2] = count;
-      if(gGotExpecteds)
+   if((end - chp >= 6) && !strncmp(chp, "#table", 6))
+   {
+      chp += 6;
+      if((token = NextToken(&chp, end, &tokenLength)) == NULL)
       {
-         gExpecteds[MatPos1][MatPos2] = expect;
+         token       = chp;
+         tokenLength = 0;
       }
+      if(!CopyToken(name, nameSize, token, tokenLength))
+         (*name)[0] = '\0';
+      return(TRUE);
    }
 
+   return(FALSE);
+}
+
+/************************************************************************/
+/*>BOOL LoadTable(CONTEXT *ctx, char *data, size_t size)
+   -----------------------------------------------------
+   I/O:     CONTEXT *ctx     Context to hold the table
+   Input:   char    *data    Binary table file mapped into memory
+            size_t  size     Size of the file
+   Returns: BOOL             Success?
+
+   Loads a binary table file written with -w. The labels and, if the
+   counts are stored dense, the counts, expecteds and totals are used
+   where they are in the mapped file so nothing is parsed or copied.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Loaded by ContabLoad()
+*/
+BOOL LoadTable(CONTEXT *ctx, char *data, size_t size)
+{
+   const char *error;
+
+   if(!ContabLoad(ctx->table, data, size, &error))
+   {
+      fprintf(ctx->err,"Error: %s\n", error);
+      return(FALSE);
+   }
    return(TRUE);
 }
 
 /************************************************************************/
-/*>REAL CalcChiSq(int matrix[MAXITEM][MAXITEM], int *NDoF)
-   -------------------------------------------------------
-   Actually calculate the Chi squared value
+/*>BOOL SaveTable(CONTEXT *ctx, char *fileName)
+   --------------------------------------------
+   Input:   CONTEXT *ctx       Context holding the table
+            char    *fileName  File to write
+   Returns: BOOL               Success?
+
+   Writes the table as a binary table file that can be read back in
+   place of the text file
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Written by ContabSave()
+*/
+BOOL SaveTable(CONTEXT *ctx, char *fileName)
+{
+   FILE *fp;
+   BOOL ok;
+
+   if((fp = fopen(fileName, "wb")) == NULL)
+   {
+      fprintf(ctx->err,"Error: unable to write %s\n", fileName);
+      return(FALSE);
+   }
+   ok = ContabSave(ctx->table, fp);
+   if(fclose(fp))
+      ok = FALSE;
+   if(!ok)
+      fprintf(ctx->err,"Error: unable to write %s\n", fileName);
+
+   return(ok);
+}
+
+/************************************************************************/
+/*>void AnalyzeTable(CONTEXT *ctx)
+   -------------------------------
+   I/O:     CONTEXT *ctx     Context holding the table
+
+   Calculates chi squared for the table and prints the result
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added -c
+   17.10.26 Result is printed by PrintResult() so it may include the
+            p-value and be in TSV or JSON
+   17.10.26 Prints the exact p-value if there is one
+   17.10.26 ...and the simulated p-value
+   17.10.26 ...and G
+   17.10.26 Times the phases and collects the counts for -S
+   17.10.26 Writes the cells for --cells
+*/
+void AnalyzeTable(CONTEXT *ctx)
+{
+   REAL chisq,
+        exactP,
+        simP,
+        g,
+        williams;
+   int  dof;
+
+   if(ctx->stats != NULL)
+   {
+      /* Before the label tables are cleared for the next table        */
+      ctx->stats->nTables++;
+      AddLabelStats(ctx->stats, ctx->table->labels1);
+      AddLabelStats(ctx->stats, ctx->table->labels2);
+      StartPhase(ctx->stats, STATS_OUTPUT);
+   }
+
+   if(ctx->opts->display)
+      PrintMatrix(ctx);
+   if(ctx->cells != NULL)
+      WriteCells(ctx);
+
+   if(ctx->opts->cellSig)
+   {
+      StartPhase(ctx->stats, STATS_CHISQ);
+      CalcCellSignificance(ctx);
+      return;
+   }
+
+   chisq = CalcChiSq(ctx, &dof, &exactP, &simP, &g, &williams);
+   StartPhase(ctx->stats, STATS_OUTPUT);
+   PrintResult(ctx->out, &(ctx->opts->result),
+               (ctx->opts->batch ? ctx->tableID : NULL), chisq, dof,
+               exactP, simP, g, williams);
+}
+
+/************************************************************************/
+/*>REAL CalcChiSq(CONTEXT *ctx, int *NDoF, REAL *exactP, REAL *simP,
+                   REAL *g, REAL *williams)
+   ------------------------------------------------------------------
+   Input:   CONTEXT *ctx      Context holding the table
+   Output:  int     *NDoF     Degrees of freedom
+            REAL    *exactP   Exact p-value (-1 if not calculated)
+            REAL    *simP     Simulated p-value (-1 if not calculated)
+            REAL    *g        G statistic (-1 without -g)
+            REAL    *williams Williams' correction for G
+   Returns: REAL              Chi squared
+
+   Actually calculate the Chi squared value. If more than 25% of the
+   expecteds are below 5 and they come from the margins, the exact
+   p-value is also calculated with ContabExactTestLimit() (unless -x).
+   Its budget is small so it can be run on every table in batch mode.
+   A one-line note is given whenever it is needed but skipped. With -B, the
+   Monte Carlo p-value is calculated with ContabMonteCarlo() from the
+   table's own totals. G comes from the same pass over the cells as
+   chi squared but is only given with -g.
 
    09.02.94 Original    By: ACRM
    16.12.94 Cast values in calculation of expected (was being done as int)
    06.08.03 Added Yates correction
    03.04.08 Added obtaining expecteds from file
    03.10.17 Added warnings
+   17.10.26 Loops are bounded by the number of items rather than MAXITEM
+   17.10.26 Totals are now collected by ReadData() so this is a single
+            pass over the cells
+   17.10.26 Warnings give the table name in batch mode
+   17.10.26 Takes a CONTEXT so it is reentrant
+   17.10.26 Each row is summed by the vectorized kernel in chikern.c.
+            The display is done in a separate loop
+   17.10.26 Chi squared is calculated by ContabChiSq(). This just does
+            the display and warnings
+   17.10.26 Added exact test
+   17.10.26 Added Monte Carlo test
+   17.10.26 Added G
+   17.10.26 Times chi squared and the tests separately for -S
+   17.10.26 The display is written through ctx->display
+   17.10.26 The exact test has a budget of EXACTQUICKCELLS and may be
+            turned off with -x
+   17.10.26 Always notes when the exact test is needed but skipped
 */
-REAL CalcChiSq(int matrix[MAXITEM][MAXITEM], int *NDoF)
+REAL CalcChiSq(CONTEXT *ctx, int *NDoF, REAL *exactP, REAL *simP,
+               REAL *g, REAL *williams)
 {
-   REAL chisq = (REAL)0.0,
-        observed,
-        expected;
-   int  i, j, NObs = 0, NCells = 0, NSmall = 0, NZero = 0,
-        Tot1[MAXITEM], Tot2[MAXITEM];
-   
-   /* Find total number of observations                                 */
-   for(i=0; i<MAXITEM; i++)
-   {
-      Tot1[i] = Tot2[i] = 0;
-      for(j=0; j<MAXITEM; j++)
-      {
-         NObs += matrix[i][j];
-      }
-   }
-
-   if(gDisplay)
-      printf("\nTotal observations: %d\n\n",NObs);
+   OPTIONS   *opts = ctx->opts;
+   CONTAB    *ct   = ctx->table;
+   OUTBUF    *ob   = ctx->display;
+   CHIRESULT result;
+   double    pValue;
+   int       i, j, status,
+             method = ExpectedsMethod(opts);
 
-   /* Find the matrix totals                                            */
-   for(i=0; i<MAXITEM; i++)
-      for(j=0; j<MAXITEM; j++)
-         Tot1[i] += matrix[i][j];
-   for(j=0; j<MAXITEM; j++)
-      for(i=0; i<MAXITEM; i++)
-         Tot2[j] += matrix[i][j];
+   *exactP = *simP = (REAL)(-1.0);
 
-   /* Calc DoFs                                                         */
-   *NDoF = CalcNDoF(Tot1,Tot2);
-
-   /* Step through positions in matrix                                  */
-   for(i=0; i<MAXITEM; i++)
+   /* Display the observed and expected values                         */
+   if(opts->display)
    {
-      for(j=0; j<MAXITEM; j++)
+      ob->fp = ctx->out;
+      OutBufString(ob, "\nTotal observations: ");
+      OutBufInt(ob, ct->nObs, 0);
+      OutBufString(ob, "\n\n");
+
+      /* Each line is "row, column: Obs %5.1f Exp %5.1f"                */
+      for(i=0; i<ct->nItem1; i++)
       {
-         if(Tot1[i] && Tot2[j])
+         for(j=0; j<ct->nItem2; j++)
          {
-            /* Calculate expected value at this cell                    */
-            if(gGotExpecteds)
-            {
-               expected = gExpecteds[i][j];
-            }
-            else if(gFirstAsExpecteds)   /* V1.7 16.06.09               */
+            if(ct->tot1[i] && ct->tot2[j])
             {
-               expected = (REAL)matrix[0][j] * (REAL)Tot1[i] / (REAL)Tot1[0];
+               OutBufString(ob, CONTABROW(ct, i));
+               OutBufText(ob, ", ", 2);
+               OutBufString(ob, CONTABCOLUMN(ct, j));
+               OutBufText(ob, ": Obs ", 6);
+               OutBufReal(ob, (REAL)CONTABCELL(ct, i, j), 5, 1);
+               OutBufText(ob, " Exp ", 5);
+               OutBufReal(ob, (REAL)ContabExpected(ct, method, i, j),
+                          5, 1);
+               OutBufChar(ob, '\n');
             }
-            else
-            {
-               expected = (REAL)Tot1[i] * (REAL)Tot2[j] / (REAL)NObs;
-            }
-            
-            observed = (REAL)matrix[i][j];
+         }
+      }
+      FlushOutBuf(ob);
+   }
 
-            NCells++;
+   StartPhase(ctx->stats, STATS_CHISQ);
+   ContabChiSq(ct, method, opts->yates, opts->result.gStat, &result);
+   AddResultStats(ctx->stats, &result);
+   StartPhase(ctx->stats, STATS_TESTS);
+   *NDoF     = result.dof;
+   *g        = (REAL)result.g;
+   *williams = (REAL)result.williams;
 
-            if(gDisplay)
-               printf("%s, %s: Obs %5.1f Exp %5.1f\n",
-                      gItemList1[i],gItemList2[j],observed,expected);
-            
-            /* Add to chisq value                                       */
-            if(expected > SMALL)
-            {
-               if(expected < (REAL)5.0)
-               {
-                  NSmall++;
-               }
+   if(result.warnings & CHIWARN_ZERO)
+   {
+      if(opts->batch)
+         fprintf(ctx->err,"%s: ", ctx->tableID);
+      fprintf(ctx->err,"Warning: %d expecteds were < %g and not included\n",
+              result.nZero, SMALL);
+   }
 
-               if(gYates && (*NDoF == 1))
-               {
-                  chisq += ((ABS(observed - expected)-0.5) *
-                            (ABS(observed - expected)-0.5)) / expected;
-               }
-               else
-               {
-                  chisq += (observed - expected)*(observed - expected) / 
-                     expected;
-               }
-            }
+   if(result.warnings & CHIWARN_SMALL)
+   {
+      if(opts->batch)
+         fprintf(ctx->err,"%s: ", ctx->tableID);
+      fprintf(ctx->err,"Warning: More than 25%% of expecteds were < 5\n");
+
+      if((method == CHIEXP_MARGINS) && opts->result.exact)
+      {
+         if((status = ContabExactTestLimit(ct, EXACTQUICKCELLS, &pValue))
+            == 1)
+         {
+            *exactP = (REAL)pValue;
+         }
+         else
+         {
+            if(opts->batch)
+               fprintf(ctx->err,"%s: ", ctx->tableID);
+            if(status < 0)
+               fprintf(ctx->err,"Note: Exact test skipped as the table \
+is too large\n");
             else
-            {
-               NZero++;
-            }
+               fprintf(ctx->err,"Warning: No memory for the exact \
+test\n");
          }
       }
+      else if(opts->result.exact)
+      {
+         if(opts->batch)
+            fprintf(ctx->err,"%s: ", ctx->tableID);
+         fprintf(ctx->err,"Note: Exact test skipped as the expecteds \
+are not from the totals\n");
+      }
    }
 
-   if(NZero)
+   if(opts->nReps)
    {
-      fprintf(stderr,"Warning: %d expecteds were < %g and not included\n",
-              NZero, SMALL);
-   }
-               
-   if ((NSmall / (REAL)NCells) > 0.25)
-   {
-      fprintf(stderr,"Warning: More than 25%% of expecteds were < 5\n");
+      if(ContabMonteCarlo(ct, opts->nReps, opts->seed, ctx->nThreads,
+                          &pValue))
+      {
+         *simP = (REAL)pValue;
+      }
+      else
+      {
+         if(opts->batch)
+            fprintf(ctx->err,"%s: ", ctx->tableID);
+         fprintf(ctx->err,"Warning: No memory for the Monte Carlo \
+test\n");
+      }
    }
 
-   return(chisq);
+   return((REAL)result.chisq);
 }
 
 /************************************************************************/
-/*>int CalcNDoF(int Tot1[MAXITEM], int Tot2[MAXITEM])
-   --------------------------------------------------
-   Calculate number of degress of freedom
+/*>void CalcCellSignificance(CONTEXT *ctx)
+   ---------------------------------------
+   I/O:     CONTEXT *ctx     Context holding the table
 
-   09.02.94 Original    By: ACRM
+   Tests each cell for significance by comparing it with the rest of the
+   table as a 2x2 table (see ContabCellSig()). The p-value is
+   Bonferroni-corrected for the number of cells (unless -n). Cells are
+   reported as SIGNIFICANT if p < SIGLEVEL and (unless -l) all four
+   expecteds are at least 5.
+
+   Replaces cellsignificance.pl which ran chisq and chisig on a
+   temporary file for each cell. The output format is the same.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Each cell is tested by ContabCellSig()
 */
-int CalcNDoF(int Tot1[MAXITEM], int Tot2[MAXITEM])
+void CalcCellSignificance(CONTEXT *ctx)
 {
-   int i, rows, cols;
-   
-   for(i=0,rows=0; i<MAXITEM; i++)
-      if(Tot1[i]) rows++;
+   CONTAB  *ct = ctx->table;
+   CELLSIG cs;
+   REAL    pvalue, bonferroni;
+   int     i, j;
+
+   bonferroni = (ctx->opts->noBonferroni ? (REAL)1.0 :
+                 (REAL)ct->nItem1 * (REAL)ct->nItem2);
+
+   for(i=0; i<ct->nItem1; i++)
+   {
+      for(j=0; j<ct->nItem2; j++)
+      {
+         ContabCellSig(ct, i, j, &cs);
 
-   for(i=0,cols=0; i<MAXITEM; i++)
-      if(Tot2[i]) cols++;
+         if(ctx->opts->batch)
+            fprintf(ctx->out, "%s: ", ctx->tableID);
+         fprintf(ctx->out, "%s %s Chi=%f  [%.1f %.1f] %s ",
+                 CONTABROW(ct, i), CONTABCOLUMN(ct, j),
+                 cs.chisq, cs.observed, cs.expected[0],
+                 ((cs.observed > cs.expected[0]) ? "over" : "under"));
 
-   return((rows-1) * (cols-1));
+         pvalue = cs.pValue * bonferroni;
+         if((pvalue < SIGLEVEL) && (ctx->opts->lowOK || !cs.lowExpected))
+            fprintf(ctx->out, "SIGNIFICANT (p=%.5g)", pvalue);
+         fprintf(ctx->out, "\n");
+      }
+   }
+}
+
+/************************************************************************/
+/*>int ExpectedsMethod(OPTIONS *opts)
+   ----------------------------------
+   Input:   OPTIONS *opts    The options
+   Returns: int              How expecteds are obtained (CHIEXP_...)
+
+   17.10.26 Original    By: ACRM
+*/
+int ExpectedsMethod(OPTIONS *opts)
+{
+   if(opts->gotExpecteds)
+      return(CHIEXP_GIVEN);
+   if(opts->firstAsExpecteds)                   /* V1.7 16.06.09        */
+      return(CHIEXP_FIRSTROW);
+   return(CHIEXP_MARGINS);
 }
 
 /************************************************************************/
@@ -397,18 +1085,192 @@ int CalcNDoF(int Tot1[MAXITEM], int Tot2[MAXITEM])
    04.03.08 V1.5 - Added -e
    03.11.08 V1.6 Improved usage message!
    03.10.17 V1.8
+   17.10.26 V1.9
+   17.10.26 V1.10 Table size is no longer limited
+   17.10.26 V1.12 Added -b and -t
+   17.10.26 V1.13 Added -j
+   17.10.26 V1.14 Added -c, -n and -l
+   17.10.26 V1.15 Added -p, -a and -o
+   17.10.26 V1.16
+   17.10.26 V1.17 Added -w
+   17.10.26 V1.18
+   17.10.26 V1.19 Added --serve
+   17.10.26 V1.20 Added -u
+   17.10.26 V1.21 Describes the exact test
+   17.10.26 V1.22 Added -B and -s
+   17.10.26 V1.23 Added -g
+   17.10.26 V1.24 Added -S, --stats and --perf
+   17.10.26 V1.25 Added -A
+   17.10.26 V1.26 Added -r
+   17.10.26 V1.27 Added --cells
+   17.10.26 V1.28 Added -x
+   17.10.26 V1.29 Binary requests to --serve are checked
+   17.10.26 V1.32 --serve connections time out when idle
 */
 void Usage(void)
 {
-   fprintf(stderr,"ChiSq V1.8 (c) 1994-2009 Andrew C.R. Martin, UCL\n");
-   fprintf(stderr,"Usage: chisq [-d] [-y] [-e] [-f] [in [out]]\n");
+   fprintf(stderr,"ChiSq V1.32 (c) 1994-2026 Andrew C.R. Martin, UCL\n");
+   fprintf(stderr,"Usage: chisq [-d] [-y] [-e|-r] [-f] [-A] [-b] [-t] \
+[-j n] [-c [-n] [-l]]\n");
+   fprintf(stderr,"             [-p] [-g] [-a alpha] [-o text|tsv|json] \
+[-B n [-s seed]]\n");
+   fprintf(stderr,"             [-x] [-w file] [-S [--stats file] \
+[--perf]] [--cells file]\n");
+   fprintf(stderr,"             [in [out]]\n");
+   fprintf(stderr,"       chisq -u [-p] [-a alpha] [-o text|tsv|json] \
+[in [out]]\n");
+   fprintf(stderr,"       chisq --serve socket [-j n] [-d] [-y] [-e|-r] \
+[-f] [-A] [-c [-n] [-l]]\n");
+   fprintf(stderr,"             [-p] [-g] [-a alpha] [-o text|tsv|json] \
+[-B n [-s seed]]\n");
    fprintf(stderr,"       -d Display observed and expected values\n");
    fprintf(stderr,"       -y Apply Yates correction\n");
    fprintf(stderr,"       -e Expecteds appear in the file\n");
-   fprintf(stderr,"       -f Use first dataset observeds as expecteds\n\n");
+   fprintf(stderr,"       -f Use first dataset observeds as expecteds\n");
+   fprintf(stderr,"       -A Add up the counts (and expecteds) for cells \
+that appear more\n");
+   fprintf(stderr,"          than once rather than using the last\n");
+   fprintf(stderr,"       -r Raw input - each line is one observation: \
+item1 item2\n");
+   fprintf(stderr,"       -b Batch mode - the file contains several tables\n");
+   fprintf(stderr,"       -t Batch mode with the table name in the first \
+column\n");
+   fprintf(stderr,"       -j Use n threads in batch mode or serve n \
+clients at once with\n");
+   fprintf(stderr,"          --serve (0 uses all processors, the default \
+with --serve)\n");
+   fprintf(stderr,"          Otherwise -B uses n threads (default all \
+processors)\n");
+   fprintf(stderr,"       -c Calculate the significance of each cell\n");
+   fprintf(stderr,"       -n Do not apply Bonferroni correction with -c\n");
+   fprintf(stderr,"       -l Allow cells with low expecteds to be \
+significant with -c\n");
+   fprintf(stderr,"       -p Print the p-value\n");
+   fprintf(stderr,"       -g Also give the G (likelihood ratio) \
+statistic\n");
+   fprintf(stderr,"       -a Print the critical value at significance \
+level alpha\n");
+   fprintf(stderr,"       -o Output format (default text). TSV and JSON \
+always include\n");
+   fprintf(stderr,"          the p-value. JSON has one object per line\n");
+   fprintf(stderr,"       -x Do not do the exact test when expecteds are \
+small\n");
+   fprintf(stderr,"       -w Also write the table to a binary table file \
+(not with -b)\n");
+   fprintf(stderr,"       -u Update mode - the input is a stream of \
+changes to cells\n");
+   fprintf(stderr,"       -B Also give a p-value simulated from n random \
+tables\n");
+   fprintf(stderr,"       -s Random number seed for -B (default %lu)\n",
+           DEFSEED);
+   fprintf(stderr,"       -S Report the time in each phase and counts of \
+the work done\n");
+   fprintf(stderr,"          on stderr (not with -j n>1 in batch mode, \
+--serve or -u)\n");
+   fprintf(stderr,"       --stats Write the -S report to a file as JSON \
+instead\n");
+   fprintf(stderr,"       --perf  Also count instructions, cycles and \
+cache misses with -S\n");
+   fprintf(stderr,"               (Linux only)\n");
+   fprintf(stderr,"       --cells Write the observed, expected and \
+contribution to chi\n");
+   fprintf(stderr,"               squared of each cell to a file as TSV \
+(not with -j n>1\n");
+   fprintf(stderr,"               in batch mode, --serve or -u)\n\n");
    fprintf(stderr,"Input file has format: item1 item2 NObs [Exp]\n");
-   fprintf(stderr,"Max dimensions of contingency table: %d x %d\n\n",
-           MAXITEM, MAXITEM);
+   fprintf(stderr,"The contingency table grows to fit the data\n");
+   fprintf(stderr,"A count for a cell replaces any earlier count for it \
+unless -A is given.\n");
+   fprintf(stderr,"With -r, each line is instead a single observation, \
+item1 item2, and\n");
+   fprintf(stderr,"the observations are counted as they are read.\n");
+   fprintf(stderr,"A count, or a sum of counts with -A, too large for \
+an int is an error.\n");
+   fprintf(stderr,"The input file may also be a binary table file written \
+with -w which\n");
+   fprintf(stderr,"is mapped into memory rather than parsed (so it cannot be \
+piped). Use\n");
+   fprintf(stderr,"-e with it only if it was written with -e.\n\n");
+   fprintf(stderr,"With -u, each line of input has format: item1 item2 \
+Change and adds\n");
+   fprintf(stderr,"Change (which may be negative) to the count for that \
+cell. Chi squared\n");
+   fprintf(stderr,"is printed after every line. It is updated in time \
+proportional to the\n");
+   fprintf(stderr,"size of the row and column changed rather than the \
+whole table, but\n");
+   fprintf(stderr,"no warnings are given.\n\n");
+   fprintf(stderr,"With --serve, chisq listens on a Unix domain socket \
+and answers requests\n");
+   fprintf(stderr,"until killed. Each request holds one table (text or a \
+binary table file)\n");
+   fprintf(stderr,"and is answered with what chisq would print for it. \
+Use chiclient to send\n");
+   fprintf(stderr,"requests. A binary table file whose counts do not add \
+up to its totals\n");
+   fprintf(stderr,"is refused. A connection that is idle for %d seconds \
+is closed.\n\n", IDLETIMEOUT);
+   fprintf(stderr,"In batch mode (-b), tables are separated by blank lines \
+or by lines\n");
+   fprintf(stderr,"starting #table which may be followed by a name for the \
+table. Tables\n");
+   fprintf(stderr,"that are not named are numbered from 1. With -t, the \
+input file has\n");
+   fprintf(stderr,"format: table item1 item2 NObs [Exp] and a new table \
+starts whenever\n");
+   fprintf(stderr,"the table name changes. One result line is printed for \
+each table.\n");
+   fprintf(stderr,"Results are always printed in the order of the input \
+even with -j.\n\n");
+   fprintf(stderr,"With -c, each cell is compared with the rest of the \
+table as a 2x2\n");
+   fprintf(stderr,"contingency table using the Yates correction. Cells are \
+flagged as\n");
+   fprintf(stderr,"SIGNIFICANT if p<%g after Bonferroni correction for the \
+number of\n", SIGLEVEL);
+   fprintf(stderr,"cells, as long as all four expecteds are at least 5.\n\n");
+   fprintf(stderr,"If more than 25%% of the expecteds are below 5, the \
+chi squared\n");
+   fprintf(stderr,"approximation is poor so the exact p-value is also \
+calculated (Fisher's\n");
+   fprintf(stderr,"exact test for a 2x2 table or its extension to larger \
+tables). It is\n");
+   fprintf(stderr,"not done with -e, -f, -u or -x. TSV output has an \
+exact_p column, which\n");
+   fprintf(stderr,"is NA when the test was not needed. The test is only \
+given a small\n");
+   fprintf(stderr,"budget so it is quick enough to run on every table. \
+Larger tables are\n");
+   fprintf(stderr,"skipped, and most are spotted from their totals \
+before starting. A\n");
+   fprintf(stderr,"skipped test is always given a one-line note, so NA \
+with no note means\n");
+   fprintf(stderr,"the test was not needed.\n\n");
+   fprintf(stderr,"With -B, random tables with the same row and column \
+totals are\n");
+   fprintf(stderr,"generated and the p-value is the fraction with chi \
+squared (without the\n");
+   fprintf(stderr,"Yates correction) at least as large as that observed. \
+The same seed\n");
+   fprintf(stderr,"gives the same p-value whatever the number of \
+threads. -B cannot be\n");
+   fprintf(stderr,"used with -e, -f, -c or -u.\n\n");
+   fprintf(stderr,"With -g, G = 2 sum(O ln(O/E)) is also given. It is \
+never Yates\n");
+   fprintf(stderr,"corrected. Its p-value is for G divided by Williams' \
+correction, q,\n");
+   fprintf(stderr,"which is shown when the expecteds come from the \
+margins. -g cannot be\n");
+   fprintf(stderr,"used with -c or -u.\n\n");
+   fprintf(stderr,"With -S, the phases timed are: open (opening the \
+input), read (parsing\n");
+   fprintf(stderr,"lines, which also keeps the totals), chisq, tests \
+(exact and Monte\n");
+   fprintf(stderr,"Carlo), output and clear (between tables in batch \
+mode). The counts\n");
+   fprintf(stderr,"are of input lines, label lookups and the hash slots \
+probed, and the\n");
+   fprintf(stderr,"cells visited, occupied and with small expecteds.\n\n");
    fprintf(stderr,"The Yates correction is (|O-E| - 0.5) and is often\n");
    fprintf(stderr,"used for 2x2 contingency tables\n\n");
    fprintf(stderr,"When using -f, the first occurrence of item1 is used \
@@ -421,48 +1283,127 @@ For other datasets,\n");
 }
 
 /************************************************************************/
-/*>void PrintMatrix(int matrix[MAXITEM][MAXITEM])
-   ----------------------------------------------
+/*>void PrintMatrix(CONTEXT *ctx)
+   ------------------------------
    Print out the matrix
 
    09.02.94 Original    By: ACRM
    15.12.94 Changed print field from 3 to 5
+   17.10.26 Takes a CONTEXT
+   17.10.26 Written through ctx->display
 */
-void PrintMatrix(int matrix[MAXITEM][MAXITEM])
+void PrintMatrix(CONTEXT *ctx)
 {
-   int i, j, jtot;
-   
+   CONTAB *ct = ctx->table;
+   OUTBUF *ob = ctx->display;
+   int    i, j, jtot;
+
 
-   for(i=0; i<gNItem1; i++)
+   ob->fp = ctx->out;
+   for(i=0; i<ct->nItem1; i++)
    {
       jtot = 0;
-      for(j=0; j<gNItem2; j++)
+      for(j=0; j<ct->nItem2; j++)
       {
-         printf("%5d ",matrix[i][j]);
-         jtot += matrix[i][j];
+         OutBufInt(ob, CONTABCELL(ct, i, j), 5);
+         OutBufChar(ob, ' ');
+         jtot += CONTABCELL(ct, i, j);
+      }
+      OutBufText(ob, " : ", 3);
+      OutBufInt(ob, jtot, 0);
+      OutBufChar(ob, '\n');
+   }
+   FlushOutBuf(ob);
+}
+
+/************************************************************************/
+/*>void WriteCells(CONTEXT *ctx)
+   -----------------------------
+   I/O:     CONTEXT *ctx     Context holding the table and the --cells
+                             file
+
+   Writes a TSV line for each cell in a row and column with
+   observations: the labels, observed, expected and the cell's
+   contribution to chi squared (0 if the expected is too small to be
+   included). In batch mode the first column is the table. The buffer is
+   not flushed so tables follow each other without a write for each.
+
+   17.10.26 Original    By: ACRM
+*/
+void WriteCells(CONTEXT *ctx)
+{
+   CONTAB *ct    = ctx->table;
+   OUTBUF *ob    = ctx->cells;
+   int    method = ExpectedsMethod(ctx->opts),
+          yates  = (ctx->opts->yates && (ContabDoF(ct) == 1)),
+          i, j;
+   double expected;
+
+   for(i=0; i<ct->nItem1; i++)
+   {
+      if(!ct->tot1[i])
+         continue;
+
+      for(j=0; j<ct->nItem2; j++)
+      {
+         if(!ct->tot2[j])
+            continue;
+
+         expected = ContabExpected(ct, method, i, j);
+         if(ctx->opts->batch)
+         {
+            OutBufString(ob, ctx->tableID);
+            OutBufChar(ob, '\t');
+         }
+         OutBufString(ob, CONTABROW(ct, i));
+         OutBufChar(ob, '\t');
+         OutBufString(ob, CONTABCOLUMN(ct, j));
+         OutBufChar(ob, '\t');
+         OutBufInt(ob, CONTABCELL(ct, i, j), 0);
+         OutBufChar(ob, '\t');
+         OutBufReal(ob, expected, 0, 6);
+         OutBufChar(ob, '\t');
+         OutBufReal(ob, ChiContribution((double)CONTABCELL(ct, i, j),
+                                        expected, yates), 0, 6);
+         OutBufChar(ob, '\n');
       }
-      printf(" : %d\n",jtot);
    }
 }
 
 
 /************************************************************************/
-/*>BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
+/*>BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile,
+                     OPTIONS *opts)
    ---------------------------------------------------------------------
-   Input:   int    argc         Argument count
-            char   **argv       Argument array
-   Output:  char   *infile      Input file (or blank string)
-            char   *outfile     Output file (or blank string)
-   Globals: int    gDisplay
-            int    gYates
+   Input:   int     argc        Argument count
+            char    **argv      Argument array
+   Output:  char    *infile     Input file (or blank string)
+            char    *outfile    Output file (or blank string)
+            OPTIONS *opts       The options
    Returns: BOOL                Success?
 
    Parse the command line
-   
+
    06.08.03 Original    By: ACRM
    16.06.09 Added -f
+   17.10.26 Added -b and -t
+   17.10.26 Added -j. Options are returned in an OPTIONS structure
+   17.10.26 Added -c, -n and -l
+   17.10.26 Added -p, -a and -o
+   17.10.26 Added -w
+   17.10.26 Added --serve. -j defaults to the number of processors with
+            --serve
+   17.10.26 Added -u
+   17.10.26 Exact tests are only done with expecteds from the margins
+   17.10.26 Added -B and -s
+   17.10.26 Added -S, --stats and --perf
+   17.10.26 Added -A
+   17.10.26 Added -r
+   17.10.26 Added --cells
+   17.10.26 Added -x
 */
-BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
+BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile,
+                  OPTIONS *opts)
 {
    int minArgs = 0,
        maxArgs = 2;
@@ -471,10 +1412,38 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
    argv++;
 
    infile[0] = outfile[0] = '\0';
-   
+
+   opts->display          = FALSE;
+   opts->yates            = FALSE;
+   opts->gotExpecteds     = FALSE;
+   opts->firstAsExpecteds = FALSE;
+   opts->batch            = FALSE;
+   opts->tableColumn      = FALSE;
+   opts->cellSig          = FALSE;
+   opts->noBonferroni     = FALSE;
+   opts->lowOK            = FALSE;
+   opts->update           = FALSE;
+   opts->accumulate       = FALSE;
+   opts->raw              = FALSE;
+   opts->stats            = FALSE;
+   opts->perf             = FALSE;
+   opts->nThreads         = 0;
+   opts->nReps            = 0;
+   opts->seed             = DEFSEED;
+   opts->result.format    = OUTPUT_TEXT;
+   opts->result.pValue    = FALSE;
+   opts->result.alpha     = 0.0;
+   opts->result.exact     = TRUE;
+   opts->result.simulated = FALSE;
+   opts->result.gStat     = FALSE;
+   opts->writeFile        = NULL;
+   opts->serve            = NULL;
+   opts->statsFile        = NULL;
+   opts->cellsFile        = NULL;
+
    if(argc < minArgs)
       return(FALSE);
-   
+
    while(argc)
    {
       if(argv[0][0] == '-')
@@ -482,16 +1451,126 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
          switch(argv[0][1])
          {
          case 'd':
-            gDisplay = TRUE;
+            opts->display = TRUE;
             break;
          case 'y':
-            gYates = TRUE;
+            opts->yates = TRUE;
             break;
          case 'e':
-            gGotExpecteds = TRUE;
+            opts->gotExpecteds = TRUE;
+            opts->result.exact = FALSE;
             break;
          case 'f':
-            gFirstAsExpecteds = TRUE;
+            opts->firstAsExpecteds = TRUE;
+            opts->result.exact = FALSE;
+            break;
+         case 'A':
+            opts->accumulate = TRUE;
+            break;
+         case 'r':
+            opts->raw = TRUE;
+            break;
+         case 'b':
+            opts->batch = TRUE;
+            break;
+         case 't':
+            opts->batch = opts->tableColumn = TRUE;
+            break;
+         case 'c':
+            opts->cellSig = TRUE;
+            break;
+         case 'n':
+            opts->noBonferroni = TRUE;
+            break;
+         case 'l':
+            opts->lowOK = TRUE;
+            break;
+         case 'u':
+            opts->update       = TRUE;
+            opts->result.exact = FALSE;
+            break;
+         case 'p':
+            opts->result.pValue = TRUE;
+            break;
+         case 'g':
+            opts->result.gStat = TRUE;
+            break;
+         case 'S':
+            opts->stats = TRUE;
+            break;
+         case 'x':
+            opts->result.exact = FALSE;
+            break;
+         case 'a':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lf", &(opts->result.alpha)) ||
+               (opts->result.alpha <= 0.0) || (opts->result.alpha >= 1.0))
+               return(FALSE);
+            break;
+         case 'o':
+            argc--;
+            argv++;
+            if(!argc ||
+               ((opts->result.format = ParseOutputFormat(argv[0])) < 0))
+               return(FALSE);
+            break;
+         case 'w':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            opts->writeFile = argv[0];
+            break;
+         case 'B':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%ld", &(opts->nReps)) ||
+               (opts->nReps < 1) || (opts->nReps > MAXREPS))
+               return(FALSE);
+            opts->result.simulated = TRUE;
+            break;
+         case 's':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lu", &(opts->seed)))
+               return(FALSE);
+            break;
+         case 'j':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", &(opts->nThreads)) ||
+               (opts->nThreads < 0))
+               return(FALSE);
+            if(opts->nThreads == 0)
+               opts->nThreads = NumProcessors();
+            break;
+         case '-':
+            if(!strcmp(argv[0], "--perf"))
+            {
+               opts->stats = opts->perf = TRUE;
+               break;
+            }
+            if(strcmp(argv[0], "--serve") && strcmp(argv[0], "--stats") &&
+               strcmp(argv[0], "--cells"))
+               return(FALSE);
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            if(!strcmp(argv[-1], "--serve"))
+            {
+               opts->serve = argv[0];
+            }
+            else if(!strcmp(argv[-1], "--cells"))
+            {
+               opts->cellsFile = argv[0];
+            }
+            else
+            {
+               opts->statsFile = argv[0];
+               opts->stats     = TRUE;
+            }
             break;
          default:
             return(FALSE);
@@ -503,7 +1582,7 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
          /* Check that there are correct number of arguments left       */
          if((argc < minArgs) || (argc > maxArgs))
             return(FALSE);
-         
+
          /* Copy the first to infile                                    */
          if(argc)
          {
@@ -519,13 +1598,580 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
                argv++;
             }
          }
-         
+
          return(TRUE);
       }
       argc--;
       argv++;
    }
-   
+
    return(TRUE);
 }
 
+/************************************************************************/
+/*>BOOL RunThreadedBatch(LINEREADER *in, FILE *out, OPTIONS *opts)
+   ---------------------------------------------------------------
+   Input:   LINEREADER *in      Input file
+            FILE       *out     Output file
+            OPTIONS    *opts    Options
+   Returns: BOOL                Success?
+
+   Batch mode on several threads. The input is split into the text for
+   each table, up to CHUNKSPERTHREAD tables per thread (or MAXBATCHBYTES
+   of input) at a time. These are analyzed on a work-stealing thread
+   pool with one CONTEXT per thread, and the output from each is
+   collected and then written in the original order.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Reads from a LINEREADER
+*/
+BOOL RunThreadedBatch(LINEREADER *in, FILE *out, OPTIONS *opts)
+{
+   BATCH batch;
+   int   i, nChunks;
+   BOOL  ok = TRUE;
+
+   batch.opts      = opts;
+   batch.nTables   = 0;
+   batch.pending   = FALSE;
+   batch.line      = batch.name = batch.tableID = NULL;
+   batch.nameSize  = batch.tableIDSize = 0;
+   batch.maxChunks = CHUNKSPERTHREAD * opts->nThreads;
+   batch.chunks    = (CHUNK *)calloc(batch.maxChunks, sizeof(CHUNK));
+   batch.contexts  = (CONTEXT **)calloc(opts->nThreads, sizeof(CONTEXT *));
+   if((batch.chunks == NULL) || (batch.contexts == NULL) ||
+      !CopyToken(&(batch.name), &(batch.nameSize), "", 0) ||
+      !CopyToken(&(batch.tableID), &(batch.tableIDSize), "", 0))
+   {
+      fprintf(stderr,"No memory for batch\n");
+      return(FALSE);
+   }
+
+   for(i=0; i<opts->nThreads; i++)
+   {
+      if((batch.contexts[i] = CreateContext(opts, NULL, NULL)) == NULL)
+      {
+         fprintf(stderr,"No memory for labels\n");
+         return(FALSE);
+      }
+   }
+
+   while((nChunks = ReadChunks(in, &batch)) > 0)
+   {
+      if(!RunWorkPool(opts->nThreads, nChunks, AnalyzeChunk,
+                      (void *)&batch))
+      {
+         fprintf(stderr,"Unable to start threads\n");
+         ok = FALSE;
+         break;
+      }
+
+      /* Write the results in order                                     */
+      for(i=0; i<nChunks; i++)
+      {
+         if(batch.chunks[i].outText != NULL)
+         {
+            fwrite(batch.chunks[i].outText, 1, batch.chunks[i].outLength,
+                   out);
+            free(batch.chunks[i].outText);
+            batch.chunks[i].outText = NULL;
+         }
+         if(batch.chunks[i].errText != NULL)
+         {
+            fwrite(batch.chunks[i].errText, 1, batch.chunks[i].errLength,
+                   stderr);
+            free(batch.chunks[i].errText);
+            batch.chunks[i].errText = NULL;
+         }
+      }
+   }
+   if(nChunks < 0)
+   {
+      fprintf(stderr,"No memory for input\n");
+      ok = FALSE;
+   }
+
+   for(i=0; i<opts->nThreads; i++)
+      FreeContext(batch.contexts[i]);
+   for(i=0; i<batch.maxChunks; i++)
+   {
+      if(batch.chunks[i].text != NULL)
+         free(batch.chunks[i].text);
+   }
+   free(batch.contexts);
+   free(batch.chunks);
+   free(batch.name);
+   free(batch.tableID);
+
+   return(ok);
+}
+
+/************************************************************************/
+/*>int ReadChunks(LINEREADER *in, BATCH *batch)
+   ---------------------------------------------
+   Input:   LINEREADER *in      Input file
+   I/O:     BATCH      *batch   The batch to fill with tables
+   Returns: int                 Number of tables read (0 at end of file,
+                                -1 if out of memory)
+
+   Reads the input text for the next set of tables, splitting it where
+   ReadData() would. Lines separating tables are kept with the following
+   table so that its name is seen. Tables are numbered here so that
+   unnamed tables are numbered as in a single-threaded run.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Reads from a LINEREADER. If the input is mapped, the chunks
+            point into it rather than holding a copy
+*/
+int ReadChunks(LINEREADER *in, BATCH *batch)
+{
+   int    nChunks = 0;
+   long   nBytes  = 0;
+   BOOL   gotData = FALSE;
+   CHUNK  *chunk  = &(batch->chunks[0]);
+   char   *data, *token;
+   size_t length;
+
+   chunk->length = 0;
+
+   while(batch->pending ||
+         ((batch->line = ReadLine(in, &(batch->lineLength))) != NULL))
+   {
+      batch->pending = FALSE;
+
+      if(IsTableSeparator(batch->line, batch->lineLength, &(batch->name),
+                          &(batch->nameSize)))
+      {
+         if(gotData && !batch->opts->tableColumn)
+         {
+            /* This starts the next table                               */
+            chunk->number = ++batch->nTables;
+            nBytes += chunk->length;
+            gotData = FALSE;
+            if((++nChunks == batch->maxChunks) || (nBytes > MAXBATCHBYTES))
+            {
+               batch->pending = TRUE;
+               return(nChunks);
+            }
+            chunk = &(batch->chunks[nChunks]);
+            chunk->length = 0;
+         }
+      }
+      else
+      {
+         if(batch->opts->tableColumn)
+         {
+            data = batch->line;
+            if((token = NextToken(&data, batch->line + batch->lineLength,
+                                  &length)) == NULL)
+            {
+               token  = data;
+               length = 0;
+            }
+            if(gotData &&
+               (strncmp(token, batch->tableID, length) ||
+                batch->tableID[length]))
+            {
+               /* Table name has changed                                */
+               chunk->number = ++batch->nTables;
+               nBytes += chunk->length;
+               gotData = FALSE;
+               if((++nChunks == batch->maxChunks) ||
+                  (nBytes > MAXBATCHBYTES))
+               {
+                  batch->pending = TRUE;
+                  return(nChunks);
+               }
+               chunk = &(batch->chunks[nChunks]);
+               chunk->length = 0;
+            }
+            if(!CopyToken(&(batch->tableID), &(batch->tableIDSize), token,
+                          length))
+               return(-1);
+         }
+         gotData = TRUE;
+      }
+
+      if(!AddToChunk(chunk, batch->line, batch->lineLength,
+                     READERMAPPED(in)))
+         return(-1);
+   }
+   if(in->error)
+      return(-1);
+
+   if(gotData)
+   {
+      chunk->number = ++batch->nTables;
+      nChunks++;
+   }
+
+   return(nChunks);
+}
+
+/************************************************************************/
+/*>BOOL AddToChunk(CHUNK *chunk, char *line, size_t length, BOOL mapped)
+   ---------------------------------------------------------------------
+   I/O:     CHUNK  *chunk    The chunk of input
+   Input:   char   *line     Line to add
+            size_t length    Length of the line
+            BOOL   mapped    The line is in a mapped file
+   Returns: BOOL             Success?
+
+   Appends a line of input to a chunk. Lines from a mapped file follow
+   on from each other so the chunk just points at the first and grows
+   in length. Otherwise the line is copied, growing the chunk as needed.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added length and mapped
+*/
+BOOL AddToChunk(CHUNK *chunk, char *line, size_t length, BOOL mapped)
+{
+   char   *text;
+
+   if(mapped)
+   {
+      if(chunk->length == 0)
+         chunk->input = line;
+      chunk->length += length;
+      return(TRUE);
+   }
+
+   if(chunk->length + length > chunk->size)
+   {
+      size_t size = (chunk->size ? chunk->size : 1024);
+      while(chunk->length + length > size)
+         size *= 2;
+      if((text = (char *)realloc(chunk->text, size)) == NULL)
+         return(FALSE);
+      chunk->text = text;
+      chunk->size = size;
+   }
+   memcpy(chunk->text + chunk->length, line, length);
+   chunk->length += length;
+   chunk->input   = chunk->text;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>void AnalyzeChunk(void *data, int task, int thread)
+   ---------------------------------------------------
+   Input:   void   *data     The BATCH
+            int    task      Which chunk to analyze
+            int    thread    Which thread we are running on
+
+   Thread pool task: reads and analyzes one table using the thread's
+   CONTEXT. Output and warnings are collected in memory streams so they
+   can be written in order once the batch is complete.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Reads the chunk directly with a LINEREADER
+*/
+void AnalyzeChunk(void *data, int task, int thread)
+{
+   BATCH      *batch = (BATCH *)data;
+   CHUNK      *chunk = &(batch->chunks[task]);
+   CONTEXT    *ctx   = batch->contexts[thread];
+   LINEREADER *in;
+   BOOL       gotTable;
+
+   chunk->outText = chunk->errText = NULL;
+   ctx->out = open_memstream(&(chunk->outText), &(chunk->outLength));
+   ctx->err = open_memstream(&(chunk->errText), &(chunk->errLength));
+   in       = OpenTextReader(chunk->input, chunk->length);
+
+   if((ctx->out == NULL) || (ctx->err == NULL) || (in == NULL))
+   {
+      fprintf(stderr,"No memory to analyze table %d\n", chunk->number);
+   }
+   else
+   {
+      ctx->pending = FALSE;
+      ctx->name[0] = '\0';
+      ctx->nTables = chunk->number - 1;
+      if(ReadData(in, ctx, &gotTable) && gotTable)
+         AnalyzeTable(ctx);
+      ClearContab(ctx->table);
+   }
+
+   if(in       != NULL) CloseLineReader(in);
+   if(ctx->out != NULL) fclose(ctx->out);
+   if(ctx->err != NULL) fclose(ctx->err);
+   ctx->out = ctx->err = NULL;
+}
+
+/************************************************************************/
+/*>BOOL RunServer(OPTIONS *opts)
+   -----------------------------
+   Input:   OPTIONS *opts    The options (opts->serve is the socket)
+   Returns: BOOL             Success? (only returns if it fails)
+
+   Server mode. Listens on a Unix domain socket and answers requests
+   until killed, so that the cost of starting a process is not paid for
+   every table. Each request is a frame (see chiframe.c) holding a table
+   as it would be given to chisq - either text or a binary table file -
+   and the answer is a frame holding exactly what chisq would print for
+   it, warnings first. A client may send any number of requests on one
+   connection. Connections are handled by a fixed pool of opts->nThreads
+   workers (all processors by default) so the load is bounded, and are
+   closed after IDLETIMEOUT seconds without a request.
+
+   17.10.26 Original    By: ACRM
+*/
+BOOL RunServer(OPTIONS *opts)
+{
+   struct sockaddr_un address;
+   SERVER             server;
+   int                nThreads;
+
+   /* A client going away must not kill the server                      */
+   signal(SIGPIPE, SIG_IGN);
+
+   if(strlen(opts->serve) >= sizeof(address.sun_path))
+   {
+      fprintf(stderr,"Socket name is too long: %s\n", opts->serve);
+      return(FALSE);
+   }
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, opts->serve);
+
+   if((server.listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+   {
+      perror("chisq: socket");
+      return(FALSE);
+   }
+
+   /* Remove a socket left by an earlier server                         */
+   unlink(opts->serve);
+   if((bind(server.listener, (struct sockaddr *)&address,
+            sizeof(address)) < 0) ||
+      (listen(server.listener, SOMAXCONN) < 0))
+   {
+      perror("chisq: unable to listen on socket");
+      close(server.listener);
+      return(FALSE);
+   }
+
+   server.opts = opts;
+   nThreads    = ((opts->nThreads > 0) ? opts->nThreads : NumProcessors());
+
+   /* Each worker serves connections until the server is killed         */
+   if(!RunWorkPool(nThreads, nThreads, ServeConnections, (void *)&server))
+      fprintf(stderr,"Unable to start threads\n");
+
+   close(server.listener);
+   return(FALSE);
+}
+
+/************************************************************************/
+/*>void ServeConnections(void *data, int task, int thread)
+   -------------------------------------------------------
+   Input:   void   *data     The SERVER
+            int    task      Not used
+            int    thread    Not used
+
+   Thread pool task for server mode: accepts connections and answers
+   each request on them in turn. The worker keeps its CONTEXT, request
+   buffer and output stream for its lifetime so nothing is allocated
+   per request once the buffers are big enough. A connection is closed
+   if it is idle for IDLETIMEOUT seconds, or a read or write stalls for
+   as long, so idle clients cannot keep the workers from others.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Connections time out after IDLETIMEOUT seconds
+*/
+void ServeConnections(void *data, int task, int thread)
+{
+   SERVER  *server = (SERVER *)data;
+   CONTEXT *ctx;
+   char    *request  = NULL,
+           *response = NULL;
+   size_t  requestSize    = 0,
+           requestLength  = 0,
+           responseLength = 0;
+   int     fd,
+           status;
+
+   if(((ctx = CreateContext(server->opts, NULL, NULL)) == NULL) ||
+      ((ctx->out = open_memstream(&response, &responseLength)) == NULL))
+   {
+      fprintf(stderr,"No memory for server thread\n");
+      if(ctx != NULL) FreeContext(ctx);
+      return;
+   }
+   ctx->err = ctx->out;
+
+   for(;;)
+   {
+      if((fd = accept(server->listener, NULL, NULL)) < 0)
+      {
+         if((errno == EINTR) || (errno == ECONNABORTED))
+            continue;
+         perror("chisq: accept");
+         break;
+      }
+
+      /* An idle client must not hold this worker for ever              */
+      if(!SetFrameTimeout(fd, IDLETIMEOUT))
+      {
+         perror("chisq: unable to set timeout");
+         close(fd);
+         continue;
+      }
+
+      while((status = ReadFrame(fd, &request, &requestSize,
+                                &requestLength, MAXREQUEST)) == FRAME_OK)
+      {
+         rewind(ctx->out);
+         AnswerRequest(ctx, request, requestLength);
+         fflush(ctx->out);
+         if(WriteFrame(fd, response, (size_t)ftell(ctx->out)) != FRAME_OK)
+            break;
+      }
+      if(status == FRAME_TOOBIG)
+         fprintf(stderr,"Request of more than %ld bytes refused\n",
+                 MAXREQUEST);
+      else if(status == FRAME_NOMEM)
+         fprintf(stderr,"No memory for request\n");
+
+      close(fd);
+   }
+
+   fclose(ctx->out);
+   ctx->out = ctx->err = NULL;
+   FreeContext(ctx);
+   free(response);
+   free(request);
+}
+
+/************************************************************************/
+/*>void AnswerRequest(CONTEXT *ctx, char *request, size_t length)
+   --------------------------------------------------------------
+   Input:   CONTEXT *ctx      Worker's context (output goes to ctx->out)
+            char    *request  The request - a table as text or a binary
+                              table file
+            size_t  length    Length of the request
+
+   Reads and analyzes the table in a request exactly as chisq would for
+   an input file, and then clears the table ready for the next one.
+
+   The request comes from any client, so a binary table file is only
+   used once OpenTableFile() has checked it, including that its counts
+   add up to its totals. One that fails is refused with the error sent
+   to the client and noted on stderr, and the server carries on.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Refused binary requests are reported on stderr
+*/
+void AnswerRequest(CONTEXT *ctx, char *request, size_t length)
+{
+   LINEREADER *in = NULL;
+   BOOL       gotTable,
+              ok;
+
+   if(!ctx->opts->cellSig)
+      PrintResultHeader(ctx->out, &(ctx->opts->result), FALSE);
+
+   if(IsTableFile(request, length))
+   {
+      if(!(ok = gotTable = LoadTable(ctx, request, length)))
+         fprintf(stderr,"Binary table request refused\n");
+   }
+   else if((in = OpenTextReader(request, length)) == NULL)
+   {
+      fprintf(ctx->err,"No memory for input\n");
+      return;
+   }
+   else
+   {
+      ctx->pending = FALSE;
+      ctx->name[0] = '\0';
+      ctx->nTables = 0;
+      ok = ReadData(in, ctx, &gotTable);
+   }
+
+   if(ok && gotTable)
+      AnalyzeTable(ctx);
+
+   ClearContab(ctx->table);
+   if(in != NULL)
+      CloseLineReader(in);
+}
+
+/************************************************************************/
+/*>BOOL RunUpdates(LINEREADER *in, FILE *out, OPTIONS *opts)
+   ---------------------------------------------------------
+   Input:   LINEREADER *in      Input file
+            FILE       *out     Output file
+            OPTIONS    *opts    The options
+   Returns: BOOL                Success?
+
+   Update mode. Each line of the form
+      item1 item2 change
+   adds change to the count for a cell and chi squared is printed after
+   every line. The running chi squared in the CONTAB is used so each
+   line costs time proportional to the row and column changed. Output
+   is flushed after each line so that the latest value can be read from
+   a pipe. A change too large for an int is ignored with a warning, as
+   is one that would make a count negative or too large.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 A change too large to read is ignored rather than wrapping
+*/
+BOOL RunUpdates(LINEREADER *in, FILE *out, OPTIONS *opts)
+{
+   CONTAB    *ct;
+   CHIRESULT result;
+   char      *line, *end,
+             *item1, *item2, *token;
+   size_t    length, length1, length2, tokenLength;
+   int       change,
+             status;
+
+   if((ct = CreateContab(FALSE)) == NULL)
+   {
+      fprintf(stderr,"No memory for labels\n");
+      return(FALSE);
+   }
+
+   while((line = ReadLine(in, &length)) != NULL)
+   {
+      end = line + length;
+      if(((item1 = NextToken(&line, end, &length1)) == NULL) ||
+         ((item2 = NextToken(&line, end, &length2)) == NULL))
+         continue;
+      change = 0;
+      if(((token = NextToken(&line, end, &tokenLength)) != NULL) &&
+         !ParseCount(token, tokenLength, &change))
+      {
+         fprintf(stderr,"Warning: change of %.*s to %.*s %.*s is too \
+large - ignored\n", (int)tokenLength, token, (int)length1, item1,
+                 (int)length2, item2);
+         continue;
+      }
+
+      if((status = ContabAddCount(ct, item1, length1, item2, length2,
+                                  change)) == 0)
+      {
+         fprintf(stderr,"No memory for table\n");
+         FreeContab(ct);
+         return(FALSE);
+      }
+      if(status < 0)
+      {
+         fprintf(stderr,"Warning: change of %d to %.*s %.*s would make \
+the count negative or too large - ignored\n", change, (int)length1,
+                 item1, (int)length2, item2);
+         continue;
+      }
+
+      ContabRunningChiSq(ct, &result);
+      PrintResult(out, &(opts->result), NULL, result.chisq, result.dof,
+                  -1.0, -1.0, -1.0, 1.0);
+      fflush(out);
+   }
+
+   FreeContab(ct);
+   return(!in->error);
+}
@@ -3,11 +3,11 @@
    Program:    chisq3
    File:       chisq3.c
    
-   Version:    V1.8
-   Date:       28.05.17
+   Version:    V1.26
+   Date:       17.10.26
    Function:   Do general chi squared analysis
    
-   Copyright:  (c) Dr. Andrew C. R. Martin, 2017
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2017-2026
    Author:     Dr. Andrew C. R. Martin
    Address:    Biomolecular Structure and Modelling,
                University College London,
@@ -46,6 +46,48 @@
    =================
    V1.7  28.05.17 Original based on ChiSq
    V1.8  03.10.17 Updated warnings
+   V1.9  17.10.26 Labels are interned through a hash table
+   V1.10 17.10.26 Added -p to print the p-value, -a to print the critical
+                  value and -o for TSV or JSON output
+   V1.11 17.10.26 Chi squared is summed by the vectorized kernel shared
+                  with chisq
+   V1.12 17.10.26 Regular files are mapped into memory and split into
+                  tokens in place rather than read with fgets() and
+                  sscanf()
+   V1.13 17.10.26 Added -w to write the table as a binary file. Binary
+                  table files are recognized and read instead of text
+   V1.14 17.10.26 Now a front end to libchisq. The table is allocated on
+                  the heap and grows to fit the data so is no longer
+                  limited to MAXITEM items in each dimension
+   V1.15 17.10.26 Added -B for a Monte Carlo p-value, with -s to set the
+                  seed and -j to set the number of threads
+   V1.16 17.10.26 Added -g to give the G statistic, which is summed in
+                  the same pass as chi squared
+   V1.17 17.10.26 Added -S, --stats and --perf to report the time in each
+                  phase and counts of the work done
+   V1.18 17.10.26 Added -A to sum the counts for repeated cells rather
+                  than replacing them. Counts that would overflow are an
+                  error and the grand total is a long
+   V1.19 17.10.26 Added -r to read raw observations (item1 item2 item3)
+                  and count them
+   V1.20 17.10.26 -d output is collected in a large buffer and the
+                  numbers formatted by outbuf.c rather than printf().
+                  Added --cells to write each cell as TSV
+   V1.21 17.10.26 Expecteds are no longer stored but calculated in the
+                  chi squared pass (or by Contab3Expected() for -d and
+                  --cells)
+   V1.22 17.10.26 Added -C for the conditional independence and
+                  Cochran-Mantel-Haenszel tests of each pair of
+                  dimensions within the strata of the third
+   V1.23 17.10.26 Added -m to fit and test log-linear models, with -t
+                  and -i to set the tolerance and most cycles of the fit
+   V1.24 17.10.26 A count too large for an int is refused rather than
+                  wrapping and the exit status is 1 if the input cannot
+                  be read
+   V1.25 17.10.26 The test of mutual independence has IJK-I-J-K+2
+                  degrees of freedom, the same as -m 1,2,3
+   V1.26 17.10.26 The table only stores its occupied cells, so counts
+                  are looked up with Contab3Count()
 
 *************************************************************************/
 /* Includes
@@ -60,39 +102,61 @@
 #include "bioplib/general.h"
 #include "bioplib/macros.h"
 
+#include "contab.h"
+#include "results.h"
+#include "chikern.h"
+#include "lineread.h"
+#include "tabfile.h"
+#include "workpool.h"
+#include "chistats.h"
+#include "outbuf.h"
+
 /************************************************************************/
 /* Defines
 */
-#define MAXITEM 100
-#define MAXBUFF 160
-#define SMALL   (0.1e-20)
+#define MAXREPS 2000000000L        /* Most replicates with -B           */
+#define DEFSEED 12345UL            /* Default seed for -B               */
+#define MAXMODELS 16               /* Most models with -m               */
 
 /************************************************************************/
 /* Globals
 */
 BOOL gDisplay      = FALSE,
-     gGotExpecteds = FALSE;
-char gItemList1[MAXITEM][MAXBUFF],
-     gItemList2[MAXITEM][MAXBUFF],
-     gItemList3[MAXITEM][MAXBUFF];
-int  gNItem1 = 0, 
-     gNItem2 = 0, 
-     gNItem3 = 0;
-REAL gExpecteds[MAXITEM][MAXITEM][MAXITEM];
+     gGotExpecteds = FALSE,
+     gShowStats    = FALSE,
+     gPerf         = FALSE,
+     gAccumulate   = FALSE,
+     gRaw          = FALSE,
+     gStrata       = FALSE;
+RESULTFORMAT gResult = {OUTPUT_TEXT, FALSE, FALSE, FALSE, FALSE, 0.0};
+char *gWriteFile   = NULL;
+long gReps         = 0;
+unsigned long gSeed = DEFSEED;
+int  gThreads      = 0;
+char *gStatsFile   = NULL;
+CHISTATS *gStats   = NULL;
+char *gCellsFile   = NULL;
+OUTBUF *gDisplayBuf = NULL;
+char *gModels[MAXMODELS];
+int  gNModels      = 0,
+     gMaxIter      = IPFMAXITER;
+double gTolerance  = IPFTOLERANCE;
 
 /************************************************************************/
 /* Prototypes
 */
 int main(int argc, char **argv);
-void ZeroMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM]);
-BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM][MAXITEM]);
-REAL CalcChiSq(int matrix[MAXITEM][MAXITEM][MAXITEM], int *NDoF);
-int CalcNDoF(void);
+BOOL ReadData(LINEREADER *in, CONTAB3 *ct);
+BOOL LoadTable3(CONTAB3 *ct, char *data, size_t size);
+BOOL SaveTable3(CONTAB3 *ct, char *fileName);
+REAL CalcChiSq(CONTAB3 *ct, int *NDoF, REAL *g);
+REAL SimulatePValue(CONTAB3 *ct);
 void Usage(void);
-void PrintMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM]);
+void PrintMatrix(CONTAB3 *ct);
+BOOL WriteCells(CONTAB3 *ct, char *fileName);
+BOOL PrintStrata(CONTAB3 *ct);
+BOOL PrintModels(CONTAB3 *ct);
 BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile);
-int CountObservations(int matrix[MAXITEM][MAXITEM][MAXITEM]);
-void CalculateExpecteds(int matrix[MAXITEM][MAXITEM][MAXITEM], int NObs);
 
 
 /************************************************************************/
@@ -101,34 +165,120 @@ void CalculateExpecteds(int matrix[MAXITEM][MAXITEM][MAXITEM], int NObs);
    Main program for chi squared calculation
 
    21.06.94 Original    By: ACRM
+   17.10.26 Result is printed by PrintResult()
+   17.10.26 Input is read through a LINEREADER
+   17.10.26 Reads binary table files and writes them with -w
+   17.10.26 The table is a CONTAB3 from libchisq
+   17.10.26 Added -B
+   17.10.26 Added -g
+   17.10.26 Added -S. Each phase of the run is timed
+   17.10.26 Sets accumulate for -A
+   17.10.26 ...and raw for -r
+   17.10.26 Added --cells
+   17.10.26 Added -C. Results are then named
+   17.10.26 Added -m
+   17.10.26 Returns 1 if the input cannot be read
 */
 int main(int argc, char **argv)
 {
-   FILE *in = stdin,
-        *out = stdout;
-   REAL chisq;
-   int  dof;
-   static int  matrix[MAXITEM][MAXITEM][MAXITEM];
-   char InFile[160], OutFile[160];
-
-   if(!ParseCmdLine(argc, argv, InFile, OutFile))
+   FILE       *in = stdin,
+              *out = stdout;
+   LINEREADER *reader;
+   CONTAB3    *ct;
+   REAL       chisq,
+              g,
+              simP;
+   BOOL       ok,
+              named;
+   int        dof;
+   char       InFile[160], OutFile[160],
+              mutual[] = "mutual",
+              *data;
+   size_t     size;
+
+   if(!ParseCmdLine(argc, argv, InFile, OutFile) ||
+      (gReps && gGotExpecteds) ||
+      (gRaw && gGotExpecteds) ||
+      (gNModels && gGotExpecteds))
    {
       Usage();
    }
    else
    {
+      if(gShowStats)
+      {
+         if((gStats = CreateStats(gPerf)) == NULL)
+         {
+            fprintf(stderr,"No memory for statistics\n");
+            return(1);
+         }
+         StartPhase(gStats, STATS_OPEN);
+      }
+
       if(blOpenStdFiles(InFile, OutFile, &in, &out))
       {
-         ZeroMatrix(matrix);
-   
-         if(ReadData(in, matrix))
+         if(((reader = OpenLineReader(in)) == NULL) ||
+            ((ct = CreateContab3(gGotExpecteds)) == NULL))
          {
+            fprintf(stderr,"No memory for input\n");
+            return(1);
+         }
+         ct->accumulate = gAccumulate;
+         ct->raw        = gRaw;
+         if(gDisplay && ((gDisplayBuf = CreateOutBuf(stdout, 0)) == NULL))
+         {
+            fprintf(stderr,"No memory for output\n");
+            return(1);
+         }
+
+         StartPhase(gStats, STATS_READ);
+         if(((data = MappedText(reader, &size)) != NULL) &&
+            IsTableFile(data, size))
+            ok = LoadTable3(ct, data, size);
+         else
+            ok = ReadData(reader, ct);
+
+         if(ok && (gWriteFile != NULL))
+            ok = SaveTable3(ct, gWriteFile);
+
+         if(ok)
+         {
+            if(gStats != NULL)
+            {
+               gStats->nTables++;
+               AddLabelStats(gStats, ct->labels[0]);
+               AddLabelStats(gStats, ct->labels[1]);
+               AddLabelStats(gStats, ct->labels[2]);
+               StartPhase(gStats, STATS_OUTPUT);
+            }
+
             if(gDisplay)
-               PrintMatrix(matrix);
+               PrintMatrix(ct);
             
-            chisq = CalcChiSq(matrix, &dof);
-            printf("ChiSq = %f with %d degrees of freedom\n", chisq, dof);
+            chisq = CalcChiSq(ct, &dof, &g);
+            if(gCellsFile != NULL)
+               WriteCells(ct, gCellsFile);
+            StartPhase(gStats, STATS_TESTS);
+            simP  = (gReps ? SimulatePValue(ct) : (REAL)(-1.0));
+            StartPhase(gStats, STATS_OUTPUT);
+            named = (gStrata || gNModels);
+            PrintResultHeader(stdout, &gResult, named);
+            PrintResult(stdout, &gResult, (named ? mutual : NULL),
+                        chisq, dof, -1.0, simP, g, 1.0);
+            if(gStrata)
+               PrintStrata(ct);
+            if(gNModels)
+               PrintModels(ct);
          }
+
+         if(gStats != NULL)
+            WriteStats(gStats, gStatsFile);
+         FreeStats(gStats);
+         FreeOutBuf(gDisplayBuf);
+         FreeContab3(ct);
+         CloseLineReader(reader);
+         if(!ok)
+            return(1);
       }
       else
       {
@@ -140,302 +290,221 @@ int main(int argc, char **argv)
 }
 
 /************************************************************************/
-/*>void ZeroMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM])
-   ------------------------------------------------------
-   Zeroes the data matrix
-
-   09.02.94 Original    By: ACRM
-*/
-void ZeroMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM])
-{
-   int i,j,k;
-
-   /* Zero the matrix                                                   */
-   for(i=0; i<MAXITEM; i++)
-   {
-      for(j=0; j<MAXITEM; j++)
-      {
-         for(k=0; k<MAXITEM; k++)
-         {
-            matrix[i][j][k] = 0;
-         }
-      }
-   }
-}
-
-/************************************************************************/
-/*>BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM][MAXITEM])
-   -----------------------------------------------------
+/*>BOOL ReadData(LINEREADER *in, CONTAB3 *ct)
+   ------------------------------------------
    Read data into the matrix
 
+   Lines with fewer than three labels are ignored and a missing count is
+   taken as zero. With -A, the counts for a cell that appears more than
+   once are summed, otherwise the last one is used. With -r each line
+   is a single observation with no count.
+
    21.06.94 Original    By: ACRM
    04.03.08 Added reading of expecteds
+   17.10.26 Labels are found with a hash table rather than a linear
+            search
+   17.10.26 Reads from a LINEREADER and splits the line with NextToken()
+            rather than sscanf(). Lines and labels may be any length
+   17.10.26 Each line is parsed into a CONTAB3 by Contab3ParseLine()
+   17.10.26 Counts the lines for -S
+   17.10.26 Counts that would become negative or overflow are an error
 */
-BOOL ReadData(FILE *in, int matrix[MAXITEM][MAXITEM][MAXITEM])
+BOOL ReadData(LINEREADER *in, CONTAB3 *ct)
 {
-   int  count;
-   char buffer[MAXBUFF];
-   char item1[MAXBUFF], item2[MAXBUFF], item3[MAXBUFF];
-   int  MatPos1,    MatPos2, MatPos3,
-      i, j, k;
-   REAL expect = (REAL)0.0;
-
-   for(i=0; i<MAXITEM; i++)
-      for(j=0; j<MAXITEM; j++)
-         for(k=0; k<MAXITEM; k++)
-            matrix[i][j][k] = 0;
-
-   while(fgets(buffer,MAXBUFF,in))
-   {
-      TERMINATE(buffer);
-      
-      if(gGotExpecteds)
-      {
-         REAL countDouble;
-         sscanf(buffer,"%s%s%s%lf%lf",item1,item2,item3,&countDouble,&expect);
-         count = (int)countDouble;
-      }
-      else
-      {
-         REAL countDouble;
-         sscanf(buffer,"%s %s %s %lf",item1,item2,item3,&countDouble);
-         count = (int)countDouble;
-      }
+   char   *line;
+   size_t lineLength;
+   int    status;
 
-      /* Find the matrix position for the first item                    */
-      MatPos1 = (-1);
-      for(i=0; i<gNItem1; i++)
-      {
-         if(!strcmp(item1,gItemList1[i]))
-         {
-            MatPos1 = i;
-            break;
-         }
-      }
-      if(MatPos1 == (-1))
-      {
-         strcpy(gItemList1[gNItem1],item1);
-         MatPos1 = gNItem1++;
-         if(MatPos1 >= MAXITEM)
-         {
-            fprintf(stderr,"Too many items in first column\n");
-            return(FALSE);
-         }
-      }
-      
-      /* Find the matrix position for the second item                   */
-      MatPos2 = (-1);
-      for(i=0; i<gNItem2; i++)
-      {
-         if(!strcmp(item2,gItemList2[i]))
-         {
-            MatPos2 = i;
-            break;
-         }
-      }
-      if(MatPos2 == (-1))
-      {
-         strcpy(gItemList2[gNItem2],item2);
-         MatPos2 = gNItem2++;
-         if(MatPos2 >= MAXITEM)
-         {
-            fprintf(stderr,"Too many items in second column\n");
-            return(FALSE);
-         }
-      }
-
-      /* Find the matrix position for the third item                   */
-      MatPos3 = (-1);
-      for(i=0; i<gNItem3; i++)
-      {
-         if(!strcmp(item3,gItemList3[i]))
-         {
-            MatPos3 = i;
-            break;
-         }
-      }
-      if(MatPos3 == (-1))
+   while((line = ReadLine(in, &lineLength)) != NULL)
+   {
+      if(gStats != NULL)
+         gStats->nLines++;
+      if((status = Contab3ParseLine(ct, line, lineLength)) != 1)
       {
-         strcpy(gItemList3[gNItem3],item3);
-         MatPos3 = gNItem3++;
-         if(MatPos3 >= MAXITEM)
-         {
-            fprintf(stderr,"Too many items in third column\n");
-            return(FALSE);
-         }
+         if(status < 0)
+            fprintf(stderr,"Error: a count would become negative or too \
+large\n");
+         else
+            fprintf(stderr,"No memory for table\n");
+         return(FALSE);
       }
+   }
 
-      /* Fill in the value in the matrix                                */
-      matrix[MatPos1][MatPos2][MatPos3] = count;
-      if(gGotExpecteds)
-      {
-         gExpecteds[MatPos1][MatPos2][MatPos3] = expect;
-      }
+   if(in->error)
+   {
+      fprintf(stderr,"No memory for input line\n");
+      return(FALSE);
    }
 
    return(TRUE);
 }
 
 /************************************************************************/
-int CountObservations(int matrix[MAXITEM][MAXITEM][MAXITEM])
+/*>BOOL LoadTable3(CONTAB3 *ct, char *data, size_t size)
+   -----------------------------------------------------
+   Input:   CONTAB3 *ct      The table to fill in
+            char    *data    Binary table file mapped into memory
+            size_t  size     Size of the file
+   Returns: BOOL             Success?
+
+   Loads a binary table file written with -w in place of ReadData()
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Loads into a CONTAB3
+*/
+BOOL LoadTable3(CONTAB3 *ct, char *data, size_t size)
 {
-   int row, col, plane, 
-       NObs = 0;
+   const char *error;
 
-   /* Find total number of observations                                 */
-   for(row=0; row<MAXITEM; row++)
+   if(!Contab3Load(ct, data, size, &error))
    {
-      for(col=0; col<MAXITEM; col++)
-      {
-         for(plane=0; plane<MAXITEM; plane++)
-         {
-            NObs += matrix[row][col][plane];
-         }
-      }
+      fprintf(stderr,"Error: %s\n", error);
+      return(FALSE);
    }
-
-   return(NObs);
+   return(TRUE);
 }
 
 /************************************************************************/
-void CalculateExpecteds(int matrix[MAXITEM][MAXITEM][MAXITEM], int NObs)
-{
-   int RowTotals[MAXITEM],
-       ColTotals[MAXITEM],
-       PlaneTotals[MAXITEM],
-      row, col, plane, i;
+/*>BOOL SaveTable3(CONTAB3 *ct, char *fileName)
+   --------------------------------------------
+   Input:   CONTAB3 *ct        The table
+            char    *fileName  File to write
+   Returns: BOOL               Success?
 
-   /* Zero the arrays */
-   for(i=0; i<MAXITEM; i++)
-   {
-      RowTotals[i] = ColTotals[i] = PlaneTotals[i] = 0;
-   }
+   Writes the table as a binary table file that can be read back in
+   place of the text file
 
-   /* Sum the totals */
-   for(row=0; row<MAXITEM; row++)
-   {
-      for(col=0; col<MAXITEM; col++)
-      {
-         for(plane=0; plane<MAXITEM; plane++)
-         {
-            RowTotals[row]     += matrix[row][col][plane];
-            ColTotals[col]     += matrix[row][col][plane];
-            PlaneTotals[plane] += matrix[row][col][plane];
-         }
-      }
-   }
+   17.10.26 Original    By: ACRM
+   17.10.26 Saves a CONTAB3
+*/
+BOOL SaveTable3(CONTAB3 *ct, char *fileName)
+{
+   FILE *fp;
+   BOOL ok;
 
-   /* Now calculate the expecteds */
-   for(row=0; row<MAXITEM; row++)
+   if((fp = fopen(fileName, "wb")) == NULL)
    {
-      for(col=0; col<MAXITEM; col++)
-      {
-         for(plane=0; plane<MAXITEM; plane++)
-         {
-            if(RowTotals[row] &&
-               ColTotals[col] &&
-               PlaneTotals[plane])
-            {
-               gExpecteds[row][col][plane] = ((REAL)RowTotals[row] *
-                                              (REAL)ColTotals[col] *
-                                              (REAL)PlaneTotals[plane]) /
-                  ((REAL)NObs * (REAL)NObs); 
-            }
-         }
-      }
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+      return(FALSE);
    }
+   ok = Contab3Save(ct, fp);
+   if(fclose(fp))
+      ok = FALSE;
+   if(!ok)
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+
+   return(ok);
 }
 
 /************************************************************************/
-/*>REAL CalcChiSq(int matrix[MAXITEM][MAXITEM][MAXITEM], int *NDoF)
-   -------------------------------------------------------
-   Actually calculate the Chi squared value
+/*>REAL CalcChiSq(CONTAB3 *ct, int *NDoF, REAL *g)
+   ------------------------------------------------
+   Input:   CONTAB3 *ct      The table
+   Output:  int     *NDoF    Degrees of freedom
+            REAL    *g       G statistic (-1 without -g)
+   Returns: REAL             Chi squared
+
+   Actually calculate the Chi squared value. G comes from the same pass
+   over the cells but is only given with -g. There is no Williams'
+   correction for three-way tables.
 
    09.02.94 Original    By: ACRM
    16.12.94 Cast values in calculation of expected (was being done as int)
    06.08.03 Added Yates correction
    03.04.08 Added obtaining expecteds from file
    03.10.17 Added warnings
+   17.10.26 Each line of planes is summed by the vectorized kernel in
+            chikern.c. The display is done in a separate loop
+   17.10.26 Chi squared is calculated by Contab3ChiSq(). This just does
+            the display and warnings
+   17.10.26 Added G
+   17.10.26 Times chi squared for -S. The display and warnings are
+            output
+   17.10.26 The display is written through gDisplayBuf
+   17.10.26 Expecteds come from Contab3Expected()
 */
-REAL CalcChiSq(int matrix[MAXITEM][MAXITEM][MAXITEM], int *NDoF)
+REAL CalcChiSq(CONTAB3 *ct, int *NDoF, REAL *g)
 {
-   REAL chisq = (REAL)0.0,
-        observed,
-        expected;
-   int  row, col, plane, NObs = 0, NCells = 0, NSmall = 0, NZero = 0;
+   OUTBUF    *ob = gDisplayBuf;
+   CHIRESULT result;
+   int       row, col, plane;
 
-   NObs = CountObservations(matrix);
-   if(!gGotExpecteds)
-   {
-      CalculateExpecteds(matrix, NObs);
-   }
+   StartPhase(gStats, STATS_CHISQ);
+   Contab3ChiSq(ct, gResult.gStat, &result);
+   AddResultStats(gStats, &result);
+   StartPhase(gStats, STATS_OUTPUT);
+   *NDoF = result.dof;
+   *g    = (REAL)result.g;
 
    if(gDisplay)
-      printf("\nTotal observations: %d\n\n",NObs);
-
-   /* Calc DoFs                                                         */
-   *NDoF = CalcNDoF();
-
-   NCells = gNItem1 * gNItem2 * gNItem3;
-
-   /* Step through positions in matrix                                  */
-   for(row=0; row<gNItem1; row++)
    {
-      for(col=0; col<gNItem2; col++)
+      OutBufString(ob, "\nTotal observations: ");
+      OutBufInt(ob, result.nObs, 0);
+      OutBufString(ob, "\n\n");
+
+      /* Display the observed and expected values as
+         "row col plane: Obs %5.1f Exp %5.1f"
+      */
+      for(row=0; row<ct->nItems[0]; row++)
       {
-         for(plane=0; plane<gNItem3; plane++)
+         for(col=0; col<ct->nItems[1]; col++)
          {
-            expected = (REAL)gExpecteds[row][col][plane];
-            observed = (REAL)matrix[row][col][plane];
-            
-            if(gDisplay)
-               printf("%s %s %s: Obs %5.1f Exp %5.1f\n",
-                      gItemList1[row],gItemList2[col],gItemList3[plane],
-                      observed,expected);
-            
-            /* Add to chisq value                                       */
-            if(expected > SMALL)
+            for(plane=0; plane<ct->nItems[2]; plane++)
             {
-               if(expected < (REAL)5.0)
-               {
-                  NSmall++;
-               }
-               
-               chisq += (observed - expected)*(observed - expected) / 
-                  expected;
-            }
-            else
-            {
-               NZero++;
+               OutBufString(ob, CONTAB3LABEL(ct, 0, row));
+               OutBufChar(ob, ' ');
+               OutBufString(ob, CONTAB3LABEL(ct, 1, col));
+               OutBufChar(ob, ' ');
+               OutBufString(ob, CONTAB3LABEL(ct, 2, plane));
+               OutBufText(ob, ": Obs ", 6);
+               OutBufReal(ob, (REAL)Contab3Count(ct, row, col, plane),
+                          5, 1);
+               OutBufText(ob, " Exp ", 5);
+               OutBufReal(ob, (REAL)Contab3Expected(ct, row, col, plane),
+                          5, 1);
+               OutBufChar(ob, '\n');
             }
          }
       }
+      FlushOutBuf(ob);
    }
 
-   if(NZero)
+   if(result.warnings & CHIWARN_ZERO)
    {
       fprintf(stderr,"Warning: %d expecteds were < %g and not included\n",
-              NZero, SMALL);
+              result.nZero, SMALL);
    }
                
-   if ((NSmall / (REAL)NCells) > 0.25)
+   if(result.warnings & CHIWARN_SMALL)
    {
       fprintf(stderr,"Warning: More than 25%% of expecteds were < 5\n");
    }
 
-   return(chisq);
+   return((REAL)result.chisq);
 }
 
 /************************************************************************/
-/*>int CalcNDoF(void)
-   --------------------------------------------------
-   Calculate number of degress of freedom
+/*>REAL SimulatePValue(CONTAB3 *ct)
+   --------------------------------
+   Input:   CONTAB3 *ct      The table
+   Returns: REAL             Simulated p-value (-1 if out of memory)
 
-   09.02.94 Original    By: ACRM
+   Monte Carlo p-value from gReps random tables with the same totals,
+   run on gThreads threads (all processors if 0)
+
+   17.10.26 Original    By: ACRM
 */
-int CalcNDoF(void)
+REAL SimulatePValue(CONTAB3 *ct)
 {
-   return((gNItem1-1) * (gNItem2-1) * (gNItem3-1));
+   double pValue;
+
+   if(!Contab3MonteCarlo(ct, gReps, gSeed,
+                         (gThreads ? gThreads : NumProcessors()), &pValue))
+   {
+      fprintf(stderr,"Warning: No memory for the Monte Carlo test\n");
+      return((REAL)(-1.0));
+   }
+   return((REAL)pValue);
 }
 
 /************************************************************************/
@@ -444,48 +513,363 @@ int CalcNDoF(void)
    Prints a usage message
 
    28.05.17 Original    By: ACRM
+   17.10.26 V1.10 Added -p, -a and -o
+   17.10.26 V1.13 Added -w
+   17.10.26 V1.14 Table size is no longer limited
+   17.10.26 V1.15 Added -B, -s and -j
+   17.10.26 V1.16 Added -g
+   17.10.26 V1.17 Added -S, --stats and --perf
+   17.10.26 V1.18 Added -A
+   17.10.26 V1.19 Added -r
+   17.10.26 V1.20 Added --cells
+   17.10.26 V1.22 Added -C
+   17.10.26 V1.23 Added -m, -t and -i
 */
 void Usage(void)
 {
-   fprintf(stderr,"ChiSq3 V1.8 (c) 2017 Andrew C.R. Martin, UCL\n");
-   fprintf(stderr,"Usage: chisq3 [-d] [-f] [-e] [in [out]]\n");
+   fprintf(stderr,"ChiSq3 V1.23 (c) 2017-2026 Andrew C.R. Martin, UCL\n");
+   fprintf(stderr,"Usage: chisq3 [-d] [-f] [-e|-r] [-A] [-p] [-g] \
+[-a alpha] [-o text|tsv|json]\n");
+   fprintf(stderr,"              [-w file] [--cells file] [-C]\n");
+   fprintf(stderr,"              [-m model [-m model ...] [-t tol] \
+[-i n]]\n");
+   fprintf(stderr,"              [-B n [-s seed] [-j n]] \
+[-S [--stats file] [--perf]]\n");
+   fprintf(stderr,"              [in [out]]\n");
    fprintf(stderr,"       -d Display observed and expected values\n");
    fprintf(stderr,"       -f Use first dataset observeds as expecteds\n");
    fprintf(stderr,"       -e Expected values appear in 5th column\n");
+   fprintf(stderr,"       -A Add up the counts (and expecteds) for cells \
+that appear more\n");
+   fprintf(stderr,"          than once rather than using the last\n");
+   fprintf(stderr,"       -r Raw input - each line is one observation: \
+item1 item2 item3\n");
+   fprintf(stderr,"       -p Print the p-value\n");
+   fprintf(stderr,"       -g Also give the G (likelihood ratio) \
+statistic\n");
+   fprintf(stderr,"       -a Print the critical value at significance \
+level alpha\n");
+   fprintf(stderr,"       -o Output format (default text). TSV and JSON \
+always include\n");
+   fprintf(stderr,"          the p-value\n");
+   fprintf(stderr,"       -w Also write the table to a binary table file\n");
+   fprintf(stderr,"       -B Also give a p-value simulated from n random \
+tables (not with -e)\n");
+   fprintf(stderr,"       -s Random number seed for -B (default %lu)\n",
+           DEFSEED);
+   fprintf(stderr,"       -C Also test each pair of dimensions within \
+the strata of the third\n");
+   fprintf(stderr,"       -m Also fit and test a log-linear model \
+(not with -e). Implies -g\n");
+   fprintf(stderr,"       -t Largest difference between a fitted and \
+observed margin\n");
+   fprintf(stderr,"          for -m (default %g)\n", IPFTOLERANCE);
+   fprintf(stderr,"       -i Most cycles through the margins for -m \
+(default %d)\n", IPFMAXITER);
+   fprintf(stderr,"       -j Threads for -B, -C and -m (default all \
+processors)\n");
+   fprintf(stderr,"       -S Report the time in each phase and counts of \
+the work done\n");
+   fprintf(stderr,"          on stderr\n");
+   fprintf(stderr,"       --stats Write the -S report to a file as JSON \
+instead\n");
+   fprintf(stderr,"       --perf  Also count instructions, cycles and \
+cache misses with -S\n");
+   fprintf(stderr,"               (Linux only)\n");
+   fprintf(stderr,"       --cells Write the observed, expected and \
+contribution to chi\n");
+   fprintf(stderr,"               squared of each cell to a file as \
+TSV\n");
    fprintf(stderr,"\nInput file has format: item1 item2 item3 NObs [Exp]\n");
-   fprintf(stderr,"Max dimensions of contingency table: %d x %d x %d\n\n",
-           MAXITEM, MAXITEM, MAXITEM);
+   fprintf(stderr,"or may be a binary table file written with -w\n");
+   fprintf(stderr,"The contingency table grows to fit the data\n");
+   fprintf(stderr,"A count, or a sum of counts with -A, too large for \
+an int is an error\n\n");
+   fprintf(stderr,"With -B, random tables with the same totals in each \
+dimension are\n");
+   fprintf(stderr,"generated and the p-value is the fraction with chi \
+squared at least as\n");
+   fprintf(stderr,"large as that observed. The same seed gives the same \
+p-value whatever\n");
+   fprintf(stderr,"the number of threads.\n\n");
+   fprintf(stderr,"With -g, G = 2 sum(O ln(O/E)) is also given with its \
+p-value.\n\n");
+   fprintf(stderr,"With -C, each result is named. 'mutual' is the usual \
+test and, for each\n");
+   fprintf(stderr,"dimension taken as the strata, 'item1,item2|item3' \
+tests the other two\n");
+   fprintf(stderr,"for independence within each stratum (chi squared \
+summed over the\n");
+   fprintf(stderr,"strata) and 'CMH item1,item2|item3' is the generalized \
+Cochran-Mantel-\n");
+   fprintf(stderr,"Haenszel test of association across the strata. The \
+CMH test is left\n");
+   fprintf(stderr,"out if (I-1)(J-1) > %d.\n\n", CMHMAXDOF);
+   fprintf(stderr,"A model for -m is given by its generating margins \
+as groups of\n");
+   fprintf(stderr,"dimensions separated by commas. For example 1,2,3 is \
+mutual independence,\n");
+   fprintf(stderr,"12,3 has the third dimension independent of the other \
+two, 12,13 has\n");
+   fprintf(stderr,"the second and third independent given the first and \
+12,13,23 has no\n");
+   fprintf(stderr,"three-way interaction. The expecteds are fitted by \
+iterative proportional\n");
+   fprintf(stderr,"fitting and each result is named 'model' followed by \
+the margins.\n");
+   fprintf(stderr,"The degrees of freedom are the cells less the \
+parameters of the model,\n");
+   fprintf(stderr,"over the items with observations, so 1,2,3 gives the \
+same chi squared\n");
+   fprintf(stderr,"and degrees of freedom (IJK-I-J-K+2) as 'mutual'.\n\n");
+   fprintf(stderr,"With -S, the phases timed are as for chisq: open, read \
+(which also keeps\n");
+   fprintf(stderr,"the totals), chisq (including the expecteds), tests \
+(-B, -C and -m) and\n");
+   fprintf(stderr,"output.\n\n");
 }
 
 /************************************************************************/
-/*>void PrintMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM])
-   ----------------------------------------------
+/*>void PrintMatrix(CONTAB3 *ct)
+   -----------------------------
    Print out the matrix
 
    09.02.94 Original    By: ACRM
    15.12.94 Changed print field from 3 to 5
+   17.10.26 Takes a CONTAB3
+   17.10.26 Written through gDisplayBuf
 */
-void PrintMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM])
+void PrintMatrix(CONTAB3 *ct)
 {
-   int i, j, k, jtot;
+   OUTBUF *ob = gDisplayBuf;
+   int    i, j, k, jtot;
    
-   for(k=0; k<gNItem3; k++)
+   for(k=0; k<ct->nItems[2]; k++)
    {
-      printf("Plane %d\n", k+1);
+      OutBufString(ob, "Plane ");
+      OutBufInt(ob, k+1, 0);
+      OutBufChar(ob, '\n');
       
-      for(i=0; i<gNItem1; i++)
+      for(i=0; i<ct->nItems[0]; i++)
       {
          jtot = 0;
-         for(j=0; j<gNItem2; j++)
+         for(j=0; j<ct->nItems[1]; j++)
          {
-            printf("%5d ",matrix[i][j][k]);
-            jtot += matrix[i][j][k];
+            OutBufInt(ob, Contab3Count(ct, i, j, k), 5);
+            OutBufChar(ob, ' ');
+            jtot += Contab3Count(ct, i, j, k);
          }
-         printf(" : %d\n",jtot);
+         OutBufText(ob, " : ", 3);
+         OutBufInt(ob, jtot, 0);
+         OutBufChar(ob, '\n');
       }
-      printf("\n");
+      OutBufChar(ob, '\n');
    }
-   
+   FlushOutBuf(ob);
+}
+
+/************************************************************************/
+/*>BOOL WriteCells(CONTAB3 *ct, char *fileName)
+   --------------------------------------------
+   Input:   CONTAB3 *ct        The table
+            char    *fileName  File to write
+   Returns: BOOL               Success?
+
+   Writes a TSV line for each cell: the three labels, observed, expected
+   and the cell's contribution to chi squared (0 if the expected is too
+   small to be included)
+
+   17.10.26 Original    By: ACRM
+*/
+BOOL WriteCells(CONTAB3 *ct, char *fileName)
+{
+   FILE   *fp;
+   OUTBUF *ob;
+   int    i, j, k, count;
+   double expected;
+   BOOL   ok;
+
+   if((fp = fopen(fileName, "w")) == NULL)
+   {
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+      return(FALSE);
+   }
+   if((ob = CreateOutBuf(fp, 0)) == NULL)
+   {
+      fprintf(stderr,"No memory for output\n");
+      fclose(fp);
+      return(FALSE);
+   }
+
+   OutBufString(ob, "item1\titem2\titem3\tobserved\texpected\t\
+contribution\n");
+   for(i=0; i<ct->nItems[0]; i++)
+   {
+      for(j=0; j<ct->nItems[1]; j++)
+      {
+         for(k=0; k<ct->nItems[2]; k++)
+         {
+            expected = Contab3Expected(ct, i, j, k);
+            count    = Contab3Count(ct, i, j, k);
+            OutBufString(ob, CONTAB3LABEL(ct, 0, i));
+            OutBufChar(ob, '\t');
+            OutBufString(ob, CONTAB3LABEL(ct, 1, j));
+            OutBufChar(ob, '\t');
+            OutBufString(ob, CONTAB3LABEL(ct, 2, k));
+            OutBufChar(ob, '\t');
+            OutBufInt(ob, count, 0);
+            OutBufChar(ob, '\t');
+            OutBufReal(ob, expected, 0, 6);
+            OutBufChar(ob, '\t');
+            OutBufReal(ob, ChiContribution((double)count, expected, 0),
+                       0, 6);
+            OutBufChar(ob, '\n');
+         }
+      }
+   }
+
+   ok = FreeOutBuf(ob);
+   if(fclose(fp))
+      ok = FALSE;
+   if(!ok)
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+
+   return(ok);
+}
+
+/************************************************************************/
+/*>BOOL PrintStrata(CONTAB3 *ct)
+   -----------------------------
+   Input:   CONTAB3 *ct      The table
+   Returns: BOOL             Success?
+
+   For each dimension in turn (last first) taken as the strata, prints
+   the test of the other two for independence within the strata and
+   the CMH test across them (-C)
+
+   17.10.26 Original    By: ACRM
+*/
+BOOL PrintStrata(CONTAB3 *ct)
+{
+   STRATARESULT sr;
+   char         name[40], cmhName[48];
+   int          given;
+
+   for(given=2; given>=0; given--)
+   {
+      StartPhase(gStats, STATS_TESTS);
+      if(!Contab3Strata(ct, given, gResult.gStat,
+                        (gThreads ? gThreads : NumProcessors()), &sr))
+      {
+         fprintf(stderr,"Warning: No memory for the stratified tests\n");
+         return(FALSE);
+      }
+      StartPhase(gStats, STATS_OUTPUT);
+
+      sprintf(name, "item%d,item%d|item%d", ((given == 0) ? 2 : 1),
+              ((given == 2) ? 2 : 3), given+1);
+      if(sr.partial.warnings & CHIWARN_ZERO)
+      {
+         fprintf(stderr,"Warning: %d expecteds for %s were < %g and not \
+included\n", sr.partial.nZero, name, SMALL);
+      }
+      if(sr.partial.warnings & CHIWARN_SMALL)
+      {
+         fprintf(stderr,"Warning: More than 25%% of expecteds for %s were \
+< 5\n", name);
+      }
+      PrintResult(stdout, &gResult, name, sr.partial.chisq,
+                  sr.partial.dof, -1.0, -1.0, sr.partial.g, 1.0);
+
+      if(sr.gotCMH)
+      {
+         sprintf(cmhName, "CMH %s", name);
+         PrintResult(stdout, &gResult, cmhName, sr.cmh.chisq, sr.cmh.dof,
+                     -1.0, -1.0, -1.0, 1.0);
+      }
+      else
+      {
+         fprintf(stderr,"Warning: Too many items for the CMH test of \
+%s\n", name);
+      }
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL PrintModels(CONTAB3 *ct)
+   -----------------------------
+   Input:   CONTAB3 *ct      The table
+   Globals: char    *gModels[]
+            int     gNModels
+   Returns: BOOL             Success?
+
+   Fits and prints the test of each model given with -m. The result is
+   named by the model's generating margins, with any that are contained
+   in others dropped
+
+   17.10.26 Original    By: ACRM
+*/
+BOOL PrintModels(CONTAB3 *ct)
+{
+   MODELRESULT mr;
+   char        name[40], *chp;
+   int         m, g, d, ret;
+
+   for(m=0; m<gNModels; m++)
+   {
+      StartPhase(gStats, STATS_TESTS);
+      ret = Contab3FitModel(ct, gModels[m], gTolerance, gMaxIter,
+                            (gThreads ? gThreads : NumProcessors()), &mr);
+      StartPhase(gStats, STATS_OUTPUT);
+      if(ret == 0)
+      {
+         fprintf(stderr,"Warning: No memory to fit the models\n");
+         return(FALSE);
+      }
+      if(ret < 0)
+      {
+         fprintf(stderr,"Warning: Model '%s' is not valid. Give the \
+dimensions (1-3) in each\n", gModels[m]);
+         fprintf(stderr,"         margin separated by commas, e.g. \
+12,13,23\n");
+         continue;
+      }
+
+      strcpy(name, "model ");
+      chp = name + strlen(name);
+      for(g=0; g<mr.nGenerators; g++)
+      {
+         if(g)
+            *(chp++) = ',';
+         for(d=0; d<3; d++)
+         {
+            if(mr.generators[g] & (1 << d))
+               *(chp++) = (char)('1' + d);
+         }
+      }
+      *chp = '\0';
+
+      if(!mr.converged)
+      {
+         fprintf(stderr,"Warning: %s did not converge in %d cycles \
+(largest margin\n", name, mr.iterations);
+         fprintf(stderr,"         difference %g)\n", mr.deviation);
+      }
+      if(mr.fit.warnings & CHIWARN_ZERO)
+      {
+         fprintf(stderr,"Warning: %d expecteds for %s were < %g and not \
+included\n", mr.fit.nZero, name, SMALL);
+      }
+      if(mr.fit.warnings & CHIWARN_SMALL)
+      {
+         fprintf(stderr,"Warning: More than 25%% of expecteds for %s were \
+< 5\n", name);
+      }
+      PrintResult(stdout, &gResult, name, mr.fit.chisq, mr.fit.dof,
+                  -1.0, -1.0, mr.fit.g, 1.0);
+   }
+   return(TRUE);
 }
 
 
@@ -497,12 +881,37 @@ void PrintMatrix(int matrix[MAXITEM][MAXITEM][MAXITEM])
    Output:  char   *infile      Input file (or blank string)
             char   *outfile     Output file (or blank string)
    Globals: int    gDisplay
+            RESULTFORMAT gResult
+            long   gReps
+            unsigned long gSeed
+            int    gThreads
+            BOOL   gShowStats
+            BOOL   gPerf
+            char   *gStatsFile
+            BOOL   gAccumulate
+            BOOL   gRaw
+            char   *gCellsFile
+            BOOL   gStrata
+            char   *gModels[]
+            int    gNModels
+            double gTolerance
+            int    gMaxIter
    Returns: BOOL                Success?
 
    Parse the command line
    
    06.08.03 Original    By: ACRM
    16.06.09 Added -f
+   17.10.26 Added -p, -a and -o
+   17.10.26 Added -w
+   17.10.26 Added -B, -s and -j
+   17.10.26 Added -g
+   17.10.26 Added -S, --stats and --perf
+   17.10.26 Added -A
+   17.10.26 Added -r
+   17.10.26 Added --cells
+   17.10.26 Added -C
+   17.10.26 Added -m, -t and -i
 */
 BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
 {
@@ -529,6 +938,109 @@ BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
          case 'e':
             gGotExpecteds = TRUE;
             break;
+         case 'A':
+            gAccumulate = TRUE;
+            break;
+         case 'r':
+            gRaw = TRUE;
+            break;
+         case 'p':
+            gResult.pValue = TRUE;
+            break;
+         case 'g':
+            gResult.gStat = TRUE;
+            break;
+         case 'a':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lf", &(gResult.alpha)) ||
+               (gResult.alpha <= 0.0) || (gResult.alpha >= 1.0))
+               return(FALSE);
+            break;
+         case 'o':
+            argc--;
+            argv++;
+            if(!argc || ((gResult.format = ParseOutputFormat(argv[0])) < 0))
+               return(FALSE);
+            break;
+         case 'w':
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            gWriteFile = argv[0];
+            break;
+         case 'B':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%ld", &gReps) ||
+               (gReps < 1) || (gReps > MAXREPS))
+               return(FALSE);
+            gResult.simulated = TRUE;
+            break;
+         case 's':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lu", &gSeed))
+               return(FALSE);
+            break;
+         case 'j':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", &gThreads) ||
+               (gThreads < 0))
+               return(FALSE);
+            break;
+         case 'S':
+            gShowStats = TRUE;
+            break;
+         case 'C':
+            gStrata = TRUE;
+            break;
+         case 'm':
+            argc--;
+            argv++;
+            if(!argc || (gNModels == MAXMODELS))
+               return(FALSE);
+            gModels[gNModels++] = argv[0];
+            gResult.gStat       = TRUE;
+            break;
+         case 't':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lf", &gTolerance) ||
+               (gTolerance <= 0.0))
+               return(FALSE);
+            break;
+         case 'i':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", &gMaxIter) ||
+               (gMaxIter < 1))
+               return(FALSE);
+            break;
+         case '-':
+            if(!strcmp(argv[0], "--perf"))
+            {
+               gShowStats = gPerf = TRUE;
+               break;
+            }
+            if(strcmp(argv[0], "--stats") && strcmp(argv[0], "--cells"))
+               return(FALSE);
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            if(!strcmp(argv[-1], "--cells"))
+            {
+               gCellsFile = argv[0];
+            }
+            else
+            {
+               gStatsFile = argv[0];
+               gShowStats = TRUE;
+            }
+            break;
          default:
             return(FALSE);
             break;
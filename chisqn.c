@@ -0,0 +1,672 @@
+/*************************************************************************
+
+   Program:    chisqn
+   File:       chisqn.c
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Chi squared test of mutual independence for tables with
+               any number of factors
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   A front end to the CONTABN engine in libchisq. The input is read as
+   for chisq and chisq3 but may have any number of labels before the
+   count. The number of dimensions is taken from the first line (or
+   given with -n).
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Notes:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original based on ChiSq3
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "bioplib/MathType.h"
+#include "bioplib/SysDefs.h"
+#include "bioplib/general.h"
+#include "bioplib/macros.h"
+
+#include "contab.h"
+#include "results.h"
+#include "chikern.h"
+#include "lineread.h"
+#include "chistats.h"
+#include "outbuf.h"
+
+/************************************************************************/
+/* Globals
+*/
+BOOL gDisplay      = FALSE,
+     gGotExpecteds = FALSE,
+     gShowStats    = FALSE,
+     gPerf         = FALSE,
+     gAccumulate   = FALSE,
+     gRaw          = FALSE;
+RESULTFORMAT gResult = {OUTPUT_TEXT, FALSE, FALSE, FALSE, FALSE, 0.0};
+int  gDims         = 0;
+char *gStatsFile   = NULL;
+CHISTATS *gStats   = NULL;
+char *gCellsFile   = NULL;
+
+/************************************************************************/
+/* Prototypes
+*/
+int main(int argc, char **argv);
+CONTABN *ReadData(LINEREADER *in);
+int  CountDims(char *line, size_t length);
+REAL CalcChiSq(CONTABN *ct, FILE *out, int *NDoF, REAL *g,
+               REAL *williams);
+BOOL CellObserved(CONTABN *ct, int *pos);
+void WriteLabels(OUTBUF *ob, CONTABN *ct, int *pos, int separator);
+BOOL WriteCells(CONTABN *ct, char *fileName);
+void Usage(void);
+BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile);
+
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program for chi squared calculation
+
+   17.10.26 Original    By: ACRM
+*/
+int main(int argc, char **argv)
+{
+   FILE       *in = stdin,
+              *out = stdout;
+   LINEREADER *reader;
+   CONTABN    *ct;
+   REAL       chisq,
+              g,
+              williams;
+   int        dof;
+   char       InFile[160], OutFile[160];
+
+   if(!ParseCmdLine(argc, argv, InFile, OutFile) ||
+      (gRaw && gGotExpecteds))
+   {
+      Usage();
+      return(0);
+   }
+
+   if(gShowStats)
+   {
+      if((gStats = CreateStats(gPerf)) == NULL)
+      {
+         fprintf(stderr,"No memory for statistics\n");
+         return(1);
+      }
+      StartPhase(gStats, STATS_OPEN);
+   }
+
+   if(!blOpenStdFiles(InFile, OutFile, &in, &out))
+   {
+      fprintf(stderr,"Unable to open I/O files\n");
+      return(1);
+   }
+   if((reader = OpenLineReader(in)) == NULL)
+   {
+      fprintf(stderr,"No memory for input\n");
+      return(1);
+   }
+
+   StartPhase(gStats, STATS_READ);
+   ct = ReadData(reader);
+   CloseLineReader(reader);
+   if(ct == NULL)
+      return(1);
+
+   if(gStats != NULL)
+   {
+      gStats->nTables++;
+      for(dof=0; dof<ct->nDims; dof++)
+         AddLabelStats(gStats, ct->labels[dof]);
+   }
+
+   chisq = CalcChiSq(ct, out, &dof, &g, &williams);
+   if(gCellsFile != NULL)
+      WriteCells(ct, gCellsFile);
+   PrintResultHeader(out, &gResult, FALSE);
+   PrintResult(out, &gResult, NULL, chisq, dof, -1.0, -1.0, g,
+               williams);
+
+   if(gStats != NULL)
+      WriteStats(gStats, gStatsFile);
+   FreeStats(gStats);
+   FreeContabN(ct);
+
+   return(0);
+}
+
+/************************************************************************/
+/*>CONTABN *ReadData(LINEREADER *in)
+   ---------------------------------
+   Input:   LINEREADER *in   Input file
+   Returns: CONTABN *        The table (NULL on error, which has been
+                             reported)
+
+   Creates the table with the number of dimensions given by the first
+   line that is not blank (or -n) and reads the data into it. Lines with
+   too few labels are ignored and a missing count is taken as zero. With
+   -A, the counts for a cell that appears more than once are summed,
+   otherwise the last one is used. With -r each line is a single
+   observation with no count.
+
+   17.10.26 Original    By: ACRM (from ReadData() in chisq3)
+*/
+CONTABN *ReadData(LINEREADER *in)
+{
+   CONTABN *ct = NULL;
+   char    *line;
+   size_t  lineLength;
+   int     status, nDims;
+
+   while((line = ReadLine(in, &lineLength)) != NULL)
+   {
+      if(gStats != NULL)
+         gStats->nLines++;
+
+      if(ct == NULL)
+      {
+         if((nDims = CountDims(line, lineLength)) == 0)
+            continue;
+         if((nDims < 2) || (nDims > CONTABMAXDIMS))
+         {
+            fprintf(stderr,"Error: tables must have 2 to %d dimensions\n",
+                    CONTABMAXDIMS);
+            return(NULL);
+         }
+         if((ct = CreateContabN(nDims, gGotExpecteds)) == NULL)
+         {
+            fprintf(stderr,"No memory for table\n");
+            return(NULL);
+         }
+         ct->accumulate = gAccumulate;
+         ct->raw        = gRaw;
+      }
+
+      if((status = ContabNParseLine(ct, line, lineLength)) != 1)
+      {
+         if(status < 0)
+            fprintf(stderr,"Error: a count would become negative or too \
+large\n");
+         else
+            fprintf(stderr,"No memory for table\n");
+         FreeContabN(ct);
+         return(NULL);
+      }
+   }
+
+   if(in->error)
+   {
+      fprintf(stderr,"No memory for input line\n");
+      FreeContabN(ct);
+      return(NULL);
+   }
+   if(ct == NULL)
+      fprintf(stderr,"Error: no data\n");
+
+   return(ct);
+}
+
+/************************************************************************/
+/*>int CountDims(char *line, size_t length)
+   ----------------------------------------
+   Input:   char   *line     Line of text (need not be terminated)
+            size_t length    Length of the line
+   Returns: int              Number of dimensions (0 for a blank line)
+
+   The number of labels on the line: the tokens less the count (unless
+   -r) and the expected (with -e). -n overrides this.
+
+   17.10.26 Original    By: ACRM
+*/
+int CountDims(char *line, size_t length)
+{
+   char   *end = line + length;
+   size_t tokenLength;
+   int    nTokens = 0;
+
+   while(NextToken(&line, end, &tokenLength) != NULL)
+      nTokens++;
+   if(nTokens == 0)
+      return(0);
+   if(gDims)
+      return(gDims);
+
+   return(nTokens - (gRaw ? 0 : 1) - (gGotExpecteds ? 1 : 0));
+}
+
+/************************************************************************/
+/*>REAL CalcChiSq(CONTABN *ct, FILE *out, int *NDoF, REAL *g,
+                  REAL *williams)
+   -----------------------------------------------------------
+   Input:   CONTABN *ct       The table
+            FILE    *out      Where the display is written
+   Output:  int     *NDoF     Degrees of freedom
+            REAL    *g        G statistic (-1 without -g)
+            REAL    *williams Williams' correction for G
+   Returns: REAL             Chi squared
+
+   Calculates chi squared with ContabNChiSq() and does the display and
+   warnings
+
+   17.10.26 Original    By: ACRM (from CalcChiSq() in chisq3)
+*/
+REAL CalcChiSq(CONTABN *ct, FILE *out, int *NDoF, REAL *g,
+               REAL *williams)
+{
+   CHIRESULT result;
+   OUTBUF    *ob;
+   int       pos[CONTABMAXDIMS], d, more;
+
+   StartPhase(gStats, STATS_CHISQ);
+   ContabNChiSq(ct, gResult.gStat, &result);
+   AddResultStats(gStats, &result);
+   StartPhase(gStats, STATS_OUTPUT);
+   *NDoF     = result.dof;
+   *g        = (REAL)result.g;
+   *williams = (REAL)result.williams;
+
+   if(gDisplay)
+   {
+      if((ob = CreateOutBuf(out, 0)) == NULL)
+      {
+         fprintf(stderr,"No memory for output\n");
+      }
+      else
+      {
+         OutBufString(ob, "\nTotal observations: ");
+         OutBufInt(ob, result.nObs, 0);
+         OutBufString(ob, "\n\n");
+
+         /* Cells whose items all have observations, as
+            "item1 ... itemN: Obs %5.1f Exp %5.1f"
+         */
+         for(d=0; d<ct->nDims; d++)
+            pos[d] = 0;
+         for(more=(ct->nObs != 0); more;
+             more=ContabNNextCell(ct, pos, ct->nDims))
+         {
+            if(!CellObserved(ct, pos))
+               continue;
+
+            WriteLabels(ob, ct, pos, ' ');
+            OutBufText(ob, ": Obs ", 6);
+            OutBufReal(ob, (REAL)ct->counts[ContabNIndex(ct, pos)], 5, 1);
+            OutBufText(ob, " Exp ", 5);
+            OutBufReal(ob, (REAL)ContabNExpected(ct, pos), 5, 1);
+            OutBufChar(ob, '\n');
+         }
+         FreeOutBuf(ob);
+      }
+   }
+
+   if(result.warnings & CHIWARN_ZERO)
+   {
+      fprintf(stderr,"Warning: %d expecteds were < %g and not included\n",
+              result.nZero, SMALL);
+   }
+
+   if(result.warnings & CHIWARN_SMALL)
+   {
+      fprintf(stderr,"Warning: More than 25%% of expecteds were < 5\n");
+   }
+
+   return((REAL)result.chisq);
+}
+
+/************************************************************************/
+/*>BOOL CellObserved(CONTABN *ct, int *pos)
+   ----------------------------------------
+   Input:   CONTABN *ct      The table
+            int     *pos     Position of the cell in each dimension
+   Returns: BOOL             All the cell's items have observations?
+
+   17.10.26 Original    By: ACRM
+*/
+BOOL CellObserved(CONTABN *ct, int *pos)
+{
+   int d;
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      if(!ct->tot[d][pos[d]])
+         return(FALSE);
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>void WriteLabels(OUTBUF *ob, CONTABN *ct, int *pos, int separator)
+   ------------------------------------------------------------------
+   I/O:     OUTBUF  *ob         Writer
+   Input:   CONTABN *ct         The table
+            int     *pos        Position of the cell in each dimension
+            int     separator   Character between the labels
+
+   17.10.26 Original    By: ACRM
+*/
+void WriteLabels(OUTBUF *ob, CONTABN *ct, int *pos, int separator)
+{
+   int d;
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      if(d)
+         OutBufChar(ob, separator);
+      OutBufString(ob, CONTABNLABEL(ct, d, pos[d]));
+   }
+}
+
+/************************************************************************/
+/*>BOOL WriteCells(CONTABN *ct, char *fileName)
+   --------------------------------------------
+   Input:   CONTABN *ct        The table
+            char    *fileName  File to write
+   Returns: BOOL               Success?
+
+   Writes a TSV line for each cell whose items all have observations:
+   the labels, observed, expected and the cell's contribution to chi
+   squared (0 if the expected is too small to be included)
+
+   17.10.26 Original    By: ACRM (from WriteCells() in chisq3)
+*/
+BOOL WriteCells(CONTABN *ct, char *fileName)
+{
+   FILE   *fp;
+   OUTBUF *ob;
+   int    pos[CONTABMAXDIMS], d, count, more;
+   double expected;
+   BOOL   ok;
+
+   if((fp = fopen(fileName, "w")) == NULL)
+   {
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+      return(FALSE);
+   }
+   if((ob = CreateOutBuf(fp, 0)) == NULL)
+   {
+      fprintf(stderr,"No memory for output\n");
+      fclose(fp);
+      return(FALSE);
+   }
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      OutBufString(ob, "item");
+      OutBufInt(ob, d+1, 0);
+      OutBufChar(ob, '\t');
+      pos[d] = 0;
+   }
+   OutBufString(ob, "observed\texpected\tcontribution\n");
+
+   for(more=(ct->nObs != 0); more;
+       more=ContabNNextCell(ct, pos, ct->nDims))
+   {
+      if(!CellObserved(ct, pos))
+         continue;
+
+      count    = ct->counts[ContabNIndex(ct, pos)];
+      expected = ContabNExpected(ct, pos);
+      WriteLabels(ob, ct, pos, '\t');
+      OutBufChar(ob, '\t');
+      OutBufInt(ob, count, 0);
+      OutBufChar(ob, '\t');
+      OutBufReal(ob, expected, 0, 6);
+      OutBufChar(ob, '\t');
+      OutBufReal(ob, ChiContribution((double)count, expected, 0), 0, 6);
+      OutBufChar(ob, '\n');
+   }
+
+   ok = FreeOutBuf(ob);
+   if(fclose(fp))
+      ok = FALSE;
+   if(!ok)
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+
+   return(ok);
+}
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Prints a usage message
+
+   17.10.26 Original    By: ACRM
+*/
+void Usage(void)
+{
+   fprintf(stderr,"ChiSqN V1.0 (c) 2026 Andrew C.R. Martin, UCL\n");
+   fprintf(stderr,"Usage: chisqn [-n dims] [-d] [-e|-r] [-A] [-p] [-g] \
+[-a alpha]\n");
+   fprintf(stderr,"              [-o text|tsv|json] [-S [--stats file] \
+[--perf]]\n");
+   fprintf(stderr,"              [--cells file] [in [out]]\n");
+   fprintf(stderr,"       -n Number of dimensions (default from the \
+first line)\n");
+   fprintf(stderr,"       -d Display observed and expected values\n");
+   fprintf(stderr,"       -e Expected values follow the counts\n");
+   fprintf(stderr,"       -r Raw input - each line is one observation: \
+item1 ... itemN\n");
+   fprintf(stderr,"       -A Add up the counts (and expecteds) for cells \
+that appear more\n");
+   fprintf(stderr,"          than once rather than using the last\n");
+   fprintf(stderr,"       -p Print the p-value\n");
+   fprintf(stderr,"       -g Also give the G (likelihood ratio) \
+statistic\n");
+   fprintf(stderr,"       -a Print the critical value at significance \
+level alpha\n");
+   fprintf(stderr,"       -o Output format (default text). TSV and JSON \
+always include\n");
+   fprintf(stderr,"          the p-value\n");
+   fprintf(stderr,"       -S Report the time in each phase and counts of \
+the work done\n");
+   fprintf(stderr,"          on stderr\n");
+   fprintf(stderr,"       --stats Write the -S report to a file as JSON \
+instead\n");
+   fprintf(stderr,"       --perf  Also count instructions, cycles and \
+cache misses with -S\n");
+   fprintf(stderr,"               (Linux only)\n");
+   fprintf(stderr,"       --cells Write the observed, expected and \
+contribution to chi\n");
+   fprintf(stderr,"               squared of each cell to a file as \
+TSV\n");
+   fprintf(stderr,"\nInput file has format: item1 ... itemN NObs [Exp]\n");
+   fprintf(stderr,"with 2 to %d items. Every line must have the same \
+number of items.\n", CONTABMAXDIMS);
+   fprintf(stderr,"The contingency table grows to fit the data\n");
+   fprintf(stderr,"A count, or a sum of counts with -A, too large for \
+an int is an error\n\n");
+   fprintf(stderr,"The test is for mutual independence of all the \
+factors. The expected\n");
+   fprintf(stderr,"for a cell is the product of its totals over \
+N^(dims-1) and the degrees\n");
+   fprintf(stderr,"of freedom are prod(n) - sum(n) + dims - 1 where n \
+is the number of\n");
+   fprintf(stderr,"items with observations in each dimension. Items \
+with none are left\n");
+   fprintf(stderr,"out. chisq3 gives the same degrees of freedom for \
+three factors.\n\n");
+   fprintf(stderr,"With -g, G = 2 sum(O ln(O/E)) is also given with its \
+p-value.\n\n");
+}
+
+/************************************************************************/
+/*>BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
+   ---------------------------------------------------------------------
+   Input:   int    argc         Argument count
+            char   **argv       Argument array
+   Output:  char   *infile      Input file (or blank string)
+            char   *outfile     Output file (or blank string)
+   Globals: int    gDims
+            BOOL   gDisplay
+            BOOL   gGotExpecteds
+            BOOL   gRaw
+            BOOL   gAccumulate
+            RESULTFORMAT gResult
+            BOOL   gShowStats
+            BOOL   gPerf
+            char   *gStatsFile
+            char   *gCellsFile
+   Returns: BOOL                Success?
+
+   Parse the command line
+
+   17.10.26 Original    By: ACRM (from ParseCmdLine() in chisq3)
+*/
+BOOL ParseCmdLine(int argc, char **argv, char *infile, char *outfile)
+{
+   int minArgs = 0,
+       maxArgs = 2;
+
+   argc--;
+   argv++;
+
+   infile[0] = outfile[0] = '\0';
+
+   if(argc < minArgs)
+      return(FALSE);
+
+   while(argc)
+   {
+      if(argv[0][0] == '-')
+      {
+         switch(argv[0][1])
+         {
+         case 'n':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%d", &gDims) ||
+               (gDims < 2) || (gDims > CONTABMAXDIMS))
+               return(FALSE);
+            break;
+         case 'd':
+            gDisplay = TRUE;
+            break;
+         case 'e':
+            gGotExpecteds = TRUE;
+            break;
+         case 'A':
+            gAccumulate = TRUE;
+            break;
+         case 'r':
+            gRaw = TRUE;
+            break;
+         case 'p':
+            gResult.pValue = TRUE;
+            break;
+         case 'g':
+            gResult.gStat = TRUE;
+            break;
+         case 'a':
+            argc--;
+            argv++;
+            if(!argc || !sscanf(argv[0], "%lf", &(gResult.alpha)) ||
+               (gResult.alpha <= 0.0) || (gResult.alpha >= 1.0))
+               return(FALSE);
+            break;
+         case 'o':
+            argc--;
+            argv++;
+            if(!argc || ((gResult.format = ParseOutputFormat(argv[0])) < 0))
+               return(FALSE);
+            break;
+         case 'S':
+            gShowStats = TRUE;
+            break;
+         case '-':
+            if(!strcmp(argv[0], "--perf"))
+            {
+               gShowStats = gPerf = TRUE;
+               break;
+            }
+            if(strcmp(argv[0], "--stats") && strcmp(argv[0], "--cells"))
+               return(FALSE);
+            argc--;
+            argv++;
+            if(!argc)
+               return(FALSE);
+            if(!strcmp(argv[-1], "--cells"))
+            {
+               gCellsFile = argv[0];
+            }
+            else
+            {
+               gStatsFile = argv[0];
+               gShowStats = TRUE;
+            }
+            break;
+         default:
+            return(FALSE);
+            break;
+         }
+      }
+      else
+      {
+         /* Check that there are correct number of arguments left       */
+         if((argc < minArgs) || (argc > maxArgs))
+            return(FALSE);
+
+         /* Copy the first to infile                                    */
+         if(argc)
+         {
+            strcpy(infile, argv[0]);
+            argc--;
+            argv++;
+
+            /* If there's another, copy it to outfile                   */
+            if(argc)
+            {
+               strcpy(outfile, argv[0]);
+               argc--;
+               argv++;
+            }
+         }
+
+         return(TRUE);
+      }
+      argc--;
+      argv++;
+   }
+
+   return(TRUE);
+}
@@ -0,0 +1,432 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       chistats.c
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Phase timings and counters (-S)
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Wall clock time is collected for each phase of a run, with counts of
+   the work done in the hot paths: input lines, label lookups and the
+   hash slots they probed, and the cells visited by the chi squared
+   kernel. On Linux, the instructions, cycles, cache references and
+   cache misses for each phase may also be counted with perf_event_open().
+   These are for user space only and include threads (such as those for
+   -B) once they have finished.
+
+   Only one phase is current at a time so the phase times add up to the
+   total.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE                /* For syscall()                 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "chistats.h"
+
+/************************************************************************/
+/* Globals
+*/
+static const char *sPhaseNames[NSTATSPHASES] =
+{
+   "open", "read", "chisq", "tests", "output", "clear"
+};
+
+static const char *sHWNames[NHWCOUNTERS] =
+{
+   "instructions", "cycles", "cache_refs", "cache_misses"
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+static double Now(void);
+static void   OpenHWCounters(CHISTATS *st);
+static void   ReadHWCounters(CHISTATS *st, double *values);
+
+/************************************************************************/
+/*>CHISTATS *CreateStats(int hardware)
+   -----------------------------------
+   Input:   int      hardware  Also count hardware events
+   Returns: CHISTATS *         New statistics with no phase started
+                               (NULL if no memory)
+
+   If the hardware counters cannot be opened (not Linux, or not allowed
+   by perf_event_paranoid) the run carries on without them and
+   PrintStats() says so.
+
+   17.10.26 Original    By: ACRM
+*/
+CHISTATS *CreateStats(int hardware)
+{
+   CHISTATS *st;
+   int      i;
+
+   if((st = (CHISTATS *)calloc(1, sizeof(CHISTATS))) == NULL)
+      return(NULL);
+
+   st->phase    = -1;
+   st->hwWanted = hardware;
+   st->hardware = 0;
+   for(i=0; i<NHWCOUNTERS; i++)
+      st->hwFd[i] = -1;
+
+   if(hardware)
+      OpenHWCounters(st);
+
+   return(st);
+}
+
+/************************************************************************/
+/*>void FreeStats(CHISTATS *st)
+   ----------------------------
+   I/O:     CHISTATS *st     Statistics to free (may be NULL)
+
+   17.10.26 Original    By: ACRM
+*/
+void FreeStats(CHISTATS *st)
+{
+   int i;
+
+   if(st != NULL)
+   {
+      for(i=0; i<NHWCOUNTERS; i++)
+      {
+         if(st->hwFd[i] >= 0)
+            close(st->hwFd[i]);
+      }
+      free(st);
+   }
+}
+
+/************************************************************************/
+/*>void StartPhase(CHISTATS *st, int phase)
+   ----------------------------------------
+   I/O:     CHISTATS *st     Statistics (nothing is done if NULL)
+   Input:   int      phase   STATS_ phase to start
+
+   Ends the current phase, if any, and starts timing the new one. The
+   same phase may be started many times and its times are summed.
+
+   17.10.26 Original    By: ACRM
+*/
+void StartPhase(CHISTATS *st, int phase)
+{
+   if(st == NULL)
+      return;
+
+   EndPhase(st);
+   st->phase = phase;
+   if(st->hardware)
+      ReadHWCounters(st, st->hwStart);
+   st->start = Now();
+}
+
+/************************************************************************/
+/*>void EndPhase(CHISTATS *st)
+   ---------------------------
+   I/O:     CHISTATS *st     Statistics (nothing is done if NULL)
+
+   Adds the time (and hardware counts) since the current phase started
+   to that phase. There is then no current phase.
+
+   17.10.26 Original    By: ACRM
+*/
+void EndPhase(CHISTATS *st)
+{
+   double now,
+          values[NHWCOUNTERS];
+   int    i;
+
+   if((st == NULL) || (st->phase < 0))
+      return;
+
+   now = Now();
+   st->seconds[st->phase] += now - st->start;
+   if(st->hardware)
+   {
+      ReadHWCounters(st, values);
+      for(i=0; i<NHWCOUNTERS; i++)
+         st->hw[st->phase][i] += values[i] - st->hwStart[i];
+   }
+   st->phase = -1;
+}
+
+/************************************************************************/
+/*>void AddLabelStats(CHISTATS *st, LABELTABLE *lt)
+   ------------------------------------------------
+   I/O:     CHISTATS   *st   Statistics (nothing is done if NULL)
+   Input:   LABELTABLE *lt   Label table whose lookups are to be added
+
+   Must be called before the label table is cleared since that resets
+   its counts
+
+   17.10.26 Original    By: ACRM
+*/
+void AddLabelStats(CHISTATS *st, LABELTABLE *lt)
+{
+   if((st == NULL) || (lt == NULL))
+      return;
+
+   st->nLookups += lt->nLookups;
+   st->nProbes  += lt->nProbes;
+}
+
+/************************************************************************/
+/*>void AddResultStats(CHISTATS *st, CHIRESULT *result)
+   ----------------------------------------------------
+   I/O:     CHISTATS  *st     Statistics (nothing is done if NULL)
+   Input:   CHIRESULT *result Result from ContabChiSq() or Contab3ChiSq()
+
+   17.10.26 Original    By: ACRM
+*/
+void AddResultStats(CHISTATS *st, CHIRESULT *result)
+{
+   if(st == NULL)
+      return;
+
+   st->nVisited  += (unsigned long)result->nVisited;
+   st->nOccupied += (unsigned long)result->nOccupied;
+   st->nSmall    += (unsigned long)result->nSmall;
+   st->nZero     += (unsigned long)result->nZero;
+}
+
+/************************************************************************/
+/*>void PrintStats(FILE *fp, CHISTATS *st, int json)
+   -------------------------------------------------
+   Input:   FILE     *fp     Where to print
+            CHISTATS *st     Statistics (the current phase is ended)
+            int      json    Print as a single JSON object rather than
+                             as text
+
+   17.10.26 Original    By: ACRM
+*/
+void PrintStats(FILE *fp, CHISTATS *st, int json)
+{
+   double total = 0.0;
+   int    i, j;
+
+   EndPhase(st);
+   for(i=0; i<NSTATSPHASES; i++)
+      total += st->seconds[i];
+
+   if(json)
+   {
+      fprintf(fp, "{\"phases\": {");
+      for(i=0; i<NSTATSPHASES; i++)
+      {
+         fprintf(fp, "%s\"%s\": {\"seconds\": %.6f", (i ? ", " : ""),
+                 sPhaseNames[i], st->seconds[i]);
+         for(j=0; st->hardware && (j<NHWCOUNTERS); j++)
+            fprintf(fp, ", \"%s\": %.0f", sHWNames[j], st->hw[i][j]);
+         fprintf(fp, "}");
+      }
+      fprintf(fp, "}, \"total_s\": %.6f, \"tables\": %lu, \
+\"lines\": %lu, \"label_lookups\": %lu, \"label_probes\": %lu, \
+\"cells_visited\": %lu, \"cells_occupied\": %lu, \
+\"small_expecteds\": %lu, \"zero_expecteds\": %lu, \
+\"hardware\": %s}\n",
+              total, st->nTables, st->nLines, st->nLookups, st->nProbes,
+              st->nVisited, st->nOccupied, st->nSmall, st->nZero,
+              (st->hardware ? "true" : "false"));
+      return;
+   }
+
+   fprintf(fp, "%-8s %12s", "Phase", "Seconds");
+   for(j=0; st->hardware && (j<NHWCOUNTERS); j++)
+      fprintf(fp, " %14s", sHWNames[j]);
+   fprintf(fp, "\n");
+   for(i=0; i<NSTATSPHASES; i++)
+   {
+      fprintf(fp, "%-8s %12.6f", sPhaseNames[i], st->seconds[i]);
+      for(j=0; st->hardware && (j<NHWCOUNTERS); j++)
+         fprintf(fp, " %14.0f", st->hw[i][j]);
+      fprintf(fp, "\n");
+   }
+   fprintf(fp, "%-8s %12.6f\n\n", "total", total);
+
+   fprintf(fp, "Tables analyzed:        %lu\n", st->nTables);
+   fprintf(fp, "Input lines:            %lu\n", st->nLines);
+   fprintf(fp, "Label lookups:          %lu", st->nLookups);
+   if(st->nLookups)
+      fprintf(fp, " (%.3f probes each)",
+              (double)st->nProbes / (double)st->nLookups);
+   fprintf(fp, "\n");
+   fprintf(fp, "Cells visited:          %lu\n", st->nVisited);
+   fprintf(fp, "   with observations:   %lu", st->nOccupied);
+   if(st->nVisited)
+      fprintf(fp, " (%.1f%%)",
+              100.0 * (double)st->nOccupied / (double)st->nVisited);
+   fprintf(fp, "\n");
+   fprintf(fp, "   expected < 5:        %lu\n", st->nSmall);
+   fprintf(fp, "   expected too small:  %lu\n", st->nZero);
+   if(st->hwWanted && !st->hardware)
+      fprintf(fp, "Hardware counters are not available\n");
+}
+
+/************************************************************************/
+/*>int WriteStats(CHISTATS *st, char *fileName)
+   --------------------------------------------
+   Input:   CHISTATS *st       Statistics (the current phase is ended)
+            char     *fileName File for JSON output. If NULL, text is
+                               written to stderr
+   Returns: int                Success?
+
+   17.10.26 Original    By: ACRM
+*/
+int WriteStats(CHISTATS *st, char *fileName)
+{
+   FILE *fp;
+   int  ok = 1;
+
+   if(fileName == NULL)
+   {
+      PrintStats(stderr, st, 0);
+      return(1);
+   }
+
+   if((fp = fopen(fileName, "w")) == NULL)
+   {
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+      return(0);
+   }
+   PrintStats(fp, st, 1);
+   if(fclose(fp))
+   {
+      fprintf(stderr,"Error: unable to write %s\n", fileName);
+      ok = 0;
+   }
+   return(ok);
+}
+
+/************************************************************************/
+/*>static double Now(void)
+   ------------------------
+   Returns: double           Time in seconds from an arbitrary start
+
+   17.10.26 Original    By: ACRM
+*/
+static double Now(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return((double)now.tv_sec + (double)now.tv_nsec / 1.0e9);
+}
+
+/************************************************************************/
+/*>static void OpenHWCounters(CHISTATS *st)
+   ----------------------------------------
+   I/O:     CHISTATS *st     Statistics. hardware is set if all the
+                             counters could be opened
+
+   Each counter is opened on its own (rather than as a group) so that it
+   can be inherited by threads created later
+
+   17.10.26 Original    By: ACRM
+*/
+static void OpenHWCounters(CHISTATS *st)
+{
+#ifdef __linux__
+   static const unsigned long configs[NHWCOUNTERS] =
+   {
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_CACHE_REFERENCES,
+      PERF_COUNT_HW_CACHE_MISSES
+   };
+   struct perf_event_attr attr;
+   int    i;
+
+   for(i=0; i<NHWCOUNTERS; i++)
+   {
+      memset(&attr, 0, sizeof(attr));
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.size           = sizeof(attr);
+      attr.config         = configs[i];
+      attr.inherit        = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+
+      if((st->hwFd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                                     -1, 0UL)) < 0)
+      {
+         while(i--)
+         {
+            close(st->hwFd[i]);
+            st->hwFd[i] = -1;
+         }
+         return;
+      }
+   }
+   st->hardware = 1;
+#endif
+}
+
+/************************************************************************/
+/*>static void ReadHWCounters(CHISTATS *st, double *values)
+   --------------------------------------------------------
+   Input:   CHISTATS *st     Statistics with the counters open
+   Output:  double   *values Current value of each counter (0 if it
+                             could not be read)
+
+   17.10.26 Original    By: ACRM
+*/
+static void ReadHWCounters(CHISTATS *st, double *values)
+{
+   int i;
+
+   for(i=0; i<NHWCOUNTERS; i++)
+   {
+#ifdef __linux__
+      uint64_t count;
+
+      if(read(st->hwFd[i], &count, sizeof(count)) == sizeof(count))
+      {
+         values[i] = (double)count;
+         continue;
+      }
+#endif
+      values[i] = 0.0;
+   }
+}
@@ -0,0 +1,92 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       chistats.h
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Include file for phase timings and counters (-S)
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+#ifndef _CHISTATS_H
+#define _CHISTATS_H
+
+#include <stdio.h>
+
+#include "labels.h"
+#include "contab.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define STATS_OPEN      0      /* Opening and mapping the input         */
+#define STATS_READ      1      /* Parsing lines (totals are kept here)  */
+#define STATS_CHISQ     2      /* Chi squared (or -c) over the cells    */
+#define STATS_TESTS     3      /* Exact and Monte Carlo tests           */
+#define STATS_OUTPUT    4      /* Printing the results and -d           */
+#define STATS_CLEAR     5      /* Clearing the table between tables     */
+#define NSTATSPHASES    6
+
+#define NHWCOUNTERS     4      /* Instructions, cycles, cache refs and
+                                  cache misses                          */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   double        seconds[NSTATSPHASES],           /* Time in each phase */
+                 hw[NSTATSPHASES][NHWCOUNTERS],   /* Hardware counts    */
+                 start,                           /* Start of phase     */
+                 hwStart[NHWCOUNTERS];
+   unsigned long nTables,      /* Tables analyzed                       */
+                 nLines,       /* Input lines read                      */
+                 nLookups,     /* Labels looked up in the hash tables   */
+                 nProbes,      /* ...and the slots probed to find them  */
+                 nVisited,     /* Cells looked at by the kernel         */
+                 nOccupied,    /* ...that are included with observations*/
+                 nSmall,       /* ...with expected < 5                  */
+                 nZero;        /* ...with expected too small to use     */
+   int           phase,        /* Current phase (-1 if none)            */
+                 hwFd[NHWCOUNTERS],  /* perf_event files (-1 if none)   */
+                 hwWanted,     /* Hardware counters were asked for      */
+                 hardware;     /* Hardware counters are being read      */
+}  CHISTATS;
+
+/************************************************************************/
+/* Prototypes
+*/
+CHISTATS *CreateStats(int hardware);
+void FreeStats(CHISTATS *st);
+void StartPhase(CHISTATS *st, int phase);
+void EndPhase(CHISTATS *st);
+void AddLabelStats(CHISTATS *st, LABELTABLE *lt);
+void AddResultStats(CHISTATS *st, CHIRESULT *result);
+void PrintStats(FILE *fp, CHISTATS *st, int json);
+int WriteStats(CHISTATS *st, char *fileName);
+
+#endif
@@ -0,0 +1,1060 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       contab.c
+
+   Version:    V1.9
+   Date:       17.10.26
+   Function:   Two-way contingency tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Builds a two-way contingency table from labelled counts and calculates
+   chi squared, the degrees of freedom, warnings and the p-value. This
+   was the core of chisq, which is now a front end to it. The G
+   (likelihood ratio) statistic, 2 * sum of O ln(O/E), can be summed by
+   the same pass over the cells.
+
+   The counts, expecteds and row and column totals live in a single block
+   that grows to fit the labels seen. The totals are kept up to date as
+   cells are set, so chi squared is a single pass over the cells.
+
+   With expecteds from the margins, chi squared can also be written as
+
+      N * (sum over cells of O^2 / (row total * column total)) - N
+
+   A cell only appears in the sum for its own row and column, so when a
+   count changes, only the terms for that row and column need to be
+   taken out of the sum and put back. Once a running chi squared has
+   been asked for, the sum is kept up to date like this as cells change,
+   so it can be read at any moment without a pass over the table.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original - from chisq V1.17
+   V1.1  17.10.26 Added ContabAddCount(), ContabUpdateCell() and
+                  ContabRunningChiSq()
+   V1.2  17.10.26 Frees the log factorial table used by exact.c
+   V1.3  17.10.26 ContabChiSq() can also give G with Williams' correction
+   V1.4  17.10.26 Fills in the visited and occupied cell counts
+   V1.5  17.10.26 ContabParseLine() sums repeated cells if accumulate is
+                  set. Changes that would overflow a total are refused
+   V1.6  17.10.26 ContabParseLine() counts a raw observation if raw is set
+   V1.7  17.10.26 ContabLoad() only accepts files whose counts add up to
+                  their totals
+   V1.8  17.10.26 ContabLoad() frees the block that a dense file's counts
+                  replace, and a table in a mapped file is always copied
+                  before it is changed
+   V1.9  17.10.26 The row and column totals are int64_t. A count too
+                  large for an int is refused
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "contab.h"
+#include "chikern.h"
+#include "lineread.h"
+#include "tabfile.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define INITITEM 16
+
+/************************************************************************/
+/* Prototypes
+*/
+static int FindCell(CONTAB *ct, char *label1, size_t length1,
+                    char *label2, size_t length2, int *i, int *j);
+static int GrowContab(CONTAB *ct, int nItem1, int nItem2);
+static int WouldOverflow(CONTAB *ct, int i, int j, int change);
+static int UnmapContab(CONTAB *ct);
+static double CrossSum(CONTAB *ct, int i, int j);
+static void ChangeCell(CONTAB *ct, int i, int j, int change);
+static void StartRunning(CONTAB *ct);
+
+/************************************************************************/
+/*>CONTAB *CreateContab(int gotExpecteds)
+   --------------------------------------
+   Input:   int    gotExpecteds  Expecteds will be given with the counts
+   Returns: CONTAB *             An empty table (NULL if no memory)
+
+   17.10.26 Original    By: ACRM
+*/
+CONTAB *CreateContab(int gotExpecteds)
+{
+   CONTAB *ct;
+
+   if((ct = (CONTAB *)calloc(1, sizeof(CONTAB))) == NULL)
+      return(NULL);
+
+   ct->gotExpecteds = gotExpecteds;
+   ct->labels1      = CreateLabelTable();
+   ct->labels2      = CreateLabelTable();
+
+   if((ct->labels1 == NULL) || (ct->labels2 == NULL))
+   {
+      FreeContab(ct);
+      return(NULL);
+   }
+
+   return(ct);
+}
+
+/************************************************************************/
+/*>void FreeContab(CONTAB *ct)
+   ---------------------------
+   I/O:     CONTAB *ct       Table to free
+
+   17.10.26 Original    By: ACRM   17.10.26 Also frees the log factorials
+*/
+void FreeContab(CONTAB *ct)
+{
+   if(ct != NULL)
+   {
+      if(ct->arena != NULL)
+         free(ct->arena);
+      if(ct->logFact != NULL)
+         free(ct->logFact);
+      FreeLabelTable(ct->labels1);
+      FreeLabelTable(ct->labels2);
+      free(ct);
+   }
+}
+
+/************************************************************************/
+/*>void ClearContab(CONTAB *ct)
+   ----------------------------
+   I/O:     CONTAB *ct       The table
+
+   Empties the table so it can be reused. Only the nItem1 x nItem2
+   region that was used is zeroed and the memory is kept, so the cost
+   depends on the size of the table just used rather than on the
+   largest table seen.
+
+   17.10.26 Original    By: ACRM (from ResetTable() in chisq)
+   17.10.26 Stops the running chi squared
+*/
+void ClearContab(CONTAB *ct)
+{
+   int i;
+
+   if(ct->mapped)
+   {
+      /* Just forget the mapped file                                    */
+      ct->counts  = NULL;
+      ct->tot1    = ct->tot2 = NULL;
+      ct->expecteds = NULL;
+      ct->nAlloc1 = ct->nAlloc2 = 0;
+      ct->mapped  = 0;
+   }
+   else
+   {
+      for(i=0; i<ct->nItem1; i++)
+      {
+         memset(&CONTABCELL(ct, i, 0), 0, ct->nItem2 * sizeof(int));
+         if(ct->gotExpecteds)
+            memset(&CONTABEXPECTED(ct, i, 0), 0,
+                   ct->nItem2 * sizeof(double));
+      }
+      if(ct->nItem1)
+      {
+         memset(ct->tot1, 0, ct->nItem1 * sizeof(int64_t));
+         memset(ct->tot2, 0, ct->nItem2 * sizeof(int64_t));
+      }
+   }
+   ct->nObs    = 0;
+   ct->running = 0;
+
+   if(ct->labels1->external || ct->labels2->external)
+   {
+      FreeLabelTable(ct->labels1);
+      FreeLabelTable(ct->labels2);
+      ct->labels1 = CreateLabelTable();
+      ct->labels2 = CreateLabelTable();
+   }
+   else
+   {
+      ClearLabelTable(ct->labels1);
+      ClearLabelTable(ct->labels2);
+   }
+   ct->nItem1 = ct->nItem2 = 0;
+}
+
+/************************************************************************/
+/*>int ContabSetCell(CONTAB *ct, char *label1, size_t length1,
+                     char *label2, size_t length2, int count,
+                     double expected)
+   -----------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   char   *label1   Row label (need not be terminated)
+            size_t length1   Length of label1
+            char   *label2   Column label (need not be terminated)
+            size_t length2   Length of label2
+            int    count     Observed count
+            double expected  Expected value (ignored unless the table
+                             was created with gotExpecteds)
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and the cell is not changed) if a total
+                             would overflow
+
+   Sets the count for a cell, adding the row and column if they are new
+   and updating the totals. The count replaces any earlier one for the
+   cell.
+
+   17.10.26 Original    By: ACRM (from ReadData() in chisq)
+   17.10.26 Keeps the running chi squared up to date
+   17.10.26 Refuses counts that would overflow a total
+*/
+int ContabSetCell(CONTAB *ct, char *label1, size_t length1,
+                  char *label2, size_t length2, int count,
+                  double expected)
+{
+   int pos1, pos2, change;
+
+   if(!FindCell(ct, label1, length1, label2, length2, &pos1, &pos2))
+      return(0);
+
+   change = count - CONTABCELL(ct, pos1, pos2);
+   if((change > 0) && WouldOverflow(ct, pos1, pos2, change))
+      return(-1);
+   if(change != 0)
+      ChangeCell(ct, pos1, pos2, change);
+   if(ct->gotExpecteds)
+      CONTABEXPECTED(ct, pos1, pos2) = expected;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int ContabAddCount(CONTAB *ct, char *label1, size_t length1,
+                      char *label2, size_t length2, int change)
+   ------------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   char   *label1   Row label (need not be terminated)
+            size_t length1   Length of label1
+            char   *label2   Column label (need not be terminated)
+            size_t length2   Length of label2
+            int    change    Amount to add to the count (may be negative)
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and nothing is changed) if the count
+                             would become negative or a total would
+                             overflow
+
+   Adds to the count for a cell, adding the row and column if they are
+   new
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The cell is found by FindCell()
+*/
+int ContabAddCount(CONTAB *ct, char *label1, size_t length1,
+                   char *label2, size_t length2, int change)
+{
+   int pos1, pos2;
+
+   if(!FindCell(ct, label1, length1, label2, length2, &pos1, &pos2))
+      return(0);
+
+   return(ContabUpdateCell(ct, pos1, pos2, change));
+}
+
+/************************************************************************/
+/*>int ContabUpdateCell(CONTAB *ct, int i, int j, int change)
+   ----------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   int    i         Row
+            int    j         Column
+            int    change    Amount to add to the count (may be negative)
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and nothing is changed) if the count
+                             would become negative or a total would
+                             overflow
+
+   Adds to the count for an existing cell. The totals and, if it is
+   being kept, the running chi squared are updated in time proportional
+   to the size of the row and column.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Checks for overflow
+*/
+int ContabUpdateCell(CONTAB *ct, int i, int j, int change)
+{
+   if((change < 0) ? (CONTABCELL(ct, i, j) + change < 0) :
+                     WouldOverflow(ct, i, j, change))
+      return(-1);
+
+   if(ct->mapped && !UnmapContab(ct))
+      return(0);
+
+   if(change)
+      ChangeCell(ct, i, j, change);
+   return(1);
+}
+
+/************************************************************************/
+/*>int ContabParseLine(CONTAB *ct, char *line, size_t length)
+   ----------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   char   *line     Line of text (need not be terminated)
+            size_t length    Length of the line
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and the cell is not changed) if the
+                             count is too large for an int, or would
+                             become negative or overflow
+
+   Sets a cell from a line of the form
+      item1 item2 count [expected]
+   Lines with fewer than two labels are ignored and a missing count is
+   taken as zero. If the table has accumulate set, the count (and
+   expected) are added to those from earlier lines for the same cell.
+   If it has raw set, the line is a single observation
+      item1 item2
+   which adds one to the cell. Anything after the labels is ignored.
+
+   17.10.26 Original    By: ACRM (from ReadData() in chisq)
+   17.10.26 Added accumulate
+   17.10.26 Added raw
+   17.10.26 A count too large for an int is refused
+*/
+int ContabParseLine(CONTAB *ct, char *line, size_t length)
+{
+   char   *end = line + length,
+          *item1, *item2, *token;
+   size_t length1, length2, tokenLength;
+   int    count = 0,
+          i, j, status;
+   double expected = 0.0;
+
+   if(((item1 = NextToken(&line, end, &length1)) == NULL) ||
+      ((item2 = NextToken(&line, end, &length2)) == NULL))
+      return(1);
+
+   if(ct->raw)
+   {
+      if(!FindCell(ct, item1, length1, item2, length2, &i, &j))
+         return(0);
+      return(ContabUpdateCell(ct, i, j, 1));
+   }
+
+   if(((token = NextToken(&line, end, &tokenLength)) != NULL) &&
+      !ParseCount(token, tokenLength, &count))
+      return(-1);
+   if(ct->gotExpecteds &&
+      ((token = NextToken(&line, end, &tokenLength)) != NULL))
+      expected = ParseReal(token, tokenLength);
+
+   if(ct->accumulate)
+   {
+      if(!FindCell(ct, item1, length1, item2, length2, &i, &j))
+         return(0);
+      if(((status = ContabUpdateCell(ct, i, j, count)) == 1) &&
+         ct->gotExpecteds)
+         CONTABEXPECTED(ct, i, j) += expected;
+      return(status);
+   }
+
+   return(ContabSetCell(ct, item1, length1, item2, length2, count,
+                        expected));
+}
+
+/************************************************************************/
+/*>int ContabLoad(CONTAB *ct, char *data, size_t size, const char **error)
+   -----------------------------------------------------------------------
+   I/O:     CONTAB     *ct    The table (its contents are replaced)
+   Input:   char       *data  Binary table file in memory (8-byte
+                              aligned, e.g. mapped)
+            size_t     size   Size of the file
+   Output:  const char **error Reason for failure
+   Returns: int               Success?
+
+   Loads a binary table file. The labels and, if the counts are stored
+   dense, the counts, expecteds and totals are used where they are in
+   memory so nothing is parsed or copied; data must stay valid until the
+   table is cleared or freed. Sparse counts are spread out into a table
+   of the usual kind.
+
+   OpenTableFile() refuses a file with a negative count or counts that
+   do not add up to its totals, so the totals can be trusted (the exact
+   test indexes its log factorials by them).
+
+   17.10.26 Original    By: ACRM (from LoadTable() in chisq)
+   17.10.26 The counts are checked against the totals
+   17.10.26 Frees the block the counts were in rather than leaking it
+            when they are used in place
+*/
+int ContabLoad(CONTAB *ct, char *data, size_t size, const char **error)
+{
+   TABFILE    tf;
+   LABELTABLE *labels1, *labels2;
+   uint64_t   cell;
+   int        i, j;
+
+   if(!OpenTableFile(&tf, data, size, error))
+      return(0);
+   if(tf.nDims != 2)
+   {
+      *error = "table file does not have 2 dimensions";
+      return(0);
+   }
+   if(ct->gotExpecteds && (tf.expecteds == NULL))
+   {
+      *error = "table file has no expected values";
+      return(0);
+   }
+
+   ClearContab(ct);
+
+   /* Labels                                                            */
+   labels1 = MapLabelTable(tf.labelText[0], tf.labelTextSize[0],
+                           tf.labelOffsets[0], tf.nItems[0]);
+   labels2 = MapLabelTable(tf.labelText[1], tf.labelTextSize[1],
+                           tf.labelOffsets[1], tf.nItems[1]);
+   if((labels1 == NULL) || (labels2 == NULL))
+   {
+      FreeLabelTable(labels1);
+      FreeLabelTable(labels2);
+      *error = "no memory for labels";
+      return(0);
+   }
+   FreeLabelTable(ct->labels1);
+   FreeLabelTable(ct->labels2);
+   ct->labels1 = labels1;
+   ct->labels2 = labels2;
+   ct->nItem1  = tf.nItems[0];
+   ct->nItem2  = tf.nItems[1];
+
+   /* Counts, expecteds and totals                                      */
+   if(!tf.sparse)
+   {
+      if(ct->arena != NULL)
+      {
+         free(ct->arena);
+         ct->arena = NULL;
+      }
+      ct->counts    = tf.counts;
+      ct->expecteds = (ct->gotExpecteds ? tf.expecteds : NULL);
+      ct->tot1      = tf.margins[0];
+      ct->tot2      = tf.margins[1];
+      ct->nAlloc1   = ct->nItem1;
+      ct->nAlloc2   = ct->nItem2;
+      ct->mapped    = 1;
+   }
+   else
+   {
+      if(!GrowContab(ct, ct->nItem1, ct->nItem2))
+      {
+         *error = "no memory for table";
+         return(0);
+      }
+      for(cell=0; cell<tf.nCells; cell++)
+      {
+         i = (int)(tf.cellIndex[cell] / ct->nItem2);
+         j = (int)(tf.cellIndex[cell] % ct->nItem2);
+         CONTABCELL(ct, i, j) = tf.counts[cell];
+      }
+      if(ct->gotExpecteds)
+      {
+         for(i=0; i<ct->nItem1; i++)
+            for(j=0; j<ct->nItem2; j++)
+               CONTABEXPECTED(ct, i, j) = tf.expecteds[i*ct->nItem2 + j];
+      }
+      memcpy(ct->tot1, tf.margins[0], ct->nItem1 * sizeof(int64_t));
+      memcpy(ct->tot2, tf.margins[1], ct->nItem2 * sizeof(int64_t));
+   }
+   ct->nObs = (long)tf.nObs;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int ContabSave(CONTAB *ct, FILE *fp)
+   ------------------------------------
+   Input:   CONTAB *ct       The table
+            FILE   *fp       File to write (opened in binary mode)
+   Returns: int              Success?
+
+   Writes the table as a binary table file
+
+   17.10.26 Original    By: ACRM (from SaveTable() in chisq)
+*/
+int ContabSave(CONTAB *ct, FILE *fp)
+{
+   LABELTABLE *labels[2];
+   int        nItems[2];
+   size_t     stride[2];
+
+   labels[0] = ct->labels1;
+   labels[1] = ct->labels2;
+   nItems[0] = ct->nItem1;
+   nItems[1] = ct->nItem2;
+   stride[0] = ct->nAlloc2;
+   stride[1] = 1;
+
+   return(WriteTableFile(fp, 2, nItems, labels, ct->counts, stride,
+                         (ct->gotExpecteds ? ct->expecteds : NULL)));
+}
+
+/************************************************************************/
+/*>int ContabDoF(CONTAB *ct)
+   -------------------------
+   Input:   CONTAB *ct       The table
+   Returns: int              Degrees of freedom
+
+   Rows and columns with no observations are not counted
+
+   09.02.94 Original    By: ACRM (CalcNDoF() in chisq)
+   17.10.26 Takes a CONTAB
+*/
+int ContabDoF(CONTAB *ct)
+{
+   int i, rows, cols;
+
+   for(i=0,rows=0; i<ct->nItem1; i++)
+      if(ct->tot1[i]) rows++;
+
+   for(i=0,cols=0; i<ct->nItem2; i++)
+      if(ct->tot2[i]) cols++;
+
+   return((rows-1) * (cols-1));
+}
+
+/************************************************************************/
+/*>double ContabExpected(CONTAB *ct, int method, int i, int j)
+   -----------------------------------------------------------
+   Input:   CONTAB *ct       The table
+            int    method    CHIEXP_MARGINS, CHIEXP_GIVEN or
+                             CHIEXP_FIRSTROW
+            int    i         Row
+            int    j         Column
+   Returns: double           Expected value for the cell
+
+   The row must have a non-zero total (and, with CHIEXP_FIRSTROW, so
+   must the first row)
+
+   17.10.26 Original    By: ACRM (from CalcChiSq() in chisq)
+*/
+double ContabExpected(CONTAB *ct, int method, int i, int j)
+{
+   switch(method)
+   {
+   case CHIEXP_GIVEN:
+      return(CONTABEXPECTED(ct, i, j));
+   case CHIEXP_FIRSTROW:
+      return((double)CONTABCELL(ct, 0, j) * (double)ct->tot1[i] /
+             (double)ct->tot1[0]);
+   default:
+      break;
+   }
+   return((double)ct->tot1[i] * (double)ct->tot2[j] / (double)ct->nObs);
+}
+
+/************************************************************************/
+/*>void ContabChiSq(CONTAB *ct, int method, int yates, int gStat,
+                    CHIRESULT *result)
+   ----------------------------------------------------------------------
+   Input:   CONTAB    *ct      The table
+            int       method   CHIEXP_MARGINS, CHIEXP_GIVEN or
+                               CHIEXP_FIRSTROW
+            int       yates    Apply the Yates correction if there is 1
+                               degree of freedom
+            int       gStat    Also calculate G (otherwise g is -1)
+   Output:  CHIRESULT *result  Chi squared, G, DoF, p-values and
+                               warnings
+
+   Calculates chi squared. Rows and columns with no observations are
+   skipped, as are cells whose expected is too small to use. The
+   warnings flag these and tables where more than 25% of the expecteds
+   are below 5.
+
+   G is never Yates corrected. With expecteds from the margins its
+   p-value uses Williams' correction, dividing G by
+
+      q = 1 + (N sum(1/R) - 1)(N sum(1/C) - 1) / (6 N DoF)
+
+   over the rows (R) and columns (C) with observations. Otherwise q is
+   1.
+
+   09.02.94 Original    By: ACRM (CalcChiSq() in chisq)
+   16.12.94 Cast values in calculation of expected (was being done as int)
+   06.08.03 Added Yates correction
+   03.04.08 Added obtaining expecteds from file
+   03.10.17 Added warnings
+   17.10.26 Each row is summed by the vectorized kernel in chikern.c
+   17.10.26 Takes a CONTAB. Nothing is printed
+   17.10.26 Added G and Williams' correction
+*/
+void ContabChiSq(CONTAB *ct, int method, int yates, int gStat,
+                 CHIRESULT *result)
+{
+   CHIACC acc;
+   double nObs = (double)ct->nObs,
+          rowSum, colSum;
+   int    i;
+
+   result->nObs = ct->nObs;
+   result->dof  = ContabDoF(ct);
+   yates        = (yates && (result->dof == 1));
+
+   /* Sum over the rows. The kernel skips columns with a zero total     */
+   ClearChiAcc(&acc, gStat);
+   for(i=0; i<ct->nItem1; i++)
+   {
+      if(ct->tot1[i])
+      {
+         if(method == CHIEXP_GIVEN)
+            ChiSqCells(&CONTABCELL(ct, i, 0), &CONTABEXPECTED(ct, i, 0),
+                       ct->tot2, ct->nItem2, yates, &acc);
+         else if(method == CHIEXP_FIRSTROW)
+            ChiSqCellsFromRow(&CONTABCELL(ct, i, 0),
+                              &CONTABCELL(ct, 0, 0), ct->tot2,
+                              (double)ct->tot1[i], (double)ct->tot1[0],
+                              ct->nItem2, yates, &acc);
+         else
+            ChiSqCellsFromMargins(&CONTABCELL(ct, i, 0), ct->tot2,
+                                  ct->tot2, (double)ct->tot1[i],
+                                  (double)ct->nObs, ct->nItem2, yates,
+                                  &acc);
+      }
+   }
+
+   result->williams = 1.0;
+   if((method == CHIEXP_MARGINS) && (result->dof > 0))
+   {
+      for(i=0, rowSum=0.0; i<ct->nItem1; i++)
+         if(ct->tot1[i]) rowSum += 1.0 / (double)ct->tot1[i];
+      for(i=0, colSum=0.0; i<ct->nItem2; i++)
+         if(ct->tot2[i]) colSum += 1.0 / (double)ct->tot2[i];
+
+      result->williams += (nObs * rowSum - 1.0) * (nObs * colSum - 1.0) /
+                          (6.0 * nObs * (double)result->dof);
+   }
+
+   result->chisq    = acc.chisq;
+   result->pValue   = ChiSqProb(acc.chisq, result->dof);
+   result->g        = (gStat ? (2.0 * acc.g) : -1.0);
+   if(gStat && (result->g < 0.0))  /* Rounding, or given expecteds      */
+      result->g = 0.0;             /* that total more than N            */
+   result->gPValue  = (gStat ? ChiSqProb(result->g / result->williams,
+                                         result->dof) : 1.0);
+   result->nCells   = acc.nCells;
+   result->nSmall   = acc.nSmall;
+   result->nZero    = acc.nZero;
+   result->nVisited = acc.nVisited;
+   result->nOccupied = acc.nOccupied;
+   result->warnings = 0;
+   if(acc.nZero)
+      result->warnings |= CHIWARN_ZERO;
+   if((acc.nSmall / (double)acc.nCells) > 0.25)
+      result->warnings |= CHIWARN_SMALL;
+}
+
+/************************************************************************/
+/*>void ContabCellSig(CONTAB *ct, int i, int j, CELLSIG *cs)
+   ---------------------------------------------------------
+   Input:   CONTAB  *ct      The table
+            int     i        Row
+            int     j        Column
+   Output:  CELLSIG *cs      Significance of the cell
+
+   Tests a cell for significance by collapsing the table to 2x2:
+
+         cell       | rest of row
+      --------------+-------------------
+      rest of column| everything else
+
+   The counts and expecteds of the 2x2 table follow directly from the
+   cell and the row, column and grand totals. A Yates-corrected chi
+   squared with 1 degree of freedom is calculated. The caller should
+   apply any correction for multiple testing to the p-value.
+
+   17.10.26 Original    By: ACRM (from CalcCellSignificance() in chisq)
+*/
+void ContabCellSig(CONTAB *ct, int i, int j, CELLSIG *cs)
+{
+   double nObs   = (double)ct->nObs,
+          rowTot = (double)ct->tot1[i],
+          colTot = (double)ct->tot2[j],
+          diff;
+   int    k;
+
+   cs->observed    = (double)CONTABCELL(ct, i, j);
+   cs->chisq       = 0.0;
+   cs->lowExpected = 0;
+
+   if(nObs > 0.0)
+   {
+      cs->expected[0] = rowTot * colTot / nObs;
+      cs->expected[1] = rowTot * (nObs - colTot) / nObs;
+      cs->expected[2] = (nObs - rowTot) * colTot / nObs;
+      cs->expected[3] = (nObs - rowTot) * (nObs - colTot) / nObs;
+   }
+   else
+   {
+      cs->expected[0] = cs->expected[1] = cs->expected[2] =
+         cs->expected[3] = 0.0;
+   }
+
+   /* |O-E| is the same for all four cells of a 2x2 table. If a row or
+      column of the 2x2 table is empty there are no degrees of freedom
+      so chi squared is left as zero
+   */
+   if((cs->expected[0] > SMALL) && (cs->expected[1] > SMALL) &&
+      (cs->expected[2] > SMALL) && (cs->expected[3] > SMALL))
+   {
+      diff = cs->observed - cs->expected[0];
+      diff = ((diff < 0.0) ? -diff : diff) - 0.5;
+      for(k=0; k<4; k++)
+         cs->chisq += diff * diff / cs->expected[k];
+   }
+
+   for(k=0; k<4; k++)
+   {
+      if(cs->expected[k] < 5.0)
+         cs->lowExpected = 1;
+   }
+
+   cs->pValue = ChiSqProb(cs->chisq, 1);
+}
+
+/************************************************************************/
+/*>void ContabRunningChiSq(CONTAB *ct, CHIRESULT *result)
+   ------------------------------------------------------
+   I/O:     CONTAB    *ct      The table
+   Output:  CHIRESULT *result  Chi squared, DoF and p-value
+
+   Gives chi squared with expecteds from the margins and no Yates
+   correction. The first call makes one pass over the table; after that
+   the sum is kept up to date as cells change so this does no work
+   proportional to the table. Agrees with ContabChiSq() except for
+   rounding. Only chisq, pValue, dof, nObs and nCells are filled in -
+   G and the warnings need a full pass so call ContabChiSq() for those.
+   g is set to -1.
+
+   17.10.26 Original    By: ACRM
+*/
+void ContabRunningChiSq(CONTAB *ct, CHIRESULT *result)
+{
+   double nObs = (double)ct->nObs;
+
+   /* Rounding errors build up as terms are taken out and put back, so
+      the sum is recalculated once there have been as many updates as
+      there are cells. This adds O(1) per update on average.
+   */
+   if(!ct->running ||
+      (ct->runUpdates > (ct->nItem1 * ct->nItem2)))
+      StartRunning(ct);
+
+   result->nObs     = ct->nObs;
+   result->dof      = (ct->runRows - 1) * (ct->runColumns - 1);
+   result->chisq    = ((ct->nObs > 0) ? (nObs * ct->runSum - nObs) : 0.0);
+   if(result->chisq < 0.0)
+      result->chisq = 0.0;
+   result->pValue   = ChiSqProb(result->chisq, result->dof);
+   result->g        = -1.0;
+   result->williams = 1.0;
+   result->gPValue  = 1.0;
+   result->nCells   = ct->runRows * ct->runColumns;
+   result->nSmall   = result->nZero = 0;
+   result->nVisited = result->nOccupied = 0;
+   result->warnings = 0;
+}
+
+/************************************************************************/
+/*>static int FindCell(CONTAB *ct, char *label1, size_t length1,
+                       char *label2, size_t length2, int *i, int *j)
+   ----------------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   char   *label1   Row label (need not be terminated)
+            size_t length1   Length of label1
+            char   *label2   Column label (need not be terminated)
+            size_t length2   Length of label2
+   Output:  int    *i        Row
+            int    *j        Column
+   Returns: int              Success?
+
+   Finds the cell for a pair of labels, adding the row and column if
+   they are new and growing the table to hold them
+
+   17.10.26 Original    By: ACRM (from ContabSetCell())
+*/
+static int FindCell(CONTAB *ct, char *label1, size_t length1,
+                    char *label2, size_t length2, int *i, int *j)
+{
+   if(ct->mapped && !UnmapContab(ct))
+      return(0);
+
+   if(((*i = InternLabel(ct->labels1, label1, (int)length1)) < 0) ||
+      ((*j = InternLabel(ct->labels2, label2, (int)length2)) < 0))
+      return(0);
+   ct->nItem1 = ct->labels1->nLabels;
+   ct->nItem2 = ct->labels2->nLabels;
+
+   return(GrowContab(ct, ct->nItem1, ct->nItem2));
+}
+
+/************************************************************************/
+/*>static int WouldOverflow(CONTAB *ct, int i, int j, int change)
+   --------------------------------------------------------------
+   Input:   CONTAB *ct       The table
+            int    i         Row
+            int    j         Column
+            int    change    Amount to be added (>= 0)
+   Returns: int              Would the cell or a total overflow?
+
+   The row and column totals are no larger than the grand total so
+   need not be checked
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The totals are 64-bit so only the cell and grand total are
+            checked
+*/
+static int WouldOverflow(CONTAB *ct, int i, int j, int change)
+{
+   return((CONTABCELL(ct, i, j) > INT_MAX - change) ||
+          (ct->nObs             > LONG_MAX - change));
+}
+
+/************************************************************************/
+/*>static int GrowContab(CONTAB *ct, int nItem1, int nItem2)
+   ---------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   int    nItem1    Number of rows needed
+            int    nItem2    Number of columns needed
+   Returns: int              Success?
+
+   Makes sure the table has space for at least nItem1 x nItem2 cells.
+   The expecteds, counts and row and column totals live in a single
+   zeroed block which is reallocated at (at least) double the size when
+   the data outgrow it, with the existing values copied across. An empty
+   table starts off as INITITEM x INITITEM.
+
+   17.10.26 Original    By: ACRM (GrowTable() in chisq)
+   17.10.26 Also copies a table that is in a mapped file
+   17.10.26 A table in a mapped file is always copied, even if it fits
+*/
+static int GrowContab(CONTAB *ct, int nItem1, int nItem2)
+{
+   int    nAlloc1, nAlloc2, i, j;
+   size_t nCells, expSize;
+   char   *arena;
+   double  *expecteds = NULL;
+   int64_t *tot1, *tot2;
+   int     *counts;
+
+   if(!ct->mapped && (ct->arena != NULL) &&
+      (nItem1 <= ct->nAlloc1) && (nItem2 <= ct->nAlloc2))
+      return(1);
+
+   nAlloc1 = (ct->nAlloc1 ? ct->nAlloc1 : INITITEM);
+   nAlloc2 = (ct->nAlloc2 ? ct->nAlloc2 : INITITEM);
+   while(nAlloc1 < nItem1) nAlloc1 *= 2;
+   while(nAlloc2 < nItem2) nAlloc2 *= 2;
+
+   /* Allocate a zeroed block - the expecteds and totals go first so they
+      are correctly aligned
+   */
+   nCells  = (size_t)nAlloc1 * (size_t)nAlloc2;
+   expSize = (ct->gotExpecteds ? nCells * sizeof(double) : 0);
+   if((arena = (char *)calloc(expSize +
+                              (nAlloc1 + nAlloc2) * sizeof(int64_t) +
+                              nCells * sizeof(int), 1)) == NULL)
+      return(0);
+   if(ct->gotExpecteds)
+      expecteds = (double *)arena;
+   tot1   = (int64_t *)(arena + expSize);
+   tot2   = tot1 + nAlloc1;
+   counts = (int *)(tot2 + nAlloc2);
+
+   /* Copy across any existing data                                     */
+   if(ct->counts != NULL)
+   {
+      for(i=0; i<ct->nAlloc1; i++)
+      {
+         tot1[i] = ct->tot1[i];
+         for(j=0; j<ct->nAlloc2; j++)
+         {
+            counts[i*nAlloc2 + j] = CONTABCELL(ct, i, j);
+            if(ct->gotExpecteds)
+               expecteds[i*nAlloc2 + j] = CONTABEXPECTED(ct, i, j);
+         }
+      }
+      for(j=0; j<ct->nAlloc2; j++)
+         tot2[j] = ct->tot2[j];
+   }
+   if(ct->arena != NULL)
+      free(ct->arena);
+
+   ct->arena     = arena;
+   ct->expecteds = expecteds;
+   ct->counts    = counts;
+   ct->tot1      = tot1;
+   ct->tot2      = tot2;
+   ct->nAlloc1   = nAlloc1;
+   ct->nAlloc2   = nAlloc2;
+   ct->mapped    = 0;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int UnmapContab(CONTAB *ct)
+   ----------------------------------
+   I/O:     CONTAB *ct       The table
+   Returns: int              Success?
+
+   Copies a table loaded from a mapped file so it can be changed.
+   GrowContab() always makes the copy for a mapped table, so nothing is
+   written to the file (which may be read-only or the caller's buffer).
+
+   17.10.26 Original    By: ACRM
+*/
+static int UnmapContab(CONTAB *ct)
+{
+   return(UnmapLabelTable(ct->labels1) &&
+          UnmapLabelTable(ct->labels2) &&
+          GrowContab(ct, ct->nItem1, ct->nItem2));
+}
+
+/************************************************************************/
+/*>static double CrossSum(CONTAB *ct, int i, int j)
+   ------------------------------------------------
+   Input:   CONTAB *ct       The table
+            int    i         Row
+            int    j         Column
+   Returns: double           Sum of O^2 / (row tot * column tot) over row
+                             i and column j (cell i,j counted once)
+
+   The part of the running sum that depends on the totals for row i and
+   column j. Empty cells add nothing and a non-empty cell always has
+   non-zero totals, so only those are used.
+
+   17.10.26 Original    By: ACRM
+*/
+static double CrossSum(CONTAB *ct, int i, int j)
+{
+   double sum = 0.0,
+          o;
+   int    k;
+
+   if(ct->tot1[i])
+   {
+      for(k=0; k<ct->nItem2; k++)
+      {
+         if((o = (double)CONTABCELL(ct, i, k)) != 0.0)
+            sum += o * o / ((double)ct->tot1[i] * (double)ct->tot2[k]);
+      }
+   }
+   if(ct->tot2[j])
+   {
+      for(k=0; k<ct->nItem1; k++)
+      {
+         if((k != i) && ((o = (double)CONTABCELL(ct, k, j)) != 0.0))
+            sum += o * o / ((double)ct->tot1[k] * (double)ct->tot2[j]);
+      }
+   }
+
+   return(sum);
+}
+
+/************************************************************************/
+/*>static void ChangeCell(CONTAB *ct, int i, int j, int change)
+   ------------------------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   int    i         Row
+            int    j         Column
+            int    change    Amount to add to the count
+
+   Adds to a count and the totals, keeping the running chi squared up
+   to date if it is being used
+
+   17.10.26 Original    By: ACRM
+*/
+static void ChangeCell(CONTAB *ct, int i, int j, int change)
+{
+   int wasRow    = (ct->tot1[i] != 0),
+       wasColumn = (ct->tot2[j] != 0);
+
+   if(ct->running)
+      ct->runSum -= CrossSum(ct, i, j);
+
+   CONTABCELL(ct, i, j) += change;
+   ct->tot1[i]          += change;
+   ct->tot2[j]          += change;
+   ct->nObs             += change;
+
+   if(ct->running)
+   {
+      ct->runSum     += CrossSum(ct, i, j);
+      ct->runRows    += (ct->tot1[i] != 0) - wasRow;
+      ct->runColumns += (ct->tot2[j] != 0) - wasColumn;
+      ct->runUpdates++;
+   }
+}
+
+/************************************************************************/
+/*>static void StartRunning(CONTAB *ct)
+   ------------------------------------
+   I/O:     CONTAB *ct       The table
+
+   Calculates the running sum and counts of rows and columns in use
+   from scratch
+
+   17.10.26 Original    By: ACRM
+*/
+static void StartRunning(CONTAB *ct)
+{
+   double o;
+   int    i, j;
+
+   ct->runSum = 0.0;
+   ct->runRows = ct->runColumns = 0;
+
+   for(i=0; i<ct->nItem1; i++)
+   {
+      if(ct->tot1[i])
+      {
+         ct->runRows++;
+         for(j=0; j<ct->nItem2; j++)
+         {
+            if((o = (double)CONTABCELL(ct, i, j)) != 0.0)
+               ct->runSum += o * o /
+                             ((double)ct->tot1[i] * (double)ct->tot2[j]);
+         }
+      }
+   }
+   for(j=0; j<ct->nItem2; j++)
+   {
+      if(ct->tot2[j])
+         ct->runColumns++;
+   }
+
+   ct->runUpdates = 0;
+   ct->running    = 1;
+}
@@ -0,0 +1,316 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       contab.h
+
+   Version:    V1.14
+   Date:       17.10.26
+   Function:   Include file for the contingency table library
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   The public interface of libchisq. A CONTAB is a two-way contingency
+   table, a CONTAB3 a three-way one and a CONTABN has any number of
+   dimensions up to CONTABMAXDIMS. Each holds everything about its
+   table, with no globals, so any number may be used at once from
+   different threads. Nothing is printed - the result and any warnings
+   are returned in a CHIRESULT, which can also have the G (likelihood
+   ratio) statistic from the same pass over the cells.
+
+   By default a line of input sets its cell, replacing any earlier
+   count. With accumulate set, repeated cells are summed instead so
+   partial counts can simply be concatenated. Cells are ints and a count
+   or change that would overflow one is refused. The row, column and
+   plane totals are 64-bit and the grand total is a long (64 bits on
+   LP64 systems), so a single row can pass INT_MAX. With
+   raw set, each line is a single observation with no count and is
+   counted as it is read.
+
+   A CONTAB3 is sparse: only the cells that have been given a count (or
+   an expected) are stored, in the order they were first seen, and are
+   found from their position through an open-addressing hash table.
+   Memory and the chi squared pass are proportional to the occupied
+   cells however many items there are in each dimension.
+
+   A CONTAB can also keep a running chi squared (with expecteds from the
+   margins) which is updated as counts change at a cost proportional to
+   the row and column changed - see ContabRunningChiSq().
+
+   C++ programs should include contab.hpp instead.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added running chi squared
+   V1.2  17.10.26 Added ContabExactTest()
+   V1.3  17.10.26 Added ContabMonteCarlo() and Contab3MonteCarlo()
+   V1.4  17.10.26 CHIRESULT also has the G statistic
+   V1.5  17.10.26 CHIRESULT counts the cells visited and occupied
+   V1.6  17.10.26 Added accumulate to CONTAB and CONTAB3. The grand
+                  totals are longs
+   V1.7  17.10.26 Added raw to CONTAB and CONTAB3
+   V1.8  17.10.26 CONTAB3 only stores expecteds if they are given. Added
+                  Contab3Expected()
+   V1.9  17.10.26 Added CONTABN for N-way tables
+   V1.10 17.10.26 Added Contab3Strata() for conditional independence
+                  and CMH tests
+   V1.11 17.10.26 Added Contab3FitModel() for log-linear models
+   V1.12 17.10.26 Added ContabExactTestLimit()
+   V1.13 17.10.26 The row, column and plane totals are int64_t
+   V1.14 17.10.26 CONTAB3 only stores the occupied cells, found through
+                  a hash table. CONTAB3CELL() and CONTAB3EXPECTED() are
+                  replaced by Contab3Count() and Contab3Expected(). Added
+                  Contab3GroupCells()
+
+*************************************************************************/
+#ifndef _CONTAB_H
+#define _CONTAB_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "labels.h"
+#include "chiprob.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define CHIEXP_MARGINS  0   /* Expecteds from the marginal totals       */
+#define CHIEXP_GIVEN    1   /* Expecteds supplied with the counts       */
+#define CHIEXP_FIRSTROW 2   /* Expecteds scaled from the first row      */
+
+#define CONTABMAXDIMS   8   /* Most dimensions in a CONTABN             */
+#define EXACTMAXCELLS   4000000L /* Work allowed for ContabExactTest()  */
+#define EXACTQUICKCELLS 40000L   /* ...and for a quick test             */
+#define CMHMAXDOF       1000 /* Largest (I-1)(J-1) for the CMH test     */
+#define IPFTOLERANCE    0.1 /* Default largest margin difference        */
+#define IPFMAXITER      20  /* Default most cycles of the fit           */
+
+#define CHIWARN_ZERO    0x01  /* Some expecteds too small to include    */
+#define CHIWARN_SMALL   0x02  /* More than 25% of expecteds < 5         */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   LABELTABLE *labels1,        /* Labels for the rows                   */
+              *labels2;        /* Labels for the columns                */
+   char       *arena;          /* Single block holding the arrays below
+                                  (NULL if they are in a mapped file)   */
+   double     *expecteds;      /* Expected values (only if given)       */
+   int64_t    *tot1,           /* Row totals                            */
+              *tot2;           /* Column totals                         */
+   int        *counts,         /* Observed values                       */
+              nItem1,          /* Number of rows                        */
+              nItem2,          /* Number of columns                     */
+              nAlloc1,         /* Number of rows allocated              */
+              nAlloc2,         /* Columns allocated (the row stride)    */
+              gotExpecteds,    /* Expecteds are stored                  */
+              accumulate,      /* Repeated cells are summed when read   */
+              raw,             /* Each line is one observation          */
+              mapped;          /* Counts are in a mapped file           */
+   long       nObs;            /* Grand total                           */
+   double     runSum;          /* Sum of O^2 / (row tot * column tot)   */
+   int        runRows,         /* Rows with a non-zero total            */
+              runColumns,      /* Columns with a non-zero total         */
+              runUpdates,      /* Updates since runSum was recalculated */
+              running;         /* The run... values are up to date      */
+   double     *logFact;        /* log(i!) for the exact test            */
+   int        nLogFact;        /* Number of entries in logFact          */
+}  CONTAB;
+
+typedef struct
+{
+   LABELTABLE *labels[3];      /* Labels for each dimension             */
+   double     *expecteds;      /* Expected for each cell (only if
+                                  given)                                */
+   int64_t    *tot[3],         /* Totals for each dimension             */
+              *sorted[3];      /* Workspace for Contab3ChiSq()          */
+   int        *counts,         /* Observed count for each cell          */
+              *cellPos,        /* Position of each cell, 3 per cell     */
+              *hashTable,      /* Hash table of (cell + 1), 0=empty     */
+              nCells,          /* Cells stored                          */
+              maxCells,        /* Allocated size of counts and cellPos  */
+              tableSize,       /* Hash table size (a power of 2)        */
+              nItems[3],       /* Number of items in each dimension     */
+              nAlloc[3],       /* Totals allocated in each dimension    */
+              gotExpecteds,    /* Expecteds are given                   */
+              accumulate,      /* Repeated cells are summed when read   */
+              raw;             /* Each line is one observation          */
+   long       nObs;            /* Grand total                           */
+}  CONTAB3;
+
+typedef struct
+{
+   LABELTABLE *labels[CONTABMAXDIMS]; /* Labels for each dimension      */
+   double     *expecteds;      /* Expected values (only if given)       */
+   int64_t    *tot[CONTABMAXDIMS];    /* Totals for each dimension      */
+   int        *counts,         /* Observed values, the last dimension
+                                  contiguous                            */
+              nItems[CONTABMAXDIMS],  /* Items in each dimension        */
+              nAlloc[CONTABMAXDIMS],  /* Number allocated in each       */
+              nDims,           /* Number of dimensions                  */
+              gotExpecteds,    /* Expecteds are given                   */
+              accumulate,      /* Repeated cells are summed when read   */
+              raw;             /* Each line is one observation          */
+   size_t     stride[CONTABMAXDIMS];  /* Cells from one item to the next
+                                         in each dimension              */
+   long       nObs;            /* Grand total                           */
+}  CONTABN;
+
+typedef struct
+{
+   double chisq,               /* Chi squared                           */
+          pValue,              /* Probability of chisq by chance        */
+          g,                   /* G statistic (< 0 if not calculated)   */
+          williams,            /* Williams' correction, q, for G        */
+          gPValue;             /* Probability of G/q by chance          */
+   long   nObs;                /* Total observations                    */
+   int    dof,                 /* Degrees of freedom                    */
+          nCells,              /* Cells included in chisq               */
+          nSmall,              /* ...with expected < 5                  */
+          nZero,               /* Cells with expected too small to use  */
+          nVisited,            /* Cells looked at by the kernel         */
+          nOccupied,           /* Cells included with observations      */
+          warnings;            /* CHIWARN_ flags                        */
+}  CHIRESULT;
+
+typedef struct
+{
+   double observed,            /* Count in the cell                     */
+          expected[4],         /* Expecteds for the cell, rest of row,
+                                  rest of column and everything else    */
+          chisq,               /* Yates corrected chi squared (1 DoF)   */
+          pValue;              /* Uncorrected p-value                   */
+   int    lowExpected;         /* Any of the four expecteds < 5         */
+}  CELLSIG;
+
+typedef struct
+{
+   CHIRESULT partial,          /* The other two dimensions independent
+                                  within each stratum                   */
+             cmh;              /* Generalized Cochran-Mantel-Haenszel   */
+   int       given,            /* Dimension used as the strata          */
+             nStrata,          /* Strata with observations              */
+             gotCMH;           /* cmh was calculated (not too many
+                                  items)                                */
+}  STRATARESULT;
+
+typedef struct
+{
+   CHIRESULT fit;              /* The model against the observed counts */
+   double    deviation;        /* Largest margin difference in the last
+                                  cycle                                 */
+   int       iterations,       /* Cycles through the margins            */
+             converged,        /* deviation is within the tolerance     */
+             nGenerators,      /* Generating margins                    */
+             generators[3];    /* ...as bit masks of their dimensions   */
+}  MODELRESULT;
+
+/************************************************************************/
+/* Macros
+*/
+#define CONTABCELL(ct, i, j)     ((ct)->counts[(i)*(ct)->nAlloc2 + (j)])
+#define CONTABEXPECTED(ct, i, j) \
+   ((ct)->expecteds[(i)*(ct)->nAlloc2 + (j)])
+#define CONTABROW(ct, i)         LABELTEXT((ct)->labels1, (i))
+#define CONTABCOLUMN(ct, j)      LABELTEXT((ct)->labels2, (j))
+
+#define CONTAB3POS(ct, c, d)     ((ct)->cellPos[3 * (size_t)(c) + (d)])
+#define CONTAB3LABEL(ct, d, i)   LABELTEXT((ct)->labels[(d)], (i))
+#define CONTABNLABEL(ct, d, i)   LABELTEXT((ct)->labels[(d)], (i))
+
+/************************************************************************/
+/* Prototypes
+*/
+/* Two-way tables (contab.c)                                            */
+CONTAB *CreateContab(int gotExpecteds);
+void   FreeContab(CONTAB *ct);
+void   ClearContab(CONTAB *ct);
+int    ContabSetCell(CONTAB *ct, char *label1, size_t length1,
+                     char *label2, size_t length2, int count,
+                     double expected);
+int    ContabAddCount(CONTAB *ct, char *label1, size_t length1,
+                      char *label2, size_t length2, int change);
+int    ContabUpdateCell(CONTAB *ct, int i, int j, int change);
+int    ContabParseLine(CONTAB *ct, char *line, size_t length);
+int    ContabLoad(CONTAB *ct, char *data, size_t size,
+                  const char **error);
+int    ContabSave(CONTAB *ct, FILE *fp);
+int    ContabDoF(CONTAB *ct);
+double ContabExpected(CONTAB *ct, int method, int i, int j);
+void   ContabChiSq(CONTAB *ct, int method, int yates, int gStat,
+                   CHIRESULT *result);
+void   ContabCellSig(CONTAB *ct, int i, int j, CELLSIG *cs);
+void   ContabRunningChiSq(CONTAB *ct, CHIRESULT *result);
+
+/* Exact tests (exact.c)                                                */
+int    ContabExactTest(CONTAB *ct, double *pValue);
+int    ContabExactTestLimit(CONTAB *ct, long maxCells, double *pValue);
+
+/* Monte Carlo tests (montecarlo.c)                                     */
+int    ContabMonteCarlo(CONTAB *ct, long nReps, unsigned long seed,
+                        int nThreads, double *pValue);
+int    Contab3MonteCarlo(CONTAB3 *ct, long nReps, unsigned long seed,
+                         int nThreads, double *pValue);
+
+/* Three-way tables (contab3.c)                                         */
+CONTAB3 *CreateContab3(int gotExpecteds);
+void   FreeContab3(CONTAB3 *ct);
+int    Contab3SetCell(CONTAB3 *ct, char **labels, size_t *lengths,
+                      int count, double expected);
+int    Contab3ParseLine(CONTAB3 *ct, char *line, size_t length);
+int    Contab3Load(CONTAB3 *ct, char *data, size_t size,
+                   const char **error);
+int    Contab3Save(CONTAB3 *ct, FILE *fp);
+int    Contab3DoF(CONTAB3 *ct);
+int    Contab3Count(CONTAB3 *ct, int i, int j, int k);
+double Contab3Expected(CONTAB3 *ct, int i, int j, int k);
+void   Contab3ChiSq(CONTAB3 *ct, int gStat, CHIRESULT *result);
+int    Contab3GroupCells(CONTAB3 *ct, int d, int **order, int **start);
+
+/* Stratified tests for three-way tables (strata.c)                     */
+int    Contab3Strata(CONTAB3 *ct, int given, int gStat, int nThreads,
+                     STRATARESULT *result);
+
+/* Log-linear models for three-way tables (ipf.c)                       */
+int    Contab3FitModel(CONTAB3 *ct, const char *model, double tolerance,
+                       int maxIter, int nThreads, MODELRESULT *result);
+
+/* N-way tables (contabn.c)                                             */
+CONTABN *CreateContabN(int nDims, int gotExpecteds);
+void   FreeContabN(CONTABN *ct);
+size_t ContabNIndex(CONTABN *ct, int *pos);
+int    ContabNNextCell(CONTABN *ct, int *pos, int nDims);
+int    ContabNSetCell(CONTABN *ct, char **labels, size_t *lengths,
+                      int count, double expected);
+int    ContabNParseLine(CONTABN *ct, char *line, size_t length);
+int    ContabNDoF(CONTABN *ct);
+double ContabNExpected(CONTABN *ct, int *pos);
+void   ContabNChiSq(CONTABN *ct, int gStat, CHIRESULT *result);
+
+#endif
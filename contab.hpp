@@ -0,0 +1,320 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       contab.hpp
+
+   Version:    V1.10
+   Date:       17.10.26
+   Function:   C++ interface to the contingency table library
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Thin inline wrappers round CONTAB and CONTAB3 which own the table and
+   throw std::bad_alloc if memory runs out (or std::overflow_error if a
+   total would overflow, std::invalid_argument for a model that is not
+   valid). For example:
+
+      ContingencyTable table;
+      table.set("smoker", "cancer", 12);
+      ...
+      ChiSqResult result = table.chiSq();
+      printf("%f %d %g\n", result.chisq, result.dof, result.pValue);
+
+   Link with -lchisq.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added add() and runningChiSq()
+   V1.2  17.10.26 Added exactTest()
+   V1.3  17.10.26 Added monteCarlo()
+   V1.4  17.10.26 chiSq() can also give G
+   V1.5  17.10.26 Added accumulate(). total() is a long
+   V1.6  17.10.26 Added raw()
+   V1.7  17.10.26 Added strata() to ContingencyTable3
+   V1.8  17.10.26 Added fitModel() to ContingencyTable3
+   V1.9  17.10.26 exactTest() takes a budget
+   V1.10 17.10.26 ContingencyTable3::count() uses Contab3Count()
+
+*************************************************************************/
+#ifndef _CONTAB_HPP
+#define _CONTAB_HPP
+
+#include <new>
+#include <stdexcept>
+#include <string>
+
+extern "C"
+{
+#include "contab.h"
+}
+
+/************************************************************************/
+/* Types
+*/
+typedef CHIRESULT    ChiSqResult;
+typedef CELLSIG      CellSignificance;
+typedef STRATARESULT StrataResult;
+typedef MODELRESULT  ModelResult;
+
+/************************************************************************/
+/* Throws for a status from the C library: 0 is out of memory and -1 a
+   total that would overflow (or a count that would become negative)
+*/
+inline void ContabCheck(int status)
+{
+   if(status == 0)
+      throw std::bad_alloc();
+   if(status < 0)
+      throw std::overflow_error("contingency table count out of range");
+}
+
+class ContingencyTable
+{
+public:
+   explicit ContingencyTable(bool gotExpecteds = false)
+   {
+      if((m_table = CreateContab(gotExpecteds)) == NULL)
+         throw std::bad_alloc();
+   }
+   ~ContingencyTable()
+   {
+      FreeContab(m_table);
+   }
+
+   /* Sets the count (and expected) for a cell                          */
+   void set(const std::string &row, const std::string &column,
+            int count, double expected = 0.0)
+   {
+      ContabCheck(ContabSetCell(m_table, const_cast<char *>(row.data()),
+                                row.size(),
+                                const_cast<char *>(column.data()),
+                                column.size(), count, expected));
+   }
+   /* Adds to the count for a cell. False if the count would become
+      negative (or there is no memory)
+   */
+   bool add(const std::string &row, const std::string &column,
+            int change)
+   {
+      return(ContabAddCount(m_table, const_cast<char *>(row.data()),
+                            row.size(),
+                            const_cast<char *>(column.data()),
+                            column.size(), change) > 0);
+   }
+   /* Sets a cell from a line of the form: item1 item2 count [expected] */
+   void parse(const std::string &line)
+   {
+      ContabCheck(ContabParseLine(m_table,
+                                  const_cast<char *>(line.data()),
+                                  line.size()));
+   }
+   /* parse() adds to the cell rather than setting it                   */
+   void accumulate(bool on = true)
+   {
+      m_table->accumulate = on;
+   }
+   /* parse() takes each line as one observation with no count        */
+   void raw(bool on = true)
+   {
+      m_table->raw = on;
+   }
+   void clear()
+   {
+      ClearContab(m_table);
+   }
+
+   int rows() const                { return(m_table->nItem1);          }
+   int columns() const             { return(m_table->nItem2);          }
+   long total() const              { return(m_table->nObs);            }
+   const char *row(int i) const    { return(CONTABROW(m_table, i));    }
+   const char *column(int j) const { return(CONTABCOLUMN(m_table, j)); }
+   int count(int i, int j) const   { return(CONTABCELL(m_table, i, j)); }
+   int dof() const                 { return(ContabDoF(m_table));       }
+
+   double expected(int i, int j, int method = CHIEXP_MARGINS) const
+   {
+      return(ContabExpected(m_table, method, i, j));
+   }
+   ChiSqResult chiSq(int method = CHIEXP_MARGINS, bool yates = false,
+                     bool gStat = false) const
+   {
+      ChiSqResult result;
+      ContabChiSq(m_table, method, yates, gStat, &result);
+      return(result);
+   }
+   /* Kept up to date as cells change - see ContabRunningChiSq()        */
+   ChiSqResult runningChiSq()
+   {
+      ChiSqResult result;
+      ContabRunningChiSq(m_table, &result);
+      return(result);
+   }
+   /* Exact p-value, or -1 if the table is too large for the test      */
+   double exactTest(long maxCells = EXACTMAXCELLS)
+   {
+      double pValue;
+      int    status;
+      if((status = ContabExactTestLimit(m_table, maxCells, &pValue)) == 0)
+         throw std::bad_alloc();
+      return((status < 0) ? -1.0 : pValue);
+   }
+   /* Simulated p-value from nReps random tables with the same totals   */
+   double monteCarlo(long nReps, unsigned long seed = 12345UL,
+                     int nThreads = 1) const
+   {
+      double pValue;
+      if(!ContabMonteCarlo(m_table, nReps, seed, nThreads, &pValue))
+         throw std::bad_alloc();
+      return(pValue);
+   }
+   CellSignificance cellSignificance(int i, int j) const
+   {
+      CellSignificance cs;
+      ContabCellSig(m_table, i, j, &cs);
+      return(cs);
+   }
+
+   /* The underlying table, for the rest of the C interface             */
+   CONTAB *table() const           { return(m_table);                  }
+
+private:
+   CONTAB *m_table;
+
+   /* Not copyable                                                      */
+   ContingencyTable(const ContingencyTable &);
+   ContingencyTable &operator=(const ContingencyTable &);
+};
+
+class ContingencyTable3
+{
+public:
+   explicit ContingencyTable3(bool gotExpecteds = false)
+   {
+      if((m_table = CreateContab3(gotExpecteds)) == NULL)
+         throw std::bad_alloc();
+   }
+   ~ContingencyTable3()
+   {
+      FreeContab3(m_table);
+   }
+
+   void set(const std::string &item1, const std::string &item2,
+            const std::string &item3, int count, double expected = 0.0)
+   {
+      char   *labels[3];
+      size_t lengths[3];
+
+      labels[0]  = const_cast<char *>(item1.data());
+      labels[1]  = const_cast<char *>(item2.data());
+      labels[2]  = const_cast<char *>(item3.data());
+      lengths[0] = item1.size();
+      lengths[1] = item2.size();
+      lengths[2] = item3.size();
+      ContabCheck(Contab3SetCell(m_table, labels, lengths, count,
+                                 expected));
+   }
+   void parse(const std::string &line)
+   {
+      ContabCheck(Contab3ParseLine(m_table,
+                                   const_cast<char *>(line.data()),
+                                   line.size()));
+   }
+   /* parse() adds to the cell rather than setting it                   */
+   void accumulate(bool on = true)
+   {
+      m_table->accumulate = on;
+   }
+   /* parse() takes each line as one observation with no count        */
+   void raw(bool on = true)
+   {
+      m_table->raw = on;
+   }
+
+   int items(int d) const          { return(m_table->nItems[d]);       }
+   long total() const              { return(m_table->nObs);            }
+   const char *label(int d, int i) const
+   {
+      return(CONTAB3LABEL(m_table, d, i));
+   }
+   int count(int i, int j, int k) const
+   {
+      return(Contab3Count(m_table, i, j, k));
+   }
+   int dof() const                 { return(Contab3DoF(m_table));      }
+
+   /* Also calculates the expecteds unless they were given              */
+   ChiSqResult chiSq(bool gStat = false)
+   {
+      ChiSqResult result;
+      Contab3ChiSq(m_table, gStat, &result);
+      return(result);
+   }
+   double monteCarlo(long nReps, unsigned long seed = 12345UL,
+                     int nThreads = 1) const
+   {
+      double pValue;
+      if(!Contab3MonteCarlo(m_table, nReps, seed, nThreads, &pValue))
+         throw std::bad_alloc();
+      return(pValue);
+   }
+   /* The other two dimensions tested within the strata of dimension
+      given: conditional independence and CMH
+   */
+   StrataResult strata(int given, bool gStat = false,
+                       int nThreads = 1) const
+   {
+      StrataResult result;
+      if(!Contab3Strata(m_table, given, gStat, nThreads, &result))
+         throw std::bad_alloc();
+      return(result);
+   }
+   /* Log-linear model given by its generating margins, e.g. "12,13,23"
+   */
+   ModelResult fitModel(const std::string &model,
+                        double tolerance = IPFTOLERANCE,
+                        int maxIter = IPFMAXITER, int nThreads = 1) const
+   {
+      ModelResult result;
+      int         status = Contab3FitModel(m_table, model.c_str(),
+                                           tolerance, maxIter, nThreads,
+                                           &result);
+      if(status == 0)
+         throw std::bad_alloc();
+      if(status < 0)
+         throw std::invalid_argument("log-linear model not valid");
+      return(result);
+   }
+
+   CONTAB3 *table() const          { return(m_table);                  }
+
+private:
+   CONTAB3 *m_table;
+
+   ContingencyTable3(const ContingencyTable3 &);
+   ContingencyTable3 &operator=(const ContingencyTable3 &);
+};
+
+#endif
@@ -0,0 +1,1114 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       contab3.c
+
+   Version:    V1.8
+   Date:       17.10.26
+   Function:   Three-way contingency tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Builds a three-way contingency table from labelled counts and tests
+   for mutual independence of the three factors. This was the core of
+   chisq3, which is now a front end to it.
+
+   Only the cells that are given a count are stored, replacing the
+   fixed MAXITEM x MAXITEM x MAXITEM arrays and then a cube that grew to
+   fit the labels. Each cell has its position and count (and expected,
+   if they are given) in arrays in the order the cells were first seen,
+   and is found from its position through an open-addressing hash table
+   kept no more than half full, as for labels. The three sets of totals
+   are kept as the cells are set, so nothing is proportional to the
+   size of the cube: a table with millions of items in each dimension
+   costs no more than its occupied cells.
+
+   Unless expecteds are given, the expected for a cell is the product
+   of its totals over N^2, so chi squared for mutual independence is
+      sum(O^2/E) - N
+   over the occupied cells only (see ChiSqOccupied() in chikern.c). The
+   empty cells are counted for the small expected warnings from the
+   three totals in order: for each row and column, the planes with
+   small expecteds are a run at the start of the sorted plane totals
+   which only shrinks as the column total grows.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original - from chisq3 V1.13
+   V1.1  17.10.26 Contab3ChiSq() can also give G
+   V1.2  17.10.26 Fills in the visited and occupied cell counts
+   V1.3  17.10.26 Contab3ParseLine() sums repeated cells if accumulate
+                  is set. Changes that would overflow a total are
+                  refused
+   V1.4  17.10.26 Contab3ParseLine() counts a raw observation if raw is
+                  set
+   V1.5  17.10.26 Expecteds are only stored if they are given. Otherwise
+                  the kernel calculates them in the same pass as chi
+                  squared. Added Contab3Expected()
+   V1.6  17.10.26 The plane totals are int64_t. A count too large for an
+                  int is refused
+   V1.7  17.10.26 Contab3DoF() gives the degrees of freedom for mutual
+                  independence over the items with observations, as
+                  for ContabNDoF() and the -m models
+   V1.8  17.10.26 Only the occupied cells are stored, through a hash
+                  table, and chi squared is summed over them with the
+                  small expecteds counted from the sorted totals. Binary
+                  table files are written from the cells. Added
+                  Contab3Count() and Contab3GroupCells()
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "contab.h"
+#include "chikern.h"
+#include "lineread.h"
+#include "tabfile.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define INITITEM  8
+#define INITCELLS 64
+#define CHIBLOCK  256          /* Cells gathered for each kernel call   */
+#define CAPINT(x) (((x) > (double)INT_MAX) ? INT_MAX : (int)(x))
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   uint64_t index;             /* Row-major index in the whole table    */
+   int      cell;              /* Cell number                           */
+}  CELLINDEX;
+
+/************************************************************************/
+/* Prototypes
+*/
+static int FindCell3(CONTAB3 *ct, char **labels, size_t *lengths,
+                     int *pos);
+static int ChangeCell3(CONTAB3 *ct, int cell, int change);
+static int ProbeCell3(CONTAB3 *ct, int *pos, int *slot);
+static int AddCell3(CONTAB3 *ct, int *pos);
+static unsigned long HashCell3(int *pos);
+static int GrowCells3(CONTAB3 *ct, int nNeeded);
+static int GrowContab3(CONTAB3 *ct, int *nItems);
+static void CountSmall3(CONTAB3 *ct, double nObs2, double *nSmall,
+                        double *nZero, double *lost);
+static int CompareTotals(const void *a, const void *b);
+static int CompareIndex(const void *a, const void *b);
+static void FreeArrays3(CONTAB3 *ct);
+
+/************************************************************************/
+/*>CONTAB3 *CreateContab3(int gotExpecteds)
+   ----------------------------------------
+   Input:   int    gotExpecteds  Expecteds will be given with the counts
+   Returns: CONTAB3 *            An empty table (NULL if no memory)
+
+   17.10.26 Original    By: ACRM
+*/
+CONTAB3 *CreateContab3(int gotExpecteds)
+{
+   CONTAB3 *ct;
+   int     d;
+
+   if((ct = (CONTAB3 *)calloc(1, sizeof(CONTAB3))) == NULL)
+      return(NULL);
+
+   ct->gotExpecteds = gotExpecteds;
+   for(d=0; d<3; d++)
+   {
+      if((ct->labels[d] = CreateLabelTable()) == NULL)
+      {
+         FreeContab3(ct);
+         return(NULL);
+      }
+   }
+
+   return(ct);
+}
+
+/************************************************************************/
+/*>void FreeContab3(CONTAB3 *ct)
+   -----------------------------
+   I/O:     CONTAB3 *ct      Table to free
+
+   17.10.26 Original    By: ACRM
+*/
+void FreeContab3(CONTAB3 *ct)
+{
+   int d;
+
+   if(ct != NULL)
+   {
+      FreeArrays3(ct);
+      for(d=0; d<3; d++)
+         FreeLabelTable(ct->labels[d]);
+      free(ct);
+   }
+}
+
+/************************************************************************/
+/*>int Contab3SetCell(CONTAB3 *ct, char **labels, size_t *lengths,
+                      int count, double expected)
+   ---------------------------------------------------------------
+   I/O:     CONTAB3 *ct       The table
+   Input:   char    **labels  Label in each dimension (need not be
+                              terminated)
+            size_t  *lengths  Length of each label
+            int     count     Observed count
+            double  expected  Expected value (ignored unless the table
+                              was created with gotExpecteds)
+   Returns: int               1 on success, 0 if out of memory or -1
+                              (and the cell is not changed) if a total
+                              would overflow
+
+   Sets the count for a cell, adding items if they are new and updating
+   the totals. The count replaces any earlier one for the cell.
+
+   17.10.26 Original    By: ACRM (from ReadData() in chisq3)
+   17.10.26 Refuses counts that would overflow a total
+   17.10.26 A cell is only stored once it is given a count
+*/
+int Contab3SetCell(CONTAB3 *ct, char **labels, size_t *lengths,
+                   int count, double expected)
+{
+   int pos[3], cell;
+
+   if(!FindCell3(ct, labels, lengths, pos) ||
+      ((cell = AddCell3(ct, pos)) < 0))
+      return(0);
+
+   if(!ChangeCell3(ct, cell, count - ct->counts[cell]))
+      return(-1);
+   if(ct->gotExpecteds)
+      ct->expecteds[cell] = expected;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int Contab3ParseLine(CONTAB3 *ct, char *line, size_t length)
+   ------------------------------------------------------------
+   I/O:     CONTAB3 *ct      The table
+   Input:   char    *line    Line of text (need not be terminated)
+            size_t  length   Length of the line
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and the cell is not changed) if the
+                             count is too large for an int, or would
+                             become negative or overflow
+
+   Sets a cell from a line of the form
+      item1 item2 item3 count [expected]
+   Lines with fewer than three labels are ignored and a missing count is
+   taken as zero. The count is read as a real number, as chisq3 always
+   has. If the table has accumulate set, the count (and expected) are
+   added to those from earlier lines for the same cell. If it has raw
+   set, the line is a single observation
+      item1 item2 item3
+   which adds one to the cell. Anything after the labels is ignored.
+
+   17.10.26 Original    By: ACRM (from ReadData() in chisq3)
+   17.10.26 Added accumulate
+   17.10.26 Added raw
+   17.10.26 A count too large for an int is refused
+*/
+int Contab3ParseLine(CONTAB3 *ct, char *line, size_t length)
+{
+   char   *end = line + length,
+          *labels[3], *token;
+   size_t lengths[3], tokenLength;
+   int    count = 0,
+          d, pos[3], cell;
+   double expected = 0.0;
+
+   for(d=0; d<3; d++)
+   {
+      if((labels[d] = NextToken(&line, end, &(lengths[d]))) == NULL)
+         return(1);
+   }
+
+   if(ct->raw)
+   {
+      if(!FindCell3(ct, labels, lengths, pos) ||
+         ((cell = AddCell3(ct, pos)) < 0))
+         return(0);
+      return(ChangeCell3(ct, cell, 1) ? 1 : -1);
+   }
+   if(((token = NextToken(&line, end, &tokenLength)) != NULL) &&
+      !ParseRealCount(token, tokenLength, &count))
+      return(-1);
+   if(ct->gotExpecteds &&
+      ((token = NextToken(&line, end, &tokenLength)) != NULL))
+      expected = ParseReal(token, tokenLength);
+
+   if(ct->accumulate)
+   {
+      if(!FindCell3(ct, labels, lengths, pos) ||
+         ((cell = AddCell3(ct, pos)) < 0))
+         return(0);
+      if((count < 0) && (ct->counts[cell] + count < 0))
+         return(-1);
+      if(!ChangeCell3(ct, cell, count))
+         return(-1);
+      if(ct->gotExpecteds)
+         ct->expecteds[cell] += expected;
+      return(1);
+   }
+
+   return(Contab3SetCell(ct, labels, lengths, count, expected));
+}
+
+/************************************************************************/
+/*>int Contab3Load(CONTAB3 *ct, char *data, size_t size,
+                   const char **error)
+   ----------------------------------------------------
+   I/O:     CONTAB3    *ct    The table (must be empty)
+   Input:   char       *data  Binary table file in memory (8-byte
+                              aligned, e.g. mapped)
+            size_t     size   Size of the file
+   Output:  const char **error Reason for failure
+   Returns: int               Success?
+
+   Loads a binary table file. The labels are used where they are in
+   memory so data must stay valid until the table is freed (or a cell
+   is set). The non-zero counts are copied into cells, straight from
+   the index of a sparse file. Expecteds are stored for every cell with
+   a count or a non-zero expected.
+
+   17.10.26 Original    By: ACRM (from LoadTable3() in chisq3)
+   17.10.26 Only the occupied cells are stored
+*/
+int Contab3Load(CONTAB3 *ct, char *data, size_t size, const char **error)
+{
+   TABFILE    tf;
+   LABELTABLE *labels[3];
+   uint64_t   cell, index, nCells;
+   int        d, pos[3], stored;
+
+   if(!OpenTableFile(&tf, data, size, error))
+      return(0);
+   if(tf.nDims != 3)
+   {
+      *error = "table file does not have 3 dimensions";
+      return(0);
+   }
+   if(ct->gotExpecteds && (tf.expecteds == NULL))
+   {
+      *error = "table file has no expected values";
+      return(0);
+   }
+   if(tf.nCells > (uint64_t)INT_MAX / 4)
+   {
+      *error = "table file has too many cells";
+      return(0);
+   }
+   if(!GrowContab3(ct, tf.nItems) ||
+      (tf.sparse && !GrowCells3(ct, (int)tf.nCells)))
+   {
+      *error = "no memory for table";
+      return(0);
+   }
+
+   for(d=0; d<3; d++)
+   {
+      if((labels[d] = MapLabelTable(tf.labelText[d], tf.labelTextSize[d],
+                                    tf.labelOffsets[d], tf.nItems[d]))
+         == NULL)
+      {
+         while(d--)
+            FreeLabelTable(labels[d]);
+         *error = "no memory for labels";
+         return(0);
+      }
+   }
+   for(d=0; d<3; d++)
+   {
+      FreeLabelTable(ct->labels[d]);
+      ct->labels[d] = labels[d];
+      ct->nItems[d] = tf.nItems[d];
+      memcpy(ct->tot[d], tf.margins[d], tf.nItems[d] * sizeof(int64_t));
+   }
+   ct->nObs = (long)tf.nObs;
+
+   /* Store the occupied cells (and those with expecteds). The totals
+      came from the file
+   */
+   nCells = (uint64_t)tf.nItems[0] * tf.nItems[1] * tf.nItems[2];
+   for(cell=0; cell<(tf.sparse ? tf.nCells : nCells); cell++)
+   {
+      if((tf.counts[cell] == 0) && !(ct->gotExpecteds && !tf.sparse &&
+                                     (tf.expecteds[cell] != 0.0)))
+         continue;
+      index  = (tf.sparse ? tf.cellIndex[cell] : cell);
+      pos[2] = (int)(index % tf.nItems[2]);
+      pos[1] = (int)((index / tf.nItems[2]) % tf.nItems[1]);
+      pos[0] = (int)(index / ((uint64_t)tf.nItems[1] * tf.nItems[2]));
+      if((stored = AddCell3(ct, pos)) < 0)
+      {
+         *error = "no memory for table";
+         return(0);
+      }
+      ct->counts[stored] = tf.counts[cell];
+      if(ct->gotExpecteds)
+         ct->expecteds[stored] = tf.expecteds[index];
+   }
+
+   /* Expecteds are dense, so find any for cells with no count          */
+   if(ct->gotExpecteds && tf.sparse)
+   {
+      for(index=0; index<nCells; index++)
+      {
+         if(tf.expecteds[index] == 0.0)
+            continue;
+         pos[2] = (int)(index % tf.nItems[2]);
+         pos[1] = (int)((index / tf.nItems[2]) % tf.nItems[1]);
+         pos[0] = (int)(index / ((uint64_t)tf.nItems[1] * tf.nItems[2]));
+         if((stored = AddCell3(ct, pos)) < 0)
+         {
+            *error = "no memory for table";
+            return(0);
+         }
+         ct->expecteds[stored] = tf.expecteds[index];
+      }
+   }
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int Contab3Save(CONTAB3 *ct, FILE *fp)
+   --------------------------------------
+   Input:   CONTAB3 *ct      The table
+            FILE    *fp      File to write (opened in binary mode)
+   Returns: int              Success?
+
+   Writes the table as a binary table file. The cells are put in
+   row-major order and written by WriteSparseTableFile().
+
+   17.10.26 Original    By: ACRM (from SaveTable3() in chisq3)
+   17.10.26 Written from the cells
+*/
+int Contab3Save(CONTAB3 *ct, FILE *fp)
+{
+   CELLINDEX *order;
+   uint64_t  *cellIndex;
+   double    *expecteds = NULL;
+   int       *counts,
+             c, cell,
+             n  = (ct->nCells ? ct->nCells : 1),
+             ok = 0;
+
+   order     = (CELLINDEX *)malloc(n * sizeof(CELLINDEX));
+   cellIndex = (uint64_t *)malloc(n * sizeof(uint64_t));
+   counts    = (int *)malloc(n * sizeof(int));
+   if(ct->gotExpecteds)
+      expecteds = (double *)malloc(n * sizeof(double));
+
+   if((order != NULL) && (cellIndex != NULL) && (counts != NULL) &&
+      (!ct->gotExpecteds || (expecteds != NULL)))
+   {
+      for(c=0; c<ct->nCells; c++)
+      {
+         order[c].cell  = c;
+         order[c].index = ((uint64_t)CONTAB3POS(ct, c, 0) *
+                           ct->nItems[1] + CONTAB3POS(ct, c, 1)) *
+                          ct->nItems[2] + CONTAB3POS(ct, c, 2);
+      }
+      qsort(order, ct->nCells, sizeof(CELLINDEX), CompareIndex);
+      for(c=0; c<ct->nCells; c++)
+      {
+         cell         = order[c].cell;
+         cellIndex[c] = order[c].index;
+         counts[c]    = ct->counts[cell];
+         if(ct->gotExpecteds)
+            expecteds[c] = ct->expecteds[cell];
+      }
+      ok = WriteSparseTableFile(fp, 3, ct->nItems, ct->labels,
+                                (uint64_t)ct->nCells, cellIndex, counts,
+                                expecteds);
+   }
+
+   if(order     != NULL) free(order);
+   if(cellIndex != NULL) free(cellIndex);
+   if(counts    != NULL) free(counts);
+   if(expecteds != NULL) free(expecteds);
+   return(ok);
+}
+
+/************************************************************************/
+/*>int Contab3DoF(CONTAB3 *ct)
+   ---------------------------
+   Input:   CONTAB3 *ct      The table
+   Returns: int              Degrees of freedom for mutual independence
+
+   IJK - I - J - K + 2, where only items with observations are counted.
+   A sparse table can have more cells than an int holds, so this stops
+   at INT_MAX.
+
+   09.02.94 Original    By: ACRM (CalcNDoF() in chisq3)
+   17.10.26 Takes a CONTAB3
+   17.10.26 Mutual independence rather than (I-1)(J-1)(K-1), which is
+            only the three-way interaction term
+   17.10.26 Stops at INT_MAX
+*/
+int Contab3DoF(CONTAB3 *ct)
+{
+   double cells = 1.0,
+          sum   = 0.0;
+   int    d, i, n;
+
+   for(d=0; d<3; d++)
+   {
+      for(i=0, n=0; i<ct->nItems[d]; i++)
+         if(ct->tot[d][i]) n++;
+      cells *= n;
+      sum   += n;
+   }
+   if(cells == 0.0)
+      return(0);
+
+   return(CAPINT(cells - sum + 2.0));
+}
+
+/************************************************************************/
+/*>int Contab3Count(CONTAB3 *ct, int i, int j, int k)
+   --------------------------------------------------
+   Input:   CONTAB3 *ct      The table
+            int     i        Position in the first dimension
+            int     j        ...the second
+            int     k        ...and the third
+   Returns: int              Count in the cell (0 if it is not stored)
+
+   17.10.26 Original    By: ACRM
+*/
+int Contab3Count(CONTAB3 *ct, int i, int j, int k)
+{
+   int pos[3], slot, cell;
+
+   pos[0] = i;
+   pos[1] = j;
+   pos[2] = k;
+   if((cell = ProbeCell3(ct, pos, &slot)) < 0)
+      return(0);
+   return(ct->counts[cell]);
+}
+
+/************************************************************************/
+/*>double Contab3Expected(CONTAB3 *ct, int i, int j, int k)
+   --------------------------------------------------------
+   Input:   CONTAB3 *ct      The table
+            int     i        Position in the first dimension
+            int     j        ...the second
+            int     k        ...and the third
+   Returns: double           Expected value for the cell
+
+   The given expected (0 if the cell is not stored) or, if they were not
+   given, the product of the cell's three totals over the square of the
+   grand total (0 if any total is zero)
+
+   17.10.26 Original    By: ACRM (from Contab3ChiSq())
+   17.10.26 Given expecteds are found through the hash table
+*/
+double Contab3Expected(CONTAB3 *ct, int i, int j, int k)
+{
+   double nObs = (double)ct->nObs;
+   int    pos[3], slot, cell;
+
+   if(ct->gotExpecteds)
+   {
+      pos[0] = i;
+      pos[1] = j;
+      pos[2] = k;
+      if((cell = ProbeCell3(ct, pos, &slot)) < 0)
+         return(0.0);
+      return(ct->expecteds[cell]);
+   }
+   if(!ct->tot[0][i] || !ct->tot[1][j] || !ct->tot[2][k])
+      return(0.0);
+   return(((double)ct->tot[0][i] * (double)ct->tot[1][j] *
+           (double)ct->tot[2][k]) / (nObs * nObs));
+}
+
+/************************************************************************/
+/*>void Contab3ChiSq(CONTAB3 *ct, int gStat, CHIRESULT *result)
+   ------------------------------------------------------------
+   Input:   CONTAB3   *ct      The table
+            int       gStat    Also calculate G (otherwise g is -1)
+   Output:  CHIRESULT *result  Chi squared, G, DoF, p-values and
+                               warnings
+
+   Calculates chi squared for mutual independence. Unless given, the
+   expected for a cell is the product of its three totals over the
+   square of the grand total. Cells with an expected too small to use
+   (including any with a zero total) are not included.
+
+   Without given expecteds, only the occupied cells are visited:
+   chi squared is sum(O^2/E) - N over them, less the expecteds of the
+   cells that are not included, and the cells with small or unusable
+   expecteds are counted from the sorted totals by CountSmall3(). Given
+   expecteds are only stored for the cells that have them, and every
+   other cell has an expected of zero.
+
+   G comes from the same pass if asked for. Williams' correction is only
+   defined here for two-way tables, so q is 1 and the p-value is for G
+   itself. The cell counts in the result stop at INT_MAX.
+
+   09.02.94 Original    By: ACRM (CalcChiSq() in chisq3)
+   16.12.94 Cast values in calculation of expected (was being done as int)
+   03.04.08 Added obtaining expecteds from file
+   03.10.17 Added warnings
+   17.10.26 Each line of planes is summed by the vectorized kernel in
+            chikern.c
+   17.10.26 Takes a CONTAB3. Nothing is printed
+   17.10.26 Added G
+   17.10.26 The expecteds are calculated by the kernel from the totals
+            in the same pass rather than stored in a separate pass
+            first. The products are formed in the same order so the
+            result is unchanged
+   17.10.26 Only the occupied cells are visited
+*/
+void Contab3ChiSq(CONTAB3 *ct, int gStat, CHIRESULT *result)
+{
+   CHIACC acc;
+   int    observed[CHIBLOCK],
+          c, n, b;
+   double expected[CHIBLOCK],
+          nObs2  = (double)ct->nObs * (double)ct->nObs,
+          nAll   = (double)ct->nItems[0] * (double)ct->nItems[1] *
+                   (double)ct->nItems[2],
+          nSmall = 0.0,
+          nZero  = 0.0,
+          lost   = 0.0,
+          chisq;
+
+   ClearChiAcc(&acc, gStat);
+   if(ct->gotExpecteds)
+   {
+      /* Cells that are not stored have an expected of zero             */
+      ChiSqCells(ct->counts, ct->expecteds, NULL, ct->nCells, 0, &acc);
+      nSmall = (double)acc.nSmall;
+      nZero  = (double)acc.nZero + (nAll - (double)ct->nCells);
+   }
+   else if(ct->nObs == 0)
+   {
+      nZero  = nAll;
+   }
+   else
+   {
+      CountSmall3(ct, nObs2, &nSmall, &nZero, &lost);
+
+      /* Gather the occupied cells in blocks with their expecteds, the
+         product formed in the same order as Contab3Expected()
+      */
+      for(c=0; c<ct->nCells; c+=n)
+      {
+         n = ((ct->nCells - c < CHIBLOCK) ? (ct->nCells - c) : CHIBLOCK);
+         for(b=0; b<n; b++)
+         {
+            observed[b] = ct->counts[c + b];
+            expected[b] = (double)ct->tot[0][CONTAB3POS(ct, c + b, 0)] *
+                          (double)ct->tot[1][CONTAB3POS(ct, c + b, 1)] *
+                          (double)ct->tot[2][CONTAB3POS(ct, c + b, 2)] /
+                          nObs2;
+         }
+         ChiSqOccupied(observed, expected, n, &acc);
+      }
+   }
+
+   /* The N taken off includes the expecteds that were not included     */
+   chisq = acc.chisq - lost;
+   if(chisq < 0.0)                 /* Rounding                          */
+      chisq = 0.0;
+
+   result->nObs     = ct->nObs;
+   result->dof      = Contab3DoF(ct);
+   result->chisq    = chisq;
+   result->pValue   = ChiSqProb(chisq, result->dof);
+   result->g        = (gStat ? (2.0 * acc.g) : -1.0);
+   if(gStat && (result->g < 0.0))  /* Rounding, or given expecteds      */
+      result->g = 0.0;             /* that total more than N            */
+   result->williams = 1.0;
+   result->gPValue  = (gStat ? ChiSqProb(result->g, result->dof) : 1.0);
+   result->nCells   = CAPINT(nAll);
+   result->nSmall   = CAPINT(nSmall);
+   result->nZero    = CAPINT(nZero);
+   result->nVisited = acc.nVisited;
+   result->nOccupied = acc.nOccupied;
+   result->warnings = 0;
+   if(nZero > 0.0)
+      result->warnings |= CHIWARN_ZERO;
+   if((nAll > 0.0) && ((nSmall / nAll) > 0.25))
+      result->warnings |= CHIWARN_SMALL;
+}
+
+/************************************************************************/
+/*>int Contab3GroupCells(CONTAB3 *ct, int d, int **order, int **start)
+   -------------------------------------------------------------------
+   Input:   CONTAB3 *ct      The table
+            int     d        Dimension to group by
+   Output:  int     **order  Cell numbers grouped by their item in d
+            int     **start  Where each item's cells start in order
+                             (nItems[d] + 1 entries, the last being
+                             the number of cells)
+   Returns: int              Success?
+
+   Groups the stored cells by their item in one dimension with a
+   counting sort, so the cells of item i are
+      order[start[i]] ... order[start[i+1] - 1]
+   in the order they were stored. The arrays are allocated and must be
+   freed by the caller.
+
+   17.10.26 Original    By: ACRM
+*/
+int Contab3GroupCells(CONTAB3 *ct, int d, int **order, int **start)
+{
+   int c, i, *next;
+
+   *order = (int *)malloc((ct->nCells ? ct->nCells : 1) * sizeof(int));
+   *start = (int *)calloc(ct->nItems[d] + 1, sizeof(int));
+   next   = (int *)malloc((ct->nItems[d] ? ct->nItems[d] : 1) *
+                          sizeof(int));
+   if((*order == NULL) || (*start == NULL) || (next == NULL))
+   {
+      if(*order != NULL) free(*order);
+      if(*start != NULL) free(*start);
+      if(next   != NULL) free(next);
+      *order = *start = NULL;
+      return(0);
+   }
+
+   for(c=0; c<ct->nCells; c++)
+      (*start)[CONTAB3POS(ct, c, d) + 1]++;
+   for(i=0; i<ct->nItems[d]; i++)
+   {
+      (*start)[i + 1] += (*start)[i];
+      next[i]          = (*start)[i];
+   }
+   for(c=0; c<ct->nCells; c++)
+      (*order)[next[CONTAB3POS(ct, c, d)]++] = c;
+
+   free(next);
+   return(1);
+}
+/************************************************************************/
+/*>static int FindCell3(CONTAB3 *ct, char **labels, size_t *lengths,
+                        int *pos)
+   -----------------------------------------------------------------
+   I/O:     CONTAB3 *ct       The table
+   Input:   char    **labels  Label in each dimension (need not be
+                              terminated)
+            size_t  *lengths  Length of each label
+   Output:  int     *pos      Position in each dimension
+   Returns: int               Success?
+
+   Finds the cell for the labels, adding items if they are new and
+   growing the table to hold them
+
+   17.10.26 Original    By: ACRM (from Contab3SetCell())
+*/
+static int FindCell3(CONTAB3 *ct, char **labels, size_t *lengths,
+                     int *pos)
+{
+   int nItems[3], d;
+
+   for(d=0; d<3; d++)
+   {
+      if(!UnmapLabelTable(ct->labels[d]) ||
+         ((pos[d] = InternLabel(ct->labels[d], labels[d],
+                                (int)lengths[d])) < 0))
+         return(0);
+      nItems[d] = ct->labels[d]->nLabels;
+   }
+
+   if(!GrowContab3(ct, nItems))
+      return(0);
+   for(d=0; d<3; d++)
+      ct->nItems[d] = nItems[d];
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int ChangeCell3(CONTAB3 *ct, int cell, int change)
+   ---------------------------------------------------------
+   I/O:     CONTAB3 *ct      The table
+   Input:   int     cell     The cell
+            int     change   Amount to add to the count
+   Returns: int              1 on success or 0 (and nothing is
+                             changed) if the cell or a total would
+                             overflow
+
+   Adds to a count and the totals. The totals are no larger than the
+   grand total so need not be checked.
+
+   17.10.26 Original    By: ACRM (from Contab3SetCell())
+   17.10.26 The totals are 64-bit so the cell is checked instead
+   17.10.26 Takes a stored cell rather than its position
+*/
+static int ChangeCell3(CONTAB3 *ct, int cell, int change)
+{
+   int d;
+
+   if((change > 0) &&
+      ((ct->counts[cell] > INT_MAX - change) ||
+       (ct->nObs > LONG_MAX - change)))
+      return(0);
+
+   ct->counts[cell] += change;
+   for(d=0; d<3; d++)
+      ct->tot[d][CONTAB3POS(ct, cell, d)] += change;
+   ct->nObs += change;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int ProbeCell3(CONTAB3 *ct, int *pos, int *slot)
+   -------------------------------------------------------
+   Input:   CONTAB3 *ct      The table
+            int     *pos     Position of the cell in each dimension
+   Output:  int     *slot    Hash table slot holding the cell or, if it
+                             is not stored, where it would go
+   Returns: int              The cell or -1 if it is not stored
+
+   17.10.26 Original    By: ACRM
+*/
+static int ProbeCell3(CONTAB3 *ct, int *pos, int *slot)
+{
+   int mask, cell;
+
+   *slot = 0;
+   if(ct->hashTable == NULL)
+      return(-1);
+
+   mask = ct->tableSize - 1;
+   for(*slot=(int)(HashCell3(pos) & mask);
+       ct->hashTable[*slot];
+       *slot=(*slot + 1) & mask)
+   {
+      cell = ct->hashTable[*slot] - 1;
+      if((CONTAB3POS(ct, cell, 0) == pos[0]) &&
+         (CONTAB3POS(ct, cell, 1) == pos[1]) &&
+         (CONTAB3POS(ct, cell, 2) == pos[2]))
+         return(cell);
+   }
+
+   return(-1);
+}
+
+/************************************************************************/
+/*>static int AddCell3(CONTAB3 *ct, int *pos)
+   ------------------------------------------
+   I/O:     CONTAB3 *ct      The table
+   Input:   int     *pos     Position of the cell in each dimension
+   Returns: int              The cell or -1 if out of memory
+
+   Finds a cell, storing it with a count (and expected) of zero if it
+   is new
+
+   17.10.26 Original    By: ACRM
+*/
+static int AddCell3(CONTAB3 *ct, int *pos)
+{
+   int cell, slot, d;
+
+   if((ct->nCells >= ct->maxCells) && !GrowCells3(ct, ct->nCells + 1))
+      return(-1);
+   if((cell = ProbeCell3(ct, pos, &slot)) >= 0)
+      return(cell);
+
+   cell = ct->nCells++;
+   ct->hashTable[slot] = cell + 1;
+   ct->counts[cell]    = 0;
+   if(ct->gotExpecteds)
+      ct->expecteds[cell] = 0.0;
+   for(d=0; d<3; d++)
+      CONTAB3POS(ct, cell, d) = pos[d];
+
+   return(cell);
+}
+
+/************************************************************************/
+/*>static unsigned long HashCell3(int *pos)
+   ----------------------------------------
+   Input:   int     *pos     Position of the cell in each dimension
+   Returns: unsigned long    FNV-1a hash of the position
+
+   17.10.26 Original    By: ACRM
+*/
+static unsigned long HashCell3(int *pos)
+{
+   unsigned long hash = 2166136261UL;
+   unsigned char *byte = (unsigned char *)pos;
+   size_t        i;
+
+   for(i=0; i<3*sizeof(int); i++)
+   {
+      hash ^= byte[i];
+      hash  = (hash * 16777619UL) & 0xffffffffUL;
+   }
+   return(hash);
+}
+
+/************************************************************************/
+/*>static int GrowCells3(CONTAB3 *ct, int nNeeded)
+   -----------------------------------------------
+   I/O:     CONTAB3 *ct      The table
+   Input:   int     nNeeded  Number of cells needed
+   Returns: int              Success?
+
+   Makes sure there is space for nNeeded cells. When it is outgrown the
+   space is doubled and the hash table, which is twice the size, is
+   rebuilt.
+
+   17.10.26 Original    By: ACRM
+*/
+static int GrowCells3(CONTAB3 *ct, int nNeeded)
+{
+   int    *counts, *cellPos, *hashTable,
+          maxCells, cell, slot;
+   double *expecteds;
+
+   if(nNeeded <= ct->maxCells)
+      return(1);
+
+   maxCells = (ct->maxCells ? ct->maxCells : INITCELLS);
+   while(maxCells < nNeeded)
+   {
+      if(maxCells > INT_MAX / 8)
+         return(0);
+      maxCells *= 2;
+   }
+
+   if((counts = (int *)realloc(ct->counts, maxCells * sizeof(int)))
+      == NULL)
+      return(0);
+   ct->counts = counts;
+   if((cellPos = (int *)realloc(ct->cellPos,
+                                3 * (size_t)maxCells * sizeof(int)))
+      == NULL)
+      return(0);
+   ct->cellPos = cellPos;
+   if(ct->gotExpecteds)
+   {
+      if((expecteds = (double *)realloc(ct->expecteds,
+                                        maxCells * sizeof(double)))
+         == NULL)
+         return(0);
+      ct->expecteds = expecteds;
+   }
+   if((hashTable = (int *)calloc(2 * (size_t)maxCells, sizeof(int)))
+      == NULL)
+      return(0);
+
+   if(ct->hashTable != NULL)
+      free(ct->hashTable);
+   ct->hashTable = hashTable;
+   ct->tableSize = 2 * maxCells;
+   ct->maxCells  = maxCells;
+   for(cell=0; cell<ct->nCells; cell++)
+   {
+      ProbeCell3(ct, &CONTAB3POS(ct, cell, 0), &slot);
+      ct->hashTable[slot] = cell + 1;
+   }
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int GrowContab3(CONTAB3 *ct, int *nItems)
+   ------------------------------------------------
+   I/O:     CONTAB3 *ct      The table
+   Input:   int     *nItems  Number of items needed in each dimension
+   Returns: int              Success?
+
+   Makes sure the totals have space for nItems. When they are outgrown
+   they are reallocated at (at least) double the size, with the new
+   totals zero.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Expecteds are only allocated if they are given
+   17.10.26 Only the totals (and their sorting space) are grown, as the
+            cells are stored separately
+*/
+static int GrowContab3(CONTAB3 *ct, int *nItems)
+{
+   int64_t *tot, *sorted;
+   int     nAlloc, d;
+
+   for(d=0; d<3; d++)
+   {
+      if((ct->tot[d] != NULL) && (nItems[d] <= ct->nAlloc[d]))
+         continue;
+
+      nAlloc = (ct->nAlloc[d] ? ct->nAlloc[d] : INITITEM);
+      while(nAlloc < nItems[d])
+         nAlloc *= 2;
+
+      if((tot = (int64_t *)realloc(ct->tot[d],
+                                   nAlloc * sizeof(int64_t))) == NULL)
+         return(0);
+      ct->tot[d] = tot;
+      if((sorted = (int64_t *)realloc(ct->sorted[d],
+                                      nAlloc * sizeof(int64_t))) == NULL)
+         return(0);
+      ct->sorted[d] = sorted;
+      memset(ct->tot[d] + ct->nAlloc[d], 0,
+             (nAlloc - ct->nAlloc[d]) * sizeof(int64_t));
+      ct->nAlloc[d] = nAlloc;
+   }
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static void CountSmall3(CONTAB3 *ct, double nObs2, double *nSmall,
+                           double *nZero, double *lost)
+   ------------------------------------------------------------------
+   Input:   CONTAB3 *ct      The table (with observations)
+            double  nObs2    Square of the grand total
+   Output:  double  *nSmall  Cells with an expected under 5 that are
+                             included
+            double  *nZero   Cells with an expected too small to include
+            double  *lost    Total expected of those cells
+
+   Counts the cells with small expecteds, whether or not they are
+   occupied, from the totals. With the column and plane totals sorted,
+   the expecteds for a row and column rise along the planes, so those
+   too small to use are a run at the start and those under 5 a longer
+   one. As the column total rises, both runs can only shorten, so each
+   row costs the number of columns plus planes rather than their
+   product.
+
+   17.10.26 Original    By: ACRM
+*/
+static void CountSmall3(CONTAB3 *ct, double nObs2, double *nSmall,
+                        double *nZero, double *lost)
+{
+   int64_t *t1 = ct->sorted[1],
+           *t2 = ct->sorted[2];
+   int     nJ  = ct->nItems[1],
+           nK  = ct->nItems[2],
+           i, j, kZero, kSmall;
+   double  p, below;
+
+   memcpy(t1, ct->tot[1], nJ * sizeof(int64_t));
+   memcpy(t2, ct->tot[2], nK * sizeof(int64_t));
+   qsort(t1, nJ, sizeof(int64_t), CompareTotals);
+   qsort(t2, nK, sizeof(int64_t), CompareTotals);
+
+   *nSmall = *nZero = *lost = 0.0;
+   for(i=0; i<ct->nItems[0]; i++)
+   {
+      kZero  = kSmall = nK;
+      below  = (double)ct->nObs;   /* Sum of t2[0..kZero-1]             */
+      for(j=0; j<nJ; j++)
+      {
+         p = (double)ct->tot[0][i] * (double)t1[j];
+         while((kZero > 0) && ((p * (double)t2[kZero-1] / nObs2) > SMALL))
+         {
+            kZero--;
+            below -= (double)t2[kZero];
+         }
+         while((kSmall > 0) && ((p * (double)t2[kSmall-1] / nObs2) >= 5.0))
+            kSmall--;
+
+         *nZero  += kZero;
+         *nSmall += kSmall - kZero;
+         *lost   += p * below / nObs2;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static int CompareTotals(const void *a, const void *b)
+   ------------------------------------------------------
+   qsort() comparison for ascending int64_t totals
+
+   17.10.26 Original    By: ACRM
+*/
+static int CompareTotals(const void *a, const void *b)
+{
+   int64_t ta = *(const int64_t *)a,
+           tb = *(const int64_t *)b;
+
+   return((ta > tb) - (ta < tb));
+}
+
+/************************************************************************/
+/*>static int CompareIndex(const void *a, const void *b)
+   -----------------------------------------------------
+   qsort() comparison for CELLINDEXs in ascending order of index
+
+   17.10.26 Original    By: ACRM
+*/
+static int CompareIndex(const void *a, const void *b)
+{
+   uint64_t ia = ((const CELLINDEX *)a)->index,
+            ib = ((const CELLINDEX *)b)->index;
+
+   return((ia > ib) - (ia < ib));
+}
+
+/************************************************************************/
+/*>static void FreeArrays3(CONTAB3 *ct)
+   ------------------------------------
+   I/O:     CONTAB3 *ct      The table
+
+   Frees the cells, hash table and totals
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Frees the cells and hash table
+*/
+static void FreeArrays3(CONTAB3 *ct)
+{
+   int d;
+
+   if(ct->counts    != NULL) free(ct->counts);
+   if(ct->expecteds != NULL) free(ct->expecteds);
+   if(ct->cellPos   != NULL) free(ct->cellPos);
+   if(ct->hashTable != NULL) free(ct->hashTable);
+   for(d=0; d<3; d++)
+   {
+      if(ct->tot[d]    != NULL) free(ct->tot[d]);
+      if(ct->sorted[d] != NULL) free(ct->sorted[d]);
+      ct->tot[d]    = NULL;
+      ct->sorted[d] = NULL;
+      ct->nAlloc[d] = 0;
+   }
+   ct->counts    = NULL;
+   ct->expecteds = NULL;
+   ct->cellPos   = NULL;
+   ct->hashTable = NULL;
+   ct->nCells    = 0;
+   ct->maxCells  = 0;
+   ct->tableSize = 0;
+}
@@ -0,0 +1,676 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       contabn.c
+
+   Version:    V1.1
+   Date:       17.10.26
+   Function:   N-way contingency tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   Builds a contingency table with any number of factors (2 to
+   CONTABMAXDIMS) from labelled counts and tests for mutual independence
+   of all the factors. This is the two-way CONTAB and three-way CONTAB3
+   generalized to one engine with one parser.
+
+   The counts are a single flat array with the last dimension contiguous
+   (row-major order), so the table is a set of lines along the last
+   dimension and each line is summed by the kernel in chikern.c exactly
+   as a row of a CONTAB is. The array grows to fit the labels seen and
+   the totals for each dimension are kept as the cells are set.
+
+   Unless expecteds are given, the expected for a cell is the product of
+   its totals over N^(D-1) for D dimensions. The kernel calculates it in
+   the same pass as chi squared from the product of the totals for the
+   line and the total for each position along it. As for a CONTAB, items
+   with no observations are left out, and the degrees of freedom for
+   mutual independence are
+      prod(n) - sum(n) + D - 1
+   where n is the number of items with observations in each dimension.
+   For two dimensions this is the usual (r-1)(c-1) and chi squared is
+   identical to that from a CONTAB. For three it is the same as
+   Contab3DoF().
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 The totals are int64_t. A count too large for an int
+                  is refused
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "contab.h"
+#include "chikern.h"
+#include "lineread.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define INITITEM 8
+
+/************************************************************************/
+/* Prototypes
+*/
+static int FindCellN(CONTABN *ct, char **labels, size_t *lengths,
+                     int *pos);
+static int ChangeCellN(CONTABN *ct, int *pos, int change);
+static int GrowContabN(CONTABN *ct, int *nItems);
+static void FreeArraysN(CONTABN *ct);
+static int ReadCountN(char *token, size_t length, int *count);
+
+/************************************************************************/
+/*>CONTABN *CreateContabN(int nDims, int gotExpecteds)
+   ---------------------------------------------------
+   Input:   int    nDims         Number of dimensions (2 to
+                                 CONTABMAXDIMS)
+            int    gotExpecteds  Expecteds will be given with the counts
+   Returns: CONTABN *            An empty table (NULL if no memory or
+                                 nDims is out of range)
+
+   17.10.26 Original    By: ACRM
+*/
+CONTABN *CreateContabN(int nDims, int gotExpecteds)
+{
+   CONTABN *ct;
+   int     d;
+
+   if((nDims < 2) || (nDims > CONTABMAXDIMS))
+      return(NULL);
+   if((ct = (CONTABN *)calloc(1, sizeof(CONTABN))) == NULL)
+      return(NULL);
+
+   ct->nDims        = nDims;
+   ct->gotExpecteds = gotExpecteds;
+   for(d=0; d<nDims; d++)
+   {
+      if((ct->labels[d] = CreateLabelTable()) == NULL)
+      {
+         FreeContabN(ct);
+         return(NULL);
+      }
+   }
+
+   return(ct);
+}
+
+/************************************************************************/
+/*>void FreeContabN(CONTABN *ct)
+   -----------------------------
+   I/O:     CONTABN *ct      Table to free
+
+   17.10.26 Original    By: ACRM
+*/
+void FreeContabN(CONTABN *ct)
+{
+   int d;
+
+   if(ct != NULL)
+   {
+      FreeArraysN(ct);
+      for(d=0; d<ct->nDims; d++)
+         FreeLabelTable(ct->labels[d]);
+      free(ct);
+   }
+}
+
+/************************************************************************/
+/*>size_t ContabNIndex(CONTABN *ct, int *pos)
+   ------------------------------------------
+   Input:   CONTABN *ct      The table
+            int     *pos     Position in each dimension
+   Returns: size_t           Offset of the cell in counts (and
+                             expecteds)
+
+   17.10.26 Original    By: ACRM
+*/
+size_t ContabNIndex(CONTABN *ct, int *pos)
+{
+   size_t index = 0;
+   int    d;
+
+   for(d=0; d<ct->nDims; d++)
+      index += (size_t)pos[d] * ct->stride[d];
+   return(index);
+}
+
+/************************************************************************/
+/*>int ContabNNextCell(CONTABN *ct, int *pos, int nDims)
+   -----------------------------------------------------
+   Input:   CONTABN *ct      The table
+            int     nDims    Number of dimensions to step through
+   I/O:     int     *pos     Position, stepped on to the next one
+   Returns: int              0 when all positions have been seen
+
+   Steps through every position of the first nDims dimensions in the
+   order they are stored, the last of them fastest. Start with pos all
+   zero. With nDims one less than the table's, this steps from line to
+   line.
+
+   17.10.26 Original    By: ACRM
+*/
+int ContabNNextCell(CONTABN *ct, int *pos, int nDims)
+{
+   int d;
+
+   for(d=nDims-1; d>=0; d--)
+   {
+      if(++pos[d] < ct->nItems[d])
+         return(1);
+      pos[d] = 0;
+   }
+   return(0);
+}
+
+/************************************************************************/
+/*>int ContabNSetCell(CONTABN *ct, char **labels, size_t *lengths,
+                      int count, double expected)
+   ---------------------------------------------------------------
+   I/O:     CONTABN *ct       The table
+   Input:   char    **labels  Label in each dimension (need not be
+                              terminated)
+            size_t  *lengths  Length of each label
+            int     count     Observed count
+            double  expected  Expected value (ignored unless the table
+                              was created with gotExpecteds)
+   Returns: int               1 on success, 0 if out of memory or -1
+                              (and the cell is not changed) if a total
+                              would overflow
+
+   Sets the count for a cell, adding items if they are new and updating
+   the totals. The count replaces any earlier one for the cell.
+
+   17.10.26 Original    By: ACRM
+*/
+int ContabNSetCell(CONTABN *ct, char **labels, size_t *lengths,
+                   int count, double expected)
+{
+   int pos[CONTABMAXDIMS];
+
+   if(!FindCellN(ct, labels, lengths, pos))
+      return(0);
+
+   if(!ChangeCellN(ct, pos, count - ct->counts[ContabNIndex(ct, pos)]))
+      return(-1);
+   if(ct->gotExpecteds)
+      ct->expecteds[ContabNIndex(ct, pos)] = expected;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int ContabNParseLine(CONTABN *ct, char *line, size_t length)
+   ------------------------------------------------------------
+   I/O:     CONTABN *ct      The table
+   Input:   char    *line    Line of text (need not be terminated)
+            size_t  length   Length of the line
+   Returns: int              1 on success, 0 if out of memory or -1
+                             (and the cell is not changed) if the
+                             count is too large for an int, or would
+                             become negative or overflow
+
+   Sets a cell from a line of the form
+      item1 ... itemN count [expected]
+   Lines with fewer than N labels are ignored and a missing count is
+   taken as zero. A count that is not a plain integer is read as a real
+   number, as chisq3 does.
+   If the table has accumulate set, the count (and expected) are added
+   to those from earlier lines for the same cell. If it has raw set,
+   the line is a single observation
+      item1 ... itemN
+   which adds one to the cell. Anything after the labels is ignored.
+
+   17.10.26 Original    By: ACRM (from Contab3ParseLine())
+   17.10.26 A count too large for an int is refused
+*/
+int ContabNParseLine(CONTABN *ct, char *line, size_t length)
+{
+   char   *end = line + length,
+          *labels[CONTABMAXDIMS], *token;
+   size_t lengths[CONTABMAXDIMS], tokenLength, index;
+   int    count = 0,
+          d, pos[CONTABMAXDIMS];
+   double expected = 0.0;
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      if((labels[d] = NextToken(&line, end, &(lengths[d]))) == NULL)
+         return(1);
+   }
+
+   if(ct->raw)
+   {
+      if(!FindCellN(ct, labels, lengths, pos))
+         return(0);
+      return(ChangeCellN(ct, pos, 1) ? 1 : -1);
+   }
+   if(((token = NextToken(&line, end, &tokenLength)) != NULL) &&
+      !ReadCountN(token, tokenLength, &count))
+      return(-1);
+   if(ct->gotExpecteds &&
+      ((token = NextToken(&line, end, &tokenLength)) != NULL))
+      expected = ParseReal(token, tokenLength);
+
+   if(ct->accumulate)
+   {
+      if(!FindCellN(ct, labels, lengths, pos))
+         return(0);
+      index = ContabNIndex(ct, pos);
+      if((count < 0) && (ct->counts[index] + count < 0))
+         return(-1);
+      if(!ChangeCellN(ct, pos, count))
+         return(-1);
+      if(ct->gotExpecteds)
+         ct->expecteds[index] += expected;
+      return(1);
+   }
+
+   return(ContabNSetCell(ct, labels, lengths, count, expected));
+}
+
+/************************************************************************/
+/*>int ContabNDoF(CONTABN *ct)
+   ---------------------------
+   Input:   CONTABN *ct      The table
+   Returns: int              Degrees of freedom for mutual independence
+
+   Only items with observations are counted
+
+   17.10.26 Original    By: ACRM
+*/
+int ContabNDoF(CONTABN *ct)
+{
+   long cells = 1,
+        sum   = 0;
+   int  d, i, n;
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      for(i=0, n=0; i<ct->nItems[d]; i++)
+         if(ct->tot[d][i]) n++;
+      cells *= n;
+      sum   += n;
+   }
+   if(cells == 0)
+      return(0);
+
+   return((int)(cells - sum + ct->nDims - 1));
+}
+
+/************************************************************************/
+/*>double ContabNExpected(CONTABN *ct, int *pos)
+   ---------------------------------------------
+   Input:   CONTABN *ct      The table
+            int     *pos     Position in each dimension
+   Returns: double           Expected value for the cell
+
+   The given expected or, if they were not given, the product of the
+   cell's totals over N^(D-1), formed in the same order as by
+   ContabNChiSq() (0 if any total is zero)
+
+   17.10.26 Original    By: ACRM
+*/
+double ContabNExpected(CONTABN *ct, int *pos)
+{
+   double product = 1.0,
+          divisor = (double)ct->nObs;
+   int    d, last = ct->nDims - 1;
+
+   if(ct->gotExpecteds)
+      return(ct->expecteds[ContabNIndex(ct, pos)]);
+
+   for(d=0; d<last; d++)
+      product *= (double)ct->tot[d][pos[d]];
+   for(d=2; d<ct->nDims; d++)
+      divisor *= (double)ct->nObs;
+   if((product == 0.0) || (ct->tot[last][pos[last]] == 0))
+      return(0.0);
+
+   return(product * (double)ct->tot[last][pos[last]] / divisor);
+}
+
+/************************************************************************/
+/*>void ContabNChiSq(CONTABN *ct, int gStat, CHIRESULT *result)
+   ------------------------------------------------------------
+   Input:   CONTABN   *ct      The table
+            int       gStat    Also calculate G (otherwise g is -1)
+   Output:  CHIRESULT *result  Chi squared, G, DoF, p-values and
+                               warnings
+
+   Calculates chi squared for mutual independence in a single pass over
+   the counts. Lines along the last dimension where any of the other
+   totals is zero are skipped, and the kernel skips positions along the
+   line whose total is zero. Cells whose expected is too small to use
+   are counted and not included.
+
+   G comes from the same pass if asked for. For a two-way table with
+   expecteds from the margins, its p-value uses Williams' correction as
+   in ContabChiSq(). Otherwise q is 1 and the p-value is for G itself.
+
+   17.10.26 Original    By: ACRM (from Contab3ChiSq())
+*/
+void ContabNChiSq(CONTABN *ct, int gStat, CHIRESULT *result)
+{
+   CHIACC acc;
+   double lineTot,
+          divisor = (double)ct->nObs,
+          nObs    = (double)ct->nObs,
+          sum[2];
+   size_t index;
+   int    pos[CONTABMAXDIMS], d, i,
+          last    = ct->nDims - 1;
+
+   for(d=2; d<ct->nDims; d++)
+      divisor *= (double)ct->nObs;
+
+   ClearChiAcc(&acc, gStat);
+   for(d=0; d<ct->nDims; d++)
+      pos[d] = 0;
+
+   if(ct->counts != NULL)
+   {
+      do
+      {
+         lineTot = 1.0;
+         for(d=0; d<last; d++)
+            lineTot *= (double)ct->tot[d][pos[d]];
+         if(lineTot == 0.0)
+            continue;
+
+         index = ContabNIndex(ct, pos);
+         if(ct->gotExpecteds)
+            ChiSqCells(ct->counts + index, ct->expecteds + index,
+                       ct->tot[last], ct->nItems[last], 0, &acc);
+         else
+            ChiSqCellsFromMargins(ct->counts + index, ct->tot[last],
+                                  ct->tot[last], lineTot, divisor,
+                                  ct->nItems[last], 0, &acc);
+      }  while(ContabNNextCell(ct, pos, last));
+   }
+
+   result->nObs     = ct->nObs;
+   result->dof      = ContabNDoF(ct);
+   result->chisq    = acc.chisq;
+   result->pValue   = ChiSqProb(acc.chisq, result->dof);
+   result->g        = (gStat ? (2.0 * acc.g) : -1.0);
+   if(gStat && (result->g < 0.0))  /* Rounding, or given expecteds      */
+      result->g = 0.0;             /* that total more than N            */
+   result->williams = 1.0;
+   if((ct->nDims == 2) && !ct->gotExpecteds && (result->dof > 0))
+   {
+      for(d=0; d<2; d++)
+      {
+         for(i=0, sum[d]=0.0; i<ct->nItems[d]; i++)
+            if(ct->tot[d][i]) sum[d] += 1.0 / (double)ct->tot[d][i];
+      }
+      result->williams += (nObs * sum[0] - 1.0) * (nObs * sum[1] - 1.0) /
+                          (6.0 * nObs * (double)result->dof);
+   }
+   result->gPValue  = (gStat ? ChiSqProb(result->g / result->williams,
+                                         result->dof) : 1.0);
+   result->nCells   = acc.nCells;
+   result->nSmall   = acc.nSmall;
+   result->nZero    = acc.nZero;
+   result->nVisited = acc.nVisited;
+   result->nOccupied = acc.nOccupied;
+   result->warnings = 0;
+   if(acc.nZero)
+      result->warnings |= CHIWARN_ZERO;
+   if(acc.nCells && ((acc.nSmall / (double)acc.nCells) > 0.25))
+      result->warnings |= CHIWARN_SMALL;
+}
+
+/************************************************************************/
+/*>static int FindCellN(CONTABN *ct, char **labels, size_t *lengths,
+                        int *pos)
+   -----------------------------------------------------------------
+   I/O:     CONTABN *ct       The table
+   Input:   char    **labels  Label in each dimension (need not be
+                              terminated)
+            size_t  *lengths  Length of each label
+   Output:  int     *pos      Position in each dimension
+   Returns: int               Success?
+
+   Finds the cell for the labels, adding items if they are new and
+   growing the table to hold them
+
+   17.10.26 Original    By: ACRM (from FindCell3())
+*/
+static int FindCellN(CONTABN *ct, char **labels, size_t *lengths,
+                     int *pos)
+{
+   int nItems[CONTABMAXDIMS], d;
+
+   for(d=0; d<ct->nDims; d++)
+   {
+      if((pos[d] = InternLabel(ct->labels[d], labels[d],
+                               (int)lengths[d])) < 0)
+         return(0);
+      nItems[d] = ct->labels[d]->nLabels;
+   }
+
+   if(!GrowContabN(ct, nItems))
+      return(0);
+   for(d=0; d<ct->nDims; d++)
+      ct->nItems[d] = nItems[d];
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int ChangeCellN(CONTABN *ct, int *pos, int change)
+   ---------------------------------------------------------
+   I/O:     CONTABN *ct      The table
+   Input:   int     *pos     Position of the cell in each dimension
+            int     change   Amount to add to the count
+   Returns: int              1 on success or 0 (and nothing is
+                             changed) if the cell or a total would
+                             overflow
+
+   Adds to a count and the totals. The totals are no larger than the
+   grand total so need not be checked.
+
+   17.10.26 Original    By: ACRM (from ChangeCell3())
+   17.10.26 The totals are 64-bit so the cell is checked instead
+*/
+static int ChangeCellN(CONTABN *ct, int *pos, int change)
+{
+   size_t index = ContabNIndex(ct, pos);
+   int    d;
+
+   if((change > 0) &&
+      ((ct->counts[index] > INT_MAX - change) ||
+       (ct->nObs > LONG_MAX - change)))
+      return(0);
+
+   ct->counts[index] += change;
+   for(d=0; d<ct->nDims; d++)
+      ct->tot[d][pos[d]] += change;
+   ct->nObs += change;
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static int GrowContabN(CONTABN *ct, int *nItems)
+   ------------------------------------------------
+   I/O:     CONTABN *ct      The table
+   Input:   int     *nItems  Number of items needed in each dimension
+   Returns: int              Success?
+
+   Makes sure the array has space for nItems. When it is outgrown it is
+   reallocated at (at least) double the size in each dimension that is
+   too small, and the existing values and totals are copied across a
+   line at a time.
+
+   17.10.26 Original    By: ACRM (from GrowContab3())
+*/
+static int GrowContabN(CONTABN *ct, int *nItems)
+{
+   CONTABN grown;
+   size_t  nCells, from, to;
+   int     pos[CONTABMAXDIMS], d,
+           nDims = ct->nDims,
+           last  = ct->nDims - 1;
+
+   for(d=0; d<nDims; d++)
+   {
+      if((ct->counts == NULL) || (nItems[d] > ct->nAlloc[d]))
+         break;
+   }
+   if(d == nDims)
+      return(1);
+
+   grown.nDims = nDims;
+   for(d=0; d<nDims; d++)
+   {
+      grown.nAlloc[d] = (ct->nAlloc[d] ? ct->nAlloc[d] : INITITEM);
+      while(grown.nAlloc[d] < nItems[d])
+         grown.nAlloc[d] *= 2;
+   }
+   grown.stride[last] = 1;
+   for(d=last; d>0; d--)
+      grown.stride[d-1] = grown.stride[d] * grown.nAlloc[d];
+   nCells = grown.stride[0] * grown.nAlloc[0];
+
+   grown.counts    = (int *)calloc(nCells, sizeof(int));
+   grown.expecteds = (ct->gotExpecteds ?
+                      (double *)calloc(nCells, sizeof(double)) : NULL);
+   for(d=0; d<nDims; d++)
+      grown.tot[d] = (int64_t *)calloc(grown.nAlloc[d], sizeof(int64_t));
+   for(d=0; d<nDims; d++)
+   {
+      if(grown.tot[d] == NULL)
+         break;
+   }
+   if((grown.counts == NULL) || (d < nDims) ||
+      (ct->gotExpecteds && (grown.expecteds == NULL)))
+   {
+      FreeArraysN(&grown);
+      return(0);
+   }
+
+   /* Copy across any existing data                                     */
+   if(ct->counts != NULL)
+   {
+      for(d=0; d<nDims; d++)
+      {
+         pos[d] = 0;
+         memcpy(grown.tot[d], ct->tot[d],
+                ct->nItems[d] * sizeof(int64_t));
+      }
+
+      for(d=0; d<last; d++)
+      {
+         if(ct->nItems[d] == 0)
+            break;
+      }
+      if(d == last)
+      {
+         do
+         {
+            from = ContabNIndex(ct, pos);
+            to   = ContabNIndex(&grown, pos);
+            memcpy(grown.counts + to, ct->counts + from,
+                   ct->nItems[last] * sizeof(int));
+            if(ct->gotExpecteds)
+               memcpy(grown.expecteds + to, ct->expecteds + from,
+                      ct->nItems[last] * sizeof(double));
+         }  while(ContabNNextCell(ct, pos, last));
+      }
+      FreeArraysN(ct);
+   }
+
+   ct->counts    = grown.counts;
+   ct->expecteds = grown.expecteds;
+   for(d=0; d<nDims; d++)
+   {
+      ct->tot[d]    = grown.tot[d];
+      ct->nAlloc[d] = grown.nAlloc[d];
+      ct->stride[d] = grown.stride[d];
+   }
+
+   return(1);
+}
+
+/************************************************************************/
+/*>static void FreeArraysN(CONTABN *ct)
+   ------------------------------------
+   I/O:     CONTABN *ct      The table
+
+   Frees the counts, expecteds and totals
+
+   17.10.26 Original    By: ACRM (from FreeArrays3())
+*/
+static void FreeArraysN(CONTABN *ct)
+{
+   int d;
+
+   if(ct->counts    != NULL) free(ct->counts);
+   if(ct->expecteds != NULL) free(ct->expecteds);
+   for(d=0; d<ct->nDims; d++)
+   {
+      if(ct->tot[d] != NULL) free(ct->tot[d]);
+      ct->tot[d] = NULL;
+   }
+   ct->counts    = NULL;
+   ct->expecteds = NULL;
+}
+
+/************************************************************************/
+/*>static int ReadCountN(char *token, size_t length, int *count)
+   -------------------------------------------------------------
+   Input:   char   *token    Token (need not be terminated)
+            size_t length    Length of the token
+   Output:  int    *count    The count
+   Returns: int              Success? (0 if it is too large for an int)
+
+   Plain integers (the usual case) go to ParseCount(). Anything else,
+   such as 20.0 or 1e3, is read as a real and truncated.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 A count too large for an int is refused
+*/
+static int ReadCountN(char *token, size_t length, int *count)
+{
+   size_t i = 0;
+
+   if((length > 0) && ((token[0] == '-') || (token[0] == '+')))
+      i++;
+   for(; i<length; i++)
+   {
+      if((token[i] < '0') || (token[i] > '9'))
+         return(ParseRealCount(token, length, count));
+   }
+   return(ParseCount(token, length, count));
+}
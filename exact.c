@@ -0,0 +1,930 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       exact.c
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Exact tests for two-way contingency tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Fisher's exact test, extended to RxC tables (the Freeman-Halton
+   test). With the row and column totals fixed, the probability of a
+   table is
+
+      prod(R_i!) prod(C_j!) / (N! prod(O_ij!))
+
+   and the p-value is the total probability of all tables that are no
+   more probable than the one observed. For a 2x2 table this is the
+   usual two-sided Fisher's exact test.
+
+   This uses the network algorithm of Mehta and Patel. Tables are built
+   a column at a time and a node is the set of row totals left after
+   the first k columns have been filled. The order of the rows does not
+   matter, so the totals are kept sorted and every partial table that
+   leaves the same totals meets at the same node. Each node holds the
+   distinct values of sum(log(O!)) over the paths reaching it (the
+   "past"), with the number of paths having each.
+
+   Before a node is expanded, bounds are found on sum(log(O!)) for
+   every way of completing it by filling each remaining column (and then
+   each row) on its own, ignoring the others. For each past, if every
+   completion gives a table no more probable than the one observed,
+   their total probability, which has a closed form, is added without
+   enumerating them. If none does, the past is dropped. Only pasts that
+   straddle the observed probability are carried on to the next column,
+   so only a small fraction of the tables is visited. Rows are the
+   shorter side of the table as there are fewer ways of filling a short
+   column and fewer sets of row totals.
+
+   Log factorials are taken from a table kept in the CONTAB and grown to
+   the number of observations, so they are only calculated once however
+   many tables are tested.
+
+   The work still grows quickly with the size of the table, so the test
+   gives up (returning -1) once a given number of cells have been
+   filled or a quarter as many pasts are stored. ContabExactTest()
+   allows EXACTMAXCELLS, which may take a few tenths of a second.
+   ContabExactTestLimit() takes a smaller budget, such as
+   EXACTQUICKCELLS, for a test that can be run on every table in batch
+   mode.
+
+   Most tables that are too large can be spotted without any of this
+   work. The first column is filled in every way that fits the row
+   totals, which can be counted from the totals alone. If that already
+   needs more cells than the budget allows, or the log factorials would
+   take longer to calculate than the budget, the test gives up at once.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Tables with more than INT_MAX observations are too
+                  large
+   V1.2  17.10.26 Added ContabExactTestLimit(). Tables too large for the
+                  budget are rejected from their totals before starting
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "contab.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define OBSPERCELL 100L    /* Observations (log factorials) allowed for
+                              each cell in the budget                   */
+#define RELERR   1.0e-7    /* Tables within this relative probability of
+                              the observed one are counted as equal     */
+#define SAMEPAST 1.0e-9    /* Pasts closer than this are merged         */
+#define INITSIZE 64
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   double past,            /* Sum of log(O!) over the columns filled    */
+          weight;          /* Number of paths with this past            */
+}  PAST;
+
+typedef struct
+{
+   PAST          *pasts;
+   unsigned long hash;
+   int           key,      /* Offset of the row totals in STAGE.keys    */
+                 nPasts,
+                 maxPasts,
+                 next;     /* Next node in the hash chain (-1 = none)   */
+}  NODE;
+
+/* The nodes reached after a given number of columns                    */
+typedef struct
+{
+   NODE *nodes;
+   int  *keys,             /* Sorted row totals for each node           */
+        *table,            /* Hash table of first node in each chain    */
+        nNodes,
+        maxNodes,
+        tableSize;
+}  STAGE;
+
+typedef struct
+{
+   double *lf,             /* Log factorials                            */
+          need,            /* Sum of log(O!) at or above which a table is
+                              no more probable than the observed one    */
+          total,           /* log(prod(R_i!) prod(C_j!) / N!)           */
+          pValue;
+   int    *rows,           /* Row totals left to fill                   */
+          *cols,           /* Column totals                             */
+          *sorted,         /* Workspace for the bounds                  */
+          *child,          /* Workspace for the next node's key         */
+          *maxBelow,       /* Capacity of the rows below each row       */
+          nRows,
+          nCols,
+          nKept,           /* Pasts of the current node carried on      */
+          maxKept;         /* Size of kept                              */
+   long   nPasts,          /* Pasts stored so far                       */
+          nCells,          /* Cells filled so far                       */
+          maxPasts,        /* Give up once this many pasts are stored   */
+          maxCells;        /* ...or this many cells have been filled    */
+   PAST   *kept;           /* Those pasts                               */
+   STAGE  *next;           /* Stage being built                         */
+}  EXACT;
+
+/************************************************************************/
+/* Prototypes
+*/
+static int  LogFactorials(CONTAB *ct, int n);
+static int  InitStage(STAGE *stage, int nRows);
+static void ClearStage(STAGE *stage);
+static void FreeStage(STAGE *stage);
+static int  FindNode(STAGE *stage, int *key, int nRows);
+static int  AddPast(EXACT *ex, NODE *node, double past, double weight);
+static void MergePasts(NODE *node);
+static int  ExpandNode(EXACT *ex, NODE *node, int *key, int k);
+static int  FillColumn(EXACT *ex, int k, int i, int left, double sum);
+static int  CountFillings(EXACT *ex, int k, double limit, double *count);
+static void Bounds(EXACT *ex, int k, double *least, double *most);
+static void SpreadBounds(double *lf, int count, int *caps, int n,
+                         double *least, double *most);
+static int  ComparePasts(const void *a, const void *b);
+static int  CompareInts(const void *a, const void *b);
+
+/************************************************************************/
+/*>int ContabExactTest(CONTAB *ct, double *pValue)
+   -----------------------------------------------
+   Input:   CONTAB *ct       The table
+   Output:  double *pValue   Exact p-value
+   Returns: int              1 on success, 0 if out of memory or -1 if
+                             the table is too large
+
+   Fisher's exact test (Freeman-Halton for tables larger than 2x2) with
+   the row and column totals fixed. Rows and columns with no
+   observations are ignored.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Now calls ContabExactTestLimit()
+*/
+int ContabExactTest(CONTAB *ct, double *pValue)
+{
+   return(ContabExactTestLimit(ct, EXACTMAXCELLS, pValue));
+}
+
+/************************************************************************/
+/*>int ContabExactTestLimit(CONTAB *ct, long maxCells, double *pValue)
+   -------------------------------------------------------------------
+   Input:   CONTAB *ct       The table
+            long   maxCells  Give up after filling this many cells
+   Output:  double *pValue   Exact p-value
+   Returns: int              1 on success, 0 if out of memory or -1 if
+                             the table is too large for the budget (or
+                             its totals do not add up)
+
+   ContabExactTest() with a budget for the work done
+
+   17.10.26 Original    By: ACRM (from ContabExactTest())
+   17.10.26 Refuses a table whose counts and totals are not consistent
+            rather than indexing past the log factorials
+*/
+int ContabExactTestLimit(CONTAB *ct, long maxCells, double *pValue)
+{
+   EXACT  ex;
+   STAGE  stages[2],
+          *current, *swap;
+   NODE   *node;
+   int    *block,
+          nRows = 0,
+          nCols = 0,
+          status = 1,
+          transpose, i, j, ii, jj, k, n, o;
+   long   rowSum = 0,
+          colSum = 0;
+   double observed = 0.0,
+          sum;
+
+   *pValue = 1.0;
+
+   for(i=0; i<ct->nItem1; i++)
+      if(ct->tot1[i]) nRows++;
+   for(j=0; j<ct->nItem2; j++)
+      if(ct->tot2[j]) nCols++;
+   if((nRows < 2) || (nCols < 2))
+      return(1);
+
+   if((ct->nObs > INT_MAX) || (ct->nObs / OBSPERCELL > maxCells))
+      return(-1);
+
+   /* Counts and totals index the log factorials, which only go up to
+      the number of observations
+   */
+   for(i=0; i<ct->nItem1; i++)
+   {
+      if(ct->tot1[i] < 0)
+         return(-1);
+      rowSum += ct->tot1[i];
+   }
+   for(j=0; j<ct->nItem2; j++)
+   {
+      if(ct->tot2[j] < 0)
+         return(-1);
+      colSum += ct->tot2[j];
+   }
+   if((rowSum != ct->nObs) || (colSum != ct->nObs))
+      return(-1);
+   if(!LogFactorials(ct, (int)ct->nObs))
+      return(0);
+
+   /* Rows are the shorter side                                         */
+   transpose = (nRows > nCols);
+   ex.nRows  = (transpose ? nCols : nRows);
+   ex.nCols  = (transpose ? nRows : nCols);
+   ex.lf     = ct->logFact;
+   ex.pValue = 0.0;
+   ex.nPasts = ex.nCells = 0;
+   ex.nKept  = ex.maxKept = 0;
+   ex.kept   = NULL;
+
+   ex.maxCells = maxCells;
+   ex.maxPasts = maxCells / 4;
+
+   if((block = (int *)malloc((5 * ex.nRows + ex.nCols) * sizeof(int)))
+      == NULL)
+      return(0);
+   ex.rows     = block;
+   ex.sorted   = ex.rows     + ex.nRows;
+   ex.child    = ex.sorted   + ex.nRows;
+   ex.maxBelow = ex.child    + ex.nRows;
+   ex.cols     = ex.maxBelow + ex.nRows;
+
+   /* Collect the non-zero totals and the sum of log(O!) for the table
+      observed
+   */
+   for(i=0, ii=0; i<ct->nItem1; i++)
+   {
+      if(ct->tot1[i] == 0)
+         continue;
+      (transpose ? ex.cols : ex.rows)[ii++] = (int)ct->tot1[i];
+      for(j=0; j<ct->nItem2; j++)
+      {
+         if(ct->tot2[j] && ((o = CONTABCELL(ct, i, j)) > 1))
+         {
+            if(o > ct->nObs)
+            {
+               free(block);
+               return(-1);
+            }
+            observed += ex.lf[o];
+         }
+      }
+   }
+   for(j=0, jj=0; j<ct->nItem2; j++)
+   {
+      if(ct->tot2[j])
+         (transpose ? ex.rows : ex.cols)[jj++] = (int)ct->tot2[j];
+   }
+
+   ex.need  = observed - log(1.0 + RELERR);
+   ex.total = -ex.lf[ct->nObs];
+   for(i=0; i<ex.nRows; i++)
+      ex.total += ex.lf[ex.rows[i]];
+   for(j=0; j<ex.nCols; j++)
+      ex.total += ex.lf[ex.cols[j]];
+
+   /* Columns are filled largest first                                  */
+   qsort(ex.rows, ex.nRows, sizeof(int), CompareInts);
+   qsort(ex.cols, ex.nCols, sizeof(int), CompareInts);
+
+   if(!InitStage(&stages[0], ex.nRows) || !InitStage(&stages[1], ex.nRows))
+   {
+      FreeStage(&stages[0]);
+      FreeStage(&stages[1]);
+      free(block);
+      return(0);
+   }
+   current = &stages[0];
+   ex.next = &stages[1];
+
+   /* The start node has all the row totals and one empty path          */
+   if(((n = FindNode(current, ex.rows, ex.nRows)) < 0) ||
+      !AddPast(&ex, &(current->nodes[n]), 0.0, 1.0))
+      status = 0;
+
+   for(k=0; (status > 0) && (k < ex.nCols - 1); k++)
+   {
+      ClearStage(ex.next);
+      for(n=0; (status > 0) && (n < current->nNodes); n++)
+         status = ExpandNode(&ex, &(current->nodes[n]),
+                             current->keys + current->nodes[n].key, k);
+      swap     = current;
+      current  = ex.next;
+      ex.next  = swap;
+   }
+
+   /* The last column takes what is left                                */
+   for(n=0; (status > 0) && (n < current->nNodes); n++)
+   {
+      node = &(current->nodes[n]);
+      for(i=0, sum=0.0; i<ex.nRows; i++)
+         sum += ex.lf[current->keys[node->key + i]];
+      for(i=0; i<node->nPasts; i++)
+      {
+         if(node->pasts[i].past + sum >= ex.need)
+            ex.pValue += node->pasts[i].weight *
+                         exp(ex.total - node->pasts[i].past - sum);
+      }
+   }
+
+   FreeStage(&stages[0]);
+   FreeStage(&stages[1]);
+   free(ex.kept);
+   free(block);
+
+   if(status > 0)
+      *pValue = ((ex.pValue > 1.0) ? 1.0 : ex.pValue);
+   return(status);
+}
+
+/************************************************************************/
+/*>static int LogFactorials(CONTAB *ct, int n)
+   -------------------------------------------
+   I/O:     CONTAB *ct       The table
+   Input:   int    n         Largest factorial needed
+   Returns: int              Success?
+
+   Makes sure ct->logFact holds log(i!) for i = 0..n. The table is kept
+   with the CONTAB and only ever extended.
+
+   17.10.26 Original    By: ACRM
+*/
+static int LogFactorials(CONTAB *ct, int n)
+{
+   double *logFact;
+   int    size, i;
+
+   if(n < ct->nLogFact)
+      return(1);
+
+   size = (ct->nLogFact ? ct->nLogFact : 256);
+   while(size <= n)
+      size *= 2;
+   if((logFact = (double *)realloc(ct->logFact, size * sizeof(double)))
+      == NULL)
+      return(0);
+
+   if(ct->nLogFact == 0)
+   {
+      logFact[0]   = 0.0;
+      ct->nLogFact = 1;
+   }
+   for(i=ct->nLogFact; i<size; i++)
+      logFact[i] = logFact[i-1] + log((double)i);
+
+   ct->logFact  = logFact;
+   ct->nLogFact = size;
+   return(1);
+}
+
+/************************************************************************/
+/*>static int InitStage(STAGE *stage, int nRows)
+   ---------------------------------------------
+   Output:  STAGE  *stage    An empty stage
+   Input:   int    nRows     Length of each key
+   Returns: int              Success?
+
+   17.10.26 Original    By: ACRM
+*/
+static int InitStage(STAGE *stage, int nRows)
+{
+   int i;
+
+   stage->nNodes    = 0;
+   stage->maxNodes  = INITSIZE;
+   stage->tableSize = 2 * INITSIZE;
+   stage->nodes = (NODE *)malloc(stage->maxNodes * sizeof(NODE));
+   stage->keys  = (int *)malloc(stage->maxNodes * nRows * sizeof(int));
+   stage->table = (int *)malloc(stage->tableSize * sizeof(int));
+   if((stage->nodes == NULL) || (stage->keys == NULL) ||
+      (stage->table == NULL))
+      return(0);
+
+   for(i=0; i<stage->tableSize; i++)
+      stage->table[i] = -1;
+   return(1);
+}
+
+/************************************************************************/
+/*>static void ClearStage(STAGE *stage)
+   ------------------------------------
+   I/O:     STAGE  *stage    Stage to empty (the memory is kept)
+
+   17.10.26 Original    By: ACRM
+*/
+static void ClearStage(STAGE *stage)
+{
+   int i;
+
+   for(i=0; i<stage->nNodes; i++)
+      free(stage->nodes[i].pasts);
+   for(i=0; i<stage->tableSize; i++)
+      stage->table[i] = -1;
+   stage->nNodes = 0;
+}
+
+/************************************************************************/
+/*>static void FreeStage(STAGE *stage)
+   -----------------------------------
+   I/O:     STAGE  *stage    Stage to free
+
+   17.10.26 Original    By: ACRM
+*/
+static void FreeStage(STAGE *stage)
+{
+   if(stage->nodes != NULL)
+   {
+      ClearStage(stage);
+      free(stage->nodes);
+   }
+   free(stage->keys);
+   free(stage->table);
+}
+
+/************************************************************************/
+/*>static int FindNode(STAGE *stage, int *key, int nRows)
+   ------------------------------------------------------
+   I/O:     STAGE  *stage    The stage
+   Input:   int    *key      Sorted row totals
+            int    nRows     Length of key
+   Returns: int              Index of the node (-1 if out of memory)
+
+   Finds the node for a set of row totals, adding it if it is new. The
+   nodes array may move so pointers into it must be found again.
+
+   17.10.26 Original    By: ACRM
+*/
+static int FindNode(STAGE *stage, int *key, int nRows)
+{
+   unsigned long hash = 5381;
+   NODE          *nodes;
+   int           *ints,
+                 i, n;
+
+   for(i=0; i<nRows; i++)
+      hash = (hash * 33) ^ (unsigned long)key[i];
+
+   for(n=stage->table[hash & (stage->tableSize - 1)]; n >= 0;
+       n=stage->nodes[n].next)
+   {
+      if((stage->nodes[n].hash == hash) &&
+         !memcmp(stage->keys + stage->nodes[n].key, key,
+                 nRows * sizeof(int)))
+         return(n);
+   }
+
+   if(stage->nNodes == stage->maxNodes)
+   {
+      if((nodes = (NODE *)realloc(stage->nodes, 2 * stage->maxNodes *
+                                  sizeof(NODE))) == NULL)
+         return(-1);
+      stage->nodes = nodes;
+      if((ints = (int *)realloc(stage->keys, 2 * stage->maxNodes * nRows *
+                                sizeof(int))) == NULL)
+         return(-1);
+      stage->keys      = ints;
+      stage->maxNodes *= 2;
+
+      /* Keep the hash table at twice the number of nodes               */
+      if((ints = (int *)realloc(stage->table, 2 * stage->maxNodes *
+                                sizeof(int))) == NULL)
+         return(-1);
+      stage->table     = ints;
+      stage->tableSize = 2 * stage->maxNodes;
+      for(i=0; i<stage->tableSize; i++)
+         stage->table[i] = -1;
+      for(i=0; i<stage->nNodes; i++)
+      {
+         n = (int)(stage->nodes[i].hash & (stage->tableSize - 1));
+         stage->nodes[i].next = stage->table[n];
+         stage->table[n]      = i;
+      }
+   }
+
+   n = stage->nNodes++;
+   memcpy(stage->keys + n * nRows, key, nRows * sizeof(int));
+   stage->nodes[n].key      = n * nRows;
+   stage->nodes[n].hash     = hash;
+   stage->nodes[n].pasts    = NULL;
+   stage->nodes[n].nPasts   = 0;
+   stage->nodes[n].maxPasts = 0;
+   i = (int)(hash & (stage->tableSize - 1));
+   stage->nodes[n].next = stage->table[i];
+   stage->table[i]      = n;
+
+   return(n);
+}
+
+/************************************************************************/
+/*>static int AddPast(EXACT *ex, NODE *node, double past, double weight)
+   ---------------------------------------------------------------------
+   I/O:     EXACT  *ex       The test
+            NODE   *node     Node reached
+   Input:   double past      Sum of log(O!) along the path
+            double weight    Number of paths
+   Returns: int              1 on success, 0 if out of memory, -1 if
+                             there are too many pasts
+
+   Adds a past to a node. Equal pasts are merged later by MergePasts().
+
+   17.10.26 Original    By: ACRM
+*/
+static int AddPast(EXACT *ex, NODE *node, double past, double weight)
+{
+   PAST *pasts;
+   int  size;
+
+   if(node->nPasts == node->maxPasts)
+   {
+      /* Merge before growing, in case that makes enough room           */
+      MergePasts(node);
+      if((node->maxPasts == 0) || (node->nPasts > node->maxPasts / 2))
+      {
+         size = (node->maxPasts ? 2 * node->maxPasts : 4);
+         if((pasts = (PAST *)realloc(node->pasts, size * sizeof(PAST)))
+            == NULL)
+            return(0);
+         ex->nPasts    += size - node->maxPasts;
+         node->pasts    = pasts;
+         node->maxPasts = size;
+         if(ex->nPasts > ex->maxPasts)
+            return(-1);
+      }
+   }
+
+   node->pasts[node->nPasts].past   = past;
+   node->pasts[node->nPasts].weight = weight;
+   node->nPasts++;
+   return(1);
+}
+
+/************************************************************************/
+/*>static void MergePasts(NODE *node)
+   ----------------------------------
+   I/O:     NODE   *node     The node
+
+   Sorts the pasts and merges those that are equal (to within rounding),
+   adding their weights
+
+   17.10.26 Original    By: ACRM
+*/
+static void MergePasts(NODE *node)
+{
+   int i, n;
+
+   if(node->nPasts < 2)
+      return;
+
+   qsort(node->pasts, node->nPasts, sizeof(PAST), ComparePasts);
+   for(i=1, n=0; i<node->nPasts; i++)
+   {
+      if(node->pasts[i].past - node->pasts[n].past <=
+         SAMEPAST * (1.0 + node->pasts[n].past))
+         node->pasts[n].weight += node->pasts[i].weight;
+      else
+         node->pasts[++n] = node->pasts[i];
+   }
+   node->nPasts = n + 1;
+}
+
+/************************************************************************/
+/*>static int ExpandNode(EXACT *ex, NODE *node, int *key, int k)
+   -------------------------------------------------------------
+   I/O:     EXACT  *ex       The test
+            NODE   *node     Node in the current stage
+   Input:   int    *key      The node's row totals
+            int    k         Column to fill
+   Returns: int              1 on success, 0 if out of memory, -1 if
+                             there are too many pasts
+
+   Settles the pasts of a node that can be settled from the bounds and
+   passes the others on to the nodes reached by filling column k
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Gives up at once if filling the first column would use up
+            the budget
+*/
+static int ExpandNode(EXACT *ex, NODE *node, int *key, int k)
+{
+   PAST   *kept;
+   double least, most, rest, count;
+   int    i, left;
+
+   memcpy(ex->rows, key, ex->nRows * sizeof(int));
+   MergePasts(node);
+   Bounds(ex, k, &least, &most);
+
+   /* Every completion counts. The sum over them of 1/prod(O!) is
+      M! / (prod(rows left!) prod(columns left!))
+   */
+   for(i=0, left=0; i<ex->nRows; i++)
+      left += ex->rows[i];
+   rest = ex->total + ex->lf[left];
+   for(i=0; i<ex->nRows; i++)
+      rest -= ex->lf[ex->rows[i]];
+   for(i=k; i<ex->nCols; i++)
+      rest -= ex->lf[ex->cols[i]];
+
+   if(node->nPasts > ex->maxKept)
+   {
+      if((kept = (PAST *)realloc(ex->kept, node->nPasts * sizeof(PAST)))
+         == NULL)
+         return(0);
+      ex->kept    = kept;
+      ex->maxKept = node->nPasts;
+   }
+   for(i=0, ex->nKept=0; i<node->nPasts; i++)
+   {
+      if(node->pasts[i].past + most < ex->need)
+         continue;
+      if(node->pasts[i].past + least >= ex->need)
+         ex->pValue += node->pasts[i].weight *
+                       exp(rest - node->pasts[i].past);
+      else
+         ex->kept[ex->nKept++] = node->pasts[i];
+   }
+   if(ex->nKept == 0)
+      return(1);
+
+   /* Every way of filling the first column is tried, so its cost is
+      known before starting
+   */
+   if(k == 0)
+   {
+      if(!CountFillings(ex, k, (double)ex->maxCells / ex->nRows, &count))
+         return(0);
+      if(count * ex->nRows > (double)ex->maxCells)
+         return(-1);
+   }
+
+   /* Capacity of the rows below each row, so a column is only filled
+      in ways that can be completed
+   */
+   ex->maxBelow[ex->nRows - 1] = 0;
+   for(i=ex->nRows-1; i>0; i--)
+      ex->maxBelow[i-1] = ex->maxBelow[i] + ex->rows[i];
+
+   return(FillColumn(ex, k, 0, ex->cols[k], 0.0));
+}
+
+/************************************************************************/
+/*>static int FillColumn(EXACT *ex, int k, int i, int left, double sum)
+   --------------------------------------------------------------------
+   I/O:     EXACT  *ex       The test
+   Input:   int    k         Column being filled
+            int    i         Row to fill next
+            int    left      Count still to place in the column
+            double sum       Sum of log(O!) for the column so far
+   Returns: int              1 on success, 0 if out of memory, -1 if
+                             there are too many pasts
+
+   Tries each possible count for row i of column k and then fills the
+   rest of the column. Once it is full, the kept pasts are passed on to
+   the node for the row totals left.
+
+   17.10.26 Original    By: ACRM
+*/
+static int FillColumn(EXACT *ex, int k, int i, int left, double sum)
+{
+   int o, lo, hi, n, status;
+
+   if(i == ex->nRows - 1)
+   {
+      if((ex->nCells += ex->nRows) > ex->maxCells)
+         return(-1);
+      ex->rows[i] -= left;
+      memcpy(ex->child, ex->rows, ex->nRows * sizeof(int));
+      ex->rows[i] += left;
+      sum += ex->lf[left];
+
+      qsort(ex->child, ex->nRows, sizeof(int), CompareInts);
+      if((n = FindNode(ex->next, ex->child, ex->nRows)) < 0)
+         return(0);
+      for(o=0; o<ex->nKept; o++)
+      {
+         if((status = AddPast(ex, &(ex->next->nodes[n]),
+                              ex->kept[o].past + sum,
+                              ex->kept[o].weight)) <= 0)
+            return(status);
+      }
+      return(1);
+   }
+
+   lo = ((left > ex->maxBelow[i]) ? (left - ex->maxBelow[i]) : 0);
+   hi = ((left < ex->rows[i]) ? left : ex->rows[i]);
+
+   for(o=lo; o<=hi; o++)
+   {
+      ex->rows[i] -= o;
+      status = FillColumn(ex, k, i+1, left - o, sum + ex->lf[o]);
+      ex->rows[i] += o;
+      if(status <= 0)
+         return(status);
+   }
+   return(1);
+}
+
+/************************************************************************/
+/*>static int CountFillings(EXACT *ex, int k, double limit, double *count)
+   -----------------------------------------------------------------------
+   Input:   EXACT  *ex       The test (with the rows left in ex->rows)
+            int    k         Column to fill
+            double limit     Counts above this need not be exact
+   Output:  double *count    Ways of filling the column within the row
+                             totals (limit+1 if there are more)
+   Returns: int              Success?
+
+   Counts the ways of filling column k without filling it, building up
+   the ways of placing each total over the rows a row at a time.
+
+   17.10.26 Original    By: ACRM
+*/
+static int CountFillings(EXACT *ex, int k, double limit, double *count)
+{
+   double *ways, *sums, sum;
+   int    total = ex->cols[k],
+          i, s, cap;
+
+   if((ways = (double *)malloc(2 * (total + 1) * sizeof(double))) == NULL)
+      return(0);
+   sums = ways + total + 1;
+
+   ways[0] = 1.0;
+   for(s=1; s<=total; s++)
+      ways[s] = 0.0;
+
+   for(i=0; i<ex->nRows; i++)
+   {
+      /* Row i takes 0..cap, so the new ways for s sum the old ways for
+         s-cap..s
+      */
+      cap = ex->rows[i];
+      for(s=0, sum=0.0; s<=total; s++)
+         sums[s] = (sum += ways[s]);
+      for(s=0; s<=total; s++)
+      {
+         ways[s] = sums[s] - ((s > cap) ? sums[s-cap-1] : 0.0);
+         if(ways[s] > limit + 1.0)
+            ways[s] = limit + 1.0;
+      }
+   }
+
+   *count = ways[total];
+   free(ways);
+   return(1);
+}
+
+/************************************************************************/
+/*>static void Bounds(EXACT *ex, int k, double *least, double *most)
+   -----------------------------------------------------------------
+   Input:   EXACT  *ex       The test
+            int    k         First column left to fill
+   Output:  double *least    Lower bound on sum of log(O!) over the
+                             columns left
+            double *most     Upper bound on the same
+
+   Each column is filled on its own within the row totals left, and
+   then each row on its own within the column totals. Filling them
+   together can only do worse, so each way bounds every real completion
+   and the tighter of the two is used.
+
+   17.10.26 Original    By: ACRM
+*/
+static void Bounds(EXACT *ex, int k, double *least, double *most)
+{
+   double colLeast = 0.0, colMost = 0.0,
+          rowLeast = 0.0, rowMost = 0.0;
+   int    i, j;
+
+   for(i=0; i<ex->nRows; i++)
+      ex->sorted[i] = ex->rows[i];
+   qsort(ex->sorted, ex->nRows, sizeof(int), CompareInts);
+
+   /* The columns are already sorted                                    */
+   for(j=k; j<ex->nCols; j++)
+      SpreadBounds(ex->lf, ex->cols[j], ex->sorted, ex->nRows,
+                   &colLeast, &colMost);
+   for(i=0; i<ex->nRows; i++)
+      SpreadBounds(ex->lf, ex->rows[i], ex->cols + k, ex->nCols - k,
+                   &rowLeast, &rowMost);
+
+   *least = ((colLeast > rowLeast) ? colLeast : rowLeast);
+   *most  = ((colMost  < rowMost)  ? colMost  : rowMost);
+}
+
+/************************************************************************/
+/*>static void SpreadBounds(double *lf, int count, int *caps, int n,
+                            double *least, double *most)
+   -----------------------------------------------------------------
+   Input:   double *lf       Log factorials
+            int    count     Count to place in n cells
+            int    *caps     Most each cell may take (descending)
+            int    n         Number of cells
+   I/O:     double *least    Smallest sum of log(O!) is added
+            double *most     Largest sum of log(O!) is added
+
+   As log(O!) is convex, the sum for a line of cells is smallest when
+   the count is spread as evenly as possible and largest when it is
+   packed into the largest cells
+
+   17.10.26 Original    By: ACRM
+*/
+static void SpreadBounds(double *lf, int count, int *caps, int n,
+                         double *least, double *most)
+{
+   int i, left, share, nLeft, o;
+
+   /* Largest cells first                                               */
+   for(i=0, left=count; (i<n) && left; i++)
+   {
+      o      = ((left < caps[i]) ? left : caps[i]);
+      *most += lf[o];
+      left  -= o;
+   }
+
+   /* Evenly, with the smallest cells full if they are below the share  */
+   left  = count;
+   nLeft = n;
+   for(i=n-1; i>=0; i--, nLeft--)
+   {
+      share = left / nLeft;
+      if(caps[i] <= share)
+      {
+         *least += lf[caps[i]];
+         left   -= caps[i];
+      }
+      else
+      {
+         /* The rest all take the share, some with one more             */
+         *least += (nLeft - left % nLeft) * lf[share] +
+                   (left % nLeft) * lf[share + 1];
+         break;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static int ComparePasts(const void *a, const void *b)
+   -----------------------------------------------------
+   qsort() comparison putting pasts in ascending order
+
+   17.10.26 Original    By: ACRM
+*/
+static int ComparePasts(const void *a, const void *b)
+{
+   double pa = ((const PAST *)a)->past,
+          pb = ((const PAST *)b)->past;
+
+   return((pa < pb) ? -1 : ((pa > pb) ? 1 : 0));
+}
+
+/************************************************************************/
+/*>static int CompareInts(const void *a, const void *b)
+   ----------------------------------------------------
+   qsort() comparison putting ints in descending order
+
+   17.10.26 Original    By: ACRM
+*/
+static int CompareInts(const void *a, const void *b)
+{
+   int ia = *(const int *)a,
+       ib = *(const int *)b;
+
+   return((ia < ib) ? 1 : ((ia > ib) ? -1 : 0));
+}
@@ -0,0 +1,686 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       ipf.c
+
+   Version:    V1.1
+   Date:       17.10.26
+   Function:   Hierarchical log-linear models for three-way tables by
+               iterative proportional fitting
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   A hierarchical model is given by its generating margins, written as
+   groups of dimension numbers (1-3) separated by commas, spaces or
+   brackets. For example
+      1,2,3      mutual independence
+      12,3       the third dimension independent of the other two
+      12,13      the second and third independent given the first
+      12,13,23   no three-way interaction
+      123        the saturated model
+   Margins contained in others are dropped.
+
+   The expecteds are fitted by iterative proportional fitting (Deming
+   and Stephan, 1940). Starting from 1 in every cell whose items all have
+   observations, the fitted table is scaled to match each generating
+   margin in turn. A cycle through the margins is repeated until no
+   fitted margin differs from the observed by more than the tolerance,
+   as R's loglin() does. Models with closed-form expecteds fit in the
+   first cycle, which the second confirms.
+
+   Chi squared and G (always) are then summed by the kernel in
+   chikern.c. The degrees of freedom are the cells less one and the
+   parameters of every term implied by the generating margins,
+      prod(n) - 1 - sum over terms of prod(n_d - 1)
+   with n the items with observations in each dimension. Sampling
+   zeros in the margins are not allowed for, as in loglin(). Cells
+   fitted as exactly zero (from a zero in a generating margin) must be
+   empty and are left out rather than warned about.
+
+   The fitted table is a compact array of doubles with the last
+   dimension contiguous. Each sweep is split into tasks on a work pool
+   by the first dimension in the margin (blocks of IPFBLOCK items if
+   that is the last). A task owns the margin cells for its items, so it
+   both sums and scales its own cells and the tasks never share a cell.
+   Each task's region of the table is small enough to be in cache for
+   the second pass. As nothing is summed across tasks, the fit does not
+   depend on the number of threads.
+
+   The table only stores its occupied cells. The observed margins are
+   summed from them before the fit, and for chi squared each item of
+   the first dimension has its cells scattered into a slice for the
+   thread, so the kernel sees the same lines as the fitted table.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 The observed margins and chi squared come from the
+                  table's stored cells
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "contab.h"
+#include "chikern.h"
+#include "chiprob.h"
+#include "workpool.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define IPFBLOCK      8     /* Items of the last dimension in a task    */
+
+#define IPF_START     0     /* Set the starting values                  */
+#define IPF_SCALE     1     /* Sum the fitted margin and scale to fit   */
+#define IPF_CHISQ     2     /* Sum chi squared and G                    */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   CONTAB3 *ct;
+   double  *fitted,         /* Fitted table                             */
+           *observed[3],    /* Observed margin for each generator       */
+           *margin,         /* Fitted margin, then the scale factors    */
+           *deviation;      /* Largest margin difference in each task   */
+   CHIACC  *acc;            /* Chi squared for each item of dimension 0 */
+   size_t  fStride[3],      /* Cells from one item to the next (fitted) */
+           mStride[3];      /* ...and in the margin (0 if summed over)  */
+   int     n[3],            /* Items in each dimension                  */
+           **slice,         /* Observed counts for an item of dimension
+                               0, for each thread                       */
+           *order,          /* Cells grouped by item of dimension 0     */
+           *start,          /* Where each item starts in order          */
+           *generators,     /* Generating margins as bit masks          */
+           mode,            /* IPF_ mode of the current sweep           */
+           generator,       /* Current generator                        */
+           first,           /* First dimension in the margin            */
+           block;           /* Its items in each task                   */
+}  IPF;
+
+/************************************************************************/
+/* Prototypes
+*/
+static int  ParseModel(const char *model, int *generators);
+static int  ModelDoF(CONTAB3 *ct, int *generators, int nGenerators);
+static size_t MarginSize(IPF *ipf, int mask);
+static void MarginStrides(IPF *ipf, int mask);
+static void ObservedMargin(IPF *ipf, int generator);
+static int  Sweep(IPF *ipf, int mode, int generator, int nThreads,
+                  int *nTasks);
+static void RunSweep(void *data, int task, int thread);
+static void SumRegion(IPF *ipf, int *lo, int *hi, double *margin);
+static void ScaleRegion(IPF *ipf, int *lo, int *hi);
+
+/************************************************************************/
+/*>int Contab3FitModel(CONTAB3 *ct, const char *model, double tolerance,
+                       int maxIter, int nThreads, MODELRESULT *result)
+   ---------------------------------------------------------------------
+   Input:   CONTAB3     *ct        The table
+            const char  *model     Generating margins, e.g. "12,13,23"
+            double      tolerance  Largest difference allowed between a
+                                   fitted and observed margin
+            int         maxIter    Most cycles through the margins
+            int         nThreads   Threads to use
+   Output:  MODELRESULT *result    Fit of the model
+   Returns: int                    1 on success, 0 if out of memory or
+                                   -1 if the model is not valid
+
+   Fits a hierarchical log-linear model and tests it with chi squared
+   and G. result->converged is 0 if the fit did not reach the tolerance
+   in maxIter cycles.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Works from the table's stored cells
+*/
+int Contab3FitModel(CONTAB3 *ct, const char *model, double tolerance,
+                    int maxIter, int nThreads, MODELRESULT *result)
+{
+   IPF       ipf;
+   CHIRESULT *fit = &(result->fit);
+   size_t    nCells, size, largest = 1;
+   double    deviation = 0.0;
+   int       g, d, i, nTasks, nItems = 1, ok = 1;
+
+   if((result->nGenerators = ParseModel(model, result->generators)) == 0)
+      return(-1);
+
+   ipf.ct         = ct;
+   ipf.generators = result->generators;
+   for(d=0; d<3; d++)
+   {
+      ipf.n[d] = ct->nItems[d];
+      if(ipf.n[d] > nItems)
+         nItems = ipf.n[d];
+   }
+   ipf.fStride[2] = 1;
+   ipf.fStride[1] = (size_t)ipf.n[2];
+   ipf.fStride[0] = ipf.fStride[1] * ipf.n[1];
+   nCells         = ipf.fStride[0] * ipf.n[0];
+   if(nThreads > nItems)
+      nThreads = nItems;
+   if(nThreads < 1)
+      nThreads = 1;
+
+   ipf.fitted    = (double *)malloc((nCells + 1) * sizeof(double));
+   ipf.acc       = (CHIACC *)malloc((ipf.n[0] + 1) * sizeof(CHIACC));
+   ipf.deviation = (double *)malloc((nItems + 1) * sizeof(double));
+   ipf.margin    = NULL;
+   for(g=0; g<3; g++)
+      ipf.observed[g] = NULL;
+   for(g=0; g<result->nGenerators; g++)
+   {
+      size = MarginSize(&ipf, result->generators[g]);
+      if(size > largest)
+         largest = size;
+      if((ipf.observed[g] = (double *)malloc(size * sizeof(double)))
+         == NULL)
+         ok = 0;
+   }
+   ipf.margin = (double *)malloc(largest * sizeof(double));
+   if((ipf.slice = (int **)calloc(nThreads, sizeof(int *))) != NULL)
+   {
+      for(i=0; i<nThreads; i++)
+      {
+         if((ipf.slice[i] = (int *)malloc((ipf.fStride[0] + 1) *
+                                          sizeof(int))) == NULL)
+            ok = 0;
+      }
+   }
+   if(!Contab3GroupCells(ct, 0, &ipf.order, &ipf.start))
+      ok = 0;
+
+   if(!ok || (ipf.fitted == NULL) || (ipf.acc == NULL) ||
+      (ipf.deviation == NULL) || (ipf.margin == NULL) ||
+      (ipf.slice == NULL))
+      ok = 0;
+   else
+      ok = Sweep(&ipf, IPF_START, 0, nThreads, &nTasks);
+   for(g=0; ok && (g<result->nGenerators); g++)
+      ObservedMargin(&ipf, g);
+
+   /* Cycle through the generating margins. The deviation for a cycle
+      is taken before each margin is scaled
+   */
+   result->iterations = 0;
+   result->converged  = 0;
+   while(ok && (result->iterations < maxIter))
+   {
+      result->iterations++;
+      deviation = 0.0;
+      for(g=0; ok && (g<result->nGenerators); g++)
+      {
+         if((ok = Sweep(&ipf, IPF_SCALE, g, nThreads, &nTasks)) != 0)
+         {
+            for(i=0; i<nTasks; i++)
+            {
+               if(ipf.deviation[i] > deviation)
+                  deviation = ipf.deviation[i];
+            }
+         }
+      }
+      if(deviation <= tolerance)
+      {
+         result->converged = 1;
+         break;
+      }
+   }
+   result->deviation = deviation;
+
+   if(ok && (ok = Sweep(&ipf, IPF_CHISQ, 0, nThreads, &nTasks)) != 0)
+   {
+      fit->chisq    = fit->g = 0.0;
+      fit->nCells   = fit->nSmall = fit->nZero = 0;
+      fit->nVisited = fit->nOccupied = 0;
+      for(i=0; i<ipf.n[0]; i++)
+      {
+         fit->chisq     += ipf.acc[i].chisq;
+         fit->g         += ipf.acc[i].g;
+         fit->nCells    += ipf.acc[i].nCells;
+         fit->nSmall    += ipf.acc[i].nSmall;
+         fit->nZero     += ipf.acc[i].nZero;
+         fit->nVisited  += ipf.acc[i].nVisited;
+         fit->nOccupied += ipf.acc[i].nOccupied;
+      }
+      fit->nObs     = ct->nObs;
+      fit->dof      = ModelDoF(ct, result->generators, result->nGenerators);
+      fit->pValue   = ChiSqProb(fit->chisq, fit->dof);
+      fit->g       *= 2.0;
+      if(fit->g < 0.0)             /* Rounding                          */
+         fit->g = 0.0;
+      fit->williams = 1.0;
+      fit->gPValue  = ChiSqProb(fit->g, fit->dof);
+      fit->warnings = 0;
+      if(fit->nZero)
+         fit->warnings |= CHIWARN_ZERO;
+      if(fit->nCells && ((fit->nSmall / (double)fit->nCells) > 0.25))
+         fit->warnings |= CHIWARN_SMALL;
+   }
+
+   for(g=0; g<3; g++)
+   {
+      if(ipf.observed[g] != NULL) free(ipf.observed[g]);
+   }
+   if(ipf.fitted    != NULL) free(ipf.fitted);
+   if(ipf.acc       != NULL) free(ipf.acc);
+   if(ipf.deviation != NULL) free(ipf.deviation);
+   if(ipf.margin    != NULL) free(ipf.margin);
+   if(ipf.order     != NULL) free(ipf.order);
+   if(ipf.start     != NULL) free(ipf.start);
+   if(ipf.slice     != NULL)
+   {
+      for(i=0; i<nThreads; i++)
+      {
+         if(ipf.slice[i] != NULL)
+            free(ipf.slice[i]);
+      }
+      free(ipf.slice);
+   }
+
+   return(ok);
+}
+
+/************************************************************************/
+/*>static int ParseModel(const char *model, int *generators)
+   ---------------------------------------------------------
+   Input:   const char *model       Generating margins
+   Output:  int        *generators  Each margin as a bit mask of its
+                                    dimensions (at most 3 are left)
+   Returns: int                     Number of margins (0 if not valid)
+
+   Margins contained in another are dropped
+
+   17.10.26 Original    By: ACRM
+*/
+static int ParseModel(const char *model, int *generators)
+{
+   int masks[8], nMasks = 0, mask = 0, nGen = 0, i, j;
+
+   for(;; model++)
+   {
+      if((*model >= '1') && (*model <= '3'))
+      {
+         mask |= 1 << (*model - '1');
+         continue;
+      }
+      if((*model >= '0') && (*model <= '9'))
+         return(0);
+      if(mask)
+      {
+         if(nMasks == 8)
+            return(0);
+         masks[nMasks++] = mask;
+         mask = 0;
+      }
+      if(*model == '\0')
+         break;
+   }
+
+   for(i=0; i<nMasks; i++)
+   {
+      for(j=0; j<nMasks; j++)
+      {
+         /* Contained in another, or a repeat of an earlier one         */
+         if((j != i) && ((masks[i] & masks[j]) == masks[i]) &&
+            ((masks[i] != masks[j]) || (j < i)))
+            break;
+      }
+      if(j == nMasks)
+         generators[nGen++] = masks[i];
+   }
+   return(nGen);
+}
+
+/************************************************************************/
+/*>static int ModelDoF(CONTAB3 *ct, int *generators, int nGenerators)
+   ------------------------------------------------------------------
+   Input:   CONTAB3 *ct           The table
+            int     *generators   Generating margins
+            int     nGenerators   Number of them
+   Returns: int                   Degrees of freedom
+
+   Cells less one and the parameters of each term contained in a
+   generating margin, over the items with observations
+
+   17.10.26 Original    By: ACRM
+*/
+static int ModelDoF(CONTAB3 *ct, int *generators, int nGenerators)
+{
+   int n[3], term, d, g, i, params, dof = 1;
+
+   for(d=0; d<3; d++)
+   {
+      for(i=0, n[d]=0; i<ct->nItems[d]; i++)
+      {
+         if(ct->tot[d][i])
+            n[d]++;
+      }
+      dof *= n[d];
+   }
+   if(dof == 0)
+      return(0);
+   dof--;
+
+   for(term=1; term<8; term++)
+   {
+      for(g=0; g<nGenerators; g++)
+      {
+         if((term & generators[g]) == term)
+            break;
+      }
+      if(g == nGenerators)
+         continue;
+
+      for(d=0, params=1; d<3; d++)
+      {
+         if(term & (1 << d))
+            params *= (n[d] - 1);
+      }
+      dof -= params;
+   }
+   return(dof);
+}
+
+/************************************************************************/
+/*>static size_t MarginSize(IPF *ipf, int mask)
+   --------------------------------------------
+   Input:   IPF    *ipf      The fit
+            int    mask      Dimensions in the margin
+   Returns: size_t           Cells in the margin (at least 1)
+
+   17.10.26 Original    By: ACRM
+*/
+static size_t MarginSize(IPF *ipf, int mask)
+{
+   size_t size = 1;
+   int    d;
+
+   for(d=0; d<3; d++)
+   {
+      if(mask & (1 << d))
+         size *= (size_t)ipf->n[d];
+   }
+   return(size ? size : 1);
+}
+
+/************************************************************************/
+/*>static int Sweep(IPF *ipf, int mode, int generator, int nThreads,
+                    int *nTasks)
+   ----------------------------------------------------------------
+   I/O:     IPF    *ipf        The fit
+   Input:   int    mode        IPF_ mode
+            int    generator   Generating margin (IPF_SCALE)
+            int    nThreads    Threads to use
+   Output:  int    *nTasks     Tasks the sweep was split into
+   Returns: int                Success?
+
+   Sets up the margin strides and runs a sweep over the table on the
+   work pool. IPF_START and IPF_CHISQ work an item of dimension 0 at a
+   time.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The strides are set by MarginStrides()
+*/
+static int Sweep(IPF *ipf, int mode, int generator, int nThreads,
+                 int *nTasks)
+{
+   ipf->mode      = mode;
+   ipf->generator = generator;
+   MarginStrides(ipf, ((mode == IPF_SCALE) ?
+                       ipf->generators[generator] : 1));
+   ipf->block = ((ipf->first == 2) ? IPFBLOCK : 1);
+   *nTasks    = (ipf->n[ipf->first] + ipf->block - 1) / ipf->block;
+
+   return(RunWorkPool(nThreads, *nTasks, RunSweep, (void *)ipf));
+}
+
+/************************************************************************/
+/*>static void MarginStrides(IPF *ipf, int mask)
+   ---------------------------------------------
+   I/O:     IPF    *ipf      The fit
+   Input:   int    mask      Dimensions in the margin
+
+   Sets the margin strides, with the margin's last dimension
+   contiguous, and its first dimension
+
+   17.10.26 Original    By: ACRM (from Sweep())
+*/
+static void MarginStrides(IPF *ipf, int mask)
+{
+   size_t stride = 1;
+   int    d;
+
+   for(d=2; d>=0; d--)
+   {
+      if(mask & (1 << d))
+      {
+         ipf->mStride[d] = stride;
+         stride         *= (size_t)ipf->n[d];
+         ipf->first      = d;
+      }
+      else
+      {
+         ipf->mStride[d] = 0;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void ObservedMargin(IPF *ipf, int generator)
+   ---------------------------------------------------
+   I/O:     IPF    *ipf        The fit
+   Input:   int    generator   Generating margin
+
+   Sums the observed margin for a generator from the stored cells. The
+   sums are of whole numbers so are exact in any order.
+
+   17.10.26 Original    By: ACRM (replacing the IPF_OBSERVED sweep)
+*/
+static void ObservedMargin(IPF *ipf, int generator)
+{
+   CONTAB3 *ct       = ipf->ct;
+   double  *observed = ipf->observed[generator];
+   size_t  m, size;
+   int     c, d;
+
+   MarginStrides(ipf, ipf->generators[generator]);
+   size = MarginSize(ipf, ipf->generators[generator]);
+   for(m=0; m<size; m++)
+      observed[m] = 0.0;
+   for(c=0; c<ct->nCells; c++)
+   {
+      for(d=0, m=0; d<3; d++)
+         m += (size_t)CONTAB3POS(ct, c, d) * ipf->mStride[d];
+      observed[m] += (double)ct->counts[c];
+   }
+}
+
+/************************************************************************/
+/*>static void RunSweep(void *data, int task, int thread)
+   ------------------------------------------------------
+   Input:   void   *data     The IPF
+            int    task      Block of items of the margin's first
+                             dimension
+            int    thread    Thread running it (selects the slice)
+
+   Does the task's part of a sweep. Its region of the table is every
+   cell whose item in the first dimension is in the block, and it owns
+   the contiguous range of margin cells for those items.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 IPF_CHISQ scatters the item's stored cells into a slice
+*/
+static void RunSweep(void *data, int task, int thread)
+{
+   IPF     *ipf = (IPF *)data;
+   CONTAB3 *ct  = ipf->ct;
+   double  *fitted, *observed, difference,
+           deviation = 0.0;
+   size_t  from, to, m;
+   int     *slice = ipf->slice[thread],
+           lo[3], hi[3], d, i, j, k, c, cell, nEmpty;
+
+   for(d=0; d<3; d++)
+   {
+      lo[d] = 0;
+      hi[d] = ipf->n[d];
+   }
+   lo[ipf->first] = task * ipf->block;
+   if(hi[ipf->first] > lo[ipf->first] + ipf->block)
+      hi[ipf->first] = lo[ipf->first] + ipf->block;
+   from = lo[ipf->first] * ipf->mStride[ipf->first];
+   to   = hi[ipf->first] * ipf->mStride[ipf->first];
+
+   switch(ipf->mode)
+   {
+   case IPF_START:
+      for(i=lo[0]; i<hi[0]; i++)
+      {
+         for(j=0; j<ipf->n[1]; j++)
+         {
+            fitted = ipf->fitted + i * ipf->fStride[0] +
+                     j * ipf->fStride[1];
+            for(k=0; k<ipf->n[2]; k++)
+               fitted[k] = ((ct->tot[0][i] && ct->tot[1][j] &&
+                             ct->tot[2][k]) ? 1.0 : 0.0);
+         }
+      }
+      break;
+   case IPF_SCALE:
+      observed = ipf->observed[ipf->generator];
+      for(m=from; m<to; m++)
+         ipf->margin[m] = 0.0;
+      SumRegion(ipf, lo, hi, ipf->margin);
+      for(m=from; m<to; m++)
+      {
+         difference = fabs(ipf->margin[m] - observed[m]);
+         if(difference > deviation)
+            deviation = difference;
+         ipf->margin[m] = ((ipf->margin[m] > 0.0) ?
+                           (observed[m] / ipf->margin[m]) : 0.0);
+      }
+      ScaleRegion(ipf, lo, hi);
+      ipf->deviation[task] = deviation;
+      break;
+   case IPF_CHISQ:
+      ClearChiAcc(&(ipf->acc[task]), 1);
+      if(ct->tot[0][task])
+      {
+         memset(slice, 0, ipf->fStride[0] * sizeof(int));
+         for(c=ipf->start[task]; c<ipf->start[task+1]; c++)
+         {
+            cell = ipf->order[c];
+            slice[CONTAB3POS(ct, cell, 1) * ipf->fStride[1] +
+                  CONTAB3POS(ct, cell, 2)] = ct->counts[cell];
+         }
+         for(j=0; j<ipf->n[1]; j++)
+         {
+            if(!ct->tot[1][j])
+               continue;
+            fitted = ipf->fitted + task * ipf->fStride[0] +
+                     j * ipf->fStride[1];
+            ChiSqCells(slice + j * ipf->fStride[1], fitted, ct->tot[2],
+                       ipf->n[2], 0, &(ipf->acc[task]));
+
+            /* Take out the cells fitted as zero                        */
+            for(k=0, nEmpty=0; k<ipf->n[2]; k++)
+            {
+               if(ct->tot[2][k] && (fitted[k] == 0.0))
+                  nEmpty++;
+            }
+            ipf->acc[task].nCells -= nEmpty;
+            ipf->acc[task].nZero  -= nEmpty;
+         }
+      }
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void SumRegion(IPF *ipf, int *lo, int *hi, double *margin)
+   -----------------------------------------------------------------
+   Input:   IPF    *ipf      The fit
+            int    *lo       Start of the region in each dimension
+            int    *hi       ...and end
+   I/O:     double *margin   Margin added to
+
+   Adds the region's fitted values to the margin
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Only sums fitted values, as the observed margins are summed
+            from the stored cells
+*/
+static void SumRegion(IPF *ipf, int *lo, int *hi, double *margin)
+{
+   double *fitted, *line;
+   size_t ms2 = ipf->mStride[2];
+   int    i, j, k;
+
+   for(i=lo[0]; i<hi[0]; i++)
+   {
+      for(j=lo[1]; j<hi[1]; j++)
+      {
+         line   = margin + i * ipf->mStride[0] + j * ipf->mStride[1];
+         fitted = ipf->fitted + i * ipf->fStride[0] + j * ipf->fStride[1];
+         for(k=lo[2]; k<hi[2]; k++)
+            line[k * ms2] += fitted[k];
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void ScaleRegion(IPF *ipf, int *lo, int *hi)
+   ---------------------------------------------------
+   I/O:     IPF    *ipf      The fit
+   Input:   int    *lo       Start of the region in each dimension
+            int    *hi       ...and end
+
+   Multiplies the region's fitted values by the scale factors now in
+   ipf->margin
+
+   17.10.26 Original    By: ACRM
+*/
+static void ScaleRegion(IPF *ipf, int *lo, int *hi)
+{
+   double *fitted, *factor;
+   size_t ms2 = ipf->mStride[2];
+   int    i, j, k;
+
+   for(i=lo[0]; i<hi[0]; i++)
+   {
+      for(j=lo[1]; j<hi[1]; j++)
+      {
+         factor = ipf->margin + i * ipf->mStride[0] + j * ipf->mStride[1];
+         fitted = ipf->fitted + i * ipf->fStride[0] + j * ipf->fStride[1];
+         for(k=lo[2]; k<hi[2]; k++)
+            fitted[k] *= factor[k * ms2];
+      }
+   }
+}
@@ -0,0 +1,389 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       labels.c
+
+   Version:    V1.4
+   Date:       17.10.26
+   Function:   Label interning for the chi squared programs
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Maps each distinct label onto a dense integer id (0, 1, 2...) in the
+   order in which the labels are first seen. The label text is kept in a
+   single arena and looked up through an open-addressing hash table with
+   linear probing, so finding a label costs O(1) however many labels
+   there are.
+
+   A read-only table can also be made from label text and offsets that
+   are already in memory (such as a mapped binary table file). It can be
+   used to look up the text of each id, but not to intern labels until
+   it has been converted to a normal table with UnmapLabelTable().
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added ClearLabelTable()
+   V1.2  17.10.26 Added MapLabelTable()
+   V1.3  17.10.26 Added UnmapLabelTable()
+   V1.4  17.10.26 Counts lookups and hash probes
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "labels.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define INITLABELS    64
+#define INITARENA   1024
+
+/************************************************************************/
+/* Prototypes
+*/
+static unsigned long HashLabel(char *label, int length);
+static int GrowHashTable(LABELTABLE *lt);
+
+/************************************************************************/
+/*>LABELTABLE *CreateLabelTable(void)
+   ----------------------------------
+   Returns: LABELTABLE *     An empty label table or NULL if no memory
+
+   Creates an empty label table
+
+   17.10.26 Original    By: ACRM
+*/
+LABELTABLE *CreateLabelTable(void)
+{
+   LABELTABLE *lt;
+
+   if((lt = (LABELTABLE *)malloc(sizeof(LABELTABLE))) == NULL)
+      return(NULL);
+
+   lt->nLookups  = 0;
+   lt->nProbes   = 0;
+   lt->nLabels   = 0;
+   lt->maxLabels = INITLABELS;
+   lt->arenaUsed = 0;
+   lt->arenaSize = INITARENA;
+   lt->tableSize = 2 * INITLABELS;
+   lt->external  = 0;
+
+   lt->arena  = (char *)malloc(lt->arenaSize * sizeof(char));
+   lt->offset = (int *)malloc(lt->maxLabels * sizeof(int));
+   lt->hash   = (unsigned long *)malloc(lt->maxLabels *
+                                        sizeof(unsigned long));
+   lt->table  = (int *)calloc(lt->tableSize, sizeof(int));
+
+   if((lt->arena == NULL) || (lt->offset == NULL) ||
+      (lt->hash  == NULL) || (lt->table  == NULL))
+   {
+      FreeLabelTable(lt);
+      return(NULL);
+   }
+
+   return(lt);
+}
+
+/************************************************************************/
+/*>void FreeLabelTable(LABELTABLE *lt)
+   -----------------------------------
+   I/O:     LABELTABLE *lt   Label table
+
+   Frees a label table and all its contents
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Does not free the text of a table from MapLabelTable()
+*/
+void FreeLabelTable(LABELTABLE *lt)
+{
+   if(lt != NULL)
+   {
+      if(!lt->external)
+      {
+         if(lt->arena  != NULL) free(lt->arena);
+         if(lt->offset != NULL) free(lt->offset);
+      }
+      if(lt->hash   != NULL) free(lt->hash);
+      if(lt->table  != NULL) free(lt->table);
+      free(lt);
+   }
+}
+
+/************************************************************************/
+/*>void ClearLabelTable(LABELTABLE *lt)
+   ------------------------------------
+   I/O:     LABELTABLE *lt   Label table
+
+   Empties a label table so it can be reused, keeping its memory. Only
+   the hash slots actually in use are cleared so the cost is proportional
+   to the number of labels rather than the size of the table. The lookup
+   and probe counts are reset.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Resets the counts
+*/
+void ClearLabelTable(LABELTABLE *lt)
+{
+   int id, slot;
+
+   for(id=0; id<lt->nLabels; id++)
+   {
+      slot = (int)(lt->hash[id] & (unsigned long)(lt->tableSize - 1));
+      while(lt->table[slot] != id + 1)
+         slot = (slot + 1) & (lt->tableSize - 1);
+      lt->table[slot] = 0;
+   }
+
+   lt->nLookups  = 0;
+   lt->nProbes   = 0;
+   lt->nLabels   = 0;
+   lt->arenaUsed = 0;
+}
+
+/************************************************************************/
+/*>LABELTABLE *MapLabelTable(char *arena, int arenaUsed, int *offset,
+                             int nLabels)
+   -------------------------------------------------------------------
+   Input:   char   *arena     Label text, each NUL terminated
+            int    arenaUsed  Size of the text
+            int    *offset    Offset of each label in the text
+            int    nLabels    Number of labels
+   Returns: LABELTABLE *      Read-only label table (NULL if no memory)
+
+   Makes a label table that uses text and offsets belonging to the
+   caller, which must stay valid while the table is in use. Nothing is
+   copied or hashed, so LABELTEXT() works but InternLabel() and
+   ClearLabelTable() must not be used.
+
+   17.10.26 Original    By: ACRM
+*/
+LABELTABLE *MapLabelTable(char *arena, int arenaUsed, int *offset,
+                          int nLabels)
+{
+   LABELTABLE *lt;
+
+   if((lt = (LABELTABLE *)calloc(1, sizeof(LABELTABLE))) == NULL)
+      return(NULL);
+
+   lt->arena     = arena;
+   lt->offset    = offset;
+   lt->nLabels   = nLabels;
+   lt->maxLabels = nLabels;
+   lt->arenaUsed = arenaUsed;
+   lt->arenaSize = arenaUsed;
+   lt->external  = 1;
+
+   return(lt);
+}
+
+/************************************************************************/
+/*>int UnmapLabelTable(LABELTABLE *lt)
+   -----------------------------------
+   I/O:     LABELTABLE *lt   Label table
+   Returns: int              Success?
+
+   Converts a table made by MapLabelTable() into a normal one with its
+   own copy of the text, so labels may be added. The ids are unchanged.
+   Does nothing to a normal table.
+
+   17.10.26 Original    By: ACRM
+*/
+int UnmapLabelTable(LABELTABLE *lt)
+{
+   LABELTABLE *copy;
+   int        id;
+
+   if(!lt->external)
+      return(1);
+
+   if((copy = CreateLabelTable()) == NULL)
+      return(0);
+   for(id=0; id<lt->nLabels; id++)
+   {
+      if(InternLabel(copy, LABELTEXT(lt, id),
+                     (int)strlen(LABELTEXT(lt, id))) != id)
+      {
+         FreeLabelTable(copy);
+         return(0);
+      }
+   }
+
+   *lt = *copy;
+   free(copy);
+   return(1);
+}
+
+/************************************************************************/
+/*>int InternLabel(LABELTABLE *lt, char *label, int length)
+   --------------------------------------------------------
+   I/O:     LABELTABLE *lt   Label table
+   Input:   char   *label    Label text (need not be terminated)
+            int    length    Length of the label
+   Returns: int              Id of the label (-1 if out of memory)
+
+   Finds the id for a label, adding it to the table if it has not been
+   seen before. New labels are given the next free id so ids are dense
+   and in order of first appearance. Counts the lookup and the hash
+   slots looked at, including the empty one that ends a search for a new
+   label.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Counts lookups and probes
+*/
+int InternLabel(LABELTABLE *lt, char *label, int length)
+{
+   unsigned long hash;
+   int           slot, id;
+
+   hash = HashLabel(label, length);
+   slot = (int)(hash & (unsigned long)(lt->tableSize - 1));
+   lt->nLookups++;
+   lt->nProbes++;
+
+   /* Probe for the label                                               */
+   while(lt->table[slot])
+   {
+      id = lt->table[slot] - 1;
+      if((lt->hash[id] == hash) &&
+         !strncmp(LABELTEXT(lt, id), label, length) &&
+         (LABELTEXT(lt, id)[length] == '\0'))
+      {
+         return(id);
+      }
+      slot = (slot + 1) & (lt->tableSize - 1);
+      lt->nProbes++;
+   }
+
+   /* Not found so add it. First make space for the id                  */
+   if(lt->nLabels >= lt->maxLabels)
+   {
+      int           *offset;
+      unsigned long *hashes;
+
+      lt->maxLabels *= 2;
+      if((offset = (int *)realloc(lt->offset,
+                                  lt->maxLabels * sizeof(int))) == NULL)
+         return(-1);
+      lt->offset = offset;
+      if((hashes = (unsigned long *)realloc(lt->hash, lt->maxLabels *
+                                            sizeof(unsigned long)))==NULL)
+         return(-1);
+      lt->hash = hashes;
+   }
+
+   /* ...and for the text                                               */
+   if(lt->arenaUsed + length + 1 > lt->arenaSize)
+   {
+      char *arena;
+
+      while(lt->arenaUsed + length + 1 > lt->arenaSize)
+         lt->arenaSize *= 2;
+      if((arena = (char *)realloc(lt->arena, lt->arenaSize)) == NULL)
+         return(-1);
+      lt->arena = arena;
+   }
+
+   id = lt->nLabels++;
+   lt->offset[id] = lt->arenaUsed;
+   lt->hash[id]   = hash;
+   strncpy(lt->arena + lt->arenaUsed, label, length);
+   lt->arena[lt->arenaUsed + length] = '\0';
+   lt->arenaUsed += length + 1;
+   lt->table[slot] = id + 1;
+
+   /* Keep the hash table no more than half full                        */
+   if(2 * lt->nLabels > lt->tableSize)
+   {
+      if(!GrowHashTable(lt))
+         return(-1);
+   }
+
+   return(id);
+}
+
+/************************************************************************/
+/*>static unsigned long HashLabel(char *label, int length)
+   -------------------------------------------------------
+   Input:   char   *label    Label text
+            int    length    Length of the label
+   Returns: unsigned long    Hash value
+
+   FNV-1a hash of the label
+
+   17.10.26 Original    By: ACRM
+*/
+static unsigned long HashLabel(char *label, int length)
+{
+   unsigned long hash = 2166136261UL;
+   int           i;
+
+   for(i=0; i<length; i++)
+   {
+      hash ^= (unsigned char)label[i];
+      hash *= 16777619UL;
+   }
+
+   return(hash);
+}
+
+/************************************************************************/
+/*>static int GrowHashTable(LABELTABLE *lt)
+   ----------------------------------------
+   I/O:     LABELTABLE *lt   Label table
+   Returns: int              Success?
+
+   Doubles the size of the hash table and reinserts the labels using the
+   stored hash values
+
+   17.10.26 Original    By: ACRM
+*/
+static int GrowHashTable(LABELTABLE *lt)
+{
+   int *table,
+       tableSize = 2 * lt->tableSize,
+       id, slot;
+
+   if((table = (int *)calloc(tableSize, sizeof(int))) == NULL)
+      return(0);
+
+   for(id=0; id<lt->nLabels; id++)
+   {
+      slot = (int)(lt->hash[id] & (unsigned long)(tableSize - 1));
+      while(table[slot])
+         slot = (slot + 1) & (tableSize - 1);
+      table[slot] = id + 1;
+   }
+
+   free(lt->table);
+   lt->table     = table;
+   lt->tableSize = tableSize;
+
+   return(1);
+}
@@ -0,0 +1,77 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       labels.h
+
+   Version:    V1.4
+   Date:       17.10.26
+   Function:   Include file for label interning
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added ClearLabelTable()
+   V1.2  17.10.26 Added MapLabelTable()
+   V1.3  17.10.26 Added UnmapLabelTable()
+   V1.4  17.10.26 Counts lookups and hash probes
+
+*************************************************************************/
+#ifndef _LABELS_H
+#define _LABELS_H
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   char          *arena;       /* Label text, each NUL terminated       */
+   int           *offset,      /* Offset of each label in the arena     */
+                 *table;       /* Hash table of (label id + 1), 0=empty */
+   unsigned long *hash;        /* Hash value of each label              */
+   unsigned long nLookups,     /* Calls to InternLabel()                */
+                 nProbes;      /* Hash slots looked at by them          */
+   int           nLabels,      /* Number of labels (next id)            */
+                 maxLabels,    /* Allocated size of offset/hash         */
+                 arenaUsed,    /* Bytes used in the arena               */
+                 arenaSize,    /* Allocated size of the arena           */
+                 tableSize,    /* Hash table size (a power of 2)        */
+                 external;     /* Text belongs to the caller            */
+}  LABELTABLE;
+
+/************************************************************************/
+/* Macros
+*/
+#define LABELTEXT(lt, id) ((lt)->arena + (lt)->offset[(id)])
+
+/************************************************************************/
+/* Prototypes
+*/
+LABELTABLE *CreateLabelTable(void);
+void FreeLabelTable(LABELTABLE *lt);
+void ClearLabelTable(LABELTABLE *lt);
+int  InternLabel(LABELTABLE *lt, char *label, int length);
+LABELTABLE *MapLabelTable(char *arena, int arenaUsed, int *offset,
+                          int nLabels);
+int  UnmapLabelTable(LABELTABLE *lt);
+
+#endif
@@ -0,0 +1,398 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       lineread.c
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Input line reader and tokenizer
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   Reads the input one line at a time. A regular file is mapped into
+   memory so each line is returned as a pointer into the mapping and
+   nothing is copied. Pipes and terminals cannot be mapped so they are
+   read with fgets() into a buffer that grows to fit the longest line.
+   Text that is already in memory can be read the same way.
+
+   Lines are not NUL terminated. The tokenizer returns each
+   whitespace-separated token as a pointer and a length, and counts are
+   converted without going through scanf(). A count that does not fit
+   in an int is refused rather than wrapping.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added MappedText()
+   V1.2  17.10.26 ParseCount() refuses values too large for an int.
+                  Added ParseRealCount()
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "lineread.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define INITLINE  256
+#define MAXNUMBER  64                  /* Longest number ParseReal() reads*/
+
+/************************************************************************/
+/*>LINEREADER *OpenLineReader(FILE *fp)
+   ------------------------------------
+   Input:   FILE   *fp       File to read (from its current position)
+   Returns: LINEREADER *     Reader (NULL if no memory)
+
+   Maps the file if it is a regular file. Otherwise, or if the mapping
+   fails, lines are read from fp with fgets().
+
+   17.10.26 Original    By: ACRM
+*/
+LINEREADER *OpenLineReader(FILE *fp)
+{
+   LINEREADER  *lr;
+   struct stat st;
+   long        offset;
+   void        *map;
+
+   if((lr = (LINEREADER *)calloc(1, sizeof(LINEREADER))) == NULL)
+      return(NULL);
+
+   if((fstat(fileno(fp), &st) == 0) && S_ISREG(st.st_mode) &&
+      (st.st_size > 0) && ((off_t)(size_t)st.st_size == st.st_size) &&
+      ((offset = ftell(fp)) >= 0) && (offset <= st.st_size))
+   {
+      map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                 fileno(fp), 0);
+      if(map != MAP_FAILED)
+      {
+#ifdef MADV_SEQUENTIAL
+         madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+         lr->map     = (char *)map;
+         lr->mapSize = (size_t)st.st_size;
+         lr->next    = lr->map + offset;
+         lr->end     = lr->map + lr->mapSize;
+         return(lr);
+      }
+   }
+
+   lr->fp = fp;
+   return(lr);
+}
+
+/************************************************************************/
+/*>LINEREADER *OpenTextReader(char *text, size_t length)
+   -----------------------------------------------------
+   Input:   char   *text     Text to read (kept by reference)
+            size_t length    Length of the text
+   Returns: LINEREADER *     Reader (NULL if no memory)
+
+   Reads lines from text already in memory
+
+   17.10.26 Original    By: ACRM
+*/
+LINEREADER *OpenTextReader(char *text, size_t length)
+{
+   LINEREADER *lr;
+
+   if((lr = (LINEREADER *)calloc(1, sizeof(LINEREADER))) == NULL)
+      return(NULL);
+
+   lr->next = text;
+   lr->end  = text + length;
+   return(lr);
+}
+
+/************************************************************************/
+/*>void CloseLineReader(LINEREADER *lr)
+   ------------------------------------
+   I/O:     LINEREADER *lr   Reader to close
+
+   Frees the reader and unmaps the file. The FILE is not closed.
+
+   17.10.26 Original    By: ACRM
+*/
+void CloseLineReader(LINEREADER *lr)
+{
+   if(lr != NULL)
+   {
+      if(lr->map != NULL)
+         munmap(lr->map, lr->mapSize);
+      if(lr->buffer != NULL)
+         free(lr->buffer);
+      free(lr);
+   }
+}
+
+/************************************************************************/
+/*>char *ReadLine(LINEREADER *lr, size_t *length)
+   ----------------------------------------------
+   I/O:     LINEREADER *lr   Reader
+   Output:  size_t *length   Length of the line including the newline
+                             (if any)
+   Returns: char *           Start of the line (NULL at the end of the
+                             input or if out of memory, when lr->error
+                             is set)
+
+   Returns the next line. The line is not NUL terminated. When reading
+   with fgets() it is only valid until the next call.
+
+   17.10.26 Original    By: ACRM
+*/
+char *ReadLine(LINEREADER *lr, size_t *length)
+{
+   char   *line, *newline, *buffer;
+   size_t used;
+
+   if(lr->fp == NULL)
+   {
+      if(lr->next >= lr->end)
+         return(NULL);
+      line    = lr->next;
+      newline = (char *)memchr(line, '\n', lr->end - line);
+      lr->next = ((newline != NULL) ? newline + 1 : lr->end);
+      *length  = lr->next - line;
+      return(line);
+   }
+
+   /* Read with fgets(), growing the buffer until the line fits         */
+   used = 0;
+   for(;;)
+   {
+      if(lr->bufferSize - used < 2)
+      {
+         size_t size = (lr->bufferSize ? 2 * lr->bufferSize : INITLINE);
+         if((buffer = (char *)realloc(lr->buffer, size)) == NULL)
+         {
+            lr->error = 1;
+            return(NULL);
+         }
+         lr->buffer     = buffer;
+         lr->bufferSize = size;
+      }
+
+      if(!fgets(lr->buffer + used, (int)(lr->bufferSize - used), lr->fp))
+         break;
+      used += strlen(lr->buffer + used);
+      if((used > 0) && (lr->buffer[used-1] == '\n'))
+         break;
+   }
+
+   if(used == 0)
+      return(NULL);
+   *length = used;
+   return(lr->buffer);
+}
+
+/************************************************************************/
+/*>char *MappedText(LINEREADER *lr, size_t *size)
+   ----------------------------------------------
+   Input:   LINEREADER *lr   Reader
+   Output:  size_t *size     Bytes left to read
+   Returns: char *           The unread part of a mapped file (NULL if
+                             the file is not mapped)
+
+   Gives direct access to a mapped file so that it can be checked for,
+   and used as, a binary table file
+
+   17.10.26 Original    By: ACRM
+*/
+char *MappedText(LINEREADER *lr, size_t *size)
+{
+   if(lr->map == NULL)
+      return(NULL);
+   *size = lr->end - lr->next;
+   return(lr->next);
+}
+
+/************************************************************************/
+/*>char *NextToken(char **pos, char *end, size_t *length)
+   ------------------------------------------------------
+   I/O:     char   **pos     Where to start looking. Updated to just
+                             after the token
+   Input:   char   *end      End of the line
+   Output:  size_t *length   Length of the token
+   Returns: char *           Start of the token (NULL if none left)
+
+   Finds the next whitespace-separated token in a line
+
+   17.10.26 Original    By: ACRM
+*/
+char *NextToken(char **pos, char *end, size_t *length)
+{
+   char *chp   = *pos,
+        *token;
+
+   while((chp < end) && isspace((unsigned char)*chp))
+      chp++;
+   if(chp >= end)
+   {
+      *pos = end;
+      return(NULL);
+   }
+
+   token = chp;
+   while((chp < end) && !isspace((unsigned char)*chp))
+      chp++;
+
+   *length = chp - token;
+   *pos    = chp;
+   return(token);
+}
+
+/************************************************************************/
+/*>int ParseCount(char *token, size_t length, int *count)
+   ------------------------------------------------------
+   Input:   char   *token    Token (need not be terminated)
+            size_t length    Length of the token
+   Output:  int    *count    Value of the integer at the start of the
+                             token (0 if there is none)
+   Returns: int              Success? (0 if the value does not fit in
+                             an int)
+
+   Fast replacement for sscanf("%d")
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Values too large for an int are refused rather than wrapping
+*/
+int ParseCount(char *token, size_t length, int *count)
+{
+   size_t i        = 0;
+   int    value    = 0,
+          negative = 0,
+          digit;
+
+   if((length > 0) && ((token[0] == '-') || (token[0] == '+')))
+   {
+      negative = (token[0] == '-');
+      i++;
+   }
+
+   for(; (i < length) && (token[i] >= '0') && (token[i] <= '9'); i++)
+   {
+      digit = token[i] - '0';
+      if(value > (INT_MAX - digit) / 10)
+         return(0);
+      value = 10 * value + digit;
+   }
+
+   *count = (negative ? -value : value);
+   return(1);
+}
+
+/************************************************************************/
+/*>int ParseRealCount(char *token, size_t length, int *count)
+   ----------------------------------------------------------
+   Input:   char   *token    Token (need not be terminated)
+            size_t length    Length of the token
+   Output:  int    *count    The number truncated to an integer (0 if
+                             there is none)
+   Returns: int              Success? (0 if it does not fit in an int)
+
+   For counts that may be written as reals, such as 20.0 or 1e3
+
+   17.10.26 Original    By: ACRM
+*/
+int ParseRealCount(char *token, size_t length, int *count)
+{
+   double value = ParseReal(token, length);
+
+   /* Also refuses a NaN                                                */
+   if(!((value > -(double)INT_MAX - 1.0) && (value < (double)INT_MAX + 1.0)))
+      return(0);
+
+   *count = (int)value;
+   return(1);
+}
+
+/************************************************************************/
+/*>double ParseReal(char *token, size_t length)
+   --------------------------------------------
+   Input:   char   *token    Token (need not be terminated)
+            size_t length    Length of the token
+   Returns: double           Value of the number at the start of the
+                             token (0 if there is none)
+
+   The token is copied so that strtod() cannot read beyond it
+
+   17.10.26 Original    By: ACRM
+*/
+double ParseReal(char *token, size_t length)
+{
+   char number[MAXNUMBER+1];
+
+   if(length > MAXNUMBER)
+      length = MAXNUMBER;
+   memcpy(number, token, length);
+   number[length] = '\0';
+
+   return(strtod(number, NULL));
+}
+
+/************************************************************************/
+/*>int CopyToken(char **string, size_t *size, const char *token,
+                 size_t length)
+   ------------------------------------------------------------
+   I/O:     char   **string  Allocated string (may be NULL)
+            size_t *size     Allocated size of the string
+   Input:   char   *token    Token to copy (need not be terminated)
+            size_t length    Length of the token
+   Returns: int              Success?
+
+   Copies a token into a NUL terminated string, growing it if needed
+
+   17.10.26 Original    By: ACRM
+*/
+int CopyToken(char **string, size_t *size, const char *token,
+              size_t length)
+{
+   char *newString;
+
+   if((*string == NULL) || (length + 1 > *size))
+   {
+      if((newString = (char *)realloc(*string, length + 1)) == NULL)
+         return(0);
+      *string = newString;
+      *size   = length + 1;
+   }
+
+   memmove(*string, token, length);
+   (*string)[length] = '\0';
+   return(1);
+}
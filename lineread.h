@@ -0,0 +1,81 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       lineread.h
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Include file for the input line reader and tokenizer
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added MappedText()
+   V1.2  17.10.26 ParseCount() refuses values too large for an int.
+                  Added ParseRealCount()
+
+*************************************************************************/
+#ifndef _LINEREAD_H
+#define _LINEREAD_H
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   FILE   *fp;           /* Stream read with fgets() (NULL if mapped)   */
+   char   *map,          /* Start of the mapped file (NULL if not)      */
+          *next,         /* Next unread byte of the text                */
+          *end,          /* End of the text (mapped or in memory)       */
+          *buffer;       /* Line buffer when reading with fgets()       */
+   size_t mapSize,       /* Size of the mapping                         */
+          bufferSize;    /* Allocated size of buffer                    */
+   int    error;         /* Ran out of memory for a line                */
+}  LINEREADER;
+
+/************************************************************************/
+/* Macros
+*/
+/* Lines from a mapped reader stay valid until it is closed and each
+   follows directly on from the one before
+*/
+#define READERMAPPED(lr) ((lr)->map != NULL)
+
+/************************************************************************/
+/* Prototypes
+*/
+LINEREADER *OpenLineReader(FILE *fp);
+LINEREADER *OpenTextReader(char *text, size_t length);
+void   CloseLineReader(LINEREADER *lr);
+char   *ReadLine(LINEREADER *lr, size_t *length);
+char   *MappedText(LINEREADER *lr, size_t *size);
+char   *NextToken(char **pos, char *end, size_t *length);
+int    ParseCount(char *token, size_t length, int *count);
+int    ParseRealCount(char *token, size_t length, int *count);
+double ParseReal(char *token, size_t length);
+int    CopyToken(char **string, size_t *size, const char *token,
+                 size_t length);
+
+#endif
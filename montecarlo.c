@@ -0,0 +1,632 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       montecarlo.c
+
+   Version:    V1.3
+   Date:       17.10.26
+   Function:   Monte Carlo p-values for contingency tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Simulated p-values for chi squared with the marginal totals fixed.
+   Random tables with the same margins as the one observed are generated
+   and the p-value is (1 + number at least as extreme) / (1 + number
+   generated), as in R's chisq.test(simulate.p.value=TRUE).
+
+   Tables are generated as Patefield (1981) does, a cell at a time. With
+   the cells before it fixed, each cell has a hypergeometric
+   distribution, which is sampled by starting at the mode and working
+   outwards. A three-way table is generated as a two-way table of the
+   first two dimensions and then by spreading each cell of that across
+   the third dimension, which gives tables with all three sets of
+   one-way totals fixed (the null model of chisq3). Only the statistic
+   is kept, so no table is stored.
+
+   Chi squared is calculated from the totals as
+      N * sum(O^2 / (R_i C_j)) - N
+   (N^2 and the three totals for a three-way table) over the rows and
+   columns with observations. The statistic for the observed table is
+   calculated the same way, so no Yates correction is applied. Only the
+   occupied cells add to the sum, so for a three-way table it is taken
+   over the cells that are stored.
+
+   Replicates are split into blocks of MCBLOCK which are run on a work
+   pool. Each replicate draws its random numbers from a counter-based
+   generator keyed by the seed and the replicate number, so the result
+   does not depend on the number of threads or the order in which the
+   blocks are run. The generator is a six round Feistel network on the
+   64-bit (replicate, counter) pair, which is a bijection, so no two
+   replicates share a stream. All workspace is allocated before the
+   replicates are run.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Fails for tables with more than INT_MAX observations
+   V1.2  17.10.26 The table's totals are int64_t
+   V1.3  17.10.26 The statistic for a three-way table is summed over its
+                  stored (occupied) cells
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+#include "contab.h"
+#include "workpool.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MCBLOCK   1000L     /* Replicates in each task                  */
+#define MCTIES    1.0e-7    /* Relative difference counted as a tie     */
+#define NROUNDS   6         /* Rounds of the Feistel network            */
+#define MASK32    0xffffffffUL
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   double        *lf,       /* Log factorials up to nObs                */
+                 *inv[3],   /* 1 / each non-zero total                  */
+                 observed;  /* Statistic for the observed table         */
+   int           *totals[3],/* Non-zero totals for each dimension       */
+                 nTotals[3],
+                 nDims,
+                 nObs,
+                 nWork,     /* Number of workspaces                     */
+                 **work;    /* Workspace for each thread                */
+   long          nReps,
+                 *nExtreme; /* Replicates as extreme in each block      */
+   unsigned long keys[NROUNDS];
+}  MONTECARLO;
+
+typedef struct
+{
+   unsigned long *keys,
+                 replicate,
+                 counter;
+}  MCRANDOM;
+
+/************************************************************************/
+/* Prototypes
+*/
+static int    RunMonteCarlo(MONTECARLO *mc, long nReps,
+                            unsigned long seed, int nThreads,
+                            double *pValue);
+static int    CollectTotals(MONTECARLO *mc, int d, int64_t *tot, int n);
+static void   FreeMonteCarlo(MONTECARLO *mc);
+static void   RunBlock(void *data, int task, int thread);
+static double RandomTable(MONTECARLO *mc, MCRANDOM *rng, int *work);
+static int    Hypergeometric(MCRANDOM *rng, double *lf, int draws,
+                             int successes, int population);
+static double Uniform(MCRANDOM *rng);
+static unsigned long Hash32(unsigned long x);
+
+/************************************************************************/
+/*>int ContabMonteCarlo(CONTAB *ct, long nReps, unsigned long seed,
+                        int nThreads, double *pValue)
+   ----------------------------------------------------------------
+   Input:   CONTAB        *ct        The table
+            long          nReps      Number of random tables
+            unsigned long seed       Random number seed
+            int           nThreads   Threads to use
+   Output:  double        *pValue    Simulated p-value
+   Returns: int                      Success?
+
+   Simulated p-value for chi squared with expecteds from the margins.
+   The same seed always gives the same p-value.
+
+   17.10.26 Original    By: ACRM
+*/
+int ContabMonteCarlo(CONTAB *ct, long nReps, unsigned long seed,
+                     int nThreads, double *pValue)
+{
+   MONTECARLO mc;
+   double     sum, rowSum;
+   int        i, j, ii, jj, o;
+
+   /* The log factorials up to nObs would not fit in memory            */
+   if(ct->nObs > INT_MAX)
+      return(0);
+
+   mc.nDims = 2;
+   mc.nObs  = (int)ct->nObs;
+   if(!CollectTotals(&mc, 0, ct->tot1, ct->nItem1) ||
+      !CollectTotals(&mc, 1, ct->tot2, ct->nItem2))
+   {
+      FreeMonteCarlo(&mc);
+      return(0);
+   }
+
+   for(i=0, ii=0, sum=0.0; i<ct->nItem1; i++)
+   {
+      if(ct->tot1[i] == 0)
+         continue;
+      for(j=0, jj=0, rowSum=0.0; j<ct->nItem2; j++)
+      {
+         if(ct->tot2[j] == 0)
+            continue;
+         o       = CONTABCELL(ct, i, j);
+         rowSum += (double)o * (double)o * mc.inv[1][jj++];
+      }
+      sum += rowSum * mc.inv[0][ii++];
+   }
+   mc.observed = (double)mc.nObs * sum - (double)mc.nObs;
+
+   return(RunMonteCarlo(&mc, nReps, seed, nThreads, pValue));
+}
+
+/************************************************************************/
+/*>int Contab3MonteCarlo(CONTAB3 *ct, long nReps, unsigned long seed,
+                         int nThreads, double *pValue)
+   -----------------------------------------------------------------
+   Input:   CONTAB3       *ct        The table
+            long          nReps      Number of random tables
+            unsigned long seed       Random number seed
+            int           nThreads   Threads to use
+   Output:  double        *pValue    Simulated p-value
+   Returns: int                      Success?
+
+   Simulated p-value for three-way chi squared with all three sets of
+   totals fixed
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The observed statistic is summed over the stored cells
+*/
+int Contab3MonteCarlo(CONTAB3 *ct, long nReps, unsigned long seed,
+                      int nThreads, double *pValue)
+{
+   MONTECARLO mc;
+   double     sum, nObs, o;
+   int        c, d;
+
+   if(ct->nObs > INT_MAX)
+      return(0);
+
+   mc.nDims = 3;
+   mc.nObs  = (int)ct->nObs;
+   for(d=0; d<3; d++)
+   {
+      if(!CollectTotals(&mc, d, ct->tot[d], ct->nItems[d]))
+      {
+         FreeMonteCarlo(&mc);
+         return(0);
+      }
+   }
+
+   /* A cell with a count has three non-zero totals                    */
+   for(c=0, sum=0.0; c<ct->nCells; c++)
+   {
+      if(ct->counts[c] == 0)
+         continue;
+      o    = (double)ct->counts[c];
+      sum += o * o / ((double)ct->tot[0][CONTAB3POS(ct, c, 0)] *
+                      (double)ct->tot[1][CONTAB3POS(ct, c, 1)] *
+                      (double)ct->tot[2][CONTAB3POS(ct, c, 2)]);
+   }
+   nObs        = (double)mc.nObs;
+   mc.observed = nObs * nObs * sum - nObs;
+
+   return(RunMonteCarlo(&mc, nReps, seed, nThreads, pValue));
+}
+
+/************************************************************************/
+/*>static int RunMonteCarlo(MONTECARLO *mc, long nReps,
+                            unsigned long seed, int nThreads,
+                            double *pValue)
+   ----------------------------------------------------------
+   I/O:     MONTECARLO    *mc        Totals and observed statistic
+   Input:   long          nReps      Number of random tables
+            unsigned long seed       Random number seed
+            int           nThreads   Threads to use
+   Output:  double        *pValue    Simulated p-value
+   Returns: int                      Success?
+
+   Allocates the workspace, runs the replicates and frees the
+   MONTECARLO
+
+   17.10.26 Original    By: ACRM
+*/
+static int RunMonteCarlo(MONTECARLO *mc, long nReps, unsigned long seed,
+                         int nThreads, double *pValue)
+{
+   long nBlocks = (nReps + MCBLOCK - 1) / MCBLOCK,
+        nExtreme;
+   int  i, ok = 1;
+
+   *pValue      = 1.0;
+   mc->nReps    = nReps;
+   mc->nExtreme = (long *)calloc(nBlocks ? nBlocks : 1, sizeof(long));
+   mc->lf       = (double *)malloc((mc->nObs + 1) * sizeof(double));
+
+   if(nThreads > nBlocks)
+      nThreads = (int)nBlocks;
+   if(nThreads < 1)
+      nThreads = 1;
+   if((mc->work = (int **)calloc(nThreads, sizeof(int *))) != NULL)
+   {
+      mc->nWork = nThreads;
+      for(i=0; i<nThreads; i++)
+      {
+         if((mc->work[i] = (int *)malloc((mc->nTotals[1] + mc->nTotals[2])
+                                         * sizeof(int))) == NULL)
+            ok = 0;
+      }
+   }
+
+   if(!ok || (mc->nExtreme == NULL) || (mc->lf == NULL) ||
+      (mc->work == NULL))
+   {
+      FreeMonteCarlo(mc);
+      return(0);
+   }
+
+   mc->lf[0] = 0.0;
+   for(i=1; i<=mc->nObs; i++)
+      mc->lf[i] = mc->lf[i-1] + log((double)i);
+
+   mc->keys[0] = Hash32(seed);
+   for(i=1; i<NROUNDS; i++)
+      mc->keys[i] = Hash32(mc->keys[i-1] + 0x9e3779b9UL);
+
+   /* Tables with fewer than two non-empty rows or columns have only one
+      arrangement
+   */
+   if((mc->nTotals[0] > 1) && (mc->nTotals[1] > 1) &&
+      ((mc->nDims == 2) || (mc->nTotals[2] > 1)))
+   {
+      if(!RunWorkPool(nThreads, (int)nBlocks, RunBlock, (void *)mc))
+      {
+         FreeMonteCarlo(mc);
+         return(0);
+      }
+      for(i=0, nExtreme=0; i<nBlocks; i++)
+         nExtreme += mc->nExtreme[i];
+      *pValue = (1.0 + (double)nExtreme) / (1.0 + (double)nReps);
+   }
+
+   FreeMonteCarlo(mc);
+   return(1);
+}
+
+/************************************************************************/
+/*>static int CollectTotals(MONTECARLO *mc, int d, int64_t *tot, int n)
+   --------------------------------------------------------------------
+   I/O:     MONTECARLO *mc     Totals are stored here
+   Input:   int        d       Dimension
+            int64_t    *tot    Totals for that dimension
+            int        n       Number of totals
+   Returns: int                Success?
+
+   Keeps the non-zero totals for a dimension and their reciprocals. The
+   pointers for all dimensions are cleared the first time, so the
+   MONTECARLO may be freed after a failure. The grand total has been
+   checked to fit in an int so every total does.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The totals are int64_t
+*/
+static int CollectTotals(MONTECARLO *mc, int d, int64_t *tot, int n)
+{
+   int i;
+
+   if(d == 0)
+   {
+      for(i=0; i<3; i++)
+      {
+         mc->totals[i]  = NULL;
+         mc->inv[i]     = NULL;
+         mc->nTotals[i] = 0;
+      }
+      mc->lf       = NULL;
+      mc->nExtreme = NULL;
+      mc->work     = NULL;
+      mc->nWork    = 0;
+   }
+
+   if(((mc->totals[d] = (int *)malloc((n ? n : 1) * sizeof(int)))
+       == NULL) ||
+      ((mc->inv[d] = (double *)malloc((n ? n : 1) * sizeof(double)))
+       == NULL))
+      return(0);
+
+   for(i=0; i<n; i++)
+   {
+      if(tot[i])
+      {
+         mc->totals[d][mc->nTotals[d]] = (int)tot[i];
+         mc->inv[d][mc->nTotals[d]++]  = 1.0 / (double)tot[i];
+      }
+   }
+   return(1);
+}
+
+/************************************************************************/
+/*>static void FreeMonteCarlo(MONTECARLO *mc)
+   ------------------------------------------
+   I/O:     MONTECARLO *mc     Arrays to free
+
+   17.10.26 Original    By: ACRM
+*/
+static void FreeMonteCarlo(MONTECARLO *mc)
+{
+   int i;
+
+   for(i=0; i<mc->nDims; i++)
+   {
+      if(mc->totals[i] != NULL) free(mc->totals[i]);
+      if(mc->inv[i]    != NULL) free(mc->inv[i]);
+   }
+   if(mc->work != NULL)
+   {
+      for(i=0; i<mc->nWork; i++)
+      {
+         if(mc->work[i] != NULL)
+            free(mc->work[i]);
+      }
+      free(mc->work);
+   }
+   if(mc->lf       != NULL) free(mc->lf);
+   if(mc->nExtreme != NULL) free(mc->nExtreme);
+}
+
+/************************************************************************/
+/*>static void RunBlock(void *data, int task, int thread)
+   ------------------------------------------------------
+   Input:   void   *data     The MONTECARLO
+            int    task      Block of replicates to run
+            int    thread    Thread running it (selects the workspace)
+
+   Runs replicates task*MCBLOCK onwards and counts those at least as
+   extreme as the table observed
+
+   17.10.26 Original    By: ACRM
+*/
+static void RunBlock(void *data, int task, int thread)
+{
+   MONTECARLO *mc = (MONTECARLO *)data;
+   MCRANDOM   rng;
+   double     cutoff = mc->observed * (1.0 - MCTIES);
+   long       first  = (long)task * MCBLOCK,
+              last   = first + MCBLOCK,
+              count  = 0,
+              r;
+
+   if(last > mc->nReps)
+      last = mc->nReps;
+
+   rng.keys = mc->keys;
+   for(r=first; r<last; r++)
+   {
+      rng.replicate = (unsigned long)r;
+      rng.counter   = 0;
+      if(RandomTable(mc, &rng, mc->work[thread]) >= cutoff)
+         count++;
+   }
+   mc->nExtreme[task] = count;
+}
+
+/************************************************************************/
+/*>static double RandomTable(MONTECARLO *mc, MCRANDOM *rng, int *work)
+   -------------------------------------------------------------------
+   Input:   MONTECARLO *mc     Totals
+            MCRANDOM   *rng    Random numbers for this replicate
+            int        *work   Space for the column and plane totals
+   Returns: double             Chi squared for a random table
+
+   Generates a random table with the observed totals a cell at a time
+   and returns its chi squared. For a three-way table, each cell of the
+   first two dimensions is spread across the third as soon as it is
+   generated.
+
+   17.10.26 Original    By: ACRM
+*/
+static double RandomTable(MONTECARLO *mc, MCRANDOM *rng, int *work)
+{
+   int    *colLeft   = work,
+          *planeLeft = work + mc->nTotals[1],
+          i, j, k, x, y,
+          left, planesLeft,
+          rowLeft, pop, cellLeft, planePop;
+   double sum = 0.0,
+          rowSum, cellSum,
+          nObs = (double)mc->nObs;
+
+   for(j=0; j<mc->nTotals[1]; j++)
+      colLeft[j] = mc->totals[1][j];
+   for(k=0; k<mc->nTotals[2]; k++)
+      planeLeft[k] = mc->totals[2][k];
+   left = planesLeft = mc->nObs;
+
+   for(i=0; i<mc->nTotals[0]; i++)
+   {
+      rowLeft = mc->totals[0][i];
+      pop     = left;
+      left   -= rowLeft;
+      rowSum  = 0.0;
+
+      for(j=0; rowLeft && (j<mc->nTotals[1]); j++)
+      {
+         x           = Hypergeometric(rng, mc->lf, rowLeft, colLeft[j],
+                                      pop);
+         pop        -= colLeft[j];
+         colLeft[j] -= x;
+         rowLeft    -= x;
+
+         if(mc->nDims == 2)
+         {
+            rowSum += (double)x * (double)x * mc->inv[1][j];
+         }
+         else if(x)
+         {
+            /* Spread the cell across the planes                        */
+            cellLeft    = x;
+            planePop    = planesLeft;
+            planesLeft -= x;
+            cellSum     = 0.0;
+            for(k=0; cellLeft && (k<mc->nTotals[2]); k++)
+            {
+               y             = Hypergeometric(rng, mc->lf, cellLeft,
+                                              planeLeft[k], planePop);
+               planePop     -= planeLeft[k];
+               planeLeft[k] -= y;
+               cellLeft     -= y;
+               cellSum      += (double)y * (double)y * mc->inv[2][k];
+            }
+            rowSum += cellSum * mc->inv[1][j];
+         }
+      }
+      sum += rowSum * mc->inv[0][i];
+   }
+
+   if(mc->nDims == 2)
+      return(nObs * sum - nObs);
+   return(nObs * nObs * sum - nObs);
+}
+
+/************************************************************************/
+/*>static int Hypergeometric(MCRANDOM *rng, double *lf, int draws,
+                             int successes, int population)
+   ---------------------------------------------------------------
+   Input:   MCRANDOM *rng         Random numbers
+            double   *lf          Log factorials
+            int      draws        Number drawn
+            int      successes    Successes in the population
+            int      population   Size of the population
+   Returns: int                   Number of successes drawn
+
+   Samples a hypergeometric distribution by inversion, starting at the
+   mode and taking values alternately above and below it, so the number
+   of steps is of the order of the standard deviation
+
+   17.10.26 Original    By: ACRM
+*/
+static int Hypergeometric(MCRANDOM *rng, double *lf, int draws,
+                          int successes, int population)
+{
+   int    failures = population - successes,
+          lo, hi, mode, up, down;
+   double u, pUp, pDown;
+
+   lo = ((draws > failures)  ? (draws - failures) : 0);
+   hi = ((draws < successes) ? draws : successes);
+   if(lo == hi)
+      return(lo);
+
+   mode = (int)(((double)draws + 1.0) * ((double)successes + 1.0) /
+                ((double)population + 2.0));
+   if(mode < lo) mode = lo;
+   if(mode > hi) mode = hi;
+
+   pUp = exp(lf[successes] - lf[mode] - lf[successes - mode] +
+             lf[failures]  - lf[draws - mode] -
+             lf[failures - draws + mode] -
+             lf[population] + lf[draws] + lf[population - draws]);
+   pDown = pUp;
+
+   if((u = Uniform(rng) - pUp) <= 0.0)
+      return(mode);
+
+   for(up=down=mode; (up < hi) || (down > lo); )
+   {
+      if(up < hi)
+      {
+         pUp *= ((double)(successes - up) * (double)(draws - up)) /
+                ((double)(up + 1) * (double)(failures - draws + up + 1));
+         up++;
+         if((u -= pUp) <= 0.0)
+            return(up);
+      }
+      if(down > lo)
+      {
+         pDown *= ((double)down * (double)(failures - draws + down)) /
+                  ((double)(successes - down + 1) *
+                   (double)(draws - down + 1));
+         down--;
+         if((u -= pDown) <= 0.0)
+            return(down);
+      }
+   }
+
+   /* Only reached through rounding                                     */
+   return(mode);
+}
+
+/************************************************************************/
+/*>static double Uniform(MCRANDOM *rng)
+   ------------------------------------
+   I/O:     MCRANDOM *rng     Random numbers for a replicate
+   Returns: double            Uniform random number in (0,1)
+
+   The next random number for a replicate. The replicate number and a
+   counter are put through a keyed Feistel network and the 64 bits out
+   give a number with 53 bits of precision.
+
+   17.10.26 Original    By: ACRM
+*/
+static double Uniform(MCRANDOM *rng)
+{
+   unsigned long left  = rng->replicate & MASK32,
+                 right = rng->counter++ & MASK32,
+                 swap;
+   int           i;
+
+   for(i=0; i<NROUNDS; i++)
+   {
+      swap  = right;
+      right = left ^ Hash32(right ^ rng->keys[i]);
+      left  = swap;
+   }
+
+   return(((double)(left >> 5) * 67108864.0 + (double)(right >> 6) + 0.5)
+          / 9007199254740992.0);
+}
+
+/************************************************************************/
+/*>static unsigned long Hash32(unsigned long x)
+   --------------------------------------------
+   Input:   unsigned long x   Value (only the low 32 bits are used)
+   Returns: unsigned long     Well mixed 32-bit value
+
+   A 32-bit integer hash (lowbias32). It is written so that it gives
+   the same answer whether or not longs are wider than 32 bits.
+
+   17.10.26 Original    By: ACRM
+*/
+static unsigned long Hash32(unsigned long x)
+{
+   x &= MASK32;
+   x ^= x >> 16;
+   x  = (x * 0x7feb352dUL) & MASK32;
+   x ^= x >> 15;
+   x  = (x * 0x846ca68bUL) & MASK32;
+   x ^= x >> 16;
+   return(x);
+}
@@ -0,0 +1,319 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       outbuf.c
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Buffered output writer with fast number formatting
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   Output of one line per cell (-d on a large table) is dominated by the
+   cost of a formatted stdio call for each number. Text is instead
+   collected in a large buffer which is written with a single fwrite()
+   when it fills, and integers and fixed-point reals are converted by
+   hand.
+
+   OutBufInt() gives the same text as printf("%*ld") and OutBufReal() the
+   same as printf("%*.*f"). A real is scaled to an integer number of
+   units in the last decimal place and rounded. When the value is very
+   large, not finite, or so close to half way between two units that the
+   rounding might differ from printf(), it is left to sprintf().
+
+   The buffer may be reused by changing fp after it has been flushed.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "outbuf.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define MAXWIDTH     64                /* Widest field that is padded   */
+#define MAXNUMTEXT   400               /* Longest "%f" of a double with
+                                          MAXDECIMALS                   */
+#define TIEWINDOW    1.0e-3            /* Fractions this close to 0.5 go
+                                          to sprintf()                  */
+#if ULONG_MAX > 4294967295UL
+#  define MAXFAST    1.0e12            /* Largest scaled value done here*/
+#else
+#  define MAXFAST    4.0e9
+#endif
+
+/************************************************************************/
+/*>OUTBUF *CreateOutBuf(FILE *fp, size_t size)
+   -------------------------------------------
+   Input:   FILE   *fp       Where the text is to be written
+            size_t size      Size of the buffer (0 for OUTBUFSIZE)
+   Returns: OUTBUF *         Writer (NULL if no memory)
+
+   17.10.26 Original    By: ACRM
+*/
+OUTBUF *CreateOutBuf(FILE *fp, size_t size)
+{
+   OUTBUF *ob;
+
+   if(size == 0)
+      size = OUTBUFSIZE;
+
+   if((ob = (OUTBUF *)malloc(sizeof(OUTBUF))) == NULL)
+      return(NULL);
+   if((ob->buffer = (char *)malloc(size)) == NULL)
+   {
+      free(ob);
+      return(NULL);
+   }
+
+   ob->fp    = fp;
+   ob->size  = size;
+   ob->used  = 0;
+   ob->error = 0;
+   return(ob);
+}
+
+/************************************************************************/
+/*>int FreeOutBuf(OUTBUF *ob)
+   --------------------------
+   I/O:     OUTBUF *ob       Writer to free
+   Returns: int              1 if everything was written, otherwise 0
+
+   Flushes and frees the writer. The FILE is not closed.
+
+   17.10.26 Original    By: ACRM
+*/
+int FreeOutBuf(OUTBUF *ob)
+{
+   int ok = 1;
+
+   if(ob != NULL)
+   {
+      ok = FlushOutBuf(ob);
+      free(ob->buffer);
+      free(ob);
+   }
+   return(ok);
+}
+
+/************************************************************************/
+/*>int FlushOutBuf(OUTBUF *ob)
+   ---------------------------
+   I/O:     OUTBUF *ob       Writer
+   Returns: int              1 if everything so far was written,
+                             otherwise 0
+
+   Writes the buffer to ob->fp. Errors are remembered so they need only
+   be checked at the end.
+
+   17.10.26 Original    By: ACRM
+*/
+int FlushOutBuf(OUTBUF *ob)
+{
+   if(ob->used)
+   {
+      if(fwrite(ob->buffer, 1, ob->used, ob->fp) != ob->used)
+         ob->error = 1;
+      ob->used = 0;
+   }
+   return(!ob->error);
+}
+
+/************************************************************************/
+/*>void OutBufChar(OUTBUF *ob, int c)
+   ----------------------------------
+   I/O:     OUTBUF *ob       Writer
+   Input:   int    c         Character to write
+
+   17.10.26 Original    By: ACRM
+*/
+void OutBufChar(OUTBUF *ob, int c)
+{
+   if(ob->used == ob->size)
+      FlushOutBuf(ob);
+   ob->buffer[ob->used++] = (char)c;
+}
+
+/************************************************************************/
+/*>void OutBufText(OUTBUF *ob, const char *text, size_t length)
+   ------------------------------------------------------------
+   I/O:     OUTBUF *ob       Writer
+   Input:   char   *text     Text to write (need not be NUL terminated)
+            size_t length    Its length
+
+   Text too long for the buffer is written directly
+
+   17.10.26 Original    By: ACRM
+*/
+void OutBufText(OUTBUF *ob, const char *text, size_t length)
+{
+   if(length > ob->size - ob->used)
+   {
+      FlushOutBuf(ob);
+      if(length >= ob->size)
+      {
+         if(fwrite(text, 1, length, ob->fp) != length)
+            ob->error = 1;
+         return;
+      }
+   }
+
+   memcpy(ob->buffer + ob->used, text, length);
+   ob->used += length;
+}
+
+/************************************************************************/
+/*>void OutBufString(OUTBUF *ob, const char *string)
+   -------------------------------------------------
+   I/O:     OUTBUF *ob       Writer
+   Input:   char   *string   NUL terminated string to write
+
+   17.10.26 Original    By: ACRM
+*/
+void OutBufString(OUTBUF *ob, const char *string)
+{
+   OutBufText(ob, string, strlen(string));
+}
+
+/************************************************************************/
+/*>void OutBufInt(OUTBUF *ob, long value, int width)
+   -------------------------------------------------
+   I/O:     OUTBUF *ob       Writer
+   Input:   long   value     Number to write
+            int    width     Field width (right justified as "%*ld")
+
+   17.10.26 Original    By: ACRM
+*/
+void OutBufInt(OUTBUF *ob, long value, int width)
+{
+   char          text[MAXWIDTH + 24],
+                 *p = text + sizeof(text);
+   unsigned long n;
+   int           length;
+
+   /* Negated as unsigned so LONG_MIN is safe                          */
+   n = (value < 0) ? (0UL - (unsigned long)value) : (unsigned long)value;
+   do
+   {
+      *(--p) = (char)('0' + (int)(n % 10));
+      n /= 10;
+   }  while(n);
+   if(value < 0)
+      *(--p) = '-';
+
+   length = (int)((text + sizeof(text)) - p);
+   if(width > MAXWIDTH)
+      width = MAXWIDTH;
+   for(; length < width; length++)
+      *(--p) = ' ';
+
+   OutBufText(ob, p, (size_t)length);
+}
+
+/************************************************************************/
+/*>void OutBufReal(OUTBUF *ob, double value, int width, int decimals)
+   ------------------------------------------------------------------
+   I/O:     OUTBUF *ob       Writer
+   Input:   double value     Number to write
+            int    width     Field width (right justified)
+            int    decimals  Decimal places (at most MAXDECIMALS)
+
+   Writes value as printf("%*.*f") would
+
+   17.10.26 Original    By: ACRM
+*/
+void OutBufReal(OUTBUF *ob, double value, int width, int decimals)
+{
+   static const double scale[MAXDECIMALS+1] =
+      {1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8,
+       1.0e9};
+   char          text[MAXNUMTEXT],
+                 *p = text + sizeof(text);
+   double        scaled, whole, fraction;
+   unsigned long n;
+   int           negative, length, i;
+
+   if(decimals < 0)
+      decimals = 0;
+   if(decimals > MAXDECIMALS)
+      decimals = MAXDECIMALS;
+   if(width > MAXWIDTH)
+      width = MAXWIDTH;
+
+   /* printf() gives -0.0 as negative                                  */
+   negative = (value < 0.0) || ((value == 0.0) && ((1.0 / value) < 0.0));
+   scaled   = (negative ? -value : value) * scale[decimals];
+
+   /* Written as !(x < y) so NaN also goes to sprintf()                 */
+   if(!(scaled < MAXFAST))
+   {
+      OutBufText(ob, text, (size_t)sprintf(text, "%*.*f", width,
+                                           decimals, value));
+      return;
+   }
+
+   whole    = floor(scaled);
+   fraction = scaled - whole;
+   if(fabs(fraction - 0.5) < TIEWINDOW)
+   {
+      OutBufText(ob, text, (size_t)sprintf(text, "%*.*f", width,
+                                           decimals, value));
+      return;
+   }
+
+   n = (unsigned long)whole + ((fraction > 0.5) ? 1 : 0);
+   for(i=0; i<decimals; i++)
+   {
+      *(--p) = (char)('0' + (int)(n % 10));
+      n /= 10;
+   }
+   if(decimals)
+      *(--p) = '.';
+   do
+   {
+      *(--p) = (char)('0' + (int)(n % 10));
+      n /= 10;
+   }  while(n);
+   if(negative)
+      *(--p) = '-';
+
+   length = (int)((text + sizeof(text)) - p);
+   for(; length < width; length++)
+      *(--p) = ' ';
+
+   OutBufText(ob, p, (size_t)length);
+}
@@ -0,0 +1,73 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       outbuf.h
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Include file for the buffered output writer
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+#ifndef _OUTBUF_H
+#define _OUTBUF_H
+
+#include <stdio.h>
+
+/************************************************************************/
+/* Defines
+*/
+#define OUTBUFSIZE   (256 * 1024)     /* Default size of the buffer     */
+#define MAXDECIMALS  9                /* Most decimals OutBufReal() gives*/
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   FILE   *fp;           /* Where the buffer is written. May be changed
+                            between flushes                             */
+   char   *buffer;       /* Text not yet written                        */
+   size_t size,          /* Allocated size of buffer                    */
+          used;          /* Bytes of buffer in use                      */
+   int    error;         /* A write has failed                          */
+}  OUTBUF;
+
+/************************************************************************/
+/* Prototypes
+*/
+OUTBUF *CreateOutBuf(FILE *fp, size_t size);
+int  FreeOutBuf(OUTBUF *ob);
+int  FlushOutBuf(OUTBUF *ob);
+void OutBufChar(OUTBUF *ob, int c);
+void OutBufText(OUTBUF *ob, const char *text, size_t length);
+void OutBufString(OUTBUF *ob, const char *string);
+void OutBufInt(OUTBUF *ob, long value, int width);
+void OutBufReal(OUTBUF *ob, double value, int width, int decimals);
+
+#endif
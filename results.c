@@ -0,0 +1,268 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       results.c
+
+   Version:    V1.3
+   Date:       17.10.26
+   Function:   Printing chi squared results as text, TSV or JSON
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   Prints the result of a chi squared test, with its p-value and
+   optionally the critical value at a given significance level, so the
+   programs need not be followed by chisig or chitab.
+
+   Text output is the traditional
+      ChiSq = x with n degrees of freedom
+   with the p-value and critical value appended if requested. TSV output
+   has a header line and one line per table. JSON output has one object
+   per table, one per line, so batch output can be streamed. The p-value
+   is always included in TSV and JSON output.
+
+   If an exact p-value was calculated (because the expecteds were too
+   small for the chi squared approximation) it is appended to text
+   output and given as exact_p in JSON. TSV output has an exact_p column
+   if exact tests may be done, which is NA when none was. A Monte Carlo
+   p-value is given in the same way as sim_p.
+
+   The G statistic is given with Williams' correction, q, and the
+   p-value of G/q as g, williams and g_p. In text output q is only shown
+   if it is not 1 and the p-value only if requested.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added the exact p-value
+   V1.2  17.10.26 Added the simulated p-value
+   V1.3  17.10.26 Added the G statistic
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "chiprob.h"
+#include "results.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+static void PrintJSONString(FILE *out, char *string);
+
+/************************************************************************/
+/*>int ParseOutputFormat(char *name)
+   ---------------------------------
+   Input:   char   *name     Format name (text, tsv or json)
+   Returns: int              OUTPUT_xxx format (-1 if not recognized)
+
+   17.10.26 Original    By: ACRM
+*/
+int ParseOutputFormat(char *name)
+{
+   if(!strcmp(name, "text"))
+      return(OUTPUT_TEXT);
+   if(!strcmp(name, "tsv"))
+      return(OUTPUT_TSV);
+   if(!strcmp(name, "json"))
+      return(OUTPUT_JSON);
+   return(-1);
+}
+
+/************************************************************************/
+/*>void PrintResultHeader(FILE *out, RESULTFORMAT *fmt, int named)
+   ---------------------------------------------------------------
+   Input:   FILE         *out     Output file
+            RESULTFORMAT *fmt     Output format
+            int          named    Results will have table names
+
+   Prints the column headings for TSV output. Does nothing for the
+   other formats.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added the exact_p column
+   17.10.26 Added the sim_p column
+   17.10.26 Added the g, williams and g_p columns
+*/
+void PrintResultHeader(FILE *out, RESULTFORMAT *fmt, int named)
+{
+   if(fmt->format != OUTPUT_TSV)
+      return;
+
+   if(named)
+      fprintf(out, "table\t");
+   fprintf(out, "chisq\tdof\tp");
+   if(fmt->alpha > 0.0)
+      fprintf(out, "\talpha\tcritical");
+   if(fmt->exact)
+      fprintf(out, "\texact_p");
+   if(fmt->simulated)
+      fprintf(out, "\tsim_p");
+   if(fmt->gStat)
+      fprintf(out, "\tg\twilliams\tg_p");
+   fprintf(out, "\n");
+}
+
+/************************************************************************/
+/*>void PrintResult(FILE *out, RESULTFORMAT *fmt, char *name,
+                    double chisq, int dof, double exactP, double simP,
+                    double g, double williams)
+   -----------------------------------------------------------------------
+   Input:   FILE         *out     Output file
+            RESULTFORMAT *fmt     Output format
+            char         *name    Table name (NULL if none)
+            double       chisq    Chi squared value
+            int          dof      Degrees of freedom
+            double       exactP   Exact p-value (< 0 if none)
+            double       simP     Simulated p-value (< 0 if none)
+            double       g        G statistic (< 0 if none)
+            double       williams Williams' correction for G
+
+   Prints the result for one table. The p-value for G is for G divided
+   by Williams' correction.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Added exactP
+   17.10.26 Added simP
+   17.10.26 Added g and williams
+*/
+void PrintResult(FILE *out, RESULTFORMAT *fmt, char *name, double chisq,
+                 int dof, double exactP, double simP, double g,
+                 double williams)
+{
+   double pvalue   = ChiSqProb(chisq, dof),
+          gPValue  = ((g >= 0.0) ? ChiSqProb(g / williams, dof) : 1.0),
+          critical = 0.0;
+
+   if(fmt->alpha > 0.0)
+      critical = ChiSqCritical(fmt->alpha, dof);
+
+   switch(fmt->format)
+   {
+   case OUTPUT_TSV:
+      if(name != NULL)
+         fprintf(out, "%s\t", name);
+      fprintf(out, "%.10g\t%d\t%.10g", chisq, dof, pvalue);
+      if(fmt->alpha > 0.0)
+         fprintf(out, "\t%g\t%.10g", fmt->alpha, critical);
+      if(fmt->exact)
+      {
+         if(exactP < 0.0)
+            fprintf(out, "\tNA");
+         else
+            fprintf(out, "\t%.10g", exactP);
+      }
+      if(fmt->simulated)
+      {
+         if(simP < 0.0)
+            fprintf(out, "\tNA");
+         else
+            fprintf(out, "\t%.10g", simP);
+      }
+      if(fmt->gStat)
+      {
+         if(g < 0.0)
+            fprintf(out, "\tNA\tNA\tNA");
+         else
+            fprintf(out, "\t%.10g\t%.10g\t%.10g", g, williams, gPValue);
+      }
+      fprintf(out, "\n");
+      break;
+   case OUTPUT_JSON:
+      fprintf(out, "{");
+      if(name != NULL)
+      {
+         fprintf(out, "\"table\": ");
+         PrintJSONString(out, name);
+         fprintf(out, ", ");
+      }
+      fprintf(out, "\"chisq\": %.10g, \"dof\": %d, \"p\": %.10g",
+              chisq, dof, pvalue);
+      if(fmt->alpha > 0.0)
+         fprintf(out, ", \"alpha\": %g, \"critical\": %.10g",
+                 fmt->alpha, critical);
+      if(exactP >= 0.0)
+         fprintf(out, ", \"exact_p\": %.10g", exactP);
+      if(simP >= 0.0)
+         fprintf(out, ", \"sim_p\": %.10g", simP);
+      if(g >= 0.0)
+         fprintf(out, ", \"g\": %.10g, \"williams\": %.10g, \"g_p\": %.10g",
+                 g, williams, gPValue);
+      fprintf(out, "}\n");
+      break;
+   default:
+      if(name != NULL)
+         fprintf(out, "%s: ", name);
+      fprintf(out, "ChiSq = %f with %d degrees of freedom", chisq, dof);
+      if(fmt->pValue)
+         fprintf(out, ", p = %.5g", pvalue);
+      if(fmt->alpha > 0.0)
+         fprintf(out, ", critical value at %g = %f", fmt->alpha, critical);
+      if(exactP >= 0.0)
+         fprintf(out, ", exact p = %.5g", exactP);
+      if(simP >= 0.0)
+         fprintf(out, ", simulated p = %.5g", simP);
+      if(g >= 0.0)
+      {
+         fprintf(out, "; G = %f", g);
+         if(williams != 1.0)
+            fprintf(out, ", Williams' q = %.5f", williams);
+         if(fmt->pValue)
+            fprintf(out, ", p = %.5g", gPValue);
+      }
+      fprintf(out, "\n");
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void PrintJSONString(FILE *out, char *string)
+   ----------------------------------------------------
+   Input:   FILE   *out      Output file
+            char   *string   String to print
+
+   Prints a string as a quoted JSON string, escaping as required
+
+   17.10.26 Original    By: ACRM
+*/
+static void PrintJSONString(FILE *out, char *string)
+{
+   unsigned char *ch;
+
+   fputc('"', out);
+   for(ch=(unsigned char *)string; *ch; ch++)
+   {
+      if((*ch == '"') || (*ch == '\\'))
+         fprintf(out, "\\%c", *ch);
+      else if(*ch < 0x20)
+         fprintf(out, "\\u%04x", *ch);
+      else
+         fputc(*ch, out);
+   }
+   fputc('"', out);
+}
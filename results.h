@@ -0,0 +1,72 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       results.h
+
+   Version:    V1.3
+   Date:       17.10.26
+   Function:   Include file for printing chi squared results
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Added the exact p-value
+   V1.2  17.10.26 Added the simulated p-value
+   V1.3  17.10.26 Added the G statistic
+
+*************************************************************************/
+#ifndef _RESULTS_H
+#define _RESULTS_H
+
+/************************************************************************/
+/* Defines
+*/
+#define OUTPUT_TEXT 0
+#define OUTPUT_TSV  1
+#define OUTPUT_JSON 2
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   int    format,      /* OUTPUT_TEXT, OUTPUT_TSV or OUTPUT_JSON        */
+          pValue,      /* Show the p-value in text output               */
+          exact,       /* Exact p-values may be given (TSV column)      */
+          simulated,   /* Simulated p-values are given (TSV column)     */
+          gStat;       /* G statistics are given (TSV columns)          */
+   double alpha;       /* Critical value at this level (0 = none)        */
+}  RESULTFORMAT;
+
+/************************************************************************/
+/* Prototypes
+*/
+int  ParseOutputFormat(char *name);
+void PrintResultHeader(FILE *out, RESULTFORMAT *fmt, int named);
+void PrintResult(FILE *out, RESULTFORMAT *fmt, char *name, double chisq,
+                 int dof, double exactP, double simP, double g,
+                 double williams);
+
+#endif
@@ -0,0 +1,514 @@
+/*************************************************************************
+
+   Program:    libchisq
+   File:       strata.c
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Conditional independence and Cochran-Mantel-Haenszel
+               tests for three-way tables
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   One of the three dimensions of a CONTAB3 is taken as the strata and
+   the other two, A and B, are tested within them.
+
+   The conditional independence test (A and B independent given the
+   stratum) is chi squared (and G) summed over the strata, with
+   expecteds
+      E_ijk = n_i+k n_+jk / n_++k
+   and (I_k - 1)(J_k - 1) degrees of freedom from each stratum, where
+   I_k and J_k are the items of A and B with observations in stratum k.
+   This is what running chisq on each stratum and adding up the results
+   would give.
+
+   The generalized Cochran-Mantel-Haenszel statistic (general
+   association) is
+      Q = (n - m)' V^- (n - m)
+   where n and m are the observed and expected counts summed over the
+   strata for all but the last item of A and of B that have
+   observations, and V is the sum over the strata of
+      n_k^2 / (n_k - 1) (diag(p_k) - p_k p_k') x (diag(q_k) - q_k q_k')
+   with p_k and q_k the proportions in each item of A and B in stratum
+   k. Strata with fewer than two observations add nothing. V is reduced
+   by symmetric elimination, and pivots that vanish (items whose counts
+   are determined by the others) are dropped, giving a generalized
+   inverse. The degrees of freedom are the rank of V, which is
+   normally (I-1)(J-1). V has (I-1)^2(J-1)^2 elements so the test is
+   not done if (I-1)(J-1) exceeds CMHMAXDOF.
+
+   Each stratum is a task on a work pool. The table only stores its
+   occupied cells, so these are grouped by stratum first and each
+   stratum's cells are scattered into a contiguous workspace. Its
+   margins and chi squared are then calculated with the kernel in
+   chikern.c whichever dimension is stratified. The results are kept
+   for each stratum and summed in order, and V is built a row at a time
+   on the pool, so the answers do not depend on the number of threads.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 The totals are int64_t
+   V1.2  17.10.26 The strata are filled from the table's stored cells
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "contab.h"
+#include "chikern.h"
+#include "chiprob.h"
+#include "workpool.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define CMHPIVOT  1.0e-10   /* Pivots smaller than this times the
+                               largest diagonal element are dropped     */
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   CONTAB3 *ct;
+   CHIACC  *acc;            /* Chi squared for each stratum             */
+   double  *v,              /* CMH covariance (upper triangle)          */
+           *diff;           /* CMH observed - expected                  */
+   int64_t *rowTot,         /* Totals of A in each stratum              */
+           *colTot;         /* Totals of B in each stratum              */
+   int     *dof,            /* Degrees of freedom for each stratum      */
+           **work,          /* Slice of the table for each thread       */
+           *order,          /* Cells grouped by stratum                 */
+           *start,          /* Where each stratum starts in order       */
+           *useA,           /* Items of A in the CMH test               */
+           *useB,           /* Items of B in the CMH test               */
+           a, b, given,     /* Dimensions                               */
+           nA, nB, nK,      /* Items in each                            */
+           nUseA, nUseB,
+           nWork,
+           gStat;
+}  STRATA;
+
+/************************************************************************/
+/* Prototypes
+*/
+static void RunStratum(void *data, int task, int thread);
+static void RunCMHRow(void *data, int task, int thread);
+static int  CMHStatistic(STRATA *st, int nThreads, CHIRESULT *result);
+static int  UsedItems(int64_t *tot, int n, int **use);
+static void FreeStrata(STRATA *st);
+
+/************************************************************************/
+/*>int Contab3Strata(CONTAB3 *ct, int given, int gStat, int nThreads,
+                     STRATARESULT *result)
+   ------------------------------------------------------------------
+   Input:   CONTAB3      *ct       The table
+            int          given     Dimension (0-2) used as the strata
+            int          gStat     Also calculate G
+            int          nThreads  Threads to use
+   Output:  STRATARESULT *result   Conditional independence and CMH
+                                   tests
+   Returns: int                    Success? (0 if out of memory)
+
+   Tests the other two dimensions for independence within the strata.
+   result->gotCMH is 0 if there were too many items for the CMH test.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The table's cells are grouped by stratum
+*/
+int Contab3Strata(CONTAB3 *ct, int given, int gStat, int nThreads,
+                  STRATARESULT *result)
+{
+   STRATA    st;
+   CHIRESULT *pr = &(result->partial);
+   int       i, k, ok = 1;
+
+   st.ct     = ct;
+   st.given  = given;
+   st.a      = (given == 0) ? 1 : 0;
+   st.b      = (given == 2) ? 1 : 2;
+   st.nA     = ct->nItems[st.a];
+   st.nB     = ct->nItems[st.b];
+   st.nK     = ct->nItems[given];
+   st.gStat  = gStat;
+   st.work   = NULL;
+   st.nWork  = 0;
+   st.v      = st.diff = NULL;
+   st.useA   = st.useB = NULL;
+   st.order  = st.start = NULL;
+
+   st.acc    = (CHIACC *)malloc((st.nK ? st.nK : 1) * sizeof(CHIACC));
+   st.dof    = (int *)malloc((st.nK ? st.nK : 1) * sizeof(int));
+   st.rowTot = (int64_t *)malloc(((size_t)st.nK * st.nA + 1) *
+                                 sizeof(int64_t));
+   st.colTot = (int64_t *)malloc(((size_t)st.nK * st.nB + 1) *
+                                 sizeof(int64_t));
+
+   if(nThreads > st.nK)
+      nThreads = st.nK;
+   if(nThreads < 1)
+      nThreads = 1;
+   if((st.work = (int **)calloc(nThreads, sizeof(int *))) != NULL)
+   {
+      st.nWork = nThreads;
+      for(i=0; i<nThreads; i++)
+      {
+         if((st.work[i] = (int *)malloc(((size_t)st.nA * st.nB + 1) *
+                                        sizeof(int))) == NULL)
+            ok = 0;
+      }
+   }
+
+   if(!ok || (st.acc == NULL) || (st.dof == NULL) ||
+      !Contab3GroupCells(ct, given, &st.order, &st.start) ||
+      (st.rowTot == NULL) || (st.colTot == NULL) || (st.work == NULL) ||
+      !RunWorkPool(nThreads, st.nK, RunStratum, (void *)&st))
+   {
+      FreeStrata(&st);
+      return(0);
+   }
+
+   /* Sum the strata in order                                           */
+   result->given   = given;
+   result->nStrata = 0;
+   pr->chisq       = pr->g = 0.0;
+   pr->dof         = pr->nCells = pr->nSmall = pr->nZero = 0;
+   pr->nVisited    = pr->nOccupied = 0;
+   for(k=0; k<st.nK; k++)
+   {
+      if(ct->tot[given][k])
+         result->nStrata++;
+      pr->chisq     += st.acc[k].chisq;
+      pr->g         += st.acc[k].g;
+      pr->dof       += st.dof[k];
+      pr->nCells    += st.acc[k].nCells;
+      pr->nSmall    += st.acc[k].nSmall;
+      pr->nZero     += st.acc[k].nZero;
+      pr->nVisited  += st.acc[k].nVisited;
+      pr->nOccupied += st.acc[k].nOccupied;
+   }
+   pr->nObs     = ct->nObs;
+   pr->pValue   = ChiSqProb(pr->chisq, pr->dof);
+   pr->g        = (gStat ? (2.0 * pr->g) : -1.0);
+   if(gStat && (pr->g < 0.0))      /* Rounding                          */
+      pr->g = 0.0;
+   pr->williams = 1.0;
+   pr->gPValue  = (gStat ? ChiSqProb(pr->g, pr->dof) : 1.0);
+   pr->warnings = 0;
+   if(pr->nZero)
+      pr->warnings |= CHIWARN_ZERO;
+   if(pr->nCells && ((pr->nSmall / (double)pr->nCells) > 0.25))
+      pr->warnings |= CHIWARN_SMALL;
+
+   if((ok = CMHStatistic(&st, nThreads, &(result->cmh))) == 0)
+   {
+      FreeStrata(&st);
+      return(0);
+   }
+   result->gotCMH = (ok > 0);
+
+   FreeStrata(&st);
+   return(1);
+}
+
+/************************************************************************/
+/*>static void RunStratum(void *data, int task, int thread)
+   --------------------------------------------------------
+   Input:   void   *data     The STRATA
+            int    task      Stratum
+            int    thread    Thread running it (selects the workspace)
+
+   Scatters the stratum's cells into the workspace, keeps its margins
+   and sums chi squared for it
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Filled from the stored cells
+*/
+static void RunStratum(void *data, int task, int thread)
+{
+   STRATA  *st     = (STRATA *)data;
+   CHIACC  *acc    = st->acc + task;
+   int64_t *rowTot = st->rowTot + (size_t)task * st->nA,
+           *colTot = st->colTot + (size_t)task * st->nB;
+   CONTAB3 *ct     = st->ct;
+   int     *slice  = st->work[thread],
+           *cell,
+           nRows   = 0,
+           nCols   = 0,
+           i, j, c;
+   long    total   = 0;
+
+   ClearChiAcc(acc, st->gStat);
+   st->dof[task] = 0;
+
+   memset(slice, 0, (size_t)st->nA * st->nB * sizeof(int));
+   for(c=st->start[task]; c<st->start[task+1]; c++)
+   {
+      cell = slice + (size_t)CONTAB3POS(ct, st->order[c], st->a) * st->nB;
+      cell[CONTAB3POS(ct, st->order[c], st->b)] = ct->counts[st->order[c]];
+   }
+
+   for(j=0; j<st->nB; j++)
+      colTot[j] = 0;
+   for(i=0; i<st->nA; i++)
+   {
+      cell      = slice + (size_t)i * st->nB;
+      rowTot[i] = 0;
+      for(j=0; j<st->nB; j++)
+      {
+         rowTot[i] += cell[j];
+         colTot[j] += cell[j];
+      }
+      total += rowTot[i];
+      if(rowTot[i])
+         nRows++;
+   }
+   if(total == 0)
+      return;
+
+   for(j=0; j<st->nB; j++)
+   {
+      if(colTot[j])
+         nCols++;
+   }
+   st->dof[task] = (nRows - 1) * (nCols - 1);
+
+   for(i=0; i<st->nA; i++)
+   {
+      if(rowTot[i])
+         ChiSqCellsFromMargins(slice + (size_t)i * st->nB, colTot, colTot,
+                               (double)rowTot[i], (double)total, st->nB,
+                               0, acc);
+   }
+}
+
+/************************************************************************/
+/*>static int CMHStatistic(STRATA *st, int nThreads, CHIRESULT *result)
+   --------------------------------------------------------------------
+   Input:   STRATA    *st        Margins of each stratum
+            int       nThreads   Threads to use
+   Output:  CHIRESULT *result    The CMH statistic, its degrees of
+                                 freedom and p-value
+   Returns: int                  1 on success, 0 if out of memory or -1
+                                 if there are too many items
+
+   Builds (n - m) and V on the work pool and reduces V
+
+   17.10.26 Original    By: ACRM
+*/
+static int CMHStatistic(STRATA *st, int nThreads, CHIRESULT *result)
+{
+   CONTAB3 *ct = st->ct;
+   double  *v, *row, pivot, factor, largest = 0.0, q = 0.0;
+   size_t  d, p, r, s;
+   int     rank = 0;
+
+   result->chisq    = 0.0;
+   result->pValue   = 1.0;
+   result->g        = -1.0;
+   result->williams = 1.0;
+   result->gPValue  = 1.0;
+   result->nObs     = ct->nObs;
+   result->dof      = result->nCells = result->nSmall = 0;
+   result->nZero    = result->nVisited = result->nOccupied = 0;
+   result->warnings = 0;
+
+   /* The last item of A and B with observations is left out           */
+   if(((st->nUseA = UsedItems(ct->tot[st->a], st->nA, &(st->useA))) < 0) ||
+      ((st->nUseB = UsedItems(ct->tot[st->b], st->nB, &(st->useB))) < 0))
+      return(0);
+   d = (size_t)st->nUseA * st->nUseB;
+   if(d == 0)
+      return(1);
+   if(d > CMHMAXDOF)
+      return(-1);
+
+   if(((st->v    = (double *)malloc(d * d * sizeof(double))) == NULL) ||
+      ((st->diff = (double *)malloc(d * sizeof(double))) == NULL))
+      return(0);
+
+   if(nThreads > (int)d)
+      nThreads = (int)d;
+   if(!RunWorkPool(nThreads, (int)d, RunCMHRow, (void *)st))
+      return(0);
+
+   /* Symmetric elimination on the upper triangle. Each pivot taken
+      adds diff^2 / pivot to Q and one to the rank
+   */
+   v = st->v;
+   for(p=0; p<d; p++)
+   {
+      if(v[p * d + p] > largest)
+         largest = v[p * d + p];
+   }
+   for(p=0; p<d; p++)
+   {
+      pivot = v[p * d + p];
+      if(pivot <= CMHPIVOT * largest)
+         continue;
+
+      rank++;
+      q += st->diff[p] * st->diff[p] / pivot;
+      for(r=p+1; r<d; r++)
+      {
+         if((factor = v[p * d + r] / pivot) == 0.0)
+            continue;
+         row = v + r * d;
+         for(s=r; s<d; s++)
+            row[s] -= factor * v[p * d + s];
+         st->diff[r] -= factor * st->diff[p];
+      }
+   }
+
+   result->chisq  = q;
+   result->dof    = rank;
+   result->pValue = ChiSqProb(q, rank);
+   return(1);
+}
+
+/************************************************************************/
+/*>static void RunCMHRow(void *data, int task, int thread)
+   -------------------------------------------------------
+   Input:   void   *data     The STRATA
+            int    task      Row of V
+            int    thread    Thread running it (not used)
+
+   Fills in the row of V on and above the diagonal and the element of
+   (n - m) for one pair of items (i, j), summing over the strata:
+      V(ij, i'j') = sum R_i (n d_ii' - R_i') C_j (n d_jj' - C_j')
+                        / (n^2 (n - 1))
+   where R and C are the stratum's totals of A and B and n its total
+
+   17.10.26 Original    By: ACRM
+*/
+static void RunCMHRow(void *data, int task, int thread)
+{
+   STRATA  *st  = (STRATA *)data;
+   CONTAB3 *ct  = st->ct;
+   size_t  d    = (size_t)st->nUseA * st->nUseB,
+           col0 = (size_t)task,
+           col;
+   double  *row = st->v + (size_t)task * d,
+           n, w, ri, cj, fi, diff = 0.0;
+   int64_t *rowTot, *colTot;
+   int     ia   = task / st->nUseB,
+           jb   = task % st->nUseB,
+           i    = st->useA[ia],
+           j    = st->useB[jb],
+           ii, jj, k, pos[3];
+
+   for(col=col0; col<d; col++)
+      row[col] = 0.0;
+
+   pos[st->a] = i;
+   pos[st->b] = j;
+   for(k=0; k<st->nK; k++)
+   {
+      if(ct->tot[st->given][k] < 2)
+         continue;
+
+      rowTot = st->rowTot + (size_t)k * st->nA;
+      colTot = st->colTot + (size_t)k * st->nB;
+      n      = (double)ct->tot[st->given][k];
+      ri     = (double)rowTot[i];
+      cj     = (double)colTot[j];
+      pos[st->given] = k;
+      diff  += (double)Contab3Count(ct, pos[0], pos[1], pos[2]) -
+               ri * cj / n;
+      if((ri == 0.0) || (cj == 0.0))
+         continue;
+
+      w = ri * cj / (n * n * (n - 1.0));
+      for(ii=ia, col=col0; ii<st->nUseA; ii++)
+      {
+         fi = w * (((ii == ia) ? n : 0.0) - (double)rowTot[st->useA[ii]]);
+         for(jj=((ii == ia) ? jb : 0); jj<st->nUseB; jj++, col++)
+            row[col] += fi * (((jj == jb) ? n : 0.0) -
+                              (double)colTot[st->useB[jj]]);
+      }
+   }
+   st->diff[task] = diff;
+}
+
+/************************************************************************/
+/*>static int UsedItems(int64_t *tot, int n, int **use)
+   ----------------------------------------------------
+   Input:   int64_t *tot     Totals for a dimension
+            int     n        Number of items
+   Output:  int     **use    Items with observations, but not the last
+                             of them (allocated)
+   Returns: int              Number of items in use (-1 if no memory)
+
+   17.10.26 Original    By: ACRM
+*/
+static int UsedItems(int64_t *tot, int n, int **use)
+{
+   int i, nUse = 0;
+
+   if((*use = (int *)malloc((n ? n : 1) * sizeof(int))) == NULL)
+      return(-1);
+   for(i=0; i<n; i++)
+   {
+      if(tot[i])
+         (*use)[nUse++] = i;
+   }
+   return(nUse ? (nUse - 1) : 0);
+}
+
+/************************************************************************/
+/*>static void FreeStrata(STRATA *st)
+   ----------------------------------
+   I/O:     STRATA *st       Workspace to free
+
+   17.10.26 Original    By: ACRM
+*/
+static void FreeStrata(STRATA *st)
+{
+   int i;
+
+   if(st->work != NULL)
+   {
+      for(i=0; i<st->nWork; i++)
+      {
+         if(st->work[i] != NULL)
+            free(st->work[i]);
+      }
+      free(st->work);
+   }
+   if(st->acc    != NULL) free(st->acc);
+   if(st->dof    != NULL) free(st->dof);
+   if(st->rowTot != NULL) free(st->rowTot);
+   if(st->colTot != NULL) free(st->colTot);
+   if(st->useA   != NULL) free(st->useA);
+   if(st->useB   != NULL) free(st->useB);
+   if(st->order  != NULL) free(st->order);
+   if(st->start  != NULL) free(st->start);
+   if(st->v      != NULL) free(st->v);
+   if(st->diff   != NULL) free(st->diff);
+}
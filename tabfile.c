@@ -0,0 +1,789 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       tabfile.c
+
+   Version:    V1.5
+   Date:       17.10.26
+   Function:   Binary contingency table files
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Description:
+   ============
+   A binary table file holds everything needed to analyze a table
+   without parsing any text: the label dictionaries, the counts, the
+   expected values (optional) and the marginal totals. See tabfile.h
+   for the layout.
+
+   Files are written in the native byte order with native int and double
+   sizes, which are recorded in the header. Reading a file means mapping
+   it and checking the header and section bounds. The sections are then
+   used in place, so nothing is parsed or copied.
+
+   A file may not come from WriteTableFile() (for example a request to
+   chisq --serve), so the counts are checked too before any of it is
+   used: every count must be at least zero, the counts must add up to
+   each stored marginal total and the totals for each dimension must
+   add up to the number of observations. This is a single pass over
+   the counts.
+
+   Counts are stored sparse (index, count pairs) if that is smaller than
+   the dense array.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 Counts and totals are checked when a file is opened
+   V1.2  17.10.26 The marginal totals are int64_t
+   V1.3  17.10.26 Sizes in the header are compared as uint64_t rather
+                  than truncated, and item counts and label text sizes
+                  must fit in an int
+   V1.4  17.10.26 Added WriteSparseTableFile() for tables held as a list
+                  of cells
+   V1.5  17.10.26 The cells in the whole table are only bounded by the
+                  file size where a section holds all of them, so large
+                  sparse tables can be read
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "labels.h"
+#include "tabfile.h"
+
+/************************************************************************/
+/* Defines
+*/
+#define ALIGN8(x) (((x) + 7) & ~((uint64_t)7))
+
+/************************************************************************/
+/* Prototypes
+*/
+static int InFile(uint64_t offset, uint64_t length, size_t size);
+static int CheckTotals(TABFILE *tf, const char **error);
+static int WritePadding(FILE *fp, uint64_t *pos);
+static void LayOutFile(TABHEADER *hdr, int nDims, int *n,
+                       LABELTABLE **labels, uint64_t nCells,
+                       uint64_t nNonZero, int gotExpecteds);
+static int WriteLabels(FILE *fp, uint64_t *pos, TABHEADER *hdr,
+                       int nDims, LABELTABLE **labels);
+static int WriteZeros(FILE *fp, uint64_t n, size_t size);
+static int WriteSection(FILE *fp, uint64_t *pos, void *data,
+                        size_t size);
+
+/************************************************************************/
+/*>int IsTableFile(char *data, size_t size)
+   ----------------------------------------
+   Input:   char   *data     Start of the file in memory
+            size_t size      Size of the file
+   Returns: int              Does it start like a binary table file?
+
+   17.10.26 Original    By: ACRM
+*/
+int IsTableFile(char *data, size_t size)
+{
+   return((size >= 8) && !memcmp(data, TABMAGIC, 8));
+}
+
+/************************************************************************/
+/*>int OpenTableFile(TABFILE *tf, char *data, size_t size,
+                     const char **error)
+   ------------------------------------------------------
+   Output:  TABFILE    *tf     The table file
+   Input:   char       *data   Start of the file in memory (8-byte
+                               aligned, e.g. mapped)
+            size_t     size    Size of the file
+   Output:  const char **error Reason for failure
+   Returns: int                Success?
+
+   Checks a binary table file and sets up tf to point at its sections
+
+   17.10.26 Original    By: ACRM
+   17.10.26 Checks the counts against the totals. Sparse indexes must be
+            in increasing order
+   17.10.26 Sizes are compared as uint64_t and the item counts and label
+            text sizes must fit in an int
+   17.10.26 The product of the item counts need only fit in a uint64_t.
+            It is bounded by the file size for the dense sections
+*/
+int OpenTableFile(TABFILE *tf, char *data, size_t size,
+                  const char **error)
+{
+   TABHEADER *hdr = (TABHEADER *)data;
+   uint64_t  nCells = 1,
+             i;
+   int       d, j;
+
+   *error = "not a binary table file";
+   if((size < sizeof(TABHEADER)) || !IsTableFile(data, size))
+      return(0);
+   *error = "unsupported table file version";
+   if(hdr->version != TABVERSION)
+      return(0);
+   *error = "table file was written on an incompatible machine";
+   if((hdr->byteOrder != TABBYTEORDER) || (hdr->intSize != sizeof(int)) ||
+      (hdr->realSize != sizeof(double)))
+      return(0);
+   *error = "table file is not aligned in memory";
+   if((size_t)data % 8)
+      return(0);
+
+   *error = "table file is corrupt";
+   if((hdr->nDims < 2) || (hdr->nDims > TABMAXDIMS) ||
+      (hdr->fileSize != size) || (hdr->nObs > (uint64_t)LONG_MAX))
+      return(0);
+
+   tf->header    = hdr;
+   tf->nDims     = (int)hdr->nDims;
+   tf->sparse    = ((hdr->flags & TABSPARSE) != 0);
+   tf->nObs      = hdr->nObs;
+   tf->nCells    = hdr->nCells;
+   tf->expecteds = NULL;
+   tf->cellIndex = NULL;
+
+   for(d=0; d<tf->nDims; d++)
+   {
+      /* Sizes are compared as uint64_t so nothing is truncated however
+         large the file, and anything stored in an int must fit
+      */
+      if(((uint64_t)hdr->nItems[d] > (uint64_t)size) ||
+         ((uint64_t)hdr->nItems[d] > (uint64_t)INT_MAX) ||
+         (hdr->labelTextSize[d] > (uint64_t)INT_MAX))
+         return(0);
+      tf->nItems[d] = (int)hdr->nItems[d];
+      if(hdr->nItems[d] && (nCells > (uint64_t)-1 / hdr->nItems[d]))
+         return(0);
+      nCells       *= hdr->nItems[d];
+
+      /* Labels - every offset must be within the text and the text must
+         end with a NUL
+      */
+      if(!InFile(hdr->labelOffsets[d],
+                 (uint64_t)hdr->nItems[d] * sizeof(int), size) ||
+         !InFile(hdr->labelText[d], hdr->labelTextSize[d], size))
+         return(0);
+      tf->labelOffsets[d]  = (int *)(data + hdr->labelOffsets[d]);
+      tf->labelText[d]     = data + hdr->labelText[d];
+      tf->labelTextSize[d] = (int)hdr->labelTextSize[d];
+      if(tf->nItems[d] &&
+         ((tf->labelTextSize[d] == 0) ||
+          tf->labelText[d][tf->labelTextSize[d]-1]))
+         return(0);
+      for(j=0; j<tf->nItems[d]; j++)
+      {
+         if((tf->labelOffsets[d][j] < 0) ||
+            (tf->labelOffsets[d][j] >= tf->labelTextSize[d]))
+            return(0);
+      }
+
+      /* Marginal totals                                                */
+      if(!InFile(hdr->margins[d],
+                 (uint64_t)hdr->nItems[d] * sizeof(int64_t), size))
+         return(0);
+      tf->margins[d] = (int64_t *)(data + hdr->margins[d]);
+   }
+
+   /* Counts                                                            */
+   if(tf->sparse)
+   {
+      if((tf->nCells > nCells) ||
+         (tf->nCells > (uint64_t)size) ||
+         !InFile(hdr->counts, tf->nCells * (sizeof(uint64_t) + sizeof(int)),
+                 size))
+         return(0);
+      tf->cellIndex = (uint64_t *)(data + hdr->counts);
+      tf->counts    = (int *)(data + hdr->counts +
+                              tf->nCells * sizeof(uint64_t));
+      for(i=0; i<tf->nCells; i++)
+      {
+         if((tf->cellIndex[i] >= nCells) ||
+            (i && (tf->cellIndex[i] <= tf->cellIndex[i-1])))
+            return(0);
+      }
+   }
+   else
+   {
+      if((tf->nCells != nCells) || (nCells > (uint64_t)size) ||
+         !InFile(hdr->counts, nCells * sizeof(int), size))
+         return(0);
+      tf->counts = (int *)(data + hdr->counts);
+   }
+
+   /* Expecteds                                                         */
+   if(hdr->flags & TABEXPECTEDS)
+   {
+      if((nCells > (uint64_t)size) ||
+         !InFile(hdr->expecteds, nCells * sizeof(double), size))
+         return(0);
+      tf->expecteds = (double *)(data + hdr->expecteds);
+   }
+
+   if(!CheckTotals(tf, error))
+      return(0);
+
+   *error = NULL;
+   return(1);
+}
+
+/************************************************************************/
+/*>static int CheckTotals(TABFILE *tf, const char **error)
+   -------------------------------------------------------
+   Input:   TABFILE    *tf     The table file
+   Output:  const char **error Reason for failure
+   Returns: int                Are the counts and totals consistent?
+
+   Checks that no count is negative, that the counts add up to the
+   stored marginal totals and that the totals for each dimension add up
+   to the number of observations
+
+   17.10.26 Original    By: ACRM
+*/
+static int CheckTotals(TABFILE *tf, const char **error)
+{
+   uint64_t *sums[TABMAXDIMS],
+            cell, index, total;
+   int      n[TABMAXDIMS],
+            pos[TABMAXDIMS],
+            d, i, count,
+            ok = 0;
+
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      n[d]    = ((d < tf->nDims) ? tf->nItems[d] : 1);
+      sums[d] = NULL;
+   }
+   for(d=0; d<tf->nDims; d++)
+   {
+      if((sums[d] = (uint64_t *)calloc(n[d] + 1, sizeof(uint64_t)))
+         == NULL)
+      {
+         *error = "no memory to check table file";
+         goto cleanup;
+      }
+   }
+
+   /* Add up the counts for each item of each dimension                */
+   *error = "table file has a negative count";
+   for(cell=0; cell<tf->nCells; cell++)
+   {
+      if((count = tf->counts[cell]) < 0)
+         goto cleanup;
+      if(count == 0)
+         continue;
+
+      index = (tf->sparse ? tf->cellIndex[cell] : cell);
+      for(d=TABMAXDIMS-1; d>=0; d--)
+      {
+         pos[d] = (int)(index % n[d]);
+         index /= n[d];
+      }
+      for(d=0; d<tf->nDims; d++)
+         sums[d][pos[d]] += count;
+   }
+
+   *error = "table file counts do not match its totals";
+   for(d=0; d<tf->nDims; d++)
+   {
+      for(i=0, total=0; i<n[d]; i++)
+      {
+         if((tf->margins[d][i] < 0) ||
+            (sums[d][i] != (uint64_t)tf->margins[d][i]))
+            goto cleanup;
+         total += sums[d][i];
+      }
+      if(total != tf->nObs)
+         goto cleanup;
+   }
+   ok = 1;
+
+cleanup:
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      if(sums[d] != NULL)
+         free(sums[d]);
+   }
+   return(ok);
+}
+
+/************************************************************************/
+/*>int WriteTableFile(FILE *fp, int nDims, int *nItems,
+                      LABELTABLE **labels, int *counts, size_t *stride,
+                      double *expecteds)
+   ------------------------------------------------------------------
+   Input:   FILE       *fp        File to write (opened in binary mode)
+            int        nDims      Number of dimensions (2 or 3)
+            int        *nItems    Number of items in each dimension
+            LABELTABLE **labels   Labels for each dimension
+            int        *counts    The counts
+            size_t     *stride    Distance between neighbouring cells of
+                                  counts (and expecteds) in each
+                                  dimension
+            double     *expecteds Expected values (NULL if none)
+   Returns: int                   Success?
+
+   Writes a table as a binary table file. The marginal totals are
+   calculated here.
+
+   17.10.26 Original    By: ACRM
+   17.10.26 The marginal totals are int64_t
+   17.10.26 The header and labels are done by LayOutFile() and
+            WriteLabels()
+*/
+int WriteTableFile(FILE *fp, int nDims, int *nItems, LABELTABLE **labels,
+                   int *counts, size_t *stride, double *expecteds)
+{
+   TABHEADER hdr;
+   int64_t   *margins[TABMAXDIMS];
+   int       n[TABMAXDIMS],
+             i, j, k, d, count,
+             ok = 0;
+   size_t    s[TABMAXDIMS],
+             cell;
+   uint64_t  pos, nCells = 1, nNonZero = 0, index;
+
+   /* Treat a 2-D table as 3-D with one plane                           */
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      n[d]       = ((d < nDims) ? nItems[d] : 1);
+      s[d]       = ((d < nDims) ? stride[d] : 0);
+      margins[d] = NULL;
+   }
+   for(d=0; d<nDims; d++)
+   {
+      nCells *= (uint64_t)n[d];
+      if((margins[d] = (int64_t *)calloc(n[d] + 1, sizeof(int64_t)))
+         == NULL)
+         goto cleanup;
+   }
+
+   /* Marginal totals and number of non-zero cells                      */
+   memset(&hdr, 0, sizeof(TABHEADER));
+   for(i=0; i<n[0]; i++)
+   {
+      for(j=0; j<n[1]; j++)
+      {
+         for(k=0; k<n[2]; k++)
+         {
+            count = counts[i*s[0] + j*s[1] + k*s[2]];
+            margins[0][i] += count;
+            margins[1][j] += count;
+            if(nDims > 2)
+               margins[2][k] += count;
+            hdr.nObs += count;
+            if(count)
+               nNonZero++;
+         }
+      }
+   }
+
+   /* Fill in the header and write it and the labels                    */
+   LayOutFile(&hdr, nDims, n, labels, nCells, nNonZero, (expecteds != NULL));
+   pos = 0;
+   if(!WriteLabels(fp, &pos, &hdr, nDims, labels))
+      goto cleanup;
+
+   if(hdr.flags & TABSPARSE)
+   {
+      /* Indexes and then counts of the non-zero cells                  */
+      for(index=0, i=0; i<n[0]; i++)
+         for(j=0; j<n[1]; j++)
+            for(k=0; k<n[2]; k++, index++)
+               if(counts[i*s[0] + j*s[1] + k*s[2]] &&
+                  (fwrite(&index, sizeof(uint64_t), 1, fp) != 1))
+                  goto cleanup;
+      pos += nNonZero * sizeof(uint64_t);
+      for(i=0; i<n[0]; i++)
+         for(j=0; j<n[1]; j++)
+            for(k=0; k<n[2]; k++)
+               if((count = counts[i*s[0] + j*s[1] + k*s[2]]) &&
+                  (fwrite(&count, sizeof(int), 1, fp) != 1))
+                  goto cleanup;
+      pos += nNonZero * sizeof(int);
+   }
+   else
+   {
+      for(i=0; i<n[0]; i++)
+         for(j=0; j<n[1]; j++)
+            for(k=0; k<n[2]; k++)
+               if(fwrite(&counts[i*s[0] + j*s[1] + k*s[2]], sizeof(int), 1,
+                         fp) != 1)
+                  goto cleanup;
+      pos += nCells * sizeof(int);
+   }
+   if(!WritePadding(fp, &pos))
+      goto cleanup;
+
+   if(expecteds != NULL)
+   {
+      for(i=0; i<n[0]; i++)
+         for(j=0; j<n[1]; j++)
+            for(k=0; k<n[2]; k++)
+            {
+               cell = i*s[0] + j*s[1] + k*s[2];
+               if(fwrite(&expecteds[cell], sizeof(double), 1, fp) != 1)
+                  goto cleanup;
+            }
+      pos += nCells * sizeof(double);
+   }
+
+   for(d=0; d<nDims; d++)
+   {
+      if(!WriteSection(fp, &pos, margins[d], n[d] * sizeof(int64_t)))
+         goto cleanup;
+   }
+
+   ok = (pos == hdr.fileSize);
+
+cleanup:
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      if(margins[d] != NULL)
+         free(margins[d]);
+   }
+   return(ok);
+}
+
+/************************************************************************/
+/*>int WriteSparseTableFile(FILE *fp, int nDims, int *nItems,
+                            LABELTABLE **labels, uint64_t nStored,
+                            uint64_t *cellIndex, int *counts,
+                            double *expecteds)
+   ---------------------------------------------------------------
+   Input:   FILE       *fp        File to write (opened in binary mode)
+            int        nDims      Number of dimensions (2 or 3)
+            int        *nItems    Number of items in each dimension
+            LABELTABLE **labels   Labels for each dimension
+            uint64_t   nStored    Number of cells given
+            uint64_t   *cellIndex Row-major index of each cell, in
+                                  increasing order
+            int        *counts    Count for each cell
+            double     *expecteds Expected for each cell (NULL if none)
+   Returns: int                   Success?
+
+   Writes a table held as a list of cells (any not given are empty) as
+   a binary table file, for sparse tables that never have a dense
+   array. The file is the same as WriteTableFile() would write for the
+   same table: the counts are sparse if that is smaller and dense
+   otherwise, and the expecteds section is always dense, so the gaps
+   between the cells given are written as zeros.
+
+   17.10.26 Original    By: ACRM
+*/
+int WriteSparseTableFile(FILE *fp, int nDims, int *nItems,
+                         LABELTABLE **labels, uint64_t nStored,
+                         uint64_t *cellIndex, int *counts,
+                         double *expecteds)
+{
+   TABHEADER hdr;
+   int64_t   *margins[TABMAXDIMS];
+   int       n[TABMAXDIMS],
+             d,
+             ok = 0;
+   uint64_t  pos, nCells = 1, nNonZero = 0, cell, next, index;
+
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      n[d]       = ((d < nDims) ? nItems[d] : 1);
+      margins[d] = NULL;
+   }
+   for(d=0; d<nDims; d++)
+   {
+      nCells *= (uint64_t)n[d];
+      if((margins[d] = (int64_t *)calloc(n[d] + 1, sizeof(int64_t)))
+         == NULL)
+         goto cleanup;
+   }
+
+   /* Marginal totals and number of non-zero cells                      */
+   memset(&hdr, 0, sizeof(TABHEADER));
+   for(cell=0; cell<nStored; cell++)
+   {
+      if(counts[cell] == 0)
+         continue;
+      index = cellIndex[cell];
+      for(d=nDims-1; d>=0; d--)
+      {
+         margins[d][index % n[d]] += counts[cell];
+         index /= n[d];
+      }
+      hdr.nObs += counts[cell];
+      nNonZero++;
+   }
+
+   LayOutFile(&hdr, nDims, n, labels, nCells, nNonZero, (expecteds != NULL));
+   pos = 0;
+   if(!WriteLabels(fp, &pos, &hdr, nDims, labels))
+      goto cleanup;
+
+   if(hdr.flags & TABSPARSE)
+   {
+      for(cell=0; cell<nStored; cell++)
+         if(counts[cell] &&
+            (fwrite(&cellIndex[cell], sizeof(uint64_t), 1, fp) != 1))
+            goto cleanup;
+      pos += nNonZero * sizeof(uint64_t);
+      for(cell=0; cell<nStored; cell++)
+         if(counts[cell] &&
+            (fwrite(&counts[cell], sizeof(int), 1, fp) != 1))
+            goto cleanup;
+      pos += nNonZero * sizeof(int);
+   }
+   else
+   {
+      for(cell=0, next=0; cell<nStored; cell++)
+      {
+         if(!WriteZeros(fp, cellIndex[cell] - next, sizeof(int)) ||
+            (fwrite(&counts[cell], sizeof(int), 1, fp) != 1))
+            goto cleanup;
+         next = cellIndex[cell] + 1;
+      }
+      if(!WriteZeros(fp, nCells - next, sizeof(int)))
+         goto cleanup;
+      pos += nCells * sizeof(int);
+   }
+   if(!WritePadding(fp, &pos))
+      goto cleanup;
+
+   if(expecteds != NULL)
+   {
+      for(cell=0, next=0; cell<nStored; cell++)
+      {
+         if(!WriteZeros(fp, cellIndex[cell] - next, sizeof(double)) ||
+            (fwrite(&expecteds[cell], sizeof(double), 1, fp) != 1))
+            goto cleanup;
+         next = cellIndex[cell] + 1;
+      }
+      if(!WriteZeros(fp, nCells - next, sizeof(double)))
+         goto cleanup;
+      pos += nCells * sizeof(double);
+   }
+
+   for(d=0; d<nDims; d++)
+   {
+      if(!WriteSection(fp, &pos, margins[d], n[d] * sizeof(int64_t)))
+         goto cleanup;
+   }
+
+   ok = (pos == hdr.fileSize);
+
+cleanup:
+   for(d=0; d<TABMAXDIMS; d++)
+   {
+      if(margins[d] != NULL)
+         free(margins[d]);
+   }
+   return(ok);
+}
+
+/************************************************************************/
+/*>static void LayOutFile(TABHEADER *hdr, int nDims, int *n,
+                          LABELTABLE **labels, uint64_t nCells,
+                          uint64_t nNonZero, int gotExpecteds)
+   -------------------------------------------------------------
+   I/O:     TABHEADER  *hdr          Header (nObs already set)
+   Input:   int        nDims         Number of dimensions
+            int        *n            Number of items in each dimension
+            LABELTABLE **labels      Labels for each dimension
+            uint64_t   nCells        Cells in the whole table
+            uint64_t   nNonZero      ...with a count
+            int        gotExpecteds  Expecteds will be written
+
+   Fills in the rest of the header and works out where the sections go.
+   The counts are sparse if that is smaller.
+
+   17.10.26 Original    By: ACRM (from WriteTableFile())
+*/
+static void LayOutFile(TABHEADER *hdr, int nDims, int *n,
+                       LABELTABLE **labels, uint64_t nCells,
+                       uint64_t nNonZero, int gotExpecteds)
+{
+   uint64_t pos;
+   int      d;
+
+   memcpy(hdr->magic, TABMAGIC, 8);
+   hdr->version   = TABVERSION;
+   hdr->byteOrder = TABBYTEORDER;
+   hdr->intSize   = sizeof(int);
+   hdr->realSize  = sizeof(double);
+   hdr->nDims     = nDims;
+   hdr->flags     = gotExpecteds ? TABEXPECTEDS : 0;
+   if(nNonZero * (sizeof(uint64_t) + sizeof(int)) < nCells * sizeof(int))
+   {
+      hdr->flags |= TABSPARSE;
+      hdr->nCells = nNonZero;
+   }
+   else
+   {
+      hdr->nCells = nCells;
+   }
+
+   pos = ALIGN8(sizeof(TABHEADER));
+   for(d=0; d<nDims; d++)
+   {
+      hdr->nItems[d]        = n[d];
+      hdr->labelOffsets[d]  = pos;
+      pos                   = ALIGN8(pos + n[d] * sizeof(int));
+      hdr->labelText[d]     = pos;
+      hdr->labelTextSize[d] = labels[d]->arenaUsed;
+      pos                   = ALIGN8(pos + hdr->labelTextSize[d]);
+   }
+   hdr->counts = pos;
+   if(hdr->flags & TABSPARSE)
+      pos = ALIGN8(pos + nNonZero * (sizeof(uint64_t) + sizeof(int)));
+   else
+      pos = ALIGN8(pos + nCells * sizeof(int));
+   if(gotExpecteds)
+   {
+      hdr->expecteds = pos;
+      pos            = ALIGN8(pos + nCells * sizeof(double));
+   }
+   for(d=0; d<nDims; d++)
+   {
+      hdr->margins[d] = pos;
+      pos             = ALIGN8(pos + n[d] * sizeof(int64_t));
+   }
+   hdr->fileSize = pos;
+}
+
+/************************************************************************/
+/*>static int WriteLabels(FILE *fp, uint64_t *pos, TABHEADER *hdr,
+                          int nDims, LABELTABLE **labels)
+   ---------------------------------------------------------------
+   Input:   FILE       *fp       File being written
+   I/O:     uint64_t   *pos      Position in the file
+   Input:   TABHEADER  *hdr      Header
+            int        nDims     Number of dimensions
+            LABELTABLE **labels  Labels for each dimension
+   Returns: int                  Success?
+
+   Writes the header and the labels for each dimension
+
+   17.10.26 Original    By: ACRM (from WriteTableFile())
+*/
+static int WriteLabels(FILE *fp, uint64_t *pos, TABHEADER *hdr,
+                       int nDims, LABELTABLE **labels)
+{
+   int d;
+
+   if(!WriteSection(fp, pos, hdr, sizeof(TABHEADER)))
+      return(0);
+   for(d=0; d<nDims; d++)
+   {
+      if(!WriteSection(fp, pos, labels[d]->offset,
+                       hdr->nItems[d] * sizeof(int)) ||
+         !WriteSection(fp, pos, labels[d]->arena,
+                       labels[d]->arenaUsed))
+         return(0);
+   }
+   return(1);
+}
+
+/************************************************************************/
+/*>static int WriteZeros(FILE *fp, uint64_t n, size_t size)
+   --------------------------------------------------------
+   Input:   FILE     *fp     File being written
+            uint64_t n       Number of values
+            size_t   size    Size of each
+   Returns: int              Success?
+
+   Writes n zero values of the given size (up to 8 bytes)
+
+   17.10.26 Original    By: ACRM
+*/
+static int WriteZeros(FILE *fp, uint64_t n, size_t size)
+{
+   static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+   for(; n; n--)
+   {
+      if(fwrite(zeros, size, 1, fp) != 1)
+         return(0);
+   }
+   return(1);
+}
+
+/************************************************************************/
+/*>static int InFile(uint64_t offset, uint64_t length, size_t size)
+   ----------------------------------------------------------------
+   Input:   uint64_t offset  Start of a section
+            uint64_t length  Length of the section
+            size_t   size    Size of the file
+   Returns: int              Is the section aligned and within the file?
+
+   17.10.26 Original    By: ACRM
+*/
+static int InFile(uint64_t offset, uint64_t length, size_t size)
+{
+   return(!(offset % 8) && (offset <= (uint64_t)size) &&
+          (length <= (uint64_t)size - offset));
+}
+
+/************************************************************************/
+/*>static int WriteSection(FILE *fp, uint64_t *pos, void *data,
+                           size_t size)
+   ------------------------------------------------------------
+   I/O:     FILE     *fp     File being written
+            uint64_t *pos    Position in the file
+   Input:   void     *data   Data to write
+            size_t   size    Size of the data
+   Returns: int              Success?
+
+   Writes a section and pads it to an 8-byte boundary
+
+   17.10.26 Original    By: ACRM
+*/
+static int WriteSection(FILE *fp, uint64_t *pos, void *data, size_t size)
+{
+   if(size && (fwrite(data, 1, size, fp) != size))
+      return(0);
+   *pos += size;
+   return(WritePadding(fp, pos));
+}
+
+/************************************************************************/
+/*>static int WritePadding(FILE *fp, uint64_t *pos)
+   ------------------------------------------------
+   I/O:     FILE     *fp     File being written
+            uint64_t *pos    Position in the file
+
+   Writes zeros up to the next 8-byte boundary
+
+   17.10.26 Original    By: ACRM
+*/
+static int WritePadding(FILE *fp, uint64_t *pos)
+{
+   while(*pos % 8)
+   {
+      if(fputc(0, fp) == EOF)
+         return(0);
+      (*pos)++;
+   }
+   return(1);
+}
@@ -0,0 +1,123 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       tabfile.h
+
+   Version:    V1.2
+   Date:       17.10.26
+   Function:   Include file for binary contingency table files
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+   V1.1  17.10.26 The marginal totals are int64_t (file version 2)
+   V1.2  17.10.26 Added WriteSparseTableFile()
+
+*************************************************************************/
+#ifndef _TABFILE_H
+#define _TABFILE_H
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines
+*/
+#define TABMAGIC     "CHISQTAB"     /* First 8 bytes of the file        */
+#define TABVERSION   2
+#define TABBYTEORDER 0x01020304     /* Written in the native order      */
+#define TABMAXDIMS   3
+
+#define TABEXPECTEDS 0x01           /* Expected values are stored       */
+#define TABSPARSE    0x02           /* Counts are stored as index/count
+                                       pairs for the non-zero cells     */
+
+/************************************************************************/
+/* Types
+*/
+/* The file starts with this header. The other sections follow, each
+   starting on an 8-byte boundary:
+      labels    for each dimension, int offsets[nItems] and the label
+                text, each label NUL terminated
+      counts    dense: int[nItems[0] x ... ] in row-major order
+                sparse: uint64_t index[nCells] then int count[nCells]
+      expecteds double[nItems[0] x ... ] (if TABEXPECTEDS)
+      margins   for each dimension, int64_t totals[nItems]
+*/
+typedef struct
+{
+   char     magic[8];
+   uint32_t version,
+            byteOrder,
+            intSize,                  /* sizeof(int) when written       */
+            realSize,                 /* sizeof(double) when written    */
+            nDims,
+            flags,
+            nItems[TABMAXDIMS],
+            pad;
+   uint64_t nObs,
+            nCells,                   /* Cells in the counts section    */
+            labelOffsets[TABMAXDIMS], /* File offsets of the sections   */
+            labelText[TABMAXDIMS],
+            labelTextSize[TABMAXDIMS],
+            counts,
+            expecteds,
+            margins[TABMAXDIMS],
+            fileSize;
+}  TABHEADER;
+
+/* A table file that has been mapped into memory. All pointers are into
+   the mapping
+*/
+typedef struct
+{
+   TABHEADER *header;
+   int       nDims,
+             nItems[TABMAXDIMS],
+             sparse,
+             *labelOffsets[TABMAXDIMS],
+             labelTextSize[TABMAXDIMS],
+             *counts;                 /* Dense counts, or sparse counts */
+   int64_t   *margins[TABMAXDIMS];
+   uint64_t  *cellIndex,              /* Sparse cell indexes            */
+             nCells,
+             nObs;
+   char      *labelText[TABMAXDIMS];
+   double    *expecteds;              /* NULL if none                   */
+}  TABFILE;
+
+/************************************************************************/
+/* Prototypes
+*/
+int  IsTableFile(char *data, size_t size);
+int  OpenTableFile(TABFILE *tf, char *data, size_t size,
+                  const char **error);
+int  WriteTableFile(FILE *fp, int nDims, int *nItems, LABELTABLE **labels,
+                    int *counts, size_t *stride, double *expecteds);
+int  WriteSparseTableFile(FILE *fp, int nDims, int *nItems,
+                          LABELTABLE **labels, uint64_t nStored,
+                          uint64_t *cellIndex, int *counts,
+                          double *expecteds);
+
+#endif
@@ -0,0 +1,272 @@
+/*************************************************************************
+
+   Program:    chisq / chisq3
+   File:       workpool.c
+
+   Version:    V1.0
+   Date:       17.10.26
+   Function:   Work-stealing thread pool for the chi squared programs
+
+   Copyright:  (c) Dr. Andrew C. R. Martin, 2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    Biomolecular Structure and Modelling,
+               University College London,
+   EMail:      andrew@bioinf.org.uk
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Runs a set of independent tasks, numbered 0..nTasks-1, on a pool of
+   threads. Each thread starts with a contiguous share of the tasks and
+   works through it from the bottom. A thread that runs out steals the
+   top half of the largest remaining share, so a few large tasks do not
+   leave the other threads idle.
+
+   The task numbers let the caller keep results in input order however
+   the tasks end up being scheduled.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  17.10.26 Original
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "workpool.h"
+
+/************************************************************************/
+/* Types
+*/
+typedef struct
+{
+   pthread_mutex_t lock;
+   int             lo,        /* Next task to run                       */
+                   hi;        /* One beyond the last task               */
+}  WORKQUEUE;
+
+typedef struct _workpool WORKPOOL;
+
+typedef struct
+{
+   WORKPOOL *pool;
+   int      thread;
+}  WORKER;
+
+struct _workpool
+{
+   WORKQUEUE *queues;
+   WORKER    *workers;
+   WORKFUNC  func;
+   void      *data;
+   int       nThreads;
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+static void *RunWorker(void *arg);
+static int  NextTask(WORKPOOL *pool, int thread);
+
+/************************************************************************/
+/*>int RunWorkPool(int nThreads, int nTasks, WORKFUNC func, void *data)
+   --------------------------------------------------------------------
+   Input:   int      nThreads   Number of threads to use
+            int      nTasks     Number of tasks
+            WORKFUNC func       Function to run each task
+            void     *data      Passed to func
+   Returns: int                 Success?
+
+   Runs func(data, task, thread) for every task and waits for them all
+   to finish. The calling thread acts as thread 0. If threads cannot be
+   created, the remaining work is done by the threads that were.
+
+   17.10.26 Original    By: ACRM
+*/
+int RunWorkPool(int nThreads, int nTasks, WORKFUNC func, void *data)
+{
+   WORKPOOL  pool;
+   pthread_t *threads;
+   int       i, nStarted;
+
+   if(nThreads > nTasks)
+      nThreads = nTasks;
+   if(nThreads < 1)
+      nThreads = 1;
+
+   pool.func     = func;
+   pool.data     = data;
+   pool.nThreads = nThreads;
+   pool.queues   = (WORKQUEUE *)malloc(nThreads * sizeof(WORKQUEUE));
+   pool.workers  = (WORKER *)malloc(nThreads * sizeof(WORKER));
+   threads       = (pthread_t *)malloc(nThreads * sizeof(pthread_t));
+
+   if((pool.queues == NULL) || (pool.workers == NULL) || (threads == NULL))
+   {
+      if(pool.queues  != NULL) free(pool.queues);
+      if(pool.workers != NULL) free(pool.workers);
+      if(threads      != NULL) free(threads);
+      return(0);
+   }
+
+   /* Give each thread an equal contiguous share of the tasks           */
+   for(i=0; i<nThreads; i++)
+   {
+      pthread_mutex_init(&(pool.queues[i].lock), NULL);
+      pool.queues[i].lo      = (int)(((long)nTasks * i) / nThreads);
+      pool.queues[i].hi      = (int)(((long)nTasks * (i+1)) / nThreads);
+      pool.workers[i].pool   = &pool;
+      pool.workers[i].thread = i;
+   }
+
+   /* Start the other threads and do our own share                      */
+   for(nStarted=1; nStarted<nThreads; nStarted++)
+   {
+      if(pthread_create(&(threads[nStarted]), NULL, RunWorker,
+                        (void *)&(pool.workers[nStarted])))
+         break;
+   }
+   RunWorker((void *)&(pool.workers[0]));
+
+   for(i=1; i<nStarted; i++)
+      pthread_join(threads[i], NULL);
+
+   /* Any thread that could not be started had its share stolen, but
+      mop up anything left to be certain
+   */
+   for(i=nStarted; i<nThreads; i++)
+   {
+      while(pool.queues[i].lo < pool.queues[i].hi)
+         (*func)(data, pool.queues[i].lo++, 0);
+   }
+
+   for(i=0; i<nThreads; i++)
+      pthread_mutex_destroy(&(pool.queues[i].lock));
+   free(pool.queues);
+   free(pool.workers);
+   free(threads);
+
+   return(1);
+}
+
+/************************************************************************/
+/*>int NumProcessors(void)
+   -----------------------
+   Returns: int     Number of online processors (at least 1)
+
+   17.10.26 Original    By: ACRM
+*/
+int NumProcessors(void)
+{
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return((n < 1) ? 1 : (int)n);
+}
+
+/************************************************************************/
+/*>static void *RunWorker(void *arg)
+   ---------------------------------
+   Input:   void   *arg      The WORKER for this thread
+   Returns: void *           NULL
+
+   Thread body - runs tasks until there are none left to take or steal
+
+   17.10.26 Original    By: ACRM
+*/
+static void *RunWorker(void *arg)
+{
+   WORKER *worker = (WORKER *)arg;
+   int    task;
+
+   while((task = NextTask(worker->pool, worker->thread)) >= 0)
+      (*worker->pool->func)(worker->pool->data, task, worker->thread);
+
+   return(NULL);
+}
+
+/************************************************************************/
+/*>static int NextTask(WORKPOOL *pool, int thread)
+   -----------------------------------------------
+   Input:   WORKPOOL *pool      The pool
+            int      thread     The thread wanting work
+   Returns: int                 Task to run (-1 if none left)
+
+   Takes the next task from the thread's own queue. If that is empty,
+   steals the top half of the fullest other queue.
+
+   17.10.26 Original    By: ACRM
+*/
+static int NextTask(WORKPOOL *pool, int thread)
+{
+   WORKQUEUE *own = &(pool->queues[thread]),
+             *victim;
+   int       task = -1,
+             i, best, bestSize, size, nSteal;
+
+   pthread_mutex_lock(&(own->lock));
+   if(own->lo < own->hi)
+      task = own->lo++;
+   pthread_mutex_unlock(&(own->lock));
+   if(task >= 0)
+      return(task);
+
+   for(;;)
+   {
+      /* Find the queue with most work left                             */
+      best     = -1;
+      bestSize = 0;
+      for(i=0; i<pool->nThreads; i++)
+      {
+         if(i != thread)
+         {
+            pthread_mutex_lock(&(pool->queues[i].lock));
+            size = pool->queues[i].hi - pool->queues[i].lo;
+            pthread_mutex_unlock(&(pool->queues[i].lock));
+            if(size > bestSize)
+            {
+               best     = i;
+               bestSize = size;
+            }
+         }
+      }
+      if(best < 0)
+         return(-1);
+
+      /* Steal the top half of it (the size may have changed)           */
+      victim = &(pool->queues[best]);
+      pthread_mutex_lock(&(victim->lock));
+      size = victim->hi - victim->lo;
+      if(size > 0)
+      {
+         nSteal     = (size + 1) / 2;
+         victim->hi -= nSteal;
+         task       = victim->hi;
+         pthread_mutex_unlock(&(victim->lock));
+
+         pthread_mutex_lock(&(own->lock));
+         own->lo = task + 1;
+         own->hi = task + nSteal;
+         pthread_mutex_unlock(&(own->lock));
+         return(task);
+      }
+      pthread_mutex_unlock(&(victim->lock));
+   }
+}